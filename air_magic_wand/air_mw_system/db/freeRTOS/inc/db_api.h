@@ -131,6 +131,37 @@
 #define DB_MSG_HEADER_SIZE    (sizeof(DB_MSG_T) - DB_MSG_PTR_SIZE)     /*size of message header, includes cq_name+method+type.count or type.result */
 #define DB_MSG_PAYLOAD_SIZE   (sizeof(DB_PAYLOAD_T) - DB_MSG_PTR_SIZE) /*size of payload header, includes t_idx+f_idx+e_idx+data_size */
 
+/* The message buffer pool, each class is a fixed-size slab of DB messages.
+ * A request larger than the biggest class, or a class that runs empty,
+ * falls back to the heap.
+ * DB task releases the requests by osapi_free, so the pool stays off until
+ * it releases them by dbapi_freeMsg(); every request is allocated from heap.
+ */
+#ifndef DB_MSG_POOL_SUPPORT
+#define DB_MSG_POOL_SUPPORT   (0)
+#endif
+#define DB_MSG_POOL_CLASS_NUM (4)
+#define DB_MSG_POOL_S_SIZE    (32)      /* one field of a table */
+#define DB_MSG_POOL_S_NUM     (24)
+#define DB_MSG_POOL_M_SIZE    (96)      /* one entry of a table */
+#define DB_MSG_POOL_M_NUM     (16)
+#define DB_MSG_POOL_L_SIZE    (256)     /* one field of all entries */
+#define DB_MSG_POOL_L_NUM     (8)
+#define DB_MSG_POOL_XL_SIZE   (1024)    /* small tables */
+#define DB_MSG_POOL_XL_NUM    (4)
+
+/* The event loop of DB client daemons, see dbapi_eventWait */
+#define DB_EVENT_NONE         (0)
+#define DB_EVENT_WAIT_FOREVER (0xFFFFFFFFUL)
+
+/* The asynchronous get requests, completed from the client's receive loop */
+#define DB_ASYNC_PENDING_NUM  (8)       /* outstanding requests of all clients */
+#define DB_ASYNC_TIMEOUT      (5000)    /* ticks before a request is expired */
+
+/* The paged iteration of tables, see dbapi_cursorOpen */
+#define DB_CURSOR_PAGE_MAX    (32)      /* entries fetched by one M_GET */
+#define DB_CURSOR_TIMEOUT     (1000)    /* ticks to wait for a page */
+
 /* The config name buffer size */
 #define DB_MAX_KEY_SIZE     (10)    /* maximum size of key name */
 #define DB_ALL_KEY          "all"   /* represent DB_ALL_FIELDS */
@@ -170,6 +201,16 @@
 #endif
 /* MACRO FUNCTION DECLARATIONS
  */
+/* Release a DB message which may come from the message pool or the heap */
+#define DB_MSG_FREE(__ptr__)                            \
+    do                                                  \
+    {                                                   \
+        if (NULL != (__ptr__))                          \
+        {                                               \
+            dbapi_freeMsg((DB_MSG_T *)(__ptr__));       \
+            (__ptr__) = NULL;                           \
+        }                                               \
+    } while (0)
 
 /* DATA TYPE DECLARATIONS
  */
@@ -486,6 +527,53 @@ typedef struct DB_MSG_S
     DB_PAYLOAD_T    *ptr_payload;  /* The payload body, not a real pointer  */
 } ATTRIBUTE_PACK DB_MSG_T;
 
+/* The completion callback of dbapi_getDataAsync.
+ * When result is MW_E_OK the callback owns ptr_msg and must release it by
+ * dbapi_freeMsg(), ptr_data points to the raw data within ptr_msg.
+ * Otherwise ptr_msg and ptr_data are NULL.
+ */
+typedef void (*DB_ASYNC_CB_T)(
+    const MW_ERROR_NO_T result,
+    DB_MSG_T *ptr_msg,
+    void *ptr_data,
+    const UI16_T data_size,
+    void *ptr_arg);
+
+/* The event loop of a DB client, a queue set of its DB queue and a doorbell */
+typedef struct DB_EVENT_LOOP_S
+{
+    void            *ptr_set;
+    void            *ptr_db_queue;
+    void            *ptr_doorbell;
+    volatile UI32_T events;                     /* The posted event bits */
+} DB_EVENT_LOOP_T;
+
+/* The entry filter of a cursor, returns TRUE to keep the entry */
+typedef BOOL_T (*DB_CURSOR_FILTER_T)(
+    const UI16_T pos,
+    const UI16_T data_size,
+    const void *ptr_data,
+    void *ptr_arg);
+
+/* A cursor on the entries of a table, see dbapi_cursorOpen */
+typedef struct DB_CURSOR_S
+{
+    C8_T                cq_name[DB_Q_NAME_SIZE];    /* The private queue of the replies */
+    UI8_T               t_idx;
+    UI8_T               f_idx;
+    UI8_T               page_num;       /* The entries requested at a time */
+    UI8_T               remain;         /* The unread entries of ptr_page */
+    UI16_T              e_idx;          /* The next entry to request */
+    UI16_T              e_last;         /* The last entry of the table, or of the FDB batch */
+    UI16_T              count;          /* The entries read, the position in the FDB walk */
+    UI8_T               fdb_result;     /* The result of the last FDB walk action */
+    BOOL_T              timed_out;      /* A reply is late, the next one cannot be trusted */
+    DB_MSG_T            *ptr_page;      /* The response of the last page */
+    UI8_T               *ptr_next;      /* The next payload in ptr_page */
+    DB_CURSOR_FILTER_T  filter;
+    void                *ptr_arg;
+} DB_CURSOR_T;
+
 /* The structure declartion of each tables */
 /* Below tables will not keep in configuration file */
 /* The system operational information table */
@@ -759,6 +847,48 @@ MW_ERROR_NO_T
 dbapi_dbisReady(
     void);
 
+/* FUNCTION NAME: dbapi_waitReady
+ * PURPOSE:
+ *      Wait until DB is ready.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      ptr_wait_ticks  -- The ticks waited, NULL if not needed
+ *
+ * RETURN:
+ *      MW_E_OK
+ *
+ * NOTES:
+ *      The caller sleeps between the polls, so DB task is not starved by
+ *      the daemons waiting for it.
+ */
+MW_ERROR_NO_T
+dbapi_waitReady(
+    UI32_T *ptr_wait_ticks);
+
+/* FUNCTION NAME: dbapi_getReadyTick
+ * PURPOSE:
+ *      Get the tick DB is first seen ready since boot.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      The tick, 0 if no task has waited DB ready yet
+ *
+ * NOTES:
+ *      It is the time-to-DB-ready of the boot, within one poll period of
+ *      dbapi_waitReady.
+ */
+UI32_T
+dbapi_getReadyTick(
+    void);
+
 /* FUNCTION NAME: dbapi_getDataSize
  * PURPOSE:
  *      Get the buffer size of the request type
@@ -1464,4 +1594,356 @@ dbapi_parseMsg(
     UI16_T *ptr_data_size,
     UI8_T **pptr_data,
     UI8_T **pptr_payload_data);
+
+/* FUNCTION NAME: dbapi_allocMsg
+ * PURPOSE:
+ *      Allocate a zeroed DB message buffer from the message pool.
+ *
+ * INPUT:
+ *      msg_size        -- The total size of the message, includes the
+ *                         message header, payload header and raw data
+ *
+ * OUTPUT:
+ *      pptr_msg        -- A double pointer returns the message buffer
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      The smallest class which fits msg_size is used. If the size is larger
+ *      than DB_MSG_POOL_XL_SIZE or the class is empty, the buffer is allocated
+ *      from heap. Either way it must be released by dbapi_freeMsg(), and must
+ *      not be passed to dbapi_appendMsgPayload() which may reallocate it.
+ *      Without DB_MSG_POOL_SUPPORT the buffer always comes from heap, which
+ *      is required for a request sent to DB task.
+ */
+MW_ERROR_NO_T
+dbapi_allocMsg(
+    const UI32_T msg_size,
+    DB_MSG_T **pptr_msg);
+
+/* FUNCTION NAME: dbapi_freeMsg
+ * PURPOSE:
+ *      Release a DB message buffer.
+ *
+ * INPUT:
+ *      ptr_msg         -- A pointer to the message to be released
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The buffer is returned to its pool class if it belongs to the message
+ *      pool, otherwise it is freed to heap. It is safe for any DB message.
+ */
+void
+dbapi_freeMsg(
+    DB_MSG_T *ptr_msg);
+
+/* FUNCTION NAME: dbapi_getDataAsync
+ * PURPOSE:
+ *      Send a get request to DB without waiting for the response.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the queue which receives the response
+ *      request         -- The table, field and entry to get
+ *      callback        -- The completion callback
+ *      ptr_arg         -- The argument passed to the callback
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_TABLE_FULL
+ *      MW_E_NO_MEMORY
+ *      MW_E_OP_INCOMPLETE
+ *
+ * NOTES:
+ *      The callback runs in the task which receives client_qname, when that
+ *      task passes the response to dbapi_completeAsync(). It is called exactly
+ *      once unless this function fails. The response is matched by the T/F/E
+ *      in request order, so the client must not send other M_GET requests on
+ *      client_qname.
+ */
+MW_ERROR_NO_T
+dbapi_getDataAsync(
+    const C8_T *client_qname,
+    const DB_REQUEST_TYPE_T request,
+    DB_ASYNC_CB_T callback,
+    void *ptr_arg);
+
+/* FUNCTION NAME: dbapi_completeAsync
+ * PURPOSE:
+ *      Complete the asynchronous request a received message responds to.
+ *
+ * INPUT:
+ *      ptr_msg         -- The message received from the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK                 -- The message is consumed by the callback
+ *      MW_E_ENTRY_NOT_FOUND    -- The message is not an asynchronous response,
+ *                                 the caller keeps the ownership
+ *
+ * NOTES:
+ *
+ */
+MW_ERROR_NO_T
+dbapi_completeAsync(
+    DB_MSG_T *ptr_msg);
+
+/* FUNCTION NAME: dbapi_expireAsync
+ * PURPOSE:
+ *      Fail the asynchronous requests of a client which wait too long.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The callbacks are called with MW_E_TIMEOUT after DB_ASYNC_TIMEOUT.
+ *      The client calls it from its receive loop when the queue is idle.
+ */
+void
+dbapi_expireAsync(
+    const C8_T *client_qname);
+
+/* FUNCTION NAME: dbapi_cancelAsync
+ * PURPOSE:
+ *      Fail all asynchronous requests of a client.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The callbacks are called with MW_E_OP_INCOMPLETE. Call it before the
+ *      client's queue is deleted.
+ */
+void
+dbapi_cancelAsync(
+    const C8_T *client_qname);
+
+/* FUNCTION NAME: dbapi_hasPendingAsync
+ * PURPOSE:
+ *      Check whether a client has asynchronous requests waiting.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      TRUE if any request of the client waits for its response
+ *
+ * NOTES:
+ *
+ */
+BOOL_T
+dbapi_hasPendingAsync(
+    const C8_T *client_qname);
+
+/* FUNCTION NAME: dbapi_eventCreate
+ * PURPOSE:
+ *      Create the event loop of a DB client.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's DB queue
+ *      queue_len       -- The length of the client's DB queue
+ *
+ * OUTPUT:
+ *      ptr_loop        -- The event loop
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_ENTRY_NOT_FOUND
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      Called right after the DB queue is created, while it is empty.
+ */
+MW_ERROR_NO_T
+dbapi_eventCreate(
+    const C8_T *client_qname,
+    const UI32_T queue_len,
+    DB_EVENT_LOOP_T *ptr_loop);
+
+/* FUNCTION NAME: dbapi_eventDelete
+ * PURPOSE:
+ *      Delete the event loop of a DB client.
+ *
+ * INPUT:
+ *      ptr_loop        -- The event loop
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The messages left in the DB queue are freed, the queue itself is kept.
+ */
+void
+dbapi_eventDelete(
+    DB_EVENT_LOOP_T *ptr_loop);
+
+/* FUNCTION NAME: dbapi_eventPost
+ * PURPOSE:
+ *      Post events to the event loop of a DB client.
+ *
+ * INPUT:
+ *      ptr_loop        -- The event loop
+ *      events          -- The event bits, defined by the client
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *
+ * NOTES:
+ *      It does not block. A bit posted again before the client collects it
+ *      is delivered once.
+ */
+MW_ERROR_NO_T
+dbapi_eventPost(
+    DB_EVENT_LOOP_T *ptr_loop,
+    const UI32_T events);
+
+/* FUNCTION NAME: dbapi_eventWait
+ * PURPOSE:
+ *      Wait for a DB message or posted events.
+ *
+ * INPUT:
+ *      ptr_loop        -- The event loop
+ *      timeout         -- The ticks to wait, DB_EVENT_WAIT_FOREVER to block
+ *
+ * OUTPUT:
+ *      pptr_msg        -- The received DB message, NULL if none
+ *      ptr_events      -- The posted event bits, DB_EVENT_NONE if none
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *      MW_E_TIMEOUT
+ *
+ * NOTES:
+ *      Either a message or events are returned. The caller frees the message.
+ */
+MW_ERROR_NO_T
+dbapi_eventWait(
+    DB_EVENT_LOOP_T *ptr_loop,
+    const UI32_T timeout,
+    DB_MSG_T **pptr_msg,
+    UI32_T *ptr_events);
+
+/* FUNCTION NAME: dbapi_cursorOpen
+ * PURPOSE:
+ *      Open a cursor on the entries of a DB table.
+ *
+ * INPUT:
+ *      t_idx           -- The table index
+ *      f_idx           -- The field index, DB_ALL_FIELDS for the whole entry
+ *      page_num        -- The entries fetched from DB at a time
+ *      filter          -- The entry filter, NULL to return all entries
+ *      ptr_arg         -- The argument passed to filter
+ *
+ * OUTPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      DYNAMIC_MAC_ADDRESS_ENTRY is read through the hardware FDB walk of DB.
+ *      The cursor must be closed by dbapi_cursorClose().
+ */
+MW_ERROR_NO_T
+dbapi_cursorOpen(
+    const UI8_T t_idx,
+    const UI8_T f_idx,
+    const UI8_T page_num,
+    DB_CURSOR_FILTER_T filter,
+    void *ptr_arg,
+    DB_CURSOR_T *ptr_cursor);
+
+/* FUNCTION NAME: dbapi_cursorNext
+ * PURPOSE:
+ *      Get the next entry of a cursor.
+ *
+ * INPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * OUTPUT:
+ *      ptr_pos         -- The entry index, or the sequence number of the
+ *                         entry in the FDB walk for DYNAMIC_MAC_ADDRESS_ENTRY
+ *      ptr_data_size   -- The data size of the entry
+ *      pptr_data       -- The data of the entry
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *      MW_E_ENTRY_NOT_FOUND
+ *      MW_E_NO_MEMORY
+ *      MW_E_TIMEOUT
+ *      MW_E_OP_INCOMPLETE
+ *
+ * NOTES:
+ *      MW_E_ENTRY_NOT_FOUND ends the iteration. (*pptr_data) is valid until
+ *      the next call or dbapi_cursorClose().
+ */
+MW_ERROR_NO_T
+dbapi_cursorNext(
+    DB_CURSOR_T *ptr_cursor,
+    UI16_T *ptr_pos,
+    UI16_T *ptr_data_size,
+    void **pptr_data);
+
+/* FUNCTION NAME: dbapi_cursorClose
+ * PURPOSE:
+ *      Close a cursor.
+ *
+ * INPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *
+ */
+void
+dbapi_cursorClose(
+    DB_CURSOR_T *ptr_cursor);
 #endif  /* End of DBAPI_H */
@@ -0,0 +1,447 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+/* FILE NAME:  db_async.c
+ * PURPOSE:
+ *      Implement the asynchronous get requests of DB clients.
+ *
+ * NOTES:
+ *      A request is remembered with its callback and sent on the client's
+ *      own queue. The client task keeps receiving its queue as usual and hands
+ *      every message to dbapi_completeAsync(), which calls the callback of the
+ *      matched request. No task blocks waiting for DB.
+ *
+ *      The DB message carries no request ID. DB answers a queue in request
+ *      order and echoes the T/F/E, so a response completes the oldest request
+ *      of its client and T/F/E. The client must not send other M_GET requests
+ *      on the same queue.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mw_error.h"
+#include "mw_types.h"
+#include "osapi.h"
+#include "osapi_string.h"
+#include "db_api.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define DB_ASYNC_SEND_TIMEOUT   (100)
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+#define DB_ASYNC_QNAME_MATCH(__ptr_ctx__, __qname__)    \
+    (0 == strncmp((__ptr_ctx__)->cq_name, (__qname__), DB_Q_NAME_SIZE))
+
+/* DATA TYPE DECLARATIONS
+ */
+typedef struct DB_ASYNC_CTX_S
+{
+    BOOL_T              used;
+    UI32_T              seq;                        /* The issue order */
+    C8_T                cq_name[DB_Q_NAME_SIZE];    /* The client's queue name */
+    DB_REQUEST_TYPE_T   request;
+    DB_ASYNC_CB_T       callback;
+    void                *ptr_arg;
+    TickType_t          start_tick;
+} DB_ASYNC_CTX_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+ */
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+static DB_ASYNC_CTX_T _db_async_ctx[DB_ASYNC_PENDING_NUM];
+static UI32_T _db_async_seq = 0;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: _db_async_match
+ * PURPOSE:
+ *      Find the pending request a response of a client answers.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *      ptr_request     -- The T/F/E echoed by the response, NULL if the
+ *                         response carries no payload
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      Pointer to the oldest matched request, NULL if not found.
+ *
+ * NOTES:
+ *      Called in critical section.
+ */
+static DB_ASYNC_CTX_T *
+_db_async_match(
+    const C8_T *client_qname,
+    const DB_REQUEST_TYPE_T *ptr_request)
+{
+    DB_ASYNC_CTX_T  *ptr_ctx = NULL;
+    DB_ASYNC_CTX_T  *ptr_match = NULL;
+    UI8_T           idx;
+
+    for (idx = 0; idx < DB_ASYNC_PENDING_NUM; idx++)
+    {
+        ptr_ctx = &_db_async_ctx[idx];
+        if ((TRUE != ptr_ctx->used) || !DB_ASYNC_QNAME_MATCH(ptr_ctx, client_qname))
+        {
+            continue;
+        }
+        if ((NULL != ptr_request) &&
+            ((ptr_ctx->request.t_idx != ptr_request->t_idx) ||
+             (ptr_ctx->request.f_idx != ptr_request->f_idx) ||
+             (ptr_ctx->request.e_idx != ptr_request->e_idx)))
+        {
+            continue;
+        }
+        if ((NULL == ptr_match) || ((I32_T)(ptr_ctx->seq - ptr_match->seq) < 0))
+        {
+            ptr_match = ptr_ctx;
+        }
+    }
+    return ptr_match;
+}
+
+/* FUNCTION NAME: _db_async_fail
+ * PURPOSE:
+ *      Fail the pending requests of a client.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *      result          -- The result passed to the callbacks
+ *      expired_only    -- TRUE to fail only the requests older than
+ *                         DB_ASYNC_TIMEOUT
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Each entry is released before its callback runs, so the callback may
+ *      issue a new request. A late response of a failed request matches no
+ *      request, or a younger one of the same T/F/E which reads the same data.
+ */
+static void
+_db_async_fail(
+    const C8_T *client_qname,
+    const MW_ERROR_NO_T result,
+    const BOOL_T expired_only)
+{
+    DB_ASYNC_CTX_T  ctx;
+    TickType_t      now = xTaskGetTickCount();
+    UI8_T           idx;
+
+    for (idx = 0; idx < DB_ASYNC_PENDING_NUM; idx++)
+    {
+        taskENTER_CRITICAL();
+        if ((TRUE != _db_async_ctx[idx].used) ||
+            !DB_ASYNC_QNAME_MATCH(&_db_async_ctx[idx], client_qname) ||
+            ((TRUE == expired_only) && ((now - _db_async_ctx[idx].start_tick) < DB_ASYNC_TIMEOUT)))
+        {
+            taskEXIT_CRITICAL();
+            continue;
+        }
+        ctx = _db_async_ctx[idx];
+        _db_async_ctx[idx].used = FALSE;
+        taskEXIT_CRITICAL();
+
+        ctx.callback(result, NULL, NULL, 0, ctx.ptr_arg);
+    }
+}
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: dbapi_getDataAsync
+ * PURPOSE:
+ *      Send a get request to DB without waiting for the response.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the queue which receives the response
+ *      request         -- The table, field and entry to get
+ *      callback        -- The completion callback
+ *      ptr_arg         -- The argument passed to the callback
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_TABLE_FULL
+ *      MW_E_NO_MEMORY
+ *      MW_E_OP_INCOMPLETE
+ *
+ * NOTES:
+ *      The callback runs in the task which receives client_qname, when that
+ *      task passes the response to dbapi_completeAsync(). It is called exactly
+ *      once unless this function fails.
+ */
+MW_ERROR_NO_T
+dbapi_getDataAsync(
+    const C8_T *client_qname,
+    const DB_REQUEST_TYPE_T request,
+    DB_ASYNC_CB_T callback,
+    void *ptr_arg)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    DB_MSG_T        *ptr_msg = NULL;
+    DB_ASYNC_CTX_T  *ptr_ctx = NULL;
+    UI16_T          data_size = 0;
+    UI8_T           idx;
+
+    MW_CHECK_PTR(client_qname);
+    MW_CHECK_PTR(callback);
+    MW_PARAM_CHK((request.t_idx >= TABLES_LAST), MW_E_BAD_PARAMETER);
+
+    rc = dbapi_getDataSize(request, &data_size);
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+    rc = dbapi_allocMsg(DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + data_size, &ptr_msg);
+    if (MW_E_OK != rc)
+    {
+        return MW_E_NO_MEMORY;
+    }
+
+    /* Register before sending, the response may be received at once */
+    taskENTER_CRITICAL();
+    for (idx = 0; idx < DB_ASYNC_PENDING_NUM; idx++)
+    {
+        if (TRUE != _db_async_ctx[idx].used)
+        {
+            ptr_ctx = &_db_async_ctx[idx];
+            break;
+        }
+    }
+    if (NULL != ptr_ctx)
+    {
+        ptr_ctx->used = TRUE;
+        ptr_ctx->seq = _db_async_seq++;
+        osapi_strncpy(ptr_ctx->cq_name, client_qname, DB_Q_NAME_SIZE);
+        ptr_ctx->request = request;
+        ptr_ctx->callback = callback;
+        ptr_ctx->ptr_arg = ptr_arg;
+        ptr_ctx->start_tick = xTaskGetTickCount();
+    }
+    taskEXIT_CRITICAL();
+    if (NULL == ptr_ctx)
+    {
+        dbapi_freeMsg(ptr_msg);
+        return MW_E_TABLE_FULL;
+    }
+
+    dbapi_setMsgHeader(ptr_msg, client_qname, M_GET, 1);
+    dbapi_setMsgPayload(M_GET, request.t_idx, request.f_idx, request.e_idx, NULL, (void *)&(ptr_msg->ptr_payload));
+
+    /* dbapi_sendMsg frees the message if it fails */
+    rc = dbapi_sendMsg(ptr_msg, DB_ASYNC_SEND_TIMEOUT);
+    if (MW_E_OK != rc)
+    {
+        taskENTER_CRITICAL();
+        ptr_ctx->used = FALSE;
+        taskEXIT_CRITICAL();
+        return rc;
+    }
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_completeAsync
+ * PURPOSE:
+ *      Complete the asynchronous request a received message responds to.
+ *
+ * INPUT:
+ *      ptr_msg         -- The message received from the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK                 -- The message is consumed by the callback
+ *      MW_E_ENTRY_NOT_FOUND    -- The message is not an asynchronous response,
+ *                                 the caller keeps the ownership
+ *
+ * NOTES:
+ *      A failed get may come back without its payload, it then completes the
+ *      oldest request of the client since DB answers in order.
+ */
+MW_ERROR_NO_T
+dbapi_completeAsync(
+    DB_MSG_T *ptr_msg)
+{
+    DB_ASYNC_CTX_T  ctx;
+    DB_ASYNC_CTX_T  *ptr_ctx = NULL;
+    DB_PAYLOAD_T    *ptr_payload = NULL;
+    MW_ERROR_NO_T   result;
+
+    /* Only the response of a single M_GET, not of a write or a subscription */
+    if ((NULL == ptr_msg) || (M_RESPONSE != ptr_msg->method))
+    {
+        return MW_E_ENTRY_NOT_FOUND;
+    }
+    result = (MW_ERROR_NO_T)ptr_msg->type.result;
+    ptr_payload = (DB_PAYLOAD_T *)&(ptr_msg->ptr_payload);
+
+    taskENTER_CRITICAL();
+    ptr_ctx = _db_async_match(ptr_msg->cq_name, (MW_E_OK == result) ? &(ptr_payload->request) : NULL);
+    if (NULL != ptr_ctx)
+    {
+        ctx = *ptr_ctx;
+        ptr_ctx->used = FALSE;
+    }
+    taskEXIT_CRITICAL();
+    if (NULL == ptr_ctx)
+    {
+        return MW_E_ENTRY_NOT_FOUND;
+    }
+
+    if (MW_E_OK != result)
+    {
+        dbapi_freeMsg(ptr_msg);
+        ctx.callback(result, NULL, NULL, 0, ctx.ptr_arg);
+        return MW_E_OK;
+    }
+    ctx.callback(MW_E_OK, ptr_msg, (void *)&(ptr_payload->ptr_data), ptr_payload->data_size, ctx.ptr_arg);
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_expireAsync
+ * PURPOSE:
+ *      Fail the asynchronous requests of a client which wait too long.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The callbacks are called with MW_E_TIMEOUT after DB_ASYNC_TIMEOUT.
+ *      The client calls it from its receive loop when the queue is idle.
+ */
+void
+dbapi_expireAsync(
+    const C8_T *client_qname)
+{
+    if (NULL == client_qname)
+    {
+        return;
+    }
+    _db_async_fail(client_qname, MW_E_TIMEOUT, TRUE);
+}
+
+/* FUNCTION NAME: dbapi_cancelAsync
+ * PURPOSE:
+ *      Fail all asynchronous requests of a client.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The callbacks are called with MW_E_OP_INCOMPLETE. Call it before the
+ *      client's queue is deleted.
+ */
+void
+dbapi_cancelAsync(
+    const C8_T *client_qname)
+{
+    if (NULL == client_qname)
+    {
+        return;
+    }
+    _db_async_fail(client_qname, MW_E_OP_INCOMPLETE, FALSE);
+}
+
+/* FUNCTION NAME: dbapi_hasPendingAsync
+ * PURPOSE:
+ *      Check whether a client has asynchronous requests waiting.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's queue
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      TRUE if any request of the client waits for its response
+ *
+ * NOTES:
+ *      The client's receive loop uses it to bound its wait, so
+ *      dbapi_expireAsync() still runs when the queue stays idle.
+ */
+BOOL_T
+dbapi_hasPendingAsync(
+    const C8_T *client_qname)
+{
+    BOOL_T  pending = FALSE;
+    UI8_T   idx;
+
+    if (NULL == client_qname)
+    {
+        return FALSE;
+    }
+    taskENTER_CRITICAL();
+    for (idx = 0; idx < DB_ASYNC_PENDING_NUM; idx++)
+    {
+        if ((TRUE == _db_async_ctx[idx].used) &&
+            DB_ASYNC_QNAME_MATCH(&_db_async_ctx[idx], client_qname))
+        {
+            pending = TRUE;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return pending;
+}
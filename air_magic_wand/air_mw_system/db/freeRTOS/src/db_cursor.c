@@ -0,0 +1,541 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  db_cursor.c
+ * PURPOSE:
+ *      Implement the paged iteration of DB tables.
+ *
+ * NOTES:
+ *      A cursor owns a private reply queue and fetches a page of entries with
+ *      one M_GET message of several requests, so a table is walked with one
+ *      page of memory whatever its size. The page is bound by
+ *      DB_CURSOR_PAGE_MAX requests and DB_MSG_POOL_XL_SIZE bytes.
+ *
+ *      A cursor has one request in flight at most, so any reply in its
+ *      private queue is the reply of that request.
+ *
+ *      DYNAMIC_MAC_ADDRESS_ENTRY is filled by DB from the hardware FDB walk,
+ *      batch by batch. The cursor drives the START/CONTINUE actions of
+ *      DYNAMIC_MAC_ADDRESS_ENTRY_CFG and pages through each batch.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <stdio.h>
+#include "mw_error.h"
+#include "mw_types.h"
+#include "osapi.h"
+#include "osapi_message.h"
+#include "osapi_string.h"
+#include "db_api.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define DB_CURSOR_QUEUE_LEN     (2)
+#define DB_CURSOR_QUEUE_FMT     "c%02x"
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+#define DB_CURSOR_IS_FDB(__ptr_cursor__)    \
+    (DYNAMIC_MAC_ADDRESS_ENTRY == (__ptr_cursor__)->t_idx)
+
+/* DATA TYPE DECLARATIONS
+ */
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+ */
+static MW_ERROR_NO_T
+_db_cursor_request(
+    DB_CURSOR_T *ptr_cursor,
+    DB_MSG_T *ptr_msg,
+    DB_MSG_T **pptr_rsp);
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+static UI8_T _db_cursor_qid = 0;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: _db_cursor_request
+ * PURPOSE:
+ *      Send a request of the cursor and wait for its response.
+ *
+ * INPUT:
+ *      ptr_cursor      -- The cursor
+ *      ptr_msg         -- The request, its header is set by the caller
+ *
+ * OUTPUT:
+ *      pptr_rsp        -- The response, freed by the caller
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_TIMEOUT
+ *      MW_E_OP_INCOMPLETE
+ *      MW_E_ENTRY_NOT_FOUND
+ *
+ * NOTES:
+ *      The request is owned by DB once sent. After a timeout the late reply
+ *      could be taken for the reply of the next request, so the cursor fails
+ *      with MW_E_TIMEOUT from then on.
+ */
+static MW_ERROR_NO_T
+_db_cursor_request(
+    DB_CURSOR_T *ptr_cursor,
+    DB_MSG_T *ptr_msg,
+    DB_MSG_T **pptr_rsp)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    DB_MSG_T        *ptr_rsp = NULL;
+
+    if (TRUE == ptr_cursor->timed_out)
+    {
+        dbapi_freeMsg(ptr_msg);
+        return MW_E_TIMEOUT;
+    }
+    /* dbapi_sendMsg frees the message if it fails */
+    rc = dbapi_sendMsg(ptr_msg, DB_CURSOR_TIMEOUT);
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+    rc = dbapi_recvMsg(ptr_cursor->cq_name, &ptr_rsp, DB_CURSOR_TIMEOUT);
+    if (MW_E_OK != rc)
+    {
+        ptr_cursor->timed_out = TRUE;
+        return rc;
+    }
+    if (MW_E_OK != ptr_rsp->type.result)
+    {
+        rc = (MW_ERROR_NO_T)ptr_rsp->type.result;
+        dbapi_freeMsg(ptr_rsp);
+        return rc;
+    }
+    (*pptr_rsp) = ptr_rsp;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _db_cursor_fdbNext
+ * PURPOSE:
+ *      Let DB fetch the next batch of the hardware FDB walk.
+ *
+ * INPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_ENTRY_NOT_FOUND    -- The walk is finished
+ *      MW_E_NO_MEMORY
+ *      MW_E_TIMEOUT
+ *      MW_E_OP_INCOMPLETE
+ *
+ * NOTES:
+ *      DB handles the requests in order, so the result read after the
+ *      action is written is the one of this batch.
+ */
+static MW_ERROR_NO_T
+_db_cursor_fdbNext(
+    DB_CURSOR_T *ptr_cursor)
+{
+    MW_ERROR_NO_T                       rc = MW_E_OK;
+    DB_MSG_T                            *ptr_msg = NULL;
+    DB_MSG_T                            *ptr_rsp = NULL;
+    DB_PAYLOAD_T                        *ptr_pload = NULL;
+    DB_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_T  cfg;
+    UI8_T                               action = AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_ACTION_CONTINUE;
+    UI16_T                              data_size = 0;
+
+    if ((AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_START_END == ptr_cursor->fdb_result) ||
+        (AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_CONTINUE_END == ptr_cursor->fdb_result))
+    {
+        return MW_E_ENTRY_NOT_FOUND;
+    }
+    if (AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_DEFAULT == ptr_cursor->fdb_result)
+    {
+        action = AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_ACTION_START;
+    }
+
+    rc = dbapi_allocMsg(DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + sizeof(action), &ptr_msg);
+    if (MW_E_OK != rc)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    dbapi_setMsgHeader(ptr_msg, ptr_cursor->cq_name, M_UPDATE, 1);
+    dbapi_setMsgPayload(M_UPDATE, DYNAMIC_MAC_ADDRESS_ENTRY_CFG, ACTION_RESULT, DB_ALL_ENTRIES, &action, (void *)&(ptr_msg->ptr_payload));
+    rc = _db_cursor_request(ptr_cursor, ptr_msg, &ptr_rsp);
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+    dbapi_freeMsg(ptr_rsp);
+    ptr_rsp = NULL;
+
+    rc = dbapi_allocMsg(DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + sizeof(cfg), &ptr_msg);
+    if (MW_E_OK != rc)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    dbapi_setMsgHeader(ptr_msg, ptr_cursor->cq_name, M_GET, 1);
+    dbapi_setMsgPayload(M_GET, DYNAMIC_MAC_ADDRESS_ENTRY_CFG, DB_ALL_FIELDS, DB_ALL_ENTRIES, NULL, (void *)&(ptr_msg->ptr_payload));
+    rc = _db_cursor_request(ptr_cursor, ptr_msg, &ptr_rsp);
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+    ptr_pload = (DB_PAYLOAD_T *)&(ptr_rsp->ptr_payload);
+    osapi_memcpy(&data_size, &(ptr_pload->data_size), sizeof(UI16_T));
+    if (data_size < sizeof(cfg))
+    {
+        dbapi_freeMsg(ptr_rsp);
+        return MW_E_OP_INCOMPLETE;
+    }
+    osapi_memcpy(&cfg, &(ptr_pload->ptr_data), sizeof(cfg));
+    dbapi_freeMsg(ptr_rsp);
+    /* Anything but a done or an end result would restart the walk forever */
+    if ((cfg.action_result < AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_START_DONE) ||
+        (cfg.action_result > AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_CONTINUE_END))
+    {
+        return MW_E_OP_INCOMPLETE;
+    }
+
+    ptr_cursor->fdb_result = cfg.action_result;
+    ptr_cursor->e_idx = 1;
+    ptr_cursor->e_last = cfg.dynamic_entry_count;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _db_cursor_fetch
+ * PURPOSE:
+ *      Fetch the next page of the cursor.
+ *
+ * INPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_ENTRY_NOT_FOUND    -- No entry is left
+ *      MW_E_NO_MEMORY
+ *      MW_E_TIMEOUT
+ *      MW_E_OP_INCOMPLETE
+ *
+ * NOTES:
+ *      The page of the previous fetch is released.
+ */
+static MW_ERROR_NO_T
+_db_cursor_fetch(
+    DB_CURSOR_T *ptr_cursor)
+{
+    MW_ERROR_NO_T       rc = MW_E_OK;
+    DB_MSG_T            *ptr_msg = NULL;
+    DB_REQUEST_TYPE_T   request;
+    UI8_T               *ptr_payload = NULL;
+    UI16_T              entry_size = 0;
+    UI16_T              count = 0;
+    UI16_T              idx;
+
+    if (NULL != ptr_cursor->ptr_page)
+    {
+        dbapi_freeMsg(ptr_cursor->ptr_page);
+        ptr_cursor->ptr_page = NULL;
+    }
+    ptr_cursor->remain = 0;
+
+    while (ptr_cursor->e_idx > ptr_cursor->e_last)
+    {
+        if (!DB_CURSOR_IS_FDB(ptr_cursor))
+        {
+            return MW_E_ENTRY_NOT_FOUND;
+        }
+        rc = _db_cursor_fdbNext(ptr_cursor);
+        if (MW_E_OK != rc)
+        {
+            return rc;
+        }
+    }
+
+    request.t_idx = ptr_cursor->t_idx;
+    request.f_idx = ptr_cursor->f_idx;
+    request.e_idx = ptr_cursor->e_idx;
+    rc = dbapi_getDataSize(request, &entry_size);
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+    count = ptr_cursor->e_last - ptr_cursor->e_idx + 1;
+    if (count > ptr_cursor->page_num)
+    {
+        count = ptr_cursor->page_num;
+    }
+    while ((count > 1) &&
+           ((DB_MSG_HEADER_SIZE + (count * (DB_MSG_PAYLOAD_SIZE + entry_size))) > DB_MSG_POOL_XL_SIZE))
+    {
+        count--;
+    }
+
+    rc = dbapi_allocMsg(DB_MSG_HEADER_SIZE + (count * (DB_MSG_PAYLOAD_SIZE + entry_size)), &ptr_msg);
+    if (MW_E_OK != rc)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    dbapi_setMsgHeader(ptr_msg, ptr_cursor->cq_name, M_GET, (UI8_T)count);
+    ptr_payload = (UI8_T *)&(ptr_msg->ptr_payload);
+    for (idx = 0; idx < count; idx++)
+    {
+        ptr_payload += dbapi_setMsgPayload(M_GET, ptr_cursor->t_idx, ptr_cursor->f_idx,
+                                           ptr_cursor->e_idx + idx, NULL, (void *)ptr_payload);
+    }
+
+    rc = _db_cursor_request(ptr_cursor, ptr_msg, &(ptr_cursor->ptr_page));
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+    ptr_cursor->e_idx += count;
+    ptr_cursor->remain = (UI8_T)count;
+    ptr_cursor->ptr_next = (UI8_T *)&(ptr_cursor->ptr_page->ptr_payload);
+    return MW_E_OK;
+}
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: dbapi_cursorOpen
+ * PURPOSE:
+ *      Open a cursor on the entries of a DB table.
+ *
+ * INPUT:
+ *      t_idx           -- The table index
+ *      f_idx           -- The field index, DB_ALL_FIELDS for the whole entry
+ *      page_num        -- The entries fetched from DB at a time
+ *      filter          -- The entries it returns FALSE for are skipped,
+ *                         NULL to return all entries
+ *      ptr_arg         -- The argument passed to filter
+ *
+ * OUTPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      page_num is clamped to DB_CURSOR_PAGE_MAX, and lowered further when
+ *      the page would not fit in DB_MSG_POOL_XL_SIZE. DYNAMIC_MAC_ADDRESS_ENTRY
+ *      starts a new hardware FDB walk on the first page. The cursor must be
+ *      closed by dbapi_cursorClose().
+ */
+MW_ERROR_NO_T
+dbapi_cursorOpen(
+    const UI8_T t_idx,
+    const UI8_T f_idx,
+    const UI8_T page_num,
+    DB_CURSOR_FILTER_T filter,
+    void *ptr_arg,
+    DB_CURSOR_T *ptr_cursor)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    UI16_T          entries_num = 0;
+    UI16_T          tries;
+
+    MW_CHECK_PTR(ptr_cursor);
+    MW_PARAM_CHK((t_idx >= TABLES_LAST), MW_E_BAD_PARAMETER);
+    MW_PARAM_CHK((0 == page_num), MW_E_BAD_PARAMETER);
+
+    osapi_memset(ptr_cursor, 0, sizeof(DB_CURSOR_T));
+    /* The FDB walk tells the entries of each batch */
+    if (DYNAMIC_MAC_ADDRESS_ENTRY != t_idx)
+    {
+        rc = dbapi_getEntriesNum(t_idx, &entries_num);
+        if (MW_E_OK != rc)
+        {
+            return MW_E_BAD_PARAMETER;
+        }
+    }
+
+    /* A private queue, the replies are not mixed with notifications */
+    for (tries = 0; tries <= 0xFF; tries++)
+    {
+        snprintf(ptr_cursor->cq_name, DB_Q_NAME_SIZE, DB_CURSOR_QUEUE_FMT, _db_cursor_qid++);
+        if (NULL == osapi_msgFindHandle(ptr_cursor->cq_name))
+        {
+            break;
+        }
+    }
+    rc = osapi_msgCreate(ptr_cursor->cq_name, DB_CURSOR_QUEUE_LEN, sizeof(void *));
+    if (MW_E_OK != rc)
+    {
+        osapi_memset(ptr_cursor, 0, sizeof(DB_CURSOR_T));
+        return MW_E_NO_MEMORY;
+    }
+
+    ptr_cursor->t_idx = t_idx;
+    ptr_cursor->f_idx = f_idx;
+    ptr_cursor->page_num = (page_num > DB_CURSOR_PAGE_MAX) ? DB_CURSOR_PAGE_MAX : page_num;
+    ptr_cursor->e_idx = 1;
+    ptr_cursor->e_last = entries_num;
+    ptr_cursor->fdb_result = AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_DEFAULT;
+    ptr_cursor->filter = filter;
+    ptr_cursor->ptr_arg = ptr_arg;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_cursorNext
+ * PURPOSE:
+ *      Get the next entry of a cursor.
+ *
+ * INPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * OUTPUT:
+ *      ptr_pos         -- The position of the entry. It is the entry index
+ *                         of the table, or the sequence number of the entry
+ *                         in the FDB walk for DYNAMIC_MAC_ADDRESS_ENTRY
+ *      ptr_data_size   -- The data size of the entry
+ *      pptr_data       -- The data of the entry
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *      MW_E_ENTRY_NOT_FOUND    -- No entry is left
+ *      MW_E_NO_MEMORY
+ *      MW_E_TIMEOUT
+ *      MW_E_OP_INCOMPLETE
+ *
+ * NOTES:
+ *      (*pptr_data) points into the page of the cursor, it is valid until the
+ *      next call or dbapi_cursorClose(). The layout of the data is the same
+ *      as the M_GET response of one entry.
+ */
+MW_ERROR_NO_T
+dbapi_cursorNext(
+    DB_CURSOR_T *ptr_cursor,
+    UI16_T *ptr_pos,
+    UI16_T *ptr_data_size,
+    void **pptr_data)
+{
+    MW_ERROR_NO_T       rc = MW_E_OK;
+    DB_REQUEST_TYPE_T   request;
+    UI16_T              data_size = 0;
+    UI16_T              pos = 0;
+    UI8_T               *ptr_data = NULL;
+
+    MW_CHECK_PTR(ptr_cursor);
+    MW_CHECK_PTR(ptr_pos);
+    MW_CHECK_PTR(ptr_data_size);
+    MW_CHECK_PTR(pptr_data);
+    if ('\0' == ptr_cursor->cq_name[0])
+    {
+        return MW_E_NOT_INITED;
+    }
+
+    for (;;)
+    {
+        if (0 == ptr_cursor->remain)
+        {
+            rc = _db_cursor_fetch(ptr_cursor);
+            if (MW_E_OK != rc)
+            {
+                return rc;
+            }
+        }
+        osapi_memcpy(&request, ptr_cursor->ptr_next, sizeof(DB_REQUEST_TYPE_T));
+        ptr_cursor->ptr_next += sizeof(DB_REQUEST_TYPE_T);
+        osapi_memcpy(&data_size, ptr_cursor->ptr_next, sizeof(UI16_T));
+        ptr_cursor->ptr_next += sizeof(UI16_T);
+        ptr_data = ptr_cursor->ptr_next;
+        ptr_cursor->ptr_next += data_size;
+        ptr_cursor->remain--;
+
+        ptr_cursor->count++;
+        pos = DB_CURSOR_IS_FDB(ptr_cursor) ? ptr_cursor->count : request.e_idx;
+        if ((NULL == ptr_cursor->filter) ||
+            (TRUE == ptr_cursor->filter(pos, data_size, ptr_data, ptr_cursor->ptr_arg)))
+        {
+            break;
+        }
+    }
+    (*ptr_pos) = pos;
+    (*ptr_data_size) = data_size;
+    (*pptr_data) = ptr_data;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_cursorClose
+ * PURPOSE:
+ *      Close a cursor.
+ *
+ * INPUT:
+ *      ptr_cursor      -- The cursor
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      A late response in the private queue is dropped with it. The FDB
+ *      walk of DB needs no close, the next START restarts it.
+ */
+void
+dbapi_cursorClose(
+    DB_CURSOR_T *ptr_cursor)
+{
+    DB_MSG_T    *ptr_msg = NULL;
+
+    if ((NULL == ptr_cursor) || ('\0' == ptr_cursor->cq_name[0]))
+    {
+        return;
+    }
+    if (NULL != ptr_cursor->ptr_page)
+    {
+        dbapi_freeMsg(ptr_cursor->ptr_page);
+    }
+    while (MW_E_OK == dbapi_recvMsg(ptr_cursor->cq_name, &ptr_msg, 0))
+    {
+        dbapi_freeMsg(ptr_msg);
+    }
+    osapi_msgDelete(ptr_cursor->cq_name);
+    osapi_memset(ptr_cursor, 0, sizeof(DB_CURSOR_T));
+}
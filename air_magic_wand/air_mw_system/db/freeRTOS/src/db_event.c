@@ -0,0 +1,317 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  db_event.c
+ * PURPOSE:
+ *      Implement the event loop of DB client daemons.
+ *
+ * NOTES:
+ *      A daemon blocks in one place, on a queue set of its DB queue and a
+ *      doorbell queue. Timers and other tasks post event bits and ring the
+ *      doorbell, so the daemon wakes only for a DB message or an event and
+ *      needs no polling timeout. Posting the same bit again before the
+ *      daemon runs is coalesced.
+ *
+ *      The queue sets need configUSE_QUEUE_SETS in FreeRTOSConfig.h.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "mw_error.h"
+#include "mw_types.h"
+#include "osapi.h"
+#include "osapi_message.h"
+#include "osapi_string.h"
+#include "db_api.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#if !configUSE_QUEUE_SETS
+#error "db_event.c needs configUSE_QUEUE_SETS in FreeRTOSConfig.h"
+#endif
+
+#define DB_EVENT_DOORBELL_LEN   (1)
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+ */
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+ */
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: dbapi_eventCreate
+ * PURPOSE:
+ *      Create the event loop of a DB client.
+ *
+ * INPUT:
+ *      client_qname    -- The name of the client's DB queue
+ *      queue_len       -- The length of the client's DB queue
+ *
+ * OUTPUT:
+ *      ptr_loop        -- The event loop
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_ENTRY_NOT_FOUND
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      Called right after the DB queue is created, a queue can only join the
+ *      set while it is empty.
+ */
+MW_ERROR_NO_T
+dbapi_eventCreate(
+    const C8_T *client_qname,
+    const UI32_T queue_len,
+    DB_EVENT_LOOP_T *ptr_loop)
+{
+    QueueHandle_t       db_queue;
+    QueueHandle_t       doorbell;
+    QueueSetHandle_t    set;
+
+    MW_CHECK_PTR(client_qname);
+    MW_CHECK_PTR(ptr_loop);
+
+    osapi_memset(ptr_loop, 0, sizeof(DB_EVENT_LOOP_T));
+    db_queue = (QueueHandle_t)osapi_msgFindHandle(client_qname);
+    if (NULL == db_queue)
+    {
+        return MW_E_ENTRY_NOT_FOUND;
+    }
+    set = xQueueCreateSet(queue_len + DB_EVENT_DOORBELL_LEN);
+    if (NULL == set)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    doorbell = xQueueCreate(DB_EVENT_DOORBELL_LEN, sizeof(UI8_T));
+    if (NULL == doorbell)
+    {
+        vQueueDelete(set);
+        return MW_E_NO_MEMORY;
+    }
+    if ((pdPASS != xQueueAddToSet(db_queue, set)) ||
+        (pdPASS != xQueueAddToSet(doorbell, set)))
+    {
+        xQueueRemoveFromSet(db_queue, set);
+        vQueueDelete(doorbell);
+        vQueueDelete(set);
+        return MW_E_BAD_PARAMETER;
+    }
+    ptr_loop->ptr_db_queue = (void *)db_queue;
+    ptr_loop->ptr_doorbell = (void *)doorbell;
+    ptr_loop->ptr_set = (void *)set;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_eventDelete
+ * PURPOSE:
+ *      Delete the event loop of a DB client.
+ *
+ * INPUT:
+ *      ptr_loop        -- The event loop
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The messages left in the DB queue are freed, the queue itself is kept
+ *      for the client to delete.
+ */
+void
+dbapi_eventDelete(
+    DB_EVENT_LOOP_T *ptr_loop)
+{
+    DB_MSG_T    *ptr_msg = NULL;
+
+    if ((NULL == ptr_loop) || (NULL == ptr_loop->ptr_set))
+    {
+        return;
+    }
+    while (pdTRUE == xQueueReceive((QueueHandle_t)ptr_loop->ptr_db_queue, &ptr_msg, 0))
+    {
+        dbapi_freeMsg(ptr_msg);
+    }
+    xQueueReset((QueueHandle_t)ptr_loop->ptr_doorbell);
+    xQueueRemoveFromSet((QueueHandle_t)ptr_loop->ptr_db_queue, (QueueSetHandle_t)ptr_loop->ptr_set);
+    xQueueRemoveFromSet((QueueHandle_t)ptr_loop->ptr_doorbell, (QueueSetHandle_t)ptr_loop->ptr_set);
+    vQueueDelete((QueueHandle_t)ptr_loop->ptr_doorbell);
+    vQueueDelete((QueueHandle_t)ptr_loop->ptr_set);
+    osapi_memset(ptr_loop, 0, sizeof(DB_EVENT_LOOP_T));
+}
+
+/* FUNCTION NAME: dbapi_eventPost
+ * PURPOSE:
+ *      Post events to the event loop of a DB client.
+ *
+ * INPUT:
+ *      ptr_loop        -- The event loop
+ *      events          -- The event bits, defined by the client
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *
+ * NOTES:
+ *      It does not block, so timer callbacks may post. A bit posted again
+ *      before the client collects it is delivered once.
+ */
+MW_ERROR_NO_T
+dbapi_eventPost(
+    DB_EVENT_LOOP_T *ptr_loop,
+    const UI32_T events)
+{
+    UI8_T   ring = 0;
+
+    MW_CHECK_PTR(ptr_loop);
+    MW_PARAM_CHK((DB_EVENT_NONE == events), MW_E_BAD_PARAMETER);
+    if (NULL == ptr_loop->ptr_set)
+    {
+        return MW_E_NOT_INITED;
+    }
+    taskENTER_CRITICAL();
+    ptr_loop->events |= events;
+    taskEXIT_CRITICAL();
+    /* A full doorbell is already rung */
+    xQueueSend((QueueHandle_t)ptr_loop->ptr_doorbell, &ring, 0);
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_eventWait
+ * PURPOSE:
+ *      Wait for a DB message or posted events.
+ *
+ * INPUT:
+ *      ptr_loop        -- The event loop
+ *      timeout         -- The ticks to wait, DB_EVENT_WAIT_FOREVER to block
+ *
+ * OUTPUT:
+ *      pptr_msg        -- The received DB message, NULL if none
+ *      ptr_events      -- The posted event bits, DB_EVENT_NONE if none
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *      MW_E_TIMEOUT
+ *
+ * NOTES:
+ *      Either a message or events are returned. The caller frees the message.
+ */
+MW_ERROR_NO_T
+dbapi_eventWait(
+    DB_EVENT_LOOP_T *ptr_loop,
+    const UI32_T timeout,
+    DB_MSG_T **pptr_msg,
+    UI32_T *ptr_events)
+{
+    QueueSetMemberHandle_t  member;
+    TickType_t              ticks = (TickType_t)timeout;
+    TickType_t              start = xTaskGetTickCount();
+    TickType_t              elapsed = 0;
+    UI8_T                   ring = 0;
+
+    MW_CHECK_PTR(ptr_loop);
+    MW_CHECK_PTR(pptr_msg);
+    MW_CHECK_PTR(ptr_events);
+    if (NULL == ptr_loop->ptr_set)
+    {
+        return MW_E_NOT_INITED;
+    }
+    (*pptr_msg) = NULL;
+    (*ptr_events) = DB_EVENT_NONE;
+
+    if (DB_EVENT_WAIT_FOREVER == timeout)
+    {
+        ticks = portMAX_DELAY;
+    }
+
+    for (;;)
+    {
+        member = xQueueSelectFromSet((QueueSetHandle_t)ptr_loop->ptr_set, ticks);
+        if (NULL == member)
+        {
+            return MW_E_TIMEOUT;
+        }
+        if (member != (QueueSetMemberHandle_t)ptr_loop->ptr_doorbell)
+        {
+            /* Only the loop receives from the DB queue, the selected message is there */
+            xQueueReceive((QueueHandle_t)member, pptr_msg, 0);
+            return MW_E_OK;
+        }
+        xQueueReceive((QueueHandle_t)ptr_loop->ptr_doorbell, &ring, 0);
+        taskENTER_CRITICAL();
+        (*ptr_events) = ptr_loop->events;
+        ptr_loop->events = DB_EVENT_NONE;
+        taskEXIT_CRITICAL();
+        if (DB_EVENT_NONE != (*ptr_events))
+        {
+            return MW_E_OK;
+        }
+        /* The events were taken with an earlier ring, wait the rest of the time */
+        if (DB_EVENT_WAIT_FOREVER != timeout)
+        {
+            elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= (TickType_t)timeout)
+            {
+                return MW_E_TIMEOUT;
+            }
+            ticks = (TickType_t)timeout - elapsed;
+        }
+    }
+}
@@ -0,0 +1,309 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  db_msgpool.c
+ * PURPOSE:
+ *      Implement the fixed-size message pool for DB requests and responses.
+ *
+ * NOTES:
+ *      Every class owns one contiguous arena, so the owner of a buffer is
+ *      found by its address and the buffer needs no extra header. Free
+ *      buffers are linked through their first word.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mw_error.h"
+#include "mw_types.h"
+#include "osapi.h"
+#include "osapi_memory.h"
+#include "osapi_string.h"
+#include "db_api.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define DB_MSG_POOL_NAME    "dbp"
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+#define DB_MSG_POOL_WORDS(__size__, __num__)    (((__size__) * (__num__)) / sizeof(UI32_T))
+
+/* DATA TYPE DECLARATIONS
+ */
+typedef struct DB_MSG_POOL_BLOCK_S
+{
+    struct DB_MSG_POOL_BLOCK_S *ptr_next;
+} DB_MSG_POOL_BLOCK_T;
+
+typedef struct DB_MSG_POOL_CLASS_S
+{
+    UI8_T                   *ptr_start;     /* The first byte of the arena */
+    UI8_T                   *ptr_end;       /* The byte after the arena */
+    DB_MSG_POOL_BLOCK_T     *ptr_free;      /* The free list */
+    UI16_T                  block_size;     /* The buffer size of the class */
+    UI16_T                  block_num;      /* The total buffers of the class */
+} DB_MSG_POOL_CLASS_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+ */
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+#if DB_MSG_POOL_SUPPORT
+static UI32_T _db_msg_pool_s[DB_MSG_POOL_WORDS(DB_MSG_POOL_S_SIZE, DB_MSG_POOL_S_NUM)];
+static UI32_T _db_msg_pool_m[DB_MSG_POOL_WORDS(DB_MSG_POOL_M_SIZE, DB_MSG_POOL_M_NUM)];
+static UI32_T _db_msg_pool_l[DB_MSG_POOL_WORDS(DB_MSG_POOL_L_SIZE, DB_MSG_POOL_L_NUM)];
+static UI32_T _db_msg_pool_xl[DB_MSG_POOL_WORDS(DB_MSG_POOL_XL_SIZE, DB_MSG_POOL_XL_NUM)];
+
+static DB_MSG_POOL_CLASS_T _db_msg_pool[DB_MSG_POOL_CLASS_NUM] =
+{
+    {
+        (UI8_T *)_db_msg_pool_s, (UI8_T *)_db_msg_pool_s + sizeof(_db_msg_pool_s), NULL,
+        DB_MSG_POOL_S_SIZE, DB_MSG_POOL_S_NUM
+    },
+    {
+        (UI8_T *)_db_msg_pool_m, (UI8_T *)_db_msg_pool_m + sizeof(_db_msg_pool_m), NULL,
+        DB_MSG_POOL_M_SIZE, DB_MSG_POOL_M_NUM
+    },
+    {
+        (UI8_T *)_db_msg_pool_l, (UI8_T *)_db_msg_pool_l + sizeof(_db_msg_pool_l), NULL,
+        DB_MSG_POOL_L_SIZE, DB_MSG_POOL_L_NUM
+    },
+    {
+        (UI8_T *)_db_msg_pool_xl, (UI8_T *)_db_msg_pool_xl + sizeof(_db_msg_pool_xl), NULL,
+        DB_MSG_POOL_XL_SIZE, DB_MSG_POOL_XL_NUM
+    },
+};
+static BOOL_T _db_msg_pool_inited = FALSE;
+#endif
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+#if DB_MSG_POOL_SUPPORT
+/* FUNCTION NAME: _db_msg_pool_init
+ * PURPOSE:
+ *      Link all blocks of every class into its free list.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called in critical section on the first allocation.
+ */
+static void
+_db_msg_pool_init(
+    void)
+{
+    UI8_T               class_idx;
+    UI16_T              blk_idx;
+    DB_MSG_POOL_CLASS_T *ptr_class = NULL;
+    DB_MSG_POOL_BLOCK_T *ptr_blk = NULL;
+
+    for (class_idx = 0; class_idx < DB_MSG_POOL_CLASS_NUM; class_idx++)
+    {
+        ptr_class = &_db_msg_pool[class_idx];
+        ptr_class->ptr_free = NULL;
+        for (blk_idx = ptr_class->block_num; blk_idx > 0; blk_idx--)
+        {
+            ptr_blk = (DB_MSG_POOL_BLOCK_T *)(ptr_class->ptr_start + ((blk_idx - 1) * ptr_class->block_size));
+            ptr_blk->ptr_next = ptr_class->ptr_free;
+            ptr_class->ptr_free = ptr_blk;
+        }
+    }
+    _db_msg_pool_inited = TRUE;
+}
+
+/* FUNCTION NAME: _db_msg_pool_owner
+ * PURPOSE:
+ *      Find the pool class which owns the buffer.
+ *
+ * INPUT:
+ *      ptr_buf         -- A pointer to the buffer
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      The pointer of the class, or NULL if the buffer comes from heap.
+ *
+ * NOTES:
+ *      None
+ */
+static DB_MSG_POOL_CLASS_T *
+_db_msg_pool_owner(
+    const UI8_T *ptr_buf)
+{
+    UI8_T class_idx;
+
+    for (class_idx = 0; class_idx < DB_MSG_POOL_CLASS_NUM; class_idx++)
+    {
+        if ((ptr_buf >= _db_msg_pool[class_idx].ptr_start) && (ptr_buf < _db_msg_pool[class_idx].ptr_end))
+        {
+            return &_db_msg_pool[class_idx];
+        }
+    }
+    return NULL;
+}
+#endif
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: dbapi_allocMsg
+ * PURPOSE:
+ *      Allocate a zeroed DB message buffer from the message pool.
+ *
+ * INPUT:
+ *      msg_size        -- The total size of the message
+ *
+ * OUTPUT:
+ *      pptr_msg        -- A double pointer returns the message buffer
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      None
+ */
+MW_ERROR_NO_T
+dbapi_allocMsg(
+    const UI32_T msg_size,
+    DB_MSG_T **pptr_msg)
+{
+#if DB_MSG_POOL_SUPPORT
+    UI8_T               class_idx;
+    DB_MSG_POOL_CLASS_T *ptr_class = NULL;
+    DB_MSG_POOL_BLOCK_T *ptr_blk = NULL;
+#endif
+
+    MW_CHECK_PTR(pptr_msg);
+    MW_PARAM_CHK((0 == msg_size), MW_E_BAD_PARAMETER);
+
+#if DB_MSG_POOL_SUPPORT
+    for (class_idx = 0; class_idx < DB_MSG_POOL_CLASS_NUM; class_idx++)
+    {
+        if (msg_size <= _db_msg_pool[class_idx].block_size)
+        {
+            break;
+        }
+    }
+    if (class_idx < DB_MSG_POOL_CLASS_NUM)
+    {
+        ptr_class = &_db_msg_pool[class_idx];
+        taskENTER_CRITICAL();
+        if (FALSE == _db_msg_pool_inited)
+        {
+            _db_msg_pool_init();
+        }
+        ptr_blk = ptr_class->ptr_free;
+        if (NULL != ptr_blk)
+        {
+            ptr_class->ptr_free = ptr_blk->ptr_next;
+        }
+        taskEXIT_CRITICAL();
+
+        if (NULL != ptr_blk)
+        {
+            osapi_memset(ptr_blk, 0, msg_size);
+            (*pptr_msg) = (DB_MSG_T *)ptr_blk;
+            return MW_E_OK;
+        }
+    }
+#endif
+
+    /* Too large or the class is empty, fall back to heap */
+    if (MW_E_OK != osapi_calloc(msg_size, DB_MSG_POOL_NAME, (void **)pptr_msg))
+    {
+        return MW_E_NO_MEMORY;
+    }
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_freeMsg
+ * PURPOSE:
+ *      Release a DB message buffer.
+ *
+ * INPUT:
+ *      ptr_msg         -- A pointer to the message to be released
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ */
+void
+dbapi_freeMsg(
+    DB_MSG_T *ptr_msg)
+{
+#if DB_MSG_POOL_SUPPORT
+    DB_MSG_POOL_CLASS_T *ptr_class = NULL;
+    DB_MSG_POOL_BLOCK_T *ptr_blk = NULL;
+#endif
+
+    if (NULL == ptr_msg)
+    {
+        return;
+    }
+
+#if DB_MSG_POOL_SUPPORT
+    ptr_class = _db_msg_pool_owner((const UI8_T *)ptr_msg);
+    if (NULL != ptr_class)
+    {
+        ptr_blk = (DB_MSG_POOL_BLOCK_T *)ptr_msg;
+        taskENTER_CRITICAL();
+        ptr_blk->ptr_next = ptr_class->ptr_free;
+        ptr_class->ptr_free = ptr_blk;
+        taskEXIT_CRITICAL();
+        return;
+    }
+#endif
+    osapi_free(ptr_msg);
+}
@@ -0,0 +1,139 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  db_ready.c
+ * PURPOSE:
+ *      Implement the wait of DB client daemons for DB ready.
+ *
+ * NOTES:
+ *      The first waiter to see DB ready records the tick, which is the
+ *      time-to-DB-ready of the boot.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mw_error.h"
+#include "mw_types.h"
+#include "db_api.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define DB_READY_POLL           (1)     /* the poll period of dbapi_waitReady */
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+ */
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+ */
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+static TickType_t _db_ready_tick = 0;  /* The tick DB is first seen ready, 0 if not yet */
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: dbapi_waitReady
+ * PURPOSE:
+ *      Wait until DB is ready.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      ptr_wait_ticks  -- The ticks waited, NULL if not needed
+ *
+ * RETURN:
+ *      MW_E_OK
+ *
+ * NOTES:
+ *      The caller sleeps between the polls, so DB task is not starved by
+ *      the daemons waiting for it.
+ */
+MW_ERROR_NO_T
+dbapi_waitReady(
+    UI32_T *ptr_wait_ticks)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (MW_E_OK != dbapi_dbisReady())
+    {
+        vTaskDelay(DB_READY_POLL);
+    }
+    taskENTER_CRITICAL();
+    if (0 == _db_ready_tick)
+    {
+        _db_ready_tick = xTaskGetTickCount();
+    }
+    taskEXIT_CRITICAL();
+    if (NULL != ptr_wait_ticks)
+    {
+        (*ptr_wait_ticks) = (UI32_T)(xTaskGetTickCount() - start);
+    }
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: dbapi_getReadyTick
+ * PURPOSE:
+ *      Get the tick DB is first seen ready since boot.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      The tick, 0 if no task has waited DB ready yet
+ *
+ * NOTES:
+ *      It is the time-to-DB-ready of the boot, within DB_READY_POLL.
+ */
+UI32_T
+dbapi_getReadyTick(
+    void)
+{
+    return (UI32_T)_db_ready_tick;
+}
@@ -92,6 +92,28 @@ typedef struct {
 } error;
 static error global_error = { NULL, 0 };
 
+/* A number is kept in valueint, unless it is not an int. Then valuestring
+ * points to the double and cJSON_NumberIsDouble is set. */
+#define number_is_double(item) (((item)->type & cJSON_NumberIsDouble) != 0)
+
+/* An array or object has no value of its own, so its valuestring keeps the
+ * last child for an O(1) append. It is only a hint: NULL means unknown, and
+ * a hint that is no longer last is walked forward. References share the
+ * children of another item and keep no hint. */
+#define has_tail(item) ((((item)->type & (cJSON_Array | cJSON_Object)) != 0) && !((item)->type & cJSON_IsReference))
+#define get_tail(item) ((cJSON*)(void*)(item)->valuestring)
+#define set_tail(item, tail) ((item)->valuestring = (char*)(void*)(tail))
+
+static double get_number(const cJSON * const item)
+{
+    if (number_is_double(item))
+    {
+        return *(const double*)(const void*)item->valuestring;
+    }
+
+    return (double)item->valueint;
+}
+
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void)
 {
     return (const char*) (global_error.json + global_error.position);
@@ -114,7 +136,7 @@ CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item)
         return (double) NAN;
     }
 
-    return item->valuedouble;
+    return get_number(item);
 }
 
 /* This is a safeguard to prevent copy-pasters from using incompatible C and header files */
@@ -239,18 +261,212 @@ CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
     }
 }
 
+/* Nodes are carved from shared chunks, so a node costs no heap block header
+ * of its own. A chunk is released once its last node is freed. Items are
+ * built by the mqttd task and parsed in the tcpip thread, hence the lock. */
+#ifndef CJSON_NODE_CHUNK_NUM
+#define CJSON_NODE_CHUNK_NUM 32
+#endif
+#ifndef CJSON_NODE_LOCK
+#include "lwip/sys.h"
+#define CJSON_NODE_DECL_LOCK SYS_ARCH_DECL_PROTECT(node_lock)
+#define CJSON_NODE_LOCK() SYS_ARCH_PROTECT(node_lock)
+#define CJSON_NODE_UNLOCK() SYS_ARCH_UNPROTECT(node_lock)
+#endif
+
+typedef struct cJSON_node_chunk
+{
+    struct cJSON_node_chunk *next;
+    cJSON *free_nodes;
+    size_t used;
+    cJSON nodes[CJSON_NODE_CHUNK_NUM];
+} cJSON_node_chunk;
+
+static cJSON_node_chunk *node_chunks = NULL;
+
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 {
-    cJSON* node = (cJSON*)hooks->allocate(sizeof(cJSON));
-    if (node)
+    CJSON_NODE_DECL_LOCK;
+    cJSON_node_chunk *chunk = NULL;
+    cJSON *node = NULL;
+    size_t i = 0;
+
+    CJSON_NODE_LOCK();
+    for (chunk = node_chunks; chunk != NULL; chunk = chunk->next)
     {
-        memset(node, '\0', sizeof(cJSON));
+        if (chunk->free_nodes != NULL)
+        {
+            node = chunk->free_nodes;
+            chunk->free_nodes = node->next;
+            chunk->used++;
+            break;
+        }
     }
+    CJSON_NODE_UNLOCK();
+
+    if (node == NULL)
+    {
+        chunk = (cJSON_node_chunk*)hooks->allocate(sizeof(cJSON_node_chunk));
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+        /* the first node is ours, the rest are free */
+        chunk->free_nodes = NULL;
+        for (i = CJSON_NODE_CHUNK_NUM - 1; i > 0; i--)
+        {
+            chunk->nodes[i].next = chunk->free_nodes;
+            chunk->free_nodes = &chunk->nodes[i];
+        }
+        chunk->used = 1;
+        node = &chunk->nodes[0];
+
+        CJSON_NODE_LOCK();
+        chunk->next = node_chunks;
+        node_chunks = chunk;
+        CJSON_NODE_UNLOCK();
+    }
+
+    memset(node, '\0', sizeof(cJSON));
 
     return node;
 }
 
+/* Internal destructor of the node itself. */
+static void cJSON_Free_Item(cJSON *node)
+{
+    CJSON_NODE_DECL_LOCK;
+    cJSON_node_chunk **link = NULL;
+    cJSON_node_chunk *chunk = NULL;
+
+    CJSON_NODE_LOCK();
+    for (link = &node_chunks; *link != NULL; link = &(*link)->next)
+    {
+        if ((node >= (*link)->nodes) && (node < ((*link)->nodes + CJSON_NODE_CHUNK_NUM)))
+        {
+            break;
+        }
+    }
+    if (*link != NULL)
+    {
+        node->next = (*link)->free_nodes;
+        (*link)->free_nodes = node;
+        (*link)->used--;
+        if ((*link)->used == 0)
+        {
+            chunk = *link;
+            *link = chunk->next;
+        }
+    }
+    CJSON_NODE_UNLOCK();
+
+    if (chunk != NULL)
+    {
+        global_hooks.deallocate(chunk);
+    }
+}
+
+/* Set the number of a cJSON_Number item, the double is only allocated when needed. */
+static cJSON_bool set_number(cJSON * const item, double number, const internal_hooks * const hooks)
+{
+    /* use saturation in case of overflow */
+    if (number >= INT_MAX)
+    {
+        item->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        item->valueint = INT_MIN;
+    }
+    else
+    {
+        item->valueint = (int)number;
+    }
+
+    if (number == (double)item->valueint)
+    {
+        if (number_is_double(item))
+        {
+            hooks->deallocate(item->valuestring);
+            item->valuestring = NULL;
+            item->type &= ~cJSON_NumberIsDouble;
+        }
+        return true;
+    }
+
+    if (!number_is_double(item))
+    {
+        item->valuestring = (char*)hooks->allocate(sizeof(double));
+        if (item->valuestring == NULL)
+        {
+            return false;
+        }
+        item->type |= cJSON_NumberIsDouble;
+    }
+    *(double*)(void*)item->valuestring = number;
+
+    return true;
+}
+
+/* Keys added by cJSON_AddItemToObject and the cJSON_Add...ToObject helpers
+ * are interned: each distinct key is allocated once and shared by all items
+ * as a constant key. Parsed keys are still duplicated per item. */
+#ifndef CJSON_KEY_INTERN_NUM
+#define CJSON_KEY_INTERN_NUM 128 /* a power of 2 */
+#endif
+#ifndef CJSON_KEY_INTERN_LEN
+#define CJSON_KEY_INTERN_LEN 32 /* longer keys are not interned */
+#endif
+static const char *interned_keys[CJSON_KEY_INTERN_NUM];
+
+static const char *intern_key(const char * const key, const internal_hooks * const hooks)
+{
+    size_t hash = 5381;
+    size_t length = 0;
+    size_t i = 0;
+    size_t slot = 0;
+    char *copy = NULL;
+
+    for (length = 0; key[length] != '\0'; length++)
+    {
+        if (length >= CJSON_KEY_INTERN_LEN)
+        {
+            return NULL;
+        }
+        hash = (hash * 33) ^ (unsigned char)key[length];
+    }
+
+    for (i = 0; i < CJSON_KEY_INTERN_NUM; i++)
+    {
+        slot = (hash + i) & (CJSON_KEY_INTERN_NUM - 1);
+        if (interned_keys[slot] == NULL)
+        {
+            break;
+        }
+        if (strcmp(interned_keys[slot], key) == 0)
+        {
+            return interned_keys[slot];
+        }
+    }
+    if (i == CJSON_KEY_INTERN_NUM)
+    {
+        /* table full */
+        return NULL;
+    }
+
+    copy = (char*)hooks->allocate(length + sizeof(""));
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy, key, length + sizeof(""));
+    /* The slot is written last, a racing writer at worst leaks its copy */
+    interned_keys[slot] = copy;
+
+    return copy;
+}
+
 /* Delete a cJSON structure. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 {
@@ -262,7 +478,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         {
             cJSON_Delete(item->child);
         }
-        if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
+        if (!(item->type & cJSON_IsReference) && !has_tail(item) && (item->valuestring != NULL))
         {
             global_hooks.deallocate(item->valuestring);
             item->valuestring = NULL;
@@ -272,7 +488,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
             global_hooks.deallocate(item->string);
             item->string = NULL;
         }
-        global_hooks.deallocate(item);
+        cJSON_Free_Item(item);
         item = next;
     }
 }
@@ -360,24 +576,12 @@ loop_end:
         return false; /* parse_error */
     }
 
-    item->valuedouble = number;
-
-    /* use saturation in case of overflow */
-    if (number >= INT_MAX)
-    {
-        item->valueint = INT_MAX;
-    }
-    else if (number <= (double)INT_MIN)
-    {
-        item->valueint = INT_MIN;
-    }
-    else
+    item->type = cJSON_Number;
+    if (!set_number(item, number, &(input_buffer->hooks)))
     {
-        item->valueint = (int)number;
+        return false; /* allocation failure */
     }
 
-    item->type = cJSON_Number;
-
     input_buffer->offset += (size_t)(after_end - number_c_string);
     return true;
 }
@@ -385,6 +589,14 @@ loop_end:
 /* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
 CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
 {
+    if ((object->type & 0xFF) == cJSON_Number)
+    {
+        /* an allocation failure keeps the saturated int */
+        (void)set_number(object, number, &global_hooks);
+        return get_number(object);
+    }
+
+    /* valuestring of other types is not ours to use */
     if (number >= INT_MAX)
     {
         object->valueint = INT_MAX;
@@ -398,7 +610,7 @@ CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
         object->valueint = (int)number;
     }
 
-    return object->valuedouble = number;
+    return number;
 }
 
 /* Note: when passing a NULL valuestring, cJSON_SetValuestring treats this as an error and return NULL */
@@ -566,7 +778,7 @@ static cJSON_bool compare_double(double a, double b)
 static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
 {
     unsigned char *output_pointer = NULL;
-    double d = item->valuedouble;
+    double d = get_number(item);
     int length = 0;
     size_t i = 0;
     unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
@@ -583,7 +795,7 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     {
         length = sprintf((char*)number_buffer, "null");
     }
-    else if(d == (double)item->valueint)
+    else if(!number_is_double(item))
     {
         length = sprintf((char*)number_buffer, "%d", item->valueint);
     }
@@ -1518,7 +1730,6 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
         {
             /* add to the end and advance */
             current_item->next = new_item;
-            new_item->prev = current_item;
             current_item = new_item;
         }
 
@@ -1541,10 +1752,6 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
 success:
     input_buffer->depth--;
 
-    if (head != NULL) {
-        head->prev = current_item;
-    }
-
     item->type = cJSON_Array;
     item->child = head;
 
@@ -1676,7 +1883,6 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
         {
             /* add to the end and advance */
             current_item->next = new_item;
-            new_item->prev = current_item;
             current_item = new_item;
         }
 
@@ -1722,10 +1928,6 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
 success:
     input_buffer->depth--;
 
-    if (head != NULL) {
-        head->prev = current_item;
-    }
-
     item->type = cJSON_Object;
     item->child = head;
 
@@ -1959,7 +2161,19 @@ CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *st
 static void suffix_object(cJSON *prev, cJSON *item)
 {
     prev->next = item;
-    item->prev = prev;
+}
+
+/* Find the link pointing to item in the children of parent. */
+static cJSON **find_link(cJSON * const parent, const cJSON * const item)
+{
+    cJSON **link = &(parent->child);
+
+    while ((*link != NULL) && (*link != item))
+    {
+        link = &((*link)->next);
+    }
+
+    return (*link != NULL) ? link : NULL;
 }
 
 /* Utility for handling references. */
@@ -1980,7 +2194,7 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
     reference->type |= cJSON_IsReference;
-    reference->next = reference->prev = NULL;
+    reference->next = NULL;
     return reference;
 }
 
@@ -1993,25 +2207,32 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         return false;
     }
 
-    child = array->child;
     /*
-     * To find the last item in array quickly, we use prev in array
+     * Children are singly linked, start from the kept last one if any
      */
+    child = has_tail(array) ? get_tail(array) : NULL;
+    if (child == NULL)
+    {
+        child = array->child;
+    }
     if (child == NULL)
     {
         /* list is empty, start new one */
         array->child = item;
-        item->prev = item;
         item->next = NULL;
     }
     else
     {
         /* append to the end */
-        if (child->prev)
+        while (child->next != NULL)
         {
-            suffix_object(child->prev, item);
-            array->child->prev = item;
+            child = child->next;
         }
+        suffix_object(child, item);
+    }
+    if (has_tail(array))
+    {
+        set_tail(array, item);
     }
 
     return true;
@@ -2054,6 +2275,10 @@ static cJSON_bool add_item_to_object(cJSON * const object, const char * const st
         new_key = (char*)cast_away_const(string);
         new_type = item->type | cJSON_StringIsConst;
     }
+    else if ((new_key = (char*)cast_away_const(intern_key(string, hooks))) != NULL)
+    {
+        new_type = item->type | cJSON_StringIsConst;
+    }
     else
     {
         new_key = (char*)cJSON_strdup((const unsigned char*)string, hooks);
@@ -2217,35 +2442,27 @@ CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * c
 
 CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const item)
 {
-    if ((parent == NULL) || (item == NULL) || (item != parent->child && item->prev == NULL))
-    {
-        return NULL;
-    }
+    cJSON **link = NULL;
 
-    if (item != parent->child)
-    {
-        /* not the first element */
-        item->prev->next = item->next;
-    }
-    if (item->next != NULL)
+    if ((parent == NULL) || (item == NULL))
     {
-        /* not the last element */
-        item->next->prev = item->prev;
+        return NULL;
     }
 
-    if (item == parent->child)
+    link = find_link(parent, item);
+    if (link == NULL)
     {
-        /* first element */
-        parent->child = item->next;
+        /* not a child of parent */
+        return NULL;
     }
-    else if (item->next == NULL)
+    if (has_tail(parent) && (get_tail(parent) == item))
     {
-        /* last element */
-        parent->child->prev = item->prev;
+        /* next is the first member, so a link other than child is the previous item */
+        set_tail(parent, (link == &(parent->child)) ? NULL : (cJSON*)(void*)link);
     }
+    *link = item->next;
 
     /* make sure the detached item doesn't point anywhere anymore */
-    item->prev = NULL;
     item->next = NULL;
 
     return item;
@@ -2293,35 +2510,26 @@ CJSON_PUBLIC(void) cJSON_DeleteItemFromObjectCaseSensitive(cJSON *object, const
 /* Replace array/object items with new ones. */
 CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem)
 {
-    cJSON *after_inserted = NULL;
+    cJSON **link = NULL;
 
-    if (which < 0 || newitem == NULL)
+    if (which < 0 || newitem == NULL || array == NULL)
     {
         return false;
     }
 
-    after_inserted = get_array_item(array, (size_t)which);
-    if (after_inserted == NULL)
+    link = &(array->child);
+    while ((*link != NULL) && (which > 0))
     {
-        return add_item_to_array(array, newitem);
-    }
-
-    if (after_inserted != array->child && after_inserted->prev == NULL) {
-        /* return false if after_inserted is a corrupted array item */
-        return false;
+        link = &((*link)->next);
+        which--;
     }
-
-    newitem->next = after_inserted;
-    newitem->prev = after_inserted->prev;
-    after_inserted->prev = newitem;
-    if (after_inserted == array->child)
-    {
-        array->child = newitem;
-    }
-    else
+    if (*link == NULL)
     {
-        newitem->prev->next = newitem;
+        return add_item_to_array(array, newitem);
     }
+
+    newitem->next = *link;
+    *link = newitem;
     return true;
 }
 
@@ -2332,43 +2540,26 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         return false;
     }
 
+    cJSON **link = NULL;
+
     if (replacement == item)
     {
         return true;
     }
 
-    replacement->next = item->next;
-    replacement->prev = item->prev;
-
-    if (replacement->next != NULL)
+    link = find_link(parent, item);
+    if (link == NULL)
     {
-        replacement->next->prev = replacement;
+        return false;
     }
-    if (parent->child == item)
+    replacement->next = item->next;
+    *link = replacement;
+    if (has_tail(parent) && (get_tail(parent) == item))
     {
-        if (parent->child->prev == parent->child)
-        {
-            replacement->prev = replacement;
-        }
-        parent->child = replacement;
-    }
-    else
-    {   /*
-         * To find the last item in array quickly, we use prev in array.
-         * We can't modify the last item's next pointer where this item was the parent's child
-         */
-        if (replacement->prev != NULL)
-        {
-            replacement->prev->next = replacement;
-        }
-        if (replacement->next == NULL)
-        {
-            parent->child->prev = replacement;
-        }
+        set_tail(parent, replacement);
     }
 
     item->next = NULL;
-    item->prev = NULL;
     cJSON_Delete(item);
 
     return true;
@@ -2468,20 +2659,10 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
     if(item)
     {
         item->type = cJSON_Number;
-        item->valuedouble = num;
-
-        /* use saturation in case of overflow */
-        if (num >= INT_MAX)
-        {
-            item->valueint = INT_MAX;
-        }
-        else if (num <= (double)INT_MIN)
-        {
-            item->valueint = INT_MIN;
-        }
-        else
+        if (!set_number(item, num, &global_hooks))
         {
-            item->valueint = (int)num;
+            cJSON_Delete(item);
+            return NULL;
         }
     }
 
@@ -2611,10 +2792,6 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateIntArray(const int *numbers, int count)
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
-    }
-
     return a;
 }
 
@@ -2651,10 +2828,6 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateFloatArray(const float *numbers, int count)
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
-    }
-
     return a;
 }
 
@@ -2691,10 +2864,6 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateDoubleArray(const double *numbers, int count)
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
-    }
-
     return a;
 }
 
@@ -2731,10 +2900,6 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char *const *strings, int co
         p = n;
     }
 
-    if (a && a->child) {
-        a->child->prev = n;
-    }
-
     return a;
 }
 
@@ -2767,8 +2932,15 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
     /* Copy over all vars */
     newitem->type = item->type & (~cJSON_IsReference);
     newitem->valueint = item->valueint;
-    newitem->valuedouble = item->valuedouble;
-    if (item->valuestring)
+    if (number_is_double(item))
+    {
+        newitem->type &= ~cJSON_NumberIsDouble;
+        if (!set_number(newitem, get_number(item), &global_hooks))
+        {
+            goto fail;
+        }
+    }
+    else if (item->valuestring && !(item->type & (cJSON_Array | cJSON_Object)))
     {
         newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
         if (!newitem->valuestring)
@@ -2803,9 +2975,8 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
         }
         if (next != NULL)
         {
-            /* If newitem->child already set, then crosswire ->prev and ->next and move on */
+            /* If newitem->child already set, then link ->next and move on */
             next->next = newchild;
-            newchild->prev = next;
             next = newchild;
         }
         else
@@ -2816,11 +2987,6 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
         }
         child = child->next;
     }
-    if (newitem && newitem->child)
-    {
-        newitem->child->prev = newchild;
-    }
-
     return newitem;
 
 fail:
@@ -3068,7 +3234,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             return true;
 
         case cJSON_Number:
-            if (compare_double(a->valuedouble, b->valuedouble))
+            if (compare_double(get_number(a), get_number(b)))
             {
                 return true;
             }
@@ -0,0 +1,103 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_bind.h
+ * PURPOSE:
+ *      It provides the field binding tables to fill DB structures from
+ *      the setConfig JSON objects.
+ *
+ * NOTES:
+ */
+
+#ifndef _MQTTD_BIND_H_
+#define _MQTTD_BIND_H_
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <stddef.h>
+#include "mw_error.h"
+#include "mw_types.h"
+#include "hr_cjson.h"
+/* NAMING CONSTANT DECLARATIONS
+*/
+#define MQTTD_BIND_MAX_FIELDS       (32)    /* the present bitmap is UI32_T */
+
+/* MACRO FUNCTION DECLARATIONS
+*/
+#define MQTTD_BIND_SIZE(st, m)      (sizeof(((st *)0)->m))
+/* A field stored into member m of structure st */
+#define MQTTD_BIND_FIELD(key, type, st, m, min, max, map) \
+    { (key), (type), (UI8_T)MQTTD_BIND_SIZE(st, m), (UI16_T)offsetof(st, m), (min), (max), (map), \
+      (UI8_T)(((map) != NULL) ? (sizeof(map) / sizeof((map)[0])) : 0) }
+/* A field the caller handles itself, see mqttd_bind_parse */
+#define MQTTD_BIND_ITEM(key) \
+    { (key), MQTTD_BIND_TYPE_ITEM, 0, 0, 0, 0, NULL, 0 }
+
+/* DATA TYPE DECLARATIONS
+*/
+typedef enum {
+    MQTTD_BIND_TYPE_ITEM = 0,   /* not stored, the cJSON item is returned */
+    MQTTD_BIND_TYPE_INT,        /* a number in [min, max] */
+    MQTTD_BIND_TYPE_MAP,        /* a number translated by the map, others are min if max is not 0 */
+    MQTTD_BIND_TYPE_MAC,        /* a MAC address string */
+    MQTTD_BIND_TYPE_PORTS,      /* an array of port numbers in [min, max] OR-ed as a bitmap */
+    MQTTD_BIND_TYPE_LAST
+} MQTTD_BIND_TYPE_T;
+
+/* A JSON value and the value stored for it */
+typedef struct MQTTD_BIND_MAP_S
+{
+    I32_T           json;
+    I32_T           value;
+} MQTTD_BIND_MAP_T;
+
+typedef struct MQTTD_BIND_FIELD_S
+{
+    const C8_T              *ptr_key;   /* The JSON key */
+    UI8_T                   type;       /* MQTTD_BIND_TYPE_T */
+    UI8_T                   size;       /* The size of the member, 1, 2 or 4, the bytes of a MAC */
+    UI16_T                  offset;     /* The offset of the member */
+    I32_T                   min;
+    I32_T                   max;
+    const MQTTD_BIND_MAP_T  *ptr_map;   /* MQTTD_BIND_TYPE_MAP only */
+    UI8_T                   map_num;
+} MQTTD_BIND_FIELD_T;
+
+/* EXPORTED SUBPROGRAM SPECIFICATIONS
+ */
+MW_ERROR_NO_T mqttd_bind_parse(const cJSON *ptr_obj, const MQTTD_BIND_FIELD_T *ptr_tbl, const UI8_T num, void *ptr_dst, const cJSON **pptr_items, UI32_T *ptr_present);
+void mqttd_bind_apply(const MQTTD_BIND_FIELD_T *ptr_tbl, const UI8_T num, const UI32_T present, const void *ptr_src, void *ptr_dst);
+
+#endif  /*_MQTTD_BIND_H_*/
@@ -54,6 +54,7 @@
 #define MQTTD_QUEUE_LEN             (18)
 #define MQTTD_QUEUE_BLOCKTIMEOUT    (0xFFFFFFFF)
 #define MQTTD_QUEUE_TIMEOUT         (100)
+#define MQTTD_GET_QUEUE_RETRY       (50)    /* times of MQTTD_QUEUE_TIMEOUT to wait a get response */
 #define MQTTD_ACCEPTMBOX_SIZE       (4)
 
 /* MACRO FUNCTION DECLARATIONS
@@ -67,9 +68,13 @@
 
 MW_ERROR_NO_T inline mqttd_queue_init();
 void mqttd_queue_free();
-MW_ERROR_NO_T mqttd_queue_recv(void **ptr_buf);
+MW_ERROR_NO_T mqttd_queue_wait(const UI32_T timeout, DB_MSG_T **pptr_msg, UI32_T *ptr_events);
+MW_ERROR_NO_T mqttd_queue_post(const UI32_T events);
 MW_ERROR_NO_T mqttd_queue_send(const UI8_T method, const UI8_T t_idx, const UI8_T f_idx, const UI16_T e_idx, const void *ptr_data, const UI16_T size, DB_MSG_T **pptr_out_msg);
 MW_ERROR_NO_T mqttd_queue_setData(const UI8_T method, const UI8_T t_idx, const UI8_T f_idx, const UI16_T e_idx, const void *ptr_data, const UI16_T size);
 MW_ERROR_NO_T mqttd_queue_getData(const UI8_T in_t_idx, const UI8_T in_f_idx, const UI16_T in_e_idx, DB_MSG_T **pptr_out_msg, UI16_T *ptr_out_size, void **pptr_out_data);
+MW_ERROR_NO_T mqttd_queue_getDataReq(const UI8_T in_t_idx, const UI8_T in_f_idx, const UI16_T in_e_idx, UI16_T *ptr_req_id);
+MW_ERROR_NO_T mqttd_queue_getDataWait(const UI16_T req_id, DB_MSG_T **pptr_out_msg, UI16_T *ptr_out_size, void **pptr_out_data);
+void mqttd_queue_getDataCancel(const UI16_T req_id);
 
 #endif  /*_MQTTD_QUEUE_H_*/
@@ -0,0 +1,77 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_rsp.h
+ * PURPOSE:
+ *      It provides the cache of serialized response sections.
+ *
+ * NOTES:
+ */
+
+#ifndef _MQTTD_RSP_H_
+#define _MQTTD_RSP_H_
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include "mw_error.h"
+#include "mw_types.h"
+#include "hr_cjson.h"
+/* NAMING CONSTANT DECLARATIONS
+*/
+
+/* MACRO FUNCTION DECLARATIONS
+*/
+
+/* DATA TYPE DECLARATIONS
+*/
+/* The cached sections, see _mqttd_rsp_table for the DB table each one is built from */
+typedef enum {
+    MQTTD_RSP_CAPABILITY = 0,       /* "data" of capability */
+    MQTTD_RSP_REMOTE_PROTOCOLS,     /* "remote_protocols" of getConfig */
+    MQTTD_RSP_DEVICE,               /* "device" of getConfig */
+    MQTTD_RSP_LAST
+} MQTTD_RSP_ID_T;
+
+/* Build the section, the cache owns and deletes the returned item */
+typedef MW_ERROR_NO_T (*MQTTD_RSP_BUILD_FUNC_T)(void *ptr_cookie, cJSON **pptr_item);
+
+/* EXPORTED SUBPROGRAM SPECIFICATIONS
+ */
+MW_ERROR_NO_T mqttd_rsp_init(void);
+void mqttd_rsp_notify(const UI8_T t_idx);
+MW_ERROR_NO_T mqttd_rsp_add(const MQTTD_RSP_ID_T id, cJSON *ptr_obj, const C8_T *ptr_name, MQTTD_RSP_BUILD_FUNC_T build, void *ptr_cookie);
+void mqttd_rsp_deinit(void);
+
+#endif  /*_MQTTD_RSP_H_*/
@@ -0,0 +1,101 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_smac.h
+ * PURPOSE:
+ *      It provides the static MAC index used by mqttd to apply deltas.
+ *
+ * NOTES:
+ */
+
+#ifndef _MQTTD_SMAC_H_
+#define _MQTTD_SMAC_H_
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include "mw_error.h"
+#include "mw_types.h"
+#include "db_api.h"
+#include "db_data.h"
+/* NAMING CONSTANT DECLARATIONS
+*/
+#define MQTTD_SMAC_MAC_LEN          (6)
+#define MQTTD_SMAC_HASH_SIZE        (256)       /* buckets, a power of 2 */
+#define MQTTD_SMAC_SLOT_NONE        (0xFFFF)    /* the (MAC, VID) is not in STATIC_MAC_ENTRY */
+#define MQTTD_SMAC_VID_MIN          (1)
+#define MQTTD_SMAC_VID_MAX          (4094)
+
+#if (MQTTD_SMAC_HASH_SIZE < MAX_STATIC_MAC_NUM)
+#error "MQTTD_SMAC_HASH_SIZE must not be less than MAX_STATIC_MAC_NUM"
+#endif
+
+/* MACRO FUNCTION DECLARATIONS
+*/
+#define MQTTD_SMAC_FIELD_SIZE(f)    (sizeof(((DB_STATIC_MAC_ENTRY_T *)0)->f[0]))
+/* One entry of all fields as DB takes and returns it: mac_addr, vid and port */
+#define MQTTD_SMAC_ENTRY_OFFSET_VID     (MQTTD_SMAC_FIELD_SIZE(mac_addr))
+#define MQTTD_SMAC_ENTRY_OFFSET_PORT    (MQTTD_SMAC_ENTRY_OFFSET_VID + MQTTD_SMAC_FIELD_SIZE(vid))
+#define MQTTD_SMAC_ENTRY_SIZE           (MQTTD_SMAC_ENTRY_OFFSET_PORT + MQTTD_SMAC_FIELD_SIZE(port))
+
+/* DATA TYPE DECLARATIONS
+*/
+/* The static MAC index, a copy of STATIC_MAC_ENTRY hashed by (MAC, VID).
+ * A slot is used when its port is not 0. Buckets and the free list are
+ * chained through next[].
+ */
+typedef struct MQTTD_SMAC_IDX_S
+{
+    UI32_T                  generation;                     /* The generation the index is built at */
+    UI16_T                  used;                           /* The slots with an entry */
+    UI16_T                  free_head;                      /* The first free slot */
+    UI16_T                  head[MQTTD_SMAC_HASH_SIZE];     /* The first slot of each bucket */
+    UI16_T                  next[MAX_STATIC_MAC_NUM];       /* The next slot of the bucket or the free list */
+    DB_STATIC_MAC_ENTRY_T   tbl;                            /* STATIC_MAC_ENTRY */
+} MQTTD_SMAC_IDX_T;
+
+/* EXPORTED SUBPROGRAM SPECIFICATIONS
+ */
+MW_ERROR_NO_T mqttd_smac_idx_init(void);
+void mqttd_smac_idx_notify(const UI8_T t_idx);
+void mqttd_smac_idx_notify_data(const DB_REQUEST_TYPE_T *ptr_req, const void *ptr_data, const UI16_T size);
+MW_ERROR_NO_T mqttd_smac_idx_get(MQTTD_SMAC_IDX_T **pptr_idx);
+void mqttd_smac_idx_release(void);
+UI16_T mqttd_smac_idx_find(const MQTTD_SMAC_IDX_T *ptr_idx, const UI8_T *ptr_mac, const UI16_T vid);
+MW_ERROR_NO_T mqttd_smac_idx_add(MQTTD_SMAC_IDX_T *ptr_idx, const UI8_T *ptr_mac, const UI16_T vid, const UI8_T port, UI16_T *ptr_slot);
+MW_ERROR_NO_T mqttd_smac_idx_del(MQTTD_SMAC_IDX_T *ptr_idx, const UI16_T slot);
+MW_ERROR_NO_T mqttd_smac_idx_commit(MQTTD_SMAC_IDX_T *ptr_idx, const UI16_T slot);
+MW_ERROR_NO_T mqttd_smac_mac_parse(const C8_T *ptr_str, UI8_T *ptr_mac);
+
+#endif  /*_MQTTD_SMAC_H_*/
@@ -0,0 +1,89 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_vlan.h
+ * PURPOSE:
+ *      It provides the VLAN index shared by mqttd report builders.
+ *
+ * NOTES:
+ */
+
+#ifndef _MQTTD_VLAN_H_
+#define _MQTTD_VLAN_H_
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include "mw_error.h"
+#include "mw_types.h"
+#include "db_api.h"
+#include "db_data.h"
+/* NAMING CONSTANT DECLARATIONS
+*/
+#define MQTTD_VLAN_VID_NUM          (4096)
+#define MQTTD_VLAN_VIDX_NONE        (0xFF)  /* the VID is not in VLAN_ENTRY */
+
+/* MACRO FUNCTION DECLARATIONS
+*/
+
+/* DATA TYPE DECLARATIONS
+*/
+/* The VLAN index, built from VLAN_ENTRY, PORT_VLAN_LIST and PORT_PVID.
+ * All per-port sets are bitmaps of VLAN_ENTRY indexes like PORT_VLAN_LIST,
+ * so they can be walked by BITMAP_VLAN_FOREACH.
+ */
+typedef struct MQTTD_VLAN_IDX_S
+{
+    UI32_T          generation;                     /* The generation the index is built at */
+    UI32_T          used;                           /* The entries with a VID */
+    UI32_T          member;                         /* The entries reported in vlan_member */
+    UI32_T          vlan_list[PLAT_MAX_PORT_NUM];   /* PORT_VLAN_LIST of each port */
+    UI32_T          tagged[PLAT_MAX_PORT_NUM];      /* The entries the port is a tagged member */
+    UI32_T          untagged[PLAT_MAX_PORT_NUM];    /* The entries the port is an untagged member */
+    UI16_T          pvid[PLAT_MAX_PORT_NUM];        /* PORT_PVID of each port */
+    UI16_T          vidx2vid[MAX_VLAN_ENTRY_NUM];   /* The VID of each entry, 0 is unused */
+    UI8_T           vid2vidx[MQTTD_VLAN_VID_NUM];   /* The entry of each VID */
+} MQTTD_VLAN_IDX_T;
+
+/* EXPORTED SUBPROGRAM SPECIFICATIONS
+ */
+MW_ERROR_NO_T mqttd_vlan_idx_init(void);
+void mqttd_vlan_idx_notify(const UI8_T t_idx);
+UI32_T mqttd_vlan_idx_generation(void);
+MW_ERROR_NO_T mqttd_vlan_idx_build(const UI32_T generation, const DB_VLAN_ENTRY_T *ptr_vlan_entry_tbl, const UI32_T *ptr_vlan_list_tbl, const UI16_T *ptr_pvid_tbl);
+MW_ERROR_NO_T mqttd_vlan_idx_acquire(const UI32_T generation, const MQTTD_VLAN_IDX_T **pptr_idx);
+MW_ERROR_NO_T mqttd_vlan_idx_get(const MQTTD_VLAN_IDX_T **pptr_idx);
+void mqttd_vlan_idx_release(void);
+
+#endif  /*_MQTTD_VLAN_H_*/
@@ -46,6 +46,10 @@
 #include <air_chipscu.h>
 #include "mqttd.h"
 #include "mqttd_queue.h"
+#include "mqttd_vlan.h"
+#include "mqttd_smac.h"
+#include "mqttd_bind.h"
+#include "mqttd_rsp.h"
 #include "mw_error.h"
 #include "mw_utils.h"
 #include "lwip/ip.h"
@@ -55,7 +59,18 @@
 #include "lwip/apps/mqtt_priv.h"
 #include "lwip/dns.h"
 #include "lwip/netif.h"
+#include "lwip/sys.h"
+/* Connect to the remote server over TLS whenever lwIP is built with mbedTLS */
+#ifndef MQTTD_SUPPORT_TLS
+#define MQTTD_SUPPORT_TLS           (LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS)
+#endif
+#if MQTTD_SUPPORT_TLS
+#include "lwip/altcp_tls.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/version.h"
+#endif
 #include "mbedtls/md5.h"
+#include "FreeRTOS.h"
 #include "osapi.h"
 #include "osapi_timer.h"
 #include "osapi_thread.h"
@@ -87,9 +102,15 @@
 #define MQTTD_TIMER_PERIOD          (500)
 #define MQTTD_MUX_LOCK_TIME         (50)
 #define MQTTD_MAX_REMAIN_MSG        (64)
+#define MQTTD_INTERACTIVE_RESERVE   (8)     /* the remain list slots only the interactive replies take */
+#define MQTTD_BULK_MAX_INFLIGHT     (1)     /* bulk PUBLISH given to lwIP at once, see _mqttd_replay_remain */
 #define MQTTD_MAX_BUFFER_SIZE       (64)
-#define MQTTD_RECONNECT_TIMER_NAME  "mqttdReTmr"
-#define MQTTD_TIMER_RECONNECT_PERIOD (1000)
+#define MQTTD_RECONNECT_MIN_DELAY   (1000)  /* ms, the first reconnect backoff */
+#define MQTTD_RECONNECT_MAX_DELAY   (64000) /* ms, the backoff ceiling */
+/* Events posted to the mqttd task, see mqttd_queue_post */
+#define MQTTD_EVENT_TICK            BIT(0)  /* the status timer expired */
+#define MQTTD_EVENT_REPLAY          BIT(1)  /* a PUBLISH completed, replay the held messages */
+#define MQTTD_EVENT_WAKE            BIT(2)  /* the state is changed by another task */
 
 /* MQTTD Client ID
 */
@@ -116,11 +137,29 @@ const ip_addr_t mqttd_server_ip = IPADDR4_INIT_BYTES(192, 168, 0, 100);  // for
 #if LWIP_DNS
 const C8_T cloud_hostname[] = "swmgr.hruicloud.com";
 #endif
+#if MQTTD_SUPPORT_TLS
+#if !(LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS)
+#error "MQTTD_SUPPORT_TLS needs LWIP_ALTCP_TLS_MBEDTLS"
+#endif
+#define MQTT_SRV_PORT			    (MQTT_TLS_PORT)
+#define MQTTD_TLS_CA_CERT           (NULL)  /* PEM of the server CA, NULL skips the verification */
+#define MQTTD_TLS_CA_CERT_LEN       (0)
+/* The session ID accessors came with mbedTLS 3.4 */
+#if MBEDTLS_VERSION_NUMBER < 0x03040000
+#define mbedtls_ssl_session_get_id(__session__)        (&((__session__)->id))
+#define mbedtls_ssl_session_get_id_len(__session__)    ((__session__)->id_len)
+#endif
+#else
 #define MQTT_SRV_PORT			    (10883)
+#endif
 #define MQTTD_USERNAME              "ik_test"
 #define MQTTD_PASSWD                "eiChaes7"
 #define MQTTD_KEEP_ALIVE            (60)
+#define MQTTD_KEEP_SESSION          (1)     /* Resume the broker session on reconnect */
+#define MQTTD_PROTOCOL_VERSION      (MQTT_VERSION_5)    /* Topic aliases and the broker flow control */
 #define MQTTD_RC4_KEY               "sqMVh5qAnHpLeMeM"
+#define MQTTD_SERVER_CACHE_TTL      (86400) /* Default lifetime of the cached broker address in seconds */
+#define MQTTD_SERVER_RACE_DELAY     (2000)  /* Head start of the cached address over a newer DNS answer in ms */
 
 /* MQTTD Topics
 */
@@ -160,6 +199,15 @@ const C8_T cloud_hostname[] = "swmgr.hruicloud.com";
 #define MQTTD_STATUS_TICK_OFFSET    (10)
 #define MQTTD_MAC_TICK_OFFSET       (0)
 #define MQTTD_MAX_CHUNK_NUM         (3)
+#define MQTTD_JSON_BUFF_SIZE        (MQTTD_MQX_OUTPUT_SIZE * MQTTD_MAX_CHUNK_NUM + 5)
+#if (MQTTD_MAX_PACKET_SIZE > MQTTD_MQX_OUTPUT_SIZE)
+#error "A continuity chunk of MQTTD_MAX_PACKET_SIZE must fit in mqtt_buff"
+#endif
+/* getConfig is answered by one message per section or page, see _mqttd_getconfig_emit */
+#define MQTTD_GETCONF_MSG_ID_SIZE   (64)
+#define MQTTD_GETCONF_ENVELOPE_SIZE (96 + MQTTD_GETCONF_MSG_ID_SIZE)                /* type, msg_id, continuity, seq, final and result */
+#define MQTTD_GETCONF_PAGE_SIZE     (MQTTD_MAX_PACKET_SIZE - MQTTD_GETCONF_ENVELOPE_SIZE) /* the printed data of one message */
+#define MQTTD_GETCONF_PAGE_FRAME    (7)     /* {"":[]} around the name and the items of a page */
 typedef enum {
     MQTTD_TX_CAPABILITY = 0,
     MQTTD_TX_RULES = 1,
@@ -177,6 +225,12 @@ typedef enum {
 }MQTTD_TX_TYPE;
 /* MACRO FUNCTION DECLARATIONS
  */
+/* One DYNAMIC_MAC_ADDRESS_ENTRY entry of all fields: mac_addr, vid, port and age */
+#define MQTTD_MACS_DYN_FIELD_SIZE(f)    (sizeof(((DB_DYNAMIC_MAC_ADDRESS_ENTRY_T *)0)->f[0]))
+#define MQTTD_MACS_DYN_OFFSET_VID       (MQTTD_MACS_DYN_FIELD_SIZE(mac_addr))
+#define MQTTD_MACS_DYN_OFFSET_PORT      (MQTTD_MACS_DYN_OFFSET_VID + MQTTD_MACS_DYN_FIELD_SIZE(vid))
+/* The mac_info of a port and VLAN index in the MAC table report */
+#define MQTTD_MACS_INFO_IDX(port, vidx) ((port) * MAX_VLAN_ENTRY_NUM + (vidx))
 
 /* DATA TYPE DECLARATIONS
 */
@@ -213,6 +267,7 @@ typedef struct MQTTD_PUB_MSG_OLD_S
     void*           ptr_data;
 } ATTRIBUTE_PACK MQTTD_PUB_MSG_OLD_T;
 
+/* The PUBLISH payload header on the wire, only used to serialize the payload */
 typedef struct MQTTD_PUB_MSG_S
 {
     UI8_T           pid;           /* The packet index of the whole message */
@@ -222,38 +277,105 @@ typedef struct MQTTD_PUB_MSG_S
     void*           ptr_data;
 } ATTRIBUTE_PACK MQTTD_PUB_MSG_T;
 
+/* The state of a remained PUBLISH */
+typedef enum {
+    MQTTD_PUB_INFLIGHT = 0,     /* Given to lwIP, waiting for PUBACK */
+    MQTTD_PUB_ACKED,            /* Acknowledged, to be freed */
+    MQTTD_PUB_REPLAY,           /* Not acknowledged, to be published again */
+    MQTTD_PUB_QUEUED            /* Waiting for its turn, never given to lwIP */
+} MQTTD_PUB_STATE_T;
+
+#define MQTTD_PUB_WAITING(ptr_msg)  ((MQTTD_PUB_REPLAY == (ptr_msg)->state) || (MQTTD_PUB_QUEUED == (ptr_msg)->state))
+
+/* The publish lane of a message, a lower lane is sent first */
+typedef enum {
+    MQTTD_PUB_LANE_INTERACTIVE = 0, /* Replies to the cloud requests */
+    MQTTD_PUB_LANE_BULK,            /* Periodic reports and DB change events */
+    MQTTD_PUB_LANE_LAST
+} MQTTD_PUB_LANE_T;
+
+/* The remained PUBLISH list node, the links come first for the list walk */
 typedef struct MQTTD_PUB_LIST_S
 {
-    C8_T            topic[MQTTD_MAX_TOPIC_SIZE];
-    UI16_T          msg_size;
-    void*           msg;
     struct MQTTD_PUB_LIST_S *next;
-} ATTRIBUTE_PACK MQTTD_PUB_LIST_T;
+    void*           msg;
+    UI16_T          msg_size;
+    volatile UI8_T  state;      /* MQTTD_PUB_STATE_T, set by _mqttd_publish_cb */
+    UI8_T           lane;       /* MQTTD_PUB_LANE_T */
+    C8_T            topic[MQTTD_MAX_TOPIC_SIZE];
+} MQTTD_PUB_LIST_T;
 
-/* The MQTTD ctrl structure */
+/* Where the server_ip of the current connect attempt comes from */
+typedef enum {
+    MQTTD_SERVER_SRC_NONE = 0,
+    MQTTD_SERVER_SRC_FIXED,     /* Set by console, never resolved */
+    MQTTD_SERVER_SRC_CACHE,     /* The cached address, a DNS refresh races it */
+    MQTTD_SERVER_SRC_DNS,       /* A DNS answer */
+    MQTTD_SERVER_SRC_DEFAULT    /* mqttd_server_ip after a failed lookup */
+} MQTTD_SERVER_SRC_T;
+
+/* The broker address cache, saved to MQTTD_CFG_INFO once the broker accepts it */
+typedef struct MQTTD_SERVER_CACHE_S
+{
+    ip_addr_t       cached_ip;      /* Last broker address */
+    ip_addr_t       fresh_ip;       /* Newer DNS answer racing the cached attempt */
+    UI32_T          ttl;            /* Lifetime of cached_ip in seconds, 0 disables the cache */
+    UI32_T          expire;         /* sys_now() when cached_ip goes stale */
+    UI32_T          start;          /* sys_now() of the cached attempt */
+    UI8_T           source;         /* MQTTD_SERVER_SRC_T of server_ip */
+    UI8_T           valid;          /* cached_ip is usable until expire */
+    UI8_T           fresh_valid;    /* fresh_ip is set and differs from cached_ip */
+    UI8_T           miss;           /* The cached attempt was never accepted */
+    UI8_T           dirty;          /* cached_ip is not saved to DB yet */
+} MQTTD_SERVER_CACHE_T;
+
+/* The connect time statistics, from mqtt_client_connect to CONNACK */
+typedef struct MQTTD_CONN_STATS_S
+{
+    UI32_T          start;          /* sys_now() of the current attempt */
+    UI32_T          last_ms;
+    UI32_T          max_ms;
+    UI32_T          total_ms;
+    UI16_T          count;          /* Accepted connections */
+    UI16_T          resumed;        /* Accepted with a resumed TLS session */
+} MQTTD_CONN_STATS_T;
+
+/* The MQTTD ctrl structure
+ * It is in memory only, so it is not packed. The fields used by the timer,
+ * the receive loop and the publish path are grouped at the head, the
+ * identity strings follow and the output buffers are kept outside.
+ */
 typedef struct MQTTD_CTRL_S
 {
     MQTTD_STATE_T   state;
-    ip_addr_t       server_ip;
+	UI32_T			ticknum;
+	UI32_T			backoff;        /* Next reconnect backoff in ms */
+	UI32_T			retry_time;     /* sys_now() of the next reconnect */
+    mqtt_client_t*  ptr_client;
+    MQTTD_PUB_LIST_T *msg_head;
+	UI8_T 			*mqtt_buff;     /* MQTTD_MQX_OUTPUT_SIZE bytes */
+	UI8_T 			*json_buff;     /* MQTTD_JSON_BUFF_SIZE bytes */
+	UI16_T          status_ontick;
+	UI16_T          mac_ontick;
 	UI16_T			port;
     UI16_T          cldb_id;        /* The switch identifier in cloud DB */
+    UI8_T           remain_msgs;    /* Not yet sent message count */
+    UI8_T           db_subscribed;
+    UI8_T           reconnect;
+    UI8_T           retry_pending;  /* retry_time is armed */
+    UI8_T           session_present;    /* The broker resumed our session */
+    UI8_T           protocol_version;   /* MQTT_VERSION_5 until the broker refuses it */
+    UI8_T           protocol_probe;     /* 3.1.1 is tried since an MQTT 5 CONNECT got no CONNACK */
+    ip_addr_t       server_ip;
+    MQTTD_SERVER_CACHE_T server_cache;
+    MQTTD_CONN_STATS_T conn_stats;
     C8_T            client_id[MQTTD_MAX_CLIENT_ID_SIZE];	/*{manufacturer}:sw:{deviceid}*/
 	C8_T            topic_prefix[MQTTD_MAX_TOPIC_PREFIX_SIZE];	/*{manufacturer}/sw/{deviceid}*/
 	C8_T			sn[MQTTD_MAX_SN_SIZE];
 	C8_T			mac[MQTTD_MAX_MAC_SIZE];
 	C8_T			device_id[MQTTD_MAX_DEVICE_ID_SIZE];
-    mqtt_client_t*  ptr_client;
-    UI8_T           db_subscribed;
-    UI8_T           reconnect;
     C8_T            pub_in_topic[MQTTD_MAX_TOPIC_SIZE];
-    UI8_T           remain_msgs;    /* Not yet sent message count */
-    MQTTD_PUB_LIST_T *msg_head;
-	UI32_T			ticknum;
-	UI16_T          status_ontick;
-	UI16_T          mac_ontick;
-	UI8_T 			mqtt_buff[MQTTD_MQX_OUTPUT_SIZE];
-	UI8_T 			json_buff[MQTTD_MQX_OUTPUT_SIZE*MQTTD_MAX_CHUNK_NUM+5];
-} ATTRIBUTE_PACK MQTTD_CTRL_T;
+} MQTTD_CTRL_T;
 
 /* The port mirror information table */
 typedef struct ONE_DB_PORT_MIRROR_INFO_S
@@ -264,11 +386,52 @@ typedef struct ONE_DB_PORT_MIRROR_INFO_S
     UI32_T          src_eg_port; /* The egress traffic of the source port */
 } ATTRIBUTE_PACK ONE_DB_PORT_MIRROR_INFO_T;
 
+/* The DB gets of the getConfig vlan_setting section, in order */
+typedef enum {
+    MQTTD_GETCONF_VLAN_STEP_ENTRY = 0,  /* VLAN_ENTRY */
+    MQTTD_GETCONF_VLAN_STEP_LIST,       /* PORT_CFG_INFO.PORT_VLAN_LIST */
+    MQTTD_GETCONF_VLAN_STEP_PVID,       /* PORT_CFG_INFO.PORT_PVID */
+    MQTTD_GETCONF_VLAN_STEP_LAST
+} MQTTD_GETCONF_VLAN_STEP_T;
+
+/* A getConfig response streamed as its sections are built */
+typedef struct MQTTD_GETCONF_STREAM_S
+{
+    MQTTD_CTRL_T    *ptr_mqttd;
+    C8_T            topic[80];
+    C8_T            msg_id[MQTTD_GETCONF_MSG_ID_SIZE];
+    UI16_T          seq;        /* the seq of the next message */
+} MQTTD_GETCONF_STREAM_T;
+
+/* The continuation of a getConfig response waiting for vlan_setting */
+typedef struct MQTTD_GETCONF_VLAN_CTX_S
+{
+    MQTTD_GETCONF_STREAM_T  stream;
+    cJSON           *data;
+    UI32_T          generation;
+    UI8_T           step;
+    DB_MSG_T        *ptr_msg[MQTTD_GETCONF_VLAN_STEP_LAST];
+    void            *ptr_data[MQTTD_GETCONF_VLAN_STEP_LAST];
+} MQTTD_GETCONF_VLAN_CTX_T;
+
+/* A static MAC shown by the MAC table report */
+typedef struct MQTTD_MACS_STATIC_S
+{
+    UI8_T           mac[MQTTD_SMAC_MAC_LEN];
+    UI16_T          vid;
+    UI16_T          port;
+} MQTTD_MACS_STATIC_T;
+
 
 /* GLOBAL VARIABLE DECLARATIONS
 */
 UI8_T mqttd_enable;
-MQTTD_CTRL_T mqttd;
+static UI8_T _mqttd_mqtt_buff[MQTTD_MQX_OUTPUT_SIZE];
+static UI8_T _mqttd_json_buff[MQTTD_JSON_BUFF_SIZE];
+MQTTD_CTRL_T mqttd = {
+    .mqtt_buff = _mqttd_mqtt_buff,
+    .json_buff = _mqttd_json_buff,
+};
 
 UI8_T mqttd_json_dump_en = 1;
 UI8_T mqttd_rc4_coding_en = 0;
@@ -284,6 +447,11 @@ UI8_T mqttd_rc4_coding_en = 0;
 */
 static void _mqttd_ctrl_init(MQTTD_CTRL_T *ptr_mqttd, ip_addr_t *server_ip);
 static void _mqttd_ctrl_free(MQTTD_CTRL_T *ptr_mqttd);
+static MQTTD_PUB_LIST_T **_mqttd_remain_scan(MQTTD_CTRL_T *ptr_mqttd, UI8_T *ptr_waiting, UI8_T *ptr_inflight);
+static void _mqttd_remain_sent(MQTTD_PUB_LIST_T *ptr_msg);
+static BOOL_T _mqttd_remain_admit(MQTTD_CTRL_T *ptr_mqttd, const C8_T *topic, UI8_T lane, UI32_T num);
+static MW_ERROR_NO_T _mqttd_publish_remain(MQTTD_CTRL_T *ptr_mqttd, const C8_T *topic, const void *ptr_data, UI16_T size, UI8_T lane);
+static void _mqttd_replay_remain(MQTTD_CTRL_T *ptr_mqttd);
 //static MW_ERROR_NO_T _mqttd_append_remain_msg(MQTTD_CTRL_T *ptr_mqttd, C8_T *topic, UI16_T msg_size, void *ptr_msg);
 //static void _mqttd_send_remain_msg(MQTTD_CTRL_T *ptr_mqttd);
 static void _mqttd_tmr(timehandle_t ptr_xTimer);
@@ -291,7 +459,12 @@ static void _mqttd_tmr(timehandle_t ptr_xTimer);
 static void _mqttd_gen_client_id(MQTTD_CTRL_T *ptr_mqttd);
 static MW_ERROR_NO_T _mqttd_subscribe_db(MQTTD_CTRL_T *ptr_mqttd);
 static MW_ERROR_NO_T _mqttd_unsubscribe_db(MQTTD_CTRL_T *ptr_mqttd);
-static void _mqttd_listen_db(MQTTD_CTRL_T *ptr_mqttd);
+static void _mqttd_handle_events(MQTTD_CTRL_T *ptr_mqttd, UI32_T events);
+static void _mqttd_listen_db(MQTTD_CTRL_T *ptr_mqttd, UI32_T timeout);
+static BOOL_T _mqttd_static_mac_used(const UI16_T pos, const UI16_T data_size, const void *ptr_data, void *ptr_arg);
+static MW_ERROR_NO_T _mqttd_macs_static_load(const UI32_T *port_vlan_list, const UI16_T *vidx2vid, MQTTD_MACS_STATIC_T **pptr_list, UI16_T *ptr_num);
+static MW_ERROR_NO_T _mqttd_macs_entry_add(cJSON *mac_info, const UI8_T *ptr_mac, const UI8_T ty);
+static MW_ERROR_NO_T _mqttd_macs_dynamic_load(const UI32_T *port_vlan_list, const UI16_T *vidx2vid, cJSON **mac_info);
 /*=== MQTT related local functions ===*/
 //static void _mqttd_cgi_proxy(MQTTD_CTRL_T *ptr_mqttd, const u8_t *data, u16_t len);
 static void _mqttd_dataDump(const void *data, UI16_T data_size);
@@ -301,18 +474,36 @@ static void _mqttd_publish_cb(void *arg, err_t err);
 static void _mqttd_incoming_publish_cb(void *arg, const char *topic, u32_t tot_len);
 static void _mqttd_incoming_data_cb(void *arg, const u8_t *data, u16_t len, u8_t flags, u8_t qos);
 static void _mqttd_subscribe_cb(void *arg, err_t err);
+static void _mqttd_publish_online(MQTTD_CTRL_T *ptr_mqttd);
 static void _mqttd_send_subscribe(mqtt_client_t *client, void *arg);
+static void _mqttd_protocol_fallback(MQTTD_CTRL_T *ptr_mqttd, mqtt_connection_status_t status);
 static void _mqttd_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status);
 #if LWIP_DNS
 void _mqttd_dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
 #endif
 static MW_ERROR_NO_T _mqttd_lookup_server(MQTTD_CTRL_T *ptr_mqttd);
+/*=== MQTT server cache functions ===*/
+static void _mqttd_server_cache_load(MQTTD_CTRL_T *ptr_mqttd);
+static void _mqttd_server_cache_save(MQTTD_CTRL_T *ptr_mqttd);
+static void _mqttd_server_cache_hit(MQTTD_CTRL_T *ptr_mqttd);
+static void _mqttd_server_cache_promote(MQTTD_SERVER_CACHE_T *ptr_cache);
+static void _mqttd_server_refresh(MQTTD_CTRL_T *ptr_mqttd, const ip_addr_t *ipaddr);
+static void _mqttd_server_race(MQTTD_CTRL_T *ptr_mqttd);
+static BOOL_T _mqttd_server_failover(MQTTD_CTRL_T *ptr_mqttd);
 static MW_ERROR_NO_T _mqttd_client_connect(MQTTD_CTRL_T *ptr_mqttd);
 static void _mqttd_client_disconnect(mqtt_client_t* ptr_mqttclient);
 static void _mqttd_main(void *arg);
 MW_ERROR_NO_T _mqttd_deinit(void);
 /*=== MQTT reconnect functions ===*/
-static void _mqttd_reconnect_tmr(timehandle_t ptr_xTimer);
+static UI32_T _mqttd_backoff_rand(void);
+static void _mqttd_reconnect_schedule(MQTTD_CTRL_T *ptr_mqttd);
+static void _mqttd_reconnect_process(MQTTD_CTRL_T *ptr_mqttd);
+#if MQTTD_SUPPORT_TLS
+/*=== MQTT TLS functions ===*/
+static MW_ERROR_NO_T _mqttd_tls_setup(struct mqtt_connect_client_info_t *ptr_info);
+static BOOL_T _mqttd_tls_save(mqtt_client_t *client);
+#endif
+static void _mqttd_conn_stats_update(MQTTD_CTRL_T *ptr_mqttd, BOOL_T resumed);
 void mqttd_reconnect(void);
 
 
@@ -321,7 +512,18 @@ void mqttd_reconnect(void);
 static threadhandle_t ptr_mqttdmain = NULL;
 static timehandle_t ptr_mqttd_time = NULL;
 static semaphorehandle_t ptr_mqttmutex = NULL;
-static timehandle_t ptr_mqttd_recon_time = NULL;
+static UI32_T _mqttd_backoff_seed = 0;
+#if MQTTD_SUPPORT_TLS
+static struct altcp_tls_config *tls_config = NULL;
+static mbedtls_ssl_session _mqttd_tls_session;      /* Resumed on the next connect */
+static BOOL_T _mqttd_tls_session_valid = FALSE;
+#endif
+static const DB_REQUEST_TYPE_T _mqttd_getconfig_vlan_setting_req[MQTTD_GETCONF_VLAN_STEP_LAST] =
+{
+    { VLAN_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES },
+    { PORT_CFG_INFO, PORT_VLAN_LIST, DB_ALL_ENTRIES },
+    { PORT_CFG_INFO, PORT_PVID, DB_ALL_ENTRIES },
+};
 
 void *mqtt_malloc(UI32_T size) {
     void *ptr_mem = NULL;
@@ -455,9 +657,33 @@ mqttd_transStrToIpv4Addr(
     return (MW_E_OK);
 }
 
-/*send json and free*/
-void mqtt_send_json_and_free(MQTTD_CTRL_T *ptr_mqttd, char *topic, cJSON *root)
+/* FUNCTION NAME:  mqtt_send_json_and_free
+ * PURPOSE:
+ *      Print a JSON report and publish it
+ *
+ * INPUT:
+ *      ptr_mqttd  -- The control structure
+ *      topic      -- The publish topic
+ *      root       -- The report
+ *      lane       -- The MQTTD_PUB_LANE_T of the report
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_OP_INVALID     -- The report is too long
+ *      MW_E_OP_INCOMPLETE  -- The report is dropped, no room for it
+ *      Others              -- The error of taking ptr_mqttmutex
+ *
+ * NOTES:
+ *      root is released by this function. A report with continuity is
+ *      sent in chunks of MQTTD_MAX_PACKET_SIZE, all of them or none.
+ */
+MW_ERROR_NO_T mqtt_send_json_and_free(MQTTD_CTRL_T *ptr_mqttd, char *topic, cJSON *root, UI8_T lane)
 {
+	MW_ERROR_NO_T rc = MW_E_OK;
 	int json_can_print = 0;
     int original_payloadlen = 0;
 	cJSON *continuity = NULL;
@@ -467,19 +693,21 @@ void mqtt_send_json_and_free(MQTTD_CTRL_T *ptr_mqttd, char *topic, cJSON *root)
     	osapi_printf("Send json param error:%p, %p\n", topic, root);
     	if(root)
     		cJSON_Delete(root);
+    	return MW_E_BAD_PARAMETER;
     }
     
     continuity = cJSON_GetObjectItemCaseSensitive(root, "continuity");
 
-	if (MW_E_OK == osapi_mutexTake(ptr_mqttmutex, MQTTD_MUX_LOCK_TIME))
+	rc = osapi_mutexTake(ptr_mqttmutex, MQTTD_MUX_LOCK_TIME);
+	if (MW_E_OK == rc)
 	{
-	    osapi_memset(ptr_mqttd->json_buff, 0, sizeof(ptr_mqttd->json_buff));
+	    osapi_memset(ptr_mqttd->json_buff, 0, MQTTD_JSON_BUFF_SIZE);
 	    json_can_print = cJSON_PrintPreallocated(root, ptr_mqttd->json_buff, MQTTD_MAX_PACKET_SIZE*MQTTD_MAX_CHUNK_NUM, 0);
 	    if (!json_can_print) {
 	        osapi_printf("Failed to print topic:%s JSON\n", topic);
 	        cJSON_Delete(root);
 	        osapi_mutexGive(ptr_mqttmutex);
-	        return;
+	        return MW_E_OP_INVALID;
 	    }
 	    
 	    mqttd_json_dump("Topic:[%s] -> %s\n", topic, ptr_mqttd->json_buff);
@@ -490,61 +718,85 @@ void mqtt_send_json_and_free(MQTTD_CTRL_T *ptr_mqttd, char *topic, cJSON *root)
 		    if(original_payloadlen > MQTTD_MAX_PACKET_SIZE)
 		    {
 		    	osapi_printf("Json error: data too long.\n");
-		    	cJSON_Delete(root);
-		    	osapi_mutexGive(ptr_mqttmutex);
-		    	return;
+		    	rc = MW_E_OP_INVALID;
+		    }
+		    else if(TRUE != _mqttd_remain_admit(ptr_mqttd, topic, lane, 1))
+		    {
+		    	rc = MW_E_OP_INCOMPLETE;
 		    }
-
 		    cJSON_Delete(root);
-		    osapi_memset(ptr_mqttd->mqtt_buff, 0, MQTTD_MQX_OUTPUT_SIZE);
-		    mqttd_rc4_encrypt((unsigned char *)ptr_mqttd->json_buff, original_payloadlen, MQTTD_RC4_KEY, ptr_mqttd->mqtt_buff);
-	        mqtt_publish(ptr_mqttd->ptr_client, topic, (const void *)ptr_mqttd->mqtt_buff, original_payloadlen, MQTTD_REQUEST_QOS, MQTTD_REQUEST_RETAIN, _mqttd_publish_cb, (void *)ptr_mqttd);
+		    if(MW_E_OK == rc)
+		    {
+		    	osapi_memset(ptr_mqttd->mqtt_buff, 0, MQTTD_MQX_OUTPUT_SIZE);
+		    	mqttd_rc4_encrypt((unsigned char *)ptr_mqttd->json_buff, original_payloadlen, MQTTD_RC4_KEY, ptr_mqttd->mqtt_buff);
+	        	rc = _mqttd_publish_remain(ptr_mqttd, topic, (const void *)ptr_mqttd->mqtt_buff, original_payloadlen, lane);
+		    }
 	    }
 	    else
 	    {
 		    if(original_payloadlen <= MQTTD_MAX_PACKET_SIZE)
 		    {
 		        cJSON_Delete(root);
+		        if(TRUE != _mqttd_remain_admit(ptr_mqttd, topic, lane, 1))
+		        {
+		            osapi_mutexGive(ptr_mqttmutex);
+		            return MW_E_OP_INCOMPLETE;
+		        }
 		        osapi_memset(ptr_mqttd->mqtt_buff, 0, MQTTD_MQX_OUTPUT_SIZE);
 		        mqttd_rc4_encrypt((unsigned char *)ptr_mqttd->json_buff, original_payloadlen, MQTTD_RC4_KEY, ptr_mqttd->mqtt_buff);
-		        mqtt_publish(ptr_mqttd->ptr_client, topic, (const void *)ptr_mqttd->mqtt_buff, original_payloadlen, MQTTD_REQUEST_QOS, MQTTD_REQUEST_RETAIN, _mqttd_publish_cb, (void *)ptr_mqttd);
+		        rc = _mqttd_publish_remain(ptr_mqttd, topic, (const void *)ptr_mqttd->mqtt_buff, original_payloadlen, lane);
 				osapi_mutexGive(ptr_mqttmutex);
-		        return;
+		        return rc;
 		    }
 		    else
 		    {
-		        int chunk_num = (original_payloadlen+1) / MQTTD_MAX_PACKET_SIZE;
+		        int chunk_num = (original_payloadlen + MQTTD_MAX_PACKET_SIZE - 1) / MQTTD_MAX_PACKET_SIZE;
+		        int chunk_size = 0;
+		        int offset = 0;
+
 				cJSON_SetIntValue(continuity, chunk_num);
 		        json_can_print = cJSON_PrintPreallocated(root, ptr_mqttd->json_buff, MQTTD_MAX_PACKET_SIZE*MQTTD_MAX_CHUNK_NUM, 0);
+		        cJSON_Delete(root);
 		        if (!json_can_print) {
 		            osapi_printf("Failed to print status last JSON\n");
-		            cJSON_Delete(root);
 		            osapi_mutexGive(ptr_mqttmutex);
-		            return;
+		            return MW_E_OP_INVALID;
+		        }
+		        /* The chunks are counted on the report printed with its continuity */
+		        original_payloadlen = strlen(ptr_mqttd->json_buff)+1;
+		        if(chunk_num != (original_payloadlen + MQTTD_MAX_PACKET_SIZE - 1) / MQTTD_MAX_PACKET_SIZE)
+		        {
+		            osapi_mutexGive(ptr_mqttmutex);
+		            return MW_E_OP_INVALID;
+		        }
+		        /* All chunks or none, a report missing a chunk is useless */
+		        if(TRUE != _mqttd_remain_admit(ptr_mqttd, topic, lane, chunk_num))
+		        {
+		            osapi_mutexGive(ptr_mqttmutex);
+		            return MW_E_OP_INCOMPLETE;
 		        }
 
-		        cJSON_Delete(root);
-
-		        int i;
-		        for(i = 0; i < chunk_num; i++)
+		        /* A chunk never exceeds mqtt_buff */
+		        for(offset = 0; (offset < original_payloadlen) && (MW_E_OK == rc); offset += chunk_size)
 		        {
-		            osapi_memset(ptr_mqttd->mqtt_buff, 0, MQTTD_MQX_OUTPUT_SIZE);
-		            if(i == chunk_num - 1)
+		            chunk_size = original_payloadlen - offset;
+		            if(chunk_size > MQTTD_MAX_PACKET_SIZE)
 		            {
-		                mqttd_rc4_encrypt((unsigned char *)ptr_mqttd->json_buff + i * MQTTD_MAX_PACKET_SIZE, original_payloadlen - i * MQTTD_MAX_PACKET_SIZE, MQTTD_RC4_KEY, ptr_mqttd->mqtt_buff);
-		                mqtt_publish(ptr_mqttd->ptr_client, topic, (const void *)ptr_mqttd->mqtt_buff, original_payloadlen - i * MQTTD_MAX_PACKET_SIZE, MQTTD_REQUEST_QOS, MQTTD_REQUEST_RETAIN, _mqttd_publish_cb, (void *)ptr_mqttd);
-		            }
-		            else
-		            { 
-		                mqttd_rc4_encrypt((unsigned char *)ptr_mqttd->json_buff + i * MQTTD_MAX_PACKET_SIZE, MQTTD_MAX_PACKET_SIZE, MQTTD_RC4_KEY, ptr_mqttd->mqtt_buff);
-		                mqtt_publish(ptr_mqttd->ptr_client, topic, (const void *)ptr_mqttd->mqtt_buff, MQTTD_MAX_PACKET_SIZE, MQTTD_REQUEST_QOS, MQTTD_REQUEST_RETAIN, _mqttd_publish_cb, (void *)ptr_mqttd);
+		                chunk_size = MQTTD_MAX_PACKET_SIZE;
 		            }
+		            osapi_memset(ptr_mqttd->mqtt_buff, 0, MQTTD_MQX_OUTPUT_SIZE);
+		            mqttd_rc4_encrypt((unsigned char *)ptr_mqttd->json_buff + offset, chunk_size, MQTTD_RC4_KEY, ptr_mqttd->mqtt_buff);
+		            rc = _mqttd_publish_remain(ptr_mqttd, topic, (const void *)ptr_mqttd->mqtt_buff, chunk_size, lane);
 		        }
 		    }
 	    }
+	    osapi_mutexGive(ptr_mqttmutex);
     }
-    osapi_mutexGive(ptr_mqttmutex);
-    return;
+    else
+    {
+        cJSON_Delete(root);
+    }
+    return rc;
 }
 
 /* LOCAL SUBPROGRAM BODIES
@@ -575,6 +827,13 @@ static void _mqttd_ctrl_init(MQTTD_CTRL_T *ptr_mqttd, ip_addr_t *server_ip)
     if ((server_ip != NULL) && (server_ip != &(ptr_mqttd->server_ip)))
     {
         osapi_memcpy((void *)&(ptr_mqttd->server_ip), (const void *)server_ip, sizeof(ip_addr_t));
+        ptr_mqttd->server_cache.source = ip_addr_isany(server_ip) ? MQTTD_SERVER_SRC_NONE : MQTTD_SERVER_SRC_FIXED;
+    }
+    else if (MQTTD_SERVER_SRC_FIXED != ptr_mqttd->server_cache.source)
+    {
+        /* Resolve again, the address of the last run is in server_cache */
+        ip_addr_set_zero(&(ptr_mqttd->server_ip));
+        ptr_mqttd->server_cache.source = MQTTD_SERVER_SRC_NONE;
     }
     ptr_mqttd->cldb_id = 0;
     ptr_mqttd->ptr_client = NULL;
@@ -582,7 +841,13 @@ static void _mqttd_ctrl_init(MQTTD_CTRL_T *ptr_mqttd, ip_addr_t *server_ip)
     ptr_mqttd->remain_msgs = 0;
     ptr_mqttd->msg_head = NULL;
     ptr_mqttd->reconnect = FALSE;
+    ptr_mqttd->retry_pending = FALSE;
+    ptr_mqttd->session_present = FALSE;
+    ptr_mqttd->protocol_version = MQTTD_PROTOCOL_VERSION;
+    ptr_mqttd->protocol_probe = FALSE;
+    ptr_mqttd->backoff = MQTTD_RECONNECT_MIN_DELAY;
     ptr_mqttd->ticknum = 0;
+    osapi_memset(&(ptr_mqttd->conn_stats), 0, sizeof(MQTTD_CONN_STATS_T));
     ptr_mqttd->status_ontick = MQTTD_PERIOD_TICK;
     ptr_mqttd->mac_ontick = MQTTD_PERIOD_TICK;
 }
@@ -606,7 +871,6 @@ static void _mqttd_ctrl_init(MQTTD_CTRL_T *ptr_mqttd, ip_addr_t *server_ip)
 static void _mqttd_ctrl_free(MQTTD_CTRL_T *ptr_mqttd)
 {
     MQTTD_PUB_LIST_T *ptr_msg = NULL;
-    MQTTD_PUB_LIST_T *ptr_head = ptr_mqttd->msg_head;
 
     mqttd_debug("Free the MQTTD control structure.");
 
@@ -615,20 +879,18 @@ static void _mqttd_ctrl_free(MQTTD_CTRL_T *ptr_mqttd)
     {
         altcp_tls_free_config(tls_config);
         tls_config = NULL;
+        mbedtls_ssl_session_free(&_mqttd_tls_session);
+        _mqttd_tls_session_valid = FALSE;
     }
 #endif
 
+    /* The client is disconnected, lwIP holds no remained message now */
     while (ptr_mqttd->msg_head != NULL)
     {
         ptr_msg = ptr_mqttd->msg_head;
-        osapi_free(ptr_msg->msg);
-        osapi_free(ptr_mqttd->msg_head);
         ptr_mqttd->msg_head = ptr_msg->next;
-        if (ptr_mqttd->msg_head == ptr_head)
-        {
-            /* The last message pointer*/
-            ptr_mqttd->msg_head = NULL;
-        }
+        mqtt_free(ptr_msg->msg);
+        mqtt_free(ptr_msg);
     }
     ptr_mqttd->remain_msgs = 0;
     if (NULL != ptr_mqttd->ptr_client)
@@ -640,6 +902,304 @@ static void _mqttd_ctrl_free(MQTTD_CTRL_T *ptr_mqttd)
     osapi_memset(ptr_mqttd->pub_in_topic, 0, MQTTD_MAX_TOPIC_SIZE);
 }
 
+/* FUNCTION NAME:  _mqttd_remain_scan
+ * PURPOSE:
+ *      Free the acknowledged messages of the remain list and count the
+ *      others per lane
+ *
+ * INPUT:
+ *      ptr_mqttd     -- The control structure
+ *
+ * OUTPUT:
+ *      ptr_waiting   -- MQTTD_PUB_LANE_LAST counters of the messages waiting to be published
+ *      ptr_inflight  -- MQTTD_PUB_LANE_LAST counters of the messages given to lwIP
+ *
+ * RETURN:
+ *      The link at the tail of the list
+ *
+ * NOTES:
+ *      Called with ptr_mqttmutex taken. One walk does all, a message is
+ *      appended without walking the list again.
+ */
+static MQTTD_PUB_LIST_T **_mqttd_remain_scan(MQTTD_CTRL_T *ptr_mqttd, UI8_T *ptr_waiting, UI8_T *ptr_inflight)
+{
+    MQTTD_PUB_LIST_T **pptr_link = &(ptr_mqttd->msg_head);
+    MQTTD_PUB_LIST_T *ptr_msg = NULL;
+    UI8_T state = 0;
+
+    osapi_memset(ptr_waiting, 0, MQTTD_PUB_LANE_LAST);
+    osapi_memset(ptr_inflight, 0, MQTTD_PUB_LANE_LAST);
+    while (NULL != (ptr_msg = *pptr_link))
+    {
+        /* Read once, _mqttd_publish_cb may change it meanwhile */
+        state = ptr_msg->state;
+        if (MQTTD_PUB_ACKED == state)
+        {
+            *pptr_link = ptr_msg->next;
+            mqtt_free(ptr_msg->msg);
+            mqtt_free(ptr_msg);
+            ptr_mqttd->remain_msgs--;
+            continue;
+        }
+        if ((MQTTD_PUB_REPLAY == state) || (MQTTD_PUB_QUEUED == state))
+        {
+            ptr_waiting[ptr_msg->lane]++;
+        }
+        else
+        {
+            ptr_inflight[ptr_msg->lane]++;
+        }
+        pptr_link = &(ptr_msg->next);
+    }
+    return pptr_link;
+}
+
+/* FUNCTION NAME:  _mqttd_remain_sent
+ * PURPOSE:
+ *      Release the copy of a bulk message given to lwIP
+ *
+ * INPUT:
+ *      ptr_msg    -- The remained message
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called with ptr_mqttmutex taken. lwIP copied the message to its
+ *      output buffer and a bulk message is never replayed, so only the node
+ *      is kept to count it in flight until _mqttd_publish_cb.
+ */
+static void _mqttd_remain_sent(MQTTD_PUB_LIST_T *ptr_msg)
+{
+    if (MQTTD_PUB_LANE_BULK == ptr_msg->lane)
+    {
+        mqtt_free(ptr_msg->msg);
+        ptr_msg->msg = NULL;
+    }
+}
+
+/* FUNCTION NAME:  _mqttd_remain_admit
+ * PURPOSE:
+ *      Check the remain list has room for all the messages of a report
+ *
+ * INPUT:
+ *      ptr_mqttd  -- The control structure
+ *      topic      -- The publish topic
+ *      lane       -- The MQTTD_PUB_LANE_T of the report
+ *      num        -- The messages of the report, its continuity chunks
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      TRUE       -- The report can be kept
+ *      FALSE      -- The report is to be dropped
+ *
+ * NOTES:
+ *      Called with ptr_mqttmutex taken. A kept message is never dropped, so
+ *      a continuity report is published whole or not at all. The bulk lane
+ *      leaves MQTTD_INTERACTIVE_RESERVE slots to the replies.
+ */
+static BOOL_T _mqttd_remain_admit(MQTTD_CTRL_T *ptr_mqttd, const C8_T *topic, UI8_T lane, UI32_T num)
+{
+    UI8_T waiting[MQTTD_PUB_LANE_LAST];
+    UI8_T inflight[MQTTD_PUB_LANE_LAST];
+    UI32_T max_num = MQTTD_MAX_REMAIN_MSG;
+
+    (void)_mqttd_remain_scan(ptr_mqttd, waiting, inflight);
+    if (MQTTD_PUB_LANE_BULK == lane)
+    {
+        max_num -= MQTTD_INTERACTIVE_RESERVE;
+    }
+    if (ptr_mqttd->remain_msgs + num > max_num)
+    {
+        mqttd_debug("Drop the report of topic %s, no room for %u message(s)", topic, (unsigned int)num);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* FUNCTION NAME:  _mqttd_publish_remain
+ * PURPOSE:
+ *      PUBLISH a message and keep it until it is acknowledged
+ *
+ * INPUT:
+ *      ptr_mqttd  -- The control structure
+ *      topic      -- The publish topic
+ *      ptr_data   -- The publish message
+ *      size       -- The publish message size
+ *      lane       -- The MQTTD_PUB_LANE_T of the message
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_OP_INCOMPLETE -- The message could not be kept nor sent
+ *
+ * NOTES:
+ *      Called with ptr_mqttmutex taken, after _mqttd_remain_admit made room
+ *      for the report. A kept message is sent later if not now. An interactive message lwIP did not get an
+ *      acknowledge for is published again by _mqttd_replay_remain after
+ *      reconnect, a bulk one is only kept until lwIP takes it.
+ *      While messages of the lane wait or the Receive Maximum of the broker
+ *      is reached, the message is queued to keep the order. A bulk message
+ *      is also queued while an interactive one waits or
+ *      MQTTD_BULK_MAX_INFLIGHT bulk messages are in flight.
+ */
+static MW_ERROR_NO_T _mqttd_publish_remain(MQTTD_CTRL_T *ptr_mqttd, const C8_T *topic, const void *ptr_data, UI16_T size, UI8_T lane)
+{
+    MQTTD_PUB_LIST_T **pptr_link = NULL;
+    MQTTD_PUB_LIST_T *ptr_msg = NULL;
+    UI8_T waiting[MQTTD_PUB_LANE_LAST];
+    UI8_T inflight[MQTTD_PUB_LANE_LAST];
+    err_t err = ERR_OK;
+
+    pptr_link = _mqttd_remain_scan(ptr_mqttd, waiting, inflight);
+    if ((ptr_mqttd->remain_msgs < MQTTD_MAX_REMAIN_MSG) && (osapi_strlen(topic) < MQTTD_MAX_TOPIC_SIZE))
+    {
+        ptr_msg = mqtt_malloc(sizeof(MQTTD_PUB_LIST_T));
+        if (NULL != ptr_msg)
+        {
+            ptr_msg->msg = mqtt_malloc(size);
+            if (NULL == ptr_msg->msg)
+            {
+                mqtt_free(ptr_msg);
+                ptr_msg = NULL;
+            }
+        }
+    }
+    if (NULL == ptr_msg)
+    {
+        /* Cannot be kept, send it once */
+        if ((NULL == ptr_mqttd->ptr_client) ||
+            (ERR_OK != mqtt_publish(ptr_mqttd->ptr_client, topic, ptr_data, size, MQTTD_REQUEST_QOS, MQTTD_REQUEST_RETAIN, _mqttd_publish_cb, NULL)))
+        {
+            return MW_E_OP_INCOMPLETE;
+        }
+        return MW_E_OK;
+    }
+
+    osapi_memcpy(ptr_msg->msg, ptr_data, size);
+    ptr_msg->msg_size = size;
+    osapi_strncpy(ptr_msg->topic, topic, MQTTD_MAX_TOPIC_SIZE - 1);
+    ptr_msg->state = MQTTD_PUB_INFLIGHT;
+    ptr_msg->lane = lane;
+    ptr_msg->next = NULL;
+    *pptr_link = ptr_msg;
+    ptr_mqttd->remain_msgs++;
+
+    if ((0 != waiting[lane]) || (NULL == ptr_mqttd->ptr_client) ||
+        (0 == mqtt_client_send_quota(ptr_mqttd->ptr_client)))
+    {
+        ptr_msg->state = MQTTD_PUB_QUEUED;
+        return MW_E_OK;
+    }
+    if ((MQTTD_PUB_LANE_BULK == lane) &&
+        ((0 != waiting[MQTTD_PUB_LANE_INTERACTIVE]) || (inflight[MQTTD_PUB_LANE_BULK] >= MQTTD_BULK_MAX_INFLIGHT)))
+    {
+        /* Yield to the replies, _mqttd_replay_remain sends it on a PUBLISH completion */
+        ptr_msg->state = MQTTD_PUB_QUEUED;
+        return MW_E_OK;
+    }
+    err = mqtt_publish(ptr_mqttd->ptr_client, ptr_msg->topic, ptr_msg->msg, size, MQTTD_REQUEST_QOS, MQTTD_REQUEST_RETAIN, _mqttd_publish_cb, (void *)ptr_msg);
+    if (ERR_OK != err)
+    {
+        mqttd_debug("Error (%d): keep the message of topic %s for replay", err, ptr_msg->topic);
+        ptr_msg->state = MQTTD_PUB_REPLAY;
+        return MW_E_OK;
+    }
+    _mqttd_remain_sent(ptr_msg);
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME:  _mqttd_replay_remain
+ * PURPOSE:
+ *      PUBLISH the waiting messages, again for the ones not acknowledged
+ *      by the broker
+ *
+ * INPUT:
+ *      ptr_mqttd  -- The control structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called by mqttd task once the broker accepts the connection and
+ *      while running, the messages are sent in their original order as the
+ *      Receive Maximum of the broker allows.
+ *      The interactive lane is sent first. The bulk lane follows while no
+ *      reply waits, MQTTD_BULK_MAX_INFLIGHT at a time, so a large report
+ *      gives way to the replies between its packets.
+ */
+static void _mqttd_replay_remain(MQTTD_CTRL_T *ptr_mqttd)
+{
+    MQTTD_PUB_LIST_T *ptr_msg = NULL;
+    UI8_T waiting[MQTTD_PUB_LANE_LAST];
+    UI8_T inflight[MQTTD_PUB_LANE_LAST];
+    UI8_T lane = 0;
+    UI8_T state = 0;
+    err_t err = ERR_OK;
+    UI8_T count = 0;
+
+    if (MW_E_OK != osapi_mutexTake(ptr_mqttmutex, MQTTD_MUX_LOCK_TIME))
+    {
+        return;
+    }
+    (void)_mqttd_remain_scan(ptr_mqttd, waiting, inflight);
+    for (lane = 0; (lane < MQTTD_PUB_LANE_LAST) && (ERR_OK == err); lane++)
+    {
+        for (ptr_msg = ptr_mqttd->msg_head; NULL != ptr_msg; ptr_msg = ptr_msg->next)
+        {
+            if ((lane != ptr_msg->lane) || !MQTTD_PUB_WAITING(ptr_msg))
+            {
+                continue;
+            }
+            if ((MQTTD_PUB_LANE_BULK == lane) &&
+                ((0 != waiting[MQTTD_PUB_LANE_INTERACTIVE]) || (inflight[MQTTD_PUB_LANE_BULK] >= MQTTD_BULK_MAX_INFLIGHT)))
+            {
+                /* The next completion posts MQTTD_EVENT_REPLAY again */
+                break;
+            }
+            state = ptr_msg->state;
+            ptr_msg->state = MQTTD_PUB_INFLIGHT;
+            err = mqtt_publish(ptr_mqttd->ptr_client, ptr_msg->topic, ptr_msg->msg, ptr_msg->msg_size, MQTTD_REQUEST_QOS, MQTTD_REQUEST_RETAIN, _mqttd_publish_cb, (void *)ptr_msg);
+            if (ERR_VAL == err)
+            {
+                /* Larger than the broker accepts, it never goes out */
+                ptr_msg->state = MQTTD_PUB_ACKED;
+                waiting[lane]--;
+                err = ERR_OK;
+                continue;
+            }
+            if (ERR_OK != err)
+            {
+                /* The request list or the output buffer is full, retry next time */
+                ptr_msg->state = state;
+                break;
+            }
+            _mqttd_remain_sent(ptr_msg);
+            waiting[lane]--;
+            inflight[lane]++;
+            if (MQTTD_PUB_REPLAY == state)
+            {
+                count++;
+            }
+        }
+    }
+    osapi_mutexGive(ptr_mqttmutex);
+    if (0 != count)
+    {
+        osapi_printf("MQTTD replayed %u message(s)\n", count);
+    }
+}
+
 #if 0
 /* FUNCTION NAME:  _mqttd_append_remain_msg
  * PURPOSE:
@@ -810,6 +1370,8 @@ static void _mqttd_publish_status(MQTTD_CTRL_T *ptr_mqttd)
     DB_MSG_T *ptr_db_msg = NULL;
     u16_t db_size = 0;
     void *db_data = NULL;
+    UI16_T oper_req_id = 0;
+    UI16_T cfg_req_id = 0;
     // Implement the logic to publish the status
     osapi_printf("Publishing port status...\n");
     char topic[80];
@@ -878,29 +1440,45 @@ static void _mqttd_publish_status(MQTTD_CTRL_T *ptr_mqttd)
             mqttd_debug("Failed to create JSON object for port entry.");
             break;
         }
-        memset(&port_oper_info, 0, sizeof(DB_PORT_OPER_INFO_T));
-        rc = mqttd_queue_getData(PORT_OPER_INFO, DB_ALL_FIELDS, i, &ptr_db_msg, &db_size, &db_data);
+        /* Issue both gets back to back, then collect the responses */
+        rc = mqttd_queue_getDataReq(PORT_OPER_INFO, DB_ALL_FIELDS, i, &oper_req_id);
         if(MW_E_OK != rc)
 	    {
 	        mqttd_debug("Get org DB port_oper_info failed(%d)\n", rc);
 	        cJSON_Delete(json_port_entry);
 			break;
 	    }
-        memcpy(&port_oper_info, db_data, sizeof(DB_PORT_OPER_INFO_T));
-	    mqtt_free(ptr_db_msg);
-
-#if 1
-        memset(port_cfg_info, 0, sizeof(DB_PORT_CFG_INFO_T));
-        rc = mqttd_queue_getData(PORT_CFG_INFO, DB_ALL_FIELDS, i, &ptr_db_msg, &db_size, &db_data);
-	    if(MW_E_OK != rc)
+        rc = mqttd_queue_getDataReq(PORT_CFG_INFO, DB_ALL_FIELDS, i, &cfg_req_id);
+        if(MW_E_OK != rc)
 	    {
 	        mqttd_debug("Get org DB port_cfg_info failed(%d)\n", rc);
+	        mqttd_queue_getDataCancel(oper_req_id);
 	        cJSON_Delete(json_port_entry);
 			break;
 	    }
-        memcpy(port_cfg_info, db_data, sizeof(DB_PORT_CFG_INFO_T));
-	    mqtt_free(ptr_db_msg);
-#endif
+
+        memset(&port_oper_info, 0, sizeof(DB_PORT_OPER_INFO_T));
+        rc = mqttd_queue_getDataWait(oper_req_id, &ptr_db_msg, &db_size, &db_data);
+        if(MW_E_OK != rc)
+	    {
+	        mqttd_debug("Get org DB port_oper_info failed(%d)\n", rc);
+	        mqttd_queue_getDataCancel(cfg_req_id);
+	        cJSON_Delete(json_port_entry);
+			break;
+	    }
+        memcpy(&port_oper_info, db_data, sizeof(DB_PORT_OPER_INFO_T));
+	    dbapi_freeMsg(ptr_db_msg);
+
+        memset(port_cfg_info, 0, sizeof(DB_PORT_CFG_INFO_T));
+        rc = mqttd_queue_getDataWait(cfg_req_id, &ptr_db_msg, &db_size, &db_data);
+	    if(MW_E_OK != rc)
+	    {
+	        mqttd_debug("Get org DB port_cfg_info failed(%d)\n", rc);
+	        cJSON_Delete(json_port_entry);
+			break;
+	    }
+        memcpy(port_cfg_info, db_data, sizeof(DB_PORT_CFG_INFO_T));
+	    dbapi_freeMsg(ptr_db_msg);
         cJSON_AddNumberToObject(json_port_entry, "index", i+1);
         char port_name[10];
         snprintf(port_name, sizeof(port_name), "port%d", i+1);
@@ -952,251 +1530,398 @@ static void _mqttd_publish_status(MQTTD_CTRL_T *ptr_mqttd)
 
 	//mqtt_free(port_cfg_info);
 	
-    mqtt_send_json_and_free(ptr_mqttd, topic, root);
+    mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
     
     return;
 }
 
+/* FUNCTION NAME: _mqttd_macs_static_load
+ * PURPOSE:
+ *      Collect the static MACs shown by the MAC table report
+ *
+ * INPUT:
+ *      port_vlan_list  --  the VLAN bitmap of each port
+ *      vidx2vid        --  the VID of each VLAN index
+ *
+ * OUTPUT:
+ *      pptr_list       --  the static MACs, freed by the caller
+ *      ptr_num         --  the number of the static MACs
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      Others          --  the error of the DB cursor
+ *
+ * NOTES:
+ *      STATIC_MAC_ENTRY is paged through by a cursor. Only the first entry
+ *      of each port and VLAN of the port is kept, so the list is bound by
+ *      the VLANs of the ports instead of the size of the table.
+ */
+static MW_ERROR_NO_T _mqttd_macs_static_load(const UI32_T *port_vlan_list, const UI16_T *vidx2vid, MQTTD_MACS_STATIC_T **pptr_list, UI16_T *ptr_num)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    DB_CURSOR_T cursor;
+    MQTTD_MACS_STATIC_T *ptr_list = NULL;
+    MQTTD_MACS_STATIC_T *ptr_static = NULL;
+    UI32_T vlan_list = 0;
+    UI32_T max_num = 0;
+    UI32_T port = 0;
+    UI16_T vid = 0;
+    UI16_T num = 0;
+    UI16_T e_idx = 0;
+    UI16_T entry_size = 0;
+    UI16_T i;
+    void *ptr_entry = NULL;
+
+    *pptr_list = NULL;
+    *ptr_num = 0;
+    for (i = 0; i < PLAT_MAX_PORT_NUM; i++)
+    {
+        for (vlan_list = port_vlan_list[i]; 0 != vlan_list; vlan_list &= (vlan_list - 1))
+        {
+            max_num++;
+        }
+    }
+    if (max_num > MAX_STATIC_MAC_NUM)
+    {
+        max_num = MAX_STATIC_MAC_NUM;
+    }
+    if (0 == max_num)
+    {
+        return MW_E_OK;
+    }
+    ptr_list = mqtt_malloc(max_num * sizeof(MQTTD_MACS_STATIC_T));
+    if (NULL == ptr_list)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    rc = dbapi_cursorOpen(STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_CURSOR_PAGE_MAX, _mqttd_static_mac_used, NULL, &cursor);
+    if (MW_E_OK != rc)
+    {
+        mqtt_free(ptr_list);
+        return rc;
+    }
+    while ((num < max_num) &&
+           (MW_E_OK == (rc = dbapi_cursorNext(&cursor, &e_idx, &entry_size, &ptr_entry))))
+    {
+        memcpy(&vid, (UI8_T *)ptr_entry + MQTTD_SMAC_ENTRY_OFFSET_VID, MQTTD_SMAC_FIELD_SIZE(vid));
+        memcpy(&port, (UI8_T *)ptr_entry + MQTTD_SMAC_ENTRY_OFFSET_PORT, MQTTD_SMAC_FIELD_SIZE(port));
+        if (port >= PLAT_MAX_PORT_NUM)
+        {
+            continue;
+        }
+        /* The report walks the VLANs of the port only */
+        for (i = 0; i < MAX_VLAN_ENTRY_NUM; i++)
+        {
+            if ((port_vlan_list[port] & BIT(i)) && (vidx2vid[i] == vid))
+            {
+                break;
+            }
+        }
+        if (i >= MAX_VLAN_ENTRY_NUM)
+        {
+            continue;
+        }
+        /* The first entry of the port and VLAN is the one reported */
+        for (i = 0; i < num; i++)
+        {
+            if ((ptr_list[i].port == port) && (ptr_list[i].vid == vid))
+            {
+                break;
+            }
+        }
+        if (i < num)
+        {
+            continue;
+        }
+        ptr_static = &ptr_list[num++];
+        memcpy(ptr_static->mac, ptr_entry, MQTTD_SMAC_MAC_LEN);
+        ptr_static->vid = vid;
+        ptr_static->port = (UI16_T)port;
+    }
+    dbapi_cursorClose(&cursor);
+    if ((num < max_num) && (MW_E_ENTRY_NOT_FOUND != rc))
+    {
+        mqtt_free(ptr_list);
+        return rc;
+    }
+    *pptr_list = ptr_list;
+    *ptr_num = num;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _mqttd_macs_entry_add
+ * PURPOSE:
+ *      Add one MAC to the mac_info of a port and VLAN of the MAC table report
+ *
+ * INPUT:
+ *      mac_info        --  the mac_info array
+ *      ptr_mac         --  the MAC address
+ *      ty              --  1 is dynamic, 2 is static
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      None
+ */
+static MW_ERROR_NO_T _mqttd_macs_entry_add(cJSON *mac_info, const UI8_T *ptr_mac, const UI8_T ty)
+{
+    C8_T mac_str[18];
+    cJSON *mac_entry = cJSON_CreateObject();
+
+    if (NULL == mac_entry)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    osapi_snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x",
+            ptr_mac[0], ptr_mac[1], ptr_mac[2], ptr_mac[3], ptr_mac[4], ptr_mac[5]);
+    cJSON_AddStringToObject(mac_entry, "mac", mac_str);
+    cJSON_AddNumberToObject(mac_entry, "ty", ty);
+    cJSON_AddItemToArray(mac_info, mac_entry);
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _mqttd_macs_dynamic_load
+ * PURPOSE:
+ *      Add the dynamic MACs to the MAC table report
+ *
+ * INPUT:
+ *      port_vlan_list  --  the VLAN bitmap of each port
+ *      vidx2vid        --  the VID of each VLAN index
+ *      mac_info        --  the mac_info array of each port and VLAN index,
+ *                          NULL when the VLAN is not a VLAN of the port
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      Others          --  the error of the DB cursor
+ *
+ * NOTES:
+ *      DYNAMIC_MAC_ADDRESS_ENTRY is paged through by a cursor, so the FDB is
+ *      walked once for all the ports and VLANs. An entry is added to each
+ *      port of its port bitmap having its VID.
+ */
+static MW_ERROR_NO_T _mqttd_macs_dynamic_load(const UI32_T *port_vlan_list, const UI16_T *vidx2vid, cJSON **mac_info)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    DB_CURSOR_T cursor;
+    UI32_T port_bitmap = 0;
+    UI16_T vid = 0;
+    UI16_T pos = 0;
+    UI16_T entry_size = 0;
+    UI16_T vidx;
+    UI16_T i;
+    void *ptr_entry = NULL;
+
+    rc = dbapi_cursorOpen(DYNAMIC_MAC_ADDRESS_ENTRY, DB_ALL_FIELDS, DB_CURSOR_PAGE_MAX, NULL, NULL, &cursor);
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+    while (MW_E_OK == (rc = dbapi_cursorNext(&cursor, &pos, &entry_size, &ptr_entry)))
+    {
+        memcpy(&vid, (UI8_T *)ptr_entry + MQTTD_MACS_DYN_OFFSET_VID, MQTTD_MACS_DYN_FIELD_SIZE(vid));
+        memcpy(&port_bitmap, (UI8_T *)ptr_entry + MQTTD_MACS_DYN_OFFSET_PORT, MQTTD_MACS_DYN_FIELD_SIZE(port));
+        for (vidx = 0; vidx < MAX_VLAN_ENTRY_NUM; vidx++)
+        {
+            if (vidx2vid[vidx] == vid)
+            {
+                break;
+            }
+        }
+        if (vidx >= MAX_VLAN_ENTRY_NUM)
+        {
+            continue;
+        }
+        for (i = 0; (i < PLAT_MAX_PORT_NUM) && (MW_E_OK == rc); i++)
+        {
+            if ((port_bitmap & BIT(i)) && (port_vlan_list[i] & BIT(vidx)))
+            {
+                rc = _mqttd_macs_entry_add(mac_info[MQTTD_MACS_INFO_IDX(i, vidx)], (const UI8_T *)ptr_entry, 1);
+            }
+        }
+        if (MW_E_OK != rc)
+        {
+            break;
+        }
+    }
+    dbapi_cursorClose(&cursor);
+    return (MW_E_ENTRY_NOT_FOUND == rc) ? MW_E_OK : rc;
+}
+
+/* FUNCTION NAME: _mqttd_publish_macs
+ * PURPOSE:
+ *      Publish the MAC table report
+ *
+ * INPUT:
+ *      ptr_mqttd       --  the control block of MQTTD
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The report lists the static MAC and the dynamic MACs of each port and
+ *      VLAN of the port. A mac_info array is made for each of them first,
+ *      then both tables are paged through by a DB cursor once and the ports
+ *      and VLANs having MACs are put into the report. The report is not sent
+ *      when a table can not be read, a partial table would be taken as the
+ *      whole one.
+ */
 static void _mqttd_publish_macs(MQTTD_CTRL_T *ptr_mqttd)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
-    DB_MSG_T *ptr_db_msg = NULL;
-    u16_t db_size = 0;
-    void *db_data = NULL;
+    MQTTD_MACS_STATIC_T *static_mac = NULL;
+    UI16_T static_num = 0;
+    C8_T topic[80];
+    UI32_T port_vlan_list[PLAT_MAX_PORT_NUM];
+    UI16_T vidx2vid[MAX_VLAN_ENTRY_NUM];
+    const MQTTD_VLAN_IDX_T *ptr_vlan_idx = NULL;
+    cJSON **mac_info = NULL;
+    cJSON *root = NULL;
+    cJSON *data = NULL;
+    cJSON *json_port_entry = NULL;
+    cJSON *vlan_info = NULL;
+    cJSON *vlan_entry = NULL;
+    UI32_T vlan_list = 0;
+    UI16_T vid_idx = 0;
+    UI16_T i, j;
 
-    // Implement the logic to publish the MAC address
     osapi_printf("Publishing MAC table...\n");
-    char topic[80];
     osapi_snprintf(topic, sizeof(topic), "%s/period", ptr_mqttd->topic_prefix);
 
-	int i, j;
-	UI16_T vid_idx = 0;
-	DB_STATIC_MAC_ENTRY_T *static_mac = NULL;
-	AIR_ERROR_NO_T air_rc = AIR_E_OK;
-	UI32_T  bucket_size = 0;
-	air_rc = air_l2_getMacBucketSize(0, &bucket_size);
-	if(air_rc != AIR_E_OK)
-	{
-		mqttd_debug("Failed to Mac Bucket Size.");
-        return;
-	}
-	
-    cJSON *root = cJSON_CreateObject();
-    cJSON *data = cJSON_CreateArray();
-    
-	static_mac = mqtt_malloc(sizeof(DB_STATIC_MAC_ENTRY_T));
-    if (static_mac == NULL) {
-        mqttd_debug("Failed to allocate memory for static_mac.");
+    /* Copy what is needed so the index is not held across the DB reads */
+    memset(port_vlan_list, 0, sizeof(port_vlan_list));
+    memset(vidx2vid, 0, sizeof(vidx2vid));
+    rc = mqttd_vlan_idx_get(&ptr_vlan_idx);
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Get VLAN index failed(%d)\n", rc);
+    }
+    else
+    {
+        memcpy(port_vlan_list, ptr_vlan_idx->vlan_list, sizeof(port_vlan_list));
+        memcpy(vidx2vid, ptr_vlan_idx->vidx2vid, sizeof(vidx2vid));
+        mqttd_vlan_idx_release();
+        ptr_vlan_idx = NULL;
+    }
+
+    /* get static mac, only those of the port VLANs */
+    rc = _mqttd_macs_static_load(port_vlan_list, vidx2vid, &static_mac, &static_num);
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Get DB static mac failed(%d)\n", rc);
         return;
     }
-    /*get static mac*/
-    memset(static_mac, 0, sizeof(DB_STATIC_MAC_ENTRY_T));
-    rc = mqttd_queue_getData(STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_db_msg, &db_size, &db_data);
-    if(MW_E_OK != rc)
+
+    mac_info = mqtt_malloc(PLAT_MAX_PORT_NUM * MAX_VLAN_ENTRY_NUM * sizeof(cJSON *));
+    if (NULL == mac_info)
     {
-        mqttd_debug("Get org DB static mac failed(%d)\n", rc);
         mqtt_free(static_mac);
         return;
     }
-    memcpy(static_mac, db_data, sizeof(DB_STATIC_MAC_ENTRY_T));
-    mqtt_free(ptr_db_msg);
-    
-    cJSON_AddStringToObject(root, "type", "macs");
-	cJSON_AddNumberToObject(root, "continuity", 0);
-    cJSON_AddItemToObject(root, "data", data);
-	cJSON *continuity = cJSON_GetObjectItemCaseSensitive(root, "continuity");
+    memset(mac_info, 0, PLAT_MAX_PORT_NUM * MAX_VLAN_ENTRY_NUM * sizeof(cJSON *));
 
-	/*
-	1. Get PORT_CFG_INFO vlanlist(DB_PORT_CFG_INFO_T vlan_list)
-	2.1 Loop BITMAP_VLAN_FOREACH vlanlist
-	2.2 Get vid from VLAN_ENTRY (DB_VLAN_ENTRY_T, loop VLAN_ENTRY 
-	3. vlan + port search in STATIC_MAC_ENTRY（DB_STATIC_MAC_ENTRY_T）and air_l2_searchMacAddr
-	*/
-
-	for (i = 0; i < PLAT_MAX_PORT_NUM; i++)
+    /* A mac_info for each VLAN of each port, the static mac first */
+    for (i = 0; (i < PLAT_MAX_PORT_NUM) && (MW_E_OK == rc); i++)
     {
-    	UI32_T   vlan_list = 0; 
-    	int      found = 0;
-	    rc = mqttd_queue_getData(PORT_CFG_INFO, DB_ALL_FIELDS, i, &ptr_db_msg, &db_size, &db_data);
-	    if(MW_E_OK != rc)
-	    {
-	        mqttd_debug("Get org DB port_cfg_info failed(%d)\n", rc);
-			break;
-	    }
-        vlan_list = ((DB_PORT_CFG_INFO_T *)db_data)->vlan_list;
-	    mqtt_free(ptr_db_msg);
-
-		if(vlan_list == 0)
-		{
-			continue;
-		}
-        //osapi_printf("Port[%d] vlan_list is 0x%x\n", i, vlan_list);
-
-		cJSON *json_port_entry = cJSON_CreateObject();
-		cJSON *vlan_info = cJSON_CreateArray();
-
-		BITMAP_VLAN_FOREACH(vlan_list, vid_idx)
-		{
-            UI16_T vlan_id = 0;
-			//get vlan id
-		    rc = mqttd_queue_getData(VLAN_ENTRY, DB_ALL_FIELDS, vid_idx, &ptr_db_msg, &db_size, &db_data);
-		    if(MW_E_OK != rc)
-		    {
-		        osapi_printf("Get org DB vlan_info failed(%d)\n", rc);
-				break;
+        vlan_list = port_vlan_list[i];
+        BITMAP_VLAN_FOREACH(vlan_list, vid_idx)
+        {
+            mac_info[MQTTD_MACS_INFO_IDX(i, vid_idx)] = cJSON_CreateArray();
+            if (NULL == mac_info[MQTTD_MACS_INFO_IDX(i, vid_idx)])
+            {
+                rc = MW_E_NO_MEMORY;
+                break;
             }
-            vlan_id = ((VLAN_ENTRY_INFO_T *)db_data)->vlan_id;
-            mqtt_free(ptr_db_msg);
-
-            cJSON *vlan_entry = cJSON_CreateObject();
-            cJSON *mac_info = cJSON_CreateArray();
-
-            cJSON_AddNumberToObject(vlan_entry, "vid", vlan_id);
-            cJSON_AddItemToObject(vlan_entry, "mac_info", mac_info);
-            
-			/*static mac*/
-			for(j = 0; j < MAX_STATIC_MAC_NUM; j++)
-			{
-				if(static_mac->vid[j] == vlan_id && static_mac->port[j] == i)
-				{
-                    char mac_str[18];
-					cJSON *static_mac_entry = cJSON_CreateObject();
-					
-                    snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-                            static_mac->mac_addr[j][0], static_mac->mac_addr[j][1],
-                            static_mac->mac_addr[j][2], static_mac->mac_addr[j][3],
-                            static_mac->mac_addr[j][4], static_mac->mac_addr[j][5]); 
-					cJSON_AddStringToObject(static_mac_entry, "mac", mac_str);
-					cJSON_AddNumberToObject(static_mac_entry, "ty", 2);
-					cJSON_AddItemToArray(mac_info, static_mac_entry);
-					found++;
-                    //osapi_printf("Found static mac: %s, port: %d, vlan: %d\n", mac_str, i, vlan_id);
-					break;
-				}
-			}
-			/*l2 mac*/
-            UI8_T   count = 0;
-            AIR_MAC_ENTRY_T *ptr_mt=NULL;
-            ptr_mt = mqtt_malloc(sizeof(AIR_MAC_ENTRY_T) * bucket_size);
-			if(ptr_mt == NULL)
-			{
-                osapi_printf("Failed to allocate memory for ptr_mt, bucket_size: %d.\n", bucket_size);
-                if(cJSON_GetArraySize(mac_info) == 0)
-                	cJSON_Delete(vlan_entry);
-				break;
-			}
-            memset(ptr_mt, 0, sizeof(AIR_MAC_ENTRY_T) * bucket_size);
-
-			air_rc = air_l2_searchMacAddr(0, AIR_L2_MAC_SEARCH_TYPE_PORT, i, &count, ptr_mt);
-			if(air_rc == AIR_E_ENTRY_NOT_FOUND)
-			{
-                mqtt_free(ptr_mt);
-                //osapi_printf("No l2 mac found for port: %d.\n", i);
-                if(cJSON_GetArraySize(mac_info) == 0)
-                	cJSON_Delete(vlan_entry);
-				continue;
-			}
-			else if (AIR_E_OK != rc)
-	        {
-	        	mqtt_free(ptr_mt);
-	            //osapi_printf("Get l2 mac for port: %d failed.\n", i);
-	            if(cJSON_GetArraySize(mac_info) == 0)
-                	cJSON_Delete(vlan_entry);
-	            continue;
-	        }
-            //osapi_printf("Found %d l2 mac for port: %d.\n", count, i);
-			for(j = 0; j < count; j++)
-			{
-                /*osapi_printf("l2 mac[%d]: %02x:%02x:%02x:%02x:%02x:%02x, cvid: %d, port_bitmap: 0x%x\n", j,
-                            ptr_mt[j].mac[0], ptr_mt[j].mac[1], ptr_mt[j].mac[2], ptr_mt[j].mac[3],
-                            ptr_mt[j].mac[4], ptr_mt[j].mac[5], ptr_mt[j].cvid, ptr_mt[j].port_bitmap[0]);*/
-
-                if(ptr_mt[j].cvid != vlan_id || !AIR_PORT_CHK(ptr_mt[j].port_bitmap, i))//not match vlan or port
-                    continue;
-                //match vlan and port
-                char mac_str[18];
-				cJSON *l2_mac_entry = cJSON_CreateObject();
-                if (l2_mac_entry == NULL) {
-                    osapi_printf("Failed to create cJSON object for l2_mac_entry.\n");
-                    break;
-                }
-                snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-                        ptr_mt[j].mac[0], ptr_mt[j].mac[1],
-                        ptr_mt[j].mac[2], ptr_mt[j].mac[3],
-                        ptr_mt[j].mac[4], ptr_mt[j].mac[5]); 
-				cJSON_AddStringToObject(l2_mac_entry, "mac", mac_str);
-				cJSON_AddNumberToObject(l2_mac_entry, "ty", 1);
-				cJSON_AddItemToArray(mac_info, l2_mac_entry);
-				found++;
-			}
-			
-            //more l2 mac
-            while(1)
+            for (j = 0; j < static_num; j++)
             {
-                memset(ptr_mt, 0, sizeof(AIR_MAC_ENTRY_T) * bucket_size);
-                air_rc = air_l2_searchNextMacAddr(0, AIR_L2_MAC_SEARCH_TYPE_PORT, i, &count, ptr_mt);
-                if(air_rc == AIR_E_ENTRY_NOT_FOUND)
-                    break;
-                else if (AIR_E_OK != rc)
-                	break;
-                
-                for(j = 0; j < count; j++)
+                if ((static_mac[j].vid == vidx2vid[vid_idx]) && (static_mac[j].port == i))
                 {
-                    /*osapi_printf("l2 mac[%d]: %02x:%02x:%02x:%02x:%02x:%02x, cvid: %d, port_bitmap: 0x%x\n", j,
-                                ptr_mt[j].mac[0], ptr_mt[j].mac[1],
-                                ptr_mt[j].mac[2], ptr_mt[j].mac[3],
-                                ptr_mt[j].mac[4], ptr_mt[j].mac[5],
-                                ptr_mt[j].cvid, ptr_mt[j].port_bitmap[0]);*/
-
-                    if(ptr_mt[j].cvid != vlan_id || !AIR_PORT_CHK(ptr_mt[j].port_bitmap, i))//not match vlan or port
-                        continue;
-                    //match vlan and port
-                    char mac_str[18];
-					cJSON *l2_mac_entry = cJSON_CreateObject();
-                    if (l2_mac_entry == NULL) {
-                        osapi_printf("Failed to create cJSON object for l2_mac_entry.\n");
-                        break;
-                    }
-                    snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-                            ptr_mt[j].mac[0], ptr_mt[j].mac[1],
-                            ptr_mt[j].mac[2], ptr_mt[j].mac[3],
-                            ptr_mt[j].mac[4], ptr_mt[j].mac[5]); 
-					cJSON_AddStringToObject(l2_mac_entry, "mac", mac_str);
-					cJSON_AddNumberToObject(l2_mac_entry, "ty", 1);
-					cJSON_AddItemToArray(mac_info, l2_mac_entry);
-					found++;
-                }   
+                    rc = _mqttd_macs_entry_add(mac_info[MQTTD_MACS_INFO_IDX(i, vid_idx)], static_mac[j].mac, 2);
+                    break;
+                }
             }
-			mqtt_free(ptr_mt);
-			
-			if(cJSON_GetArraySize(mac_info) == 0)
+            if (MW_E_OK != rc)
             {
-            	cJSON_Delete(vlan_entry);
-			}
-			else
-			{
-				cJSON_AddItemToArray(vlan_info, vlan_entry);
-			}
-		}
+                break;
+            }
+        }
+    }
+    mqtt_free(static_mac);
 
-		if(found > 0)
-		{
-			cJSON_AddNumberToObject(json_port_entry, "p", i);
-			cJSON_AddItemToObject(json_port_entry, "vlan_info", vlan_info);
-			cJSON_AddItemToArray(data, json_port_entry);
-		}
-		else
-		{
-			cJSON_Delete(json_port_entry);
-			cJSON_Delete(vlan_info);
-		}
-		
-	}
+    /* the dynamic mac, one FDB walk for all the ports */
+    if (MW_E_OK == rc)
+    {
+        rc = _mqttd_macs_dynamic_load(port_vlan_list, vidx2vid, mac_info);
+    }
+    if (MW_E_OK == rc)
+    {
+        root = cJSON_CreateObject();
+        data = cJSON_CreateArray();
+        if ((NULL == root) || (NULL == data))
+        {
+            cJSON_Delete(root);
+            cJSON_Delete(data);
+            root = NULL;
+            rc = MW_E_NO_MEMORY;
+        }
+        else
+        {
+            cJSON_AddStringToObject(root, "type", "macs");
+            cJSON_AddNumberToObject(root, "continuity", 0);
+            cJSON_AddItemToObject(root, "data", data);
+        }
+    }
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Get mac table failed(%d)\n", rc);
+    }
 
-	mqtt_free(static_mac);
-			
-    mqtt_send_json_and_free(ptr_mqttd, topic, root);
-    
+    /* Only the ports and VLANs having a mac are reported */
+    for (i = 0; i < PLAT_MAX_PORT_NUM; i++)
+    {
+        vlan_info = NULL;
+        vlan_list = port_vlan_list[i];
+        BITMAP_VLAN_FOREACH(vlan_list, vid_idx)
+        {
+            cJSON *ptr_info = mac_info[MQTTD_MACS_INFO_IDX(i, vid_idx)];
+
+            if ((NULL == root) || (NULL == ptr_info) || (0 == cJSON_GetArraySize(ptr_info)))
+            {
+                cJSON_Delete(ptr_info);
+                continue;
+            }
+            if (NULL == vlan_info)
+            {
+                vlan_info = cJSON_CreateArray();
+                json_port_entry = cJSON_CreateObject();
+                cJSON_AddNumberToObject(json_port_entry, "p", i);
+                cJSON_AddItemToObject(json_port_entry, "vlan_info", vlan_info);
+                cJSON_AddItemToArray(data, json_port_entry);
+            }
+            vlan_entry = cJSON_CreateObject();
+            cJSON_AddNumberToObject(vlan_entry, "vid", vidx2vid[vid_idx]);
+            cJSON_AddItemToObject(vlan_entry, "mac_info", ptr_info);
+            cJSON_AddItemToArray(vlan_info, vlan_entry);
+        }
+    }
+    mqtt_free(mac_info);
+
+    if (NULL != root)
+    {
+        mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
+    }
     return;
 }
 
@@ -1214,24 +1939,54 @@ static void _mqttd_publish_macs(MQTTD_CTRL_T *ptr_mqttd)
  *      None
  *
  * NOTES:
- *      None
+ *      The publishing is done by the mqttd task in _mqttd_handle_events.
  */
 static void _mqttd_tmr(timehandle_t ptr_xTimer)
 {
-    if (mqttd.state == MQTTD_STATE_RUN)
+    (void)mqttd_queue_post(MQTTD_EVENT_TICK);
+}
+
+/* FUNCTION NAME:  _mqttd_handle_events
+ * PURPOSE:
+ *      Handle the events posted to the mqttd task
+ *
+ * INPUT:
+ *      ptr_mqttd    --  the pointer of MQTTD ctrl structure
+ *      events       --  the event bits
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      MQTTD_EVENT_WAKE only returns to the state machine.
+ */
+static void _mqttd_handle_events(MQTTD_CTRL_T *ptr_mqttd, UI32_T events)
+{
+    if (events & MQTTD_EVENT_TICK)
     {
-        //_mqttd_send_remain_msg(&mqttd);
-		if((mqttd.ticknum + MQTTD_STATUS_TICK_OFFSET) % mqttd.status_ontick == 0)
-		{
-			_mqttd_publish_status(&mqttd);
-		}
-		if((mqttd.ticknum +  MQTTD_MAC_TICK_OFFSET) % mqttd.mac_ontick == 0)
-		{
-			_mqttd_publish_macs(&mqttd);
-		}
+        if (ptr_mqttd->state == MQTTD_STATE_RUN)
+        {
+            if((ptr_mqttd->ticknum + MQTTD_STATUS_TICK_OFFSET) % ptr_mqttd->status_ontick == 0)
+            {
+                _mqttd_publish_status(ptr_mqttd);
+            }
+            if((ptr_mqttd->ticknum +  MQTTD_MAC_TICK_OFFSET) % ptr_mqttd->mac_ontick == 0)
+            {
+                _mqttd_publish_macs(ptr_mqttd);
+            }
+        }
+        ptr_mqttd->ticknum++;
+        /* A PUBLISH timed out without callback is retried on the tick */
+        events |= MQTTD_EVENT_REPLAY;
+    }
+    if ((events & MQTTD_EVENT_REPLAY) && (ptr_mqttd->state == MQTTD_STATE_RUN))
+    {
+        /* Messages held back by the broker flow control */
+        _mqttd_replay_remain(ptr_mqttd);
     }
-	mqttd.ticknum++;
-
 }
 /*=== DB related local functions ===*/
 
@@ -1268,7 +2023,7 @@ static UI8_T _mqttd_gen_client_id(MQTTD_CTRL_T *ptr_mqttd)
     {
         mqttd_debug_db("get hw_version success, ptr_msg =%p", db_msg);
         memcpy(hw_version, db_data, db_size);
-        osapi_free(db_msg);
+        dbapi_freeMsg(db_msg);
     }
     else
     {
@@ -1283,7 +2038,7 @@ static UI8_T _mqttd_gen_client_id(MQTTD_CTRL_T *ptr_mqttd)
     {
         mqttd_debug_db("get sys_mac success, ptr_msg =%p", db_msg);
         memcpy(sys_mac, db_data, db_size);
-        osapi_free(db_msg);
+        dbapi_freeMsg(db_msg);
     }
     else
     {
@@ -1340,7 +2095,7 @@ _mqttd_subscribe_db(
     }
 
     /* create the subscribe data payload */
-    rc = osapi_calloc(msg_size, MQTTD_QUEUE_NAME, (void **)(&ptr_msg));
+    rc = dbapi_allocMsg(msg_size, &ptr_msg);
     if (MW_E_OK != rc)
     {
         mqttd_debug_db("Failed to allocate memory size:%d (rc = %u)\n", msg_size, rc);
@@ -1363,7 +2118,7 @@ _mqttd_subscribe_db(
     if (MW_E_OK != rc)
     {
         mqttd_debug_db("Failed to send message to DB Queue\n");
-        osapi_free(ptr_msg);
+        dbapi_freeMsg(ptr_msg);
         return rc;
     }
     osapi_printf("Subscribe internal DB done.\n");
@@ -1407,7 +2162,7 @@ _mqttd_unsubscribe_db(
     }
 
     /* create the subscribe data payload */
-    rc = osapi_calloc(msg_size, MQTTD_QUEUE_NAME, (void **)(&ptr_msg));
+    rc = dbapi_allocMsg(msg_size, &ptr_msg);
     if (MW_E_OK != rc)
     {
         mqttd_debug_db("Failed to allocate memory(rc = %u)", rc);
@@ -1427,7 +2182,7 @@ _mqttd_unsubscribe_db(
     if (MW_E_OK != rc)
     {
         mqttd_debug_db("Failed to send message to DB Queue");
-        osapi_free(ptr_msg);
+        dbapi_freeMsg(ptr_msg);
         return rc;
     }
     mqttd_debug_db("Unsubscribe DB success, db_msg =%p", ptr_msg);
@@ -1484,9 +2239,9 @@ static MW_ERROR_NO_T _mqttd_publish_sysinfo(MQTTD_CTRL_T *ptr_mqttd,  const DB_R
 		MW_UTIL_IPV4_TO_STR(ip_str, PP_HTONL(ptr_sys_info->static_dns));
 	    cJSON_AddStringToObject(ip, "dns", ip_str);
 	    
-		mqtt_free(db_msg);
+		dbapi_freeMsg(db_msg);
 		
-		mqtt_send_json_and_free(ptr_mqttd, topic, root);
+		mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
         
     }
 	return rc;
@@ -1556,8 +2311,8 @@ static MW_ERROR_NO_T _mqttd_publish_portcfg(MQTTD_CTRL_T *ptr_mqttd,  const DB_R
         cJSON_AddNumberToObject(port_setting_entry, "EEE", ptr_port_cfg_info->eee_enable);
 
         //osapi_printf("vlan %d, vlan list %x", ptr_port_cfg_info->pvid, ptr_port_cfg_info->vlan_list);
-		mqtt_free(db_msg);
-	   	mqtt_send_json_and_free(ptr_mqttd, topic, root);
+		dbapi_freeMsg(db_msg);
+	   	mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
     }
 	return rc;
 }
@@ -1595,9 +2350,9 @@ static MW_ERROR_NO_T _mqttd_publish_vlancfg(MQTTD_CTRL_T *ptr_mqttd,  const DB_R
     cJSON_AddNumberToObject(data, "untagged_member", vlan_entry->untagged_member);
     cJSON_AddItemToObject(data, "vlan_member", vlan_member);
 
-	mqtt_free(db_msg);
+	dbapi_freeMsg(db_msg);
    
-	mqtt_send_json_and_free(ptr_mqttd, topic, root);
+	mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
 
 	return rc;
 }
@@ -1619,7 +2374,7 @@ static MW_ERROR_NO_T _mqttd_publish_jumbo_frame(MQTTD_CTRL_T *ptr_mqttd,  const
 		return rc;
     }
     memcpy(&jumbo_frame_info, db_data, sizeof(DB_JUMBO_FRAME_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
 
     char topic[80];
     osapi_snprintf(topic, sizeof(topic), "%s/event", ptr_mqttd->topic_prefix);
@@ -1631,7 +2386,7 @@ static MW_ERROR_NO_T _mqttd_publish_jumbo_frame(MQTTD_CTRL_T *ptr_mqttd,  const
     cJSON_AddItemToObject(data, "jumbo_frame", jumbo_frame);
 	cJSON_AddNumberToObject(jumbo_frame, "mtu", jumbo_frame_info.cfg*1024);
 
-	mqtt_send_json_and_free(ptr_mqttd, topic, root);
+	mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
 
 	return rc;
 }
@@ -1657,7 +2412,7 @@ static MW_ERROR_NO_T _mqttd_publish_port_mirroring(MQTTD_CTRL_T *ptr_mqttd,  con
 		return rc;
     }
     memcpy(&port_mirror_info, db_data, sizeof(ONE_DB_PORT_MIRROR_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
     
     //osapi_printf("Port Mirror Info:\n");
     //osapi_printf("Session %d:\n", req->e_idx);
@@ -1695,28 +2450,57 @@ static MW_ERROR_NO_T _mqttd_publish_port_mirroring(MQTTD_CTRL_T *ptr_mqttd,  con
     cJSON_AddNumberToObject(json_port_mirror_entry, "tp", port_mirror_info.dest_port);
 
     cJSON_AddItemToArray(json_port_mirror_info, json_port_mirror_entry);
-  	mqtt_send_json_and_free(ptr_mqttd, topic, root);
+  	mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
 	return rc;
 }
 
 
+/* FUNCTION NAME: _mqttd_static_mac_used
+ * PURPOSE:
+ *      The cursor filter of STATIC_MAC_ENTRY, skips the blank entries
+ *
+ * INPUT:
+ *      pos         --  the entry index
+ *      data_size   --  the entry size
+ *      ptr_data    --  the entry, packed mac_addr, vid and port
+ *      ptr_arg     --  not used
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      TRUE if the entry has ports
+ *
+ * NOTES:
+ *      None
+ */
+static BOOL_T _mqttd_static_mac_used(const UI16_T pos, const UI16_T data_size, const void *ptr_data, void *ptr_arg)
+{
+    UI32_T port = 0;
+
+    if (data_size < MQTTD_SMAC_ENTRY_SIZE)
+    {
+        return FALSE;
+    }
+    memcpy(&port, (const UI8_T *)ptr_data + MQTTD_SMAC_ENTRY_OFFSET_PORT, MQTTD_SMAC_FIELD_SIZE(port));
+    return (0 != port) ? TRUE : FALSE;
+}
+
 static MW_ERROR_NO_T _mqttd_publish_static_mac(MQTTD_CTRL_T *ptr_mqttd,  const DB_REQUEST_TYPE_T *req, const void *ptr_data)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
-	DB_STATIC_MAC_ENTRY_T static_mac_info;
-    DB_MSG_T *ptr_db_msg = NULL;
-    u16_t db_size = 0;
-    void *db_data = NULL;
+    DB_CURSOR_T cursor;
+    UI16_T e_idx = 0;
+    UI16_T entry_size = 0;
+    void *ptr_entry = NULL;
 	osapi_printf("publish static mac: T/F/E =%u/%u/%u\n", req->t_idx, req->f_idx, req->e_idx);
-    memset(&static_mac_info, 0, sizeof(DB_STATIC_MAC_ENTRY_T));
-    rc = mqttd_queue_getData(STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_db_msg, &db_size, &db_data);
+    /* Page through the table instead of copying all MAX_STATIC_MAC_NUM entries */
+    rc = dbapi_cursorOpen(STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_CURSOR_PAGE_MAX, _mqttd_static_mac_used, NULL, &cursor);
     if(MW_E_OK != rc)
     {
-        mqttd_debug("Get org DB static_mac_info failed(%d)\n", rc);
+        mqttd_debug("Open DB static_mac cursor failed(%d)\n", rc);
 		return rc;
     }
-    memcpy(&static_mac_info, db_data, sizeof(DB_STATIC_MAC_ENTRY_T));
-    mqtt_free(ptr_db_msg);
     
     char topic[80];
     osapi_snprintf(topic, sizeof(topic), "%s/event", ptr_mqttd->topic_prefix);
@@ -1727,37 +2511,47 @@ static MW_ERROR_NO_T _mqttd_publish_static_mac(MQTTD_CTRL_T *ptr_mqttd,  const D
 	cJSON_AddItemToObject(root, "data", data);
     cJSON_AddItemToObject(data, "static_mac", json_mac_info);
    
-    int i;
-    for (i = 0; i < MAX_STATIC_MAC_NUM; i++)
+    while (MW_E_OK == (rc = dbapi_cursorNext(&cursor, &e_idx, &entry_size, &ptr_entry)))
     {
-        //blank entry
-        #if 1
-        if(static_mac_info.port[i] == 0)
+        const UI8_T *mac = (const UI8_T *)ptr_entry;
+        UI16_T vid = 0;
+        UI32_T port = 0;
+
+        if (entry_size < MQTTD_SMAC_ENTRY_SIZE)
+        {
             continue;
-        #endif
+        }
+        memcpy(&vid, mac + MQTTD_SMAC_ENTRY_OFFSET_VID, MQTTD_SMAC_FIELD_SIZE(vid));
+        memcpy(&port, mac + MQTTD_SMAC_ENTRY_OFFSET_PORT, MQTTD_SMAC_FIELD_SIZE(port));
         cJSON *json_mac_entry = cJSON_CreateObject();
         if (json_mac_entry == NULL)
         {
             mqttd_debug("Failed to create JSON object for static MAC entry.");
-            cJSON_Delete(json_mac_info);
+            dbapi_cursorClose(&cursor);
+            cJSON_Delete(root);
             return MW_E_NO_MEMORY;
         }
 
         char mac_str[18];
         snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-                 static_mac_info.mac_addr[i][0], static_mac_info.mac_addr[i][1],
-                 static_mac_info.mac_addr[i][2], static_mac_info.mac_addr[i][3],
-                 static_mac_info.mac_addr[i][4], static_mac_info.mac_addr[i][5]);
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
         cJSON_AddStringToObject(json_mac_entry, "mac", mac_str);
-        cJSON_AddNumberToObject(json_mac_entry, "vid", static_mac_info.vid[i]);
-        cJSON_AddNumberToObject(json_mac_entry, "p", static_mac_info.port[i]);
+        cJSON_AddNumberToObject(json_mac_entry, "vid", vid);
+        cJSON_AddNumberToObject(json_mac_entry, "p", port);
 
         cJSON_AddItemToArray(json_mac_info, json_mac_entry);
     }
+    dbapi_cursorClose(&cursor);
+    if (MW_E_ENTRY_NOT_FOUND != rc)
+    {
+        mqttd_debug("Get DB static_mac_info failed(%d)\n", rc);
+        cJSON_Delete(root);
+        return rc;
+    }
 
-	mqtt_send_json_and_free(ptr_mqttd, topic, root);
+	mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_BULK);
 
-	return rc;
+	return MW_E_OK;
 }
 
 #if 0
@@ -1803,7 +2597,7 @@ _mqttd_listen_db(
     if (M_B_RESPONSE == (ptr_msg->method & M_B_RESPONSE))
     {
         mqttd_debug_db("free the response meesage: ptr_msg =%p", ptr_msg);
-        osapi_free(ptr_msg);
+        dbapi_freeMsg(ptr_msg);
         return;
     }
 
@@ -1846,7 +2640,7 @@ _mqttd_listen_db(
         }
     }
     mqttd_debug_db("free ptr_msg =%p\n", ptr_msg);
-    osapi_free(ptr_msg);
+    dbapi_freeMsg(ptr_msg);
     ptr_msg = NULL;
 }
 
@@ -1857,6 +2651,7 @@ _mqttd_listen_db(
  *
  * INPUT:
  *      ptr_mqttd    --  the pointer of MQTTD ctrl structure
+ *      timeout      --  the ticks to wait, DB_EVENT_WAIT_FOREVER to block
  *
  * OUTPUT:
  *      None
@@ -1864,11 +2659,14 @@ _mqttd_listen_db(
  * RETURN:
  *
  * NOTES:
- *      None
+ *      It returns after one DB message or one batch of posted events.
+ *      While async DB gets are pending, the wait is bound by DB_ASYNC_TIMEOUT
+ *      so the expired ones are failed.
  */
 static void
 _mqttd_listen_db(
-    MQTTD_CTRL_T *ptr_mqttd)
+    MQTTD_CTRL_T *ptr_mqttd,
+    UI32_T timeout)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
     DB_MSG_T *ptr_msg = NULL;
@@ -1876,26 +2674,63 @@ _mqttd_listen_db(
     UI16_T msg_size = 0;
     UI8_T count = 0;
     UI8_T method = 0;
+    UI32_T events = DB_EVENT_NONE;
     DB_REQUEST_TYPE_T req;
 
-    /* Block mode to receive the DB message */
-    rc = dbapi_recvMsg(
-            MQTTD_QUEUE_NAME,
-            &ptr_msg,
-            MQTTD_QUEUE_TIMEOUT);
+    /* Wake up in time to expire the async requests DB never answers */
+    if ((timeout > DB_ASYNC_TIMEOUT) && (TRUE == dbapi_hasPendingAsync(MQTTD_QUEUE_NAME)))
+    {
+        timeout = DB_ASYNC_TIMEOUT;
+    }
+
+    /* Block until a DB message or an event */
+    rc = mqttd_queue_wait(timeout, &ptr_msg, &events);
     if (MW_E_OK != rc)
+    {
+        dbapi_expireAsync(MQTTD_QUEUE_NAME);
+        return;
+    }
+    if (DB_EVENT_NONE != events)
+    {
+        _mqttd_handle_events(ptr_mqttd, events);
+    }
+    if (NULL == ptr_msg)
     {
         return;
     }
 
     mqttd_debug_db("get ptr_msg =%p", ptr_msg);
+    /* Responses of dbapi_getDataAsync go to their continuations */
+    if (MW_E_OK == dbapi_completeAsync(ptr_msg))
+    {
+        return;
+    }
     if (M_B_RESPONSE == (ptr_msg->method & M_B_RESPONSE))
     {
         mqttd_debug_db("free the response meesage: ptr_msg =%p", ptr_msg);
-        osapi_free(ptr_msg);
+        dbapi_freeMsg(ptr_msg);
         return;
     }
 
+    /* Invalidate the indexes even when not connected to Cloud.
+     * Every notification counts: M_UPDATE, M_CREATE and M_DELETE all carry
+     * M_B_WRITE, and the subscription snapshot comes as M_GET.
+     */
+    count = ptr_msg->type.count;
+    ptr_data = (UI8_T *)&(ptr_msg->ptr_payload);
+    while (count > 0)
+    {
+        memcpy((void *)&req, (const void *)ptr_data, sizeof(DB_REQUEST_TYPE_T));
+        ptr_data += sizeof(DB_REQUEST_TYPE_T);
+        memcpy((void *)&msg_size, (const void *)ptr_data, sizeof(UI16_T));
+        ptr_data += sizeof(UI16_T);
+        mqttd_vlan_idx_notify(req.t_idx);
+        mqttd_smac_idx_notify_data(&req, ptr_data, msg_size);
+        mqttd_rsp_notify(req.t_idx);
+        ptr_data += msg_size;
+        count--;
+    }
+
     /* Send the updates to Cloud */
     if (ptr_mqttd->ptr_client != NULL)
     {
@@ -1954,7 +2789,7 @@ _mqttd_listen_db(
         }
     }
     mqttd_debug_db("free ptr_msg =%p\n", ptr_msg);
-    osapi_free(ptr_msg);
+    dbapi_freeMsg(ptr_msg);
     ptr_msg = NULL;
 }
 
@@ -2025,7 +2860,7 @@ static void _mqttd_db_proxy(MQTTD_CTRL_T *ptr_mqttd, const u8_t *data, u16_t len
     msg_size += DB_MSG_HEADER_SIZE;
 
     /* allocate the message and send to internal DB */
-    rc = osapi_calloc(msg_size, MQTTD_QUEUE_NAME, (void **)&ptr_db_msg);
+    rc = dbapi_allocMsg(msg_size, &ptr_db_msg);
     if (MW_E_OK != rc)
     {
         osapi_printf("%s: allocate memory failed(%d)\n", __func__, rc);
@@ -2051,7 +2886,7 @@ static void _mqttd_db_proxy(MQTTD_CTRL_T *ptr_mqttd, const u8_t *data, u16_t len
     rc = dbapi_sendMsg(ptr_db_msg, MQTTD_MUX_LOCK_TIME);
     if (MW_E_OK != rc)
     {
-        osapi_free(ptr_db_msg);
+        dbapi_freeMsg(ptr_db_msg);
     }
 }
 
@@ -2334,6 +3169,8 @@ static UI16_T _mqttd_db_topic_set(MQTTD_CTRL_T *ptr_mqttd, const UI8_T method, c
  *      MQTTD publish callback function
  *
  * INPUT:
+ *      arg     --  the remained message, NULL if it is not kept
+ *      err     --  ERR_OK if acknowledged
  *
  * OUTPUT:
  *      None
@@ -2341,13 +3178,24 @@ static UI16_T _mqttd_db_topic_set(MQTTD_CTRL_T *ptr_mqttd, const UI8_T method, c
  * RETURN:
  *
  * NOTES:
- *
+ *      ERR_TIMEOUT and ERR_CONN keep an interactive message for
+ *      _mqttd_replay_remain. A bulk message is dropped, the next report
+ *      supersedes it. ERR_VAL is a rejection by the broker, the message is
+ *      dropped.
  */
 static void _mqttd_publish_cb(void *arg, err_t err)
 {
-	//MQTTD_CTRL_T *ptr_mqttd = (MQTTD_CTRL_T *)arg;
+	MQTTD_PUB_LIST_T *ptr_msg = (MQTTD_PUB_LIST_T *)arg;
     mqttd_debug("Send Publish control packet code: (%d).\n", err);
-	
+
+    /* Only mark it here, the list is changed under ptr_mqttmutex */
+    if (NULL != ptr_msg)
+    {
+        ptr_msg->state = ((ERR_OK == err) || (ERR_VAL == err) || (MQTTD_PUB_LANE_BULK == ptr_msg->lane)) ?
+                         MQTTD_PUB_ACKED : MQTTD_PUB_REPLAY;
+    }
+    /* A completed PUBLISH frees the broker quota for the held messages */
+    (void)mqttd_queue_post(MQTTD_EVENT_REPLAY);
 }
 
 #if 0
@@ -2539,7 +3387,7 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_response(MQTTD_CTRL_T *mqttdctl, cJ
 	else
 		cJSON_AddStringToObject(root, "result", "error");
 
-	mqtt_send_json_and_free(mqttdctl, topic, root);
+	mqtt_send_json_and_free(mqttdctl, topic, root, MQTTD_PUB_LANE_INTERACTIVE);
 	
     return rc;
 
@@ -2561,7 +3409,7 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_device(MQTTD_CTRL_T *mqttdctl, cJSO
     }
 
     memcpy(&sys_info, db_data, sizeof(DB_SYS_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
 
     cJSON *name_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "n");
     if (name_obj) {
@@ -2594,7 +3442,7 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_ip(MQTTD_CTRL_T *mqttdctl, cJSON *d
     }
 
     memcpy(&sys_info, db_data, sizeof(DB_SYS_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
 
     cJSON *dhcp_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "auip");
     if (dhcp_obj) {
@@ -2650,120 +3498,87 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_ip(MQTTD_CTRL_T *mqttdctl, cJSON *d
     return rc;
 }
 
+/* setConfig "port_setting" object, "p" lists the ports it applies to */
+static const MQTTD_BIND_MAP_T _mqttd_port_speed_map[] = {
+    { 0, 0 },   /* auto */
+    { 1, 1 },   /* 10M */
+    { 2, 2 },   /* 100M */
+    { 3, 3 },   /* 1000M */
+};
+
+static const MQTTD_BIND_MAP_T _mqttd_port_duplex_map[] = {
+    { 1, 0 },
+    { 3, AIR_PORT_DUPLEX_HALF },
+    { 4, AIR_PORT_DUPLEX_FULL },
+};
+
+enum {
+    MQTTD_PORT_BIND_EN = 0,
+    MQTTD_PORT_BIND_SP,
+    MQTTD_PORT_BIND_DU,
+    MQTTD_PORT_BIND_FC,
+    MQTTD_PORT_BIND_EEE,
+    MQTTD_PORT_BIND_P,
+    MQTTD_PORT_BIND_LAST
+};
+
+static const MQTTD_BIND_FIELD_T _mqttd_port_bind[MQTTD_PORT_BIND_LAST] = {
+    MQTTD_BIND_FIELD("en", MQTTD_BIND_TYPE_INT, DB_PORT_CFG_INFO_T, admin_status, 0, 1, (const MQTTD_BIND_MAP_T *)NULL),
+    /* an unknown speed is auto */
+    MQTTD_BIND_FIELD("sp", MQTTD_BIND_TYPE_MAP, DB_PORT_CFG_INFO_T, admin_speed, 0, 1, _mqttd_port_speed_map),
+    /* an unknown duplex is ignored */
+    MQTTD_BIND_FIELD("du", MQTTD_BIND_TYPE_MAP, DB_PORT_CFG_INFO_T, admin_duplex, 0, 0, _mqttd_port_duplex_map),
+    MQTTD_BIND_FIELD("fc", MQTTD_BIND_TYPE_INT, DB_PORT_CFG_INFO_T, admin_flow_ctrl, 0, 1, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_FIELD("EEE", MQTTD_BIND_TYPE_INT, DB_PORT_CFG_INFO_T, eee_enable, 0, 1, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_ITEM("p"),
+};
+
 static MW_ERROR_NO_T _mqttd_handle_setconfig_port_setting(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
     DB_PORT_CFG_INFO_T port_cfg_info;
+    DB_PORT_CFG_INFO_T port_cfg_new;
     DB_MSG_T *ptr_db_msg = NULL;
     u16_t db_size = 0;
     void *db_data = NULL;
+    const cJSON *items[MQTTD_PORT_BIND_LAST];
+    UI32_T present = 0;
 
     cJSON *port_cfg_obj;
     cJSON_ArrayForEach(port_cfg_obj, data_obj) {
         if (cJSON_IsObject(port_cfg_obj)) {
-            cJSON *port_obj = cJSON_GetObjectItemCaseSensitive(port_cfg_obj, "p");
+            /* Walk the object once, then apply it to each port */
+            memset(&port_cfg_new, 0, sizeof(DB_PORT_CFG_INFO_T));
+            (void)mqttd_bind_parse(port_cfg_obj, _mqttd_port_bind, MQTTD_PORT_BIND_LAST, &port_cfg_new, items, &present);
+            const cJSON *port_obj = items[MQTTD_PORT_BIND_P];
             if (!port_obj) {
                 break;
             }
-            cJSON *port_id;
+            const cJSON *port_id;
             cJSON_ArrayForEach(port_id, port_obj) {
-	            if (cJSON_IsNumber(port_id) && port_id->valueint < PLAT_MAX_PORT_NUM) 
-				{
-	                int port_id_value = port_id->valueint;
-	                // Process each port_id_value as needed
-	                // For example, you can add it to port_cfg_info or perform other operations
-	                memset(&port_cfg_info, 0, sizeof(DB_PORT_CFG_INFO_T));
-
-	                rc = mqttd_queue_getData(PORT_CFG_INFO, DB_ALL_FIELDS, port_id_value, &ptr_db_msg, &db_size, &db_data);
-	                if (MW_E_OK != rc) {
-	                    mqttd_debug("get org DB port_cfg_info failed(%d)\n", rc);
-	                    break;
-	                }
-
-	                memcpy(&port_cfg_info, db_data, sizeof(DB_PORT_CFG_INFO_T));
-	                mqtt_free(ptr_db_msg);
-	                cJSON *enable_obj = cJSON_GetObjectItemCaseSensitive(port_cfg_obj, "en");
-	                if (enable_obj) {
-	                    port_cfg_info.admin_status = enable_obj->valueint;
-	                }
+                if (cJSON_IsNumber(port_id) && port_id->valueint < PLAT_MAX_PORT_NUM)
+                {
+                    int port_id_value = port_id->valueint;
 
-	                cJSON *speed_obj = cJSON_GetObjectItemCaseSensitive(port_cfg_obj, "sp");
-	                if (speed_obj) {
-	                    switch (speed_obj->valueint) {
-		                    case 0:
-		                        port_cfg_info.admin_speed = 0; /*auto*/
-		                        break;
-		                    case 1:
-		                        port_cfg_info.admin_speed = 1; /*10M*/
-		                        break;
-		                    case 2:
-		                        port_cfg_info.admin_speed = 2; /*100M*/
-		                        break;
-		                    case 3:
-		                        port_cfg_info.admin_speed = 3; /*1000M*/
-		                        break;		                        
-		                    default:
-	                            //port_cfg_info.admin_speed = AIR_PORT_SPEED_AUTO;
-	                            port_cfg_info.admin_speed = 0; /*auto*/
-	                            break;
-	                    }
-	                }
-					cJSON *duplex_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "du");
-		            if (duplex_obj) {
-		                switch (duplex_obj->valueint) {
-		                	case 1:
-		                        port_cfg_info.admin_duplex = 0;
-		                        break;
-		                    case 3:
-		                        port_cfg_info.admin_duplex = AIR_PORT_DUPLEX_HALF;
-		                        break;
-		                    case 4:
-		                        port_cfg_info.admin_duplex = AIR_PORT_DUPLEX_FULL;
-		                        break;
-		                    default:
-		                        // port_cfg_info.admin_duplex = AIR_PORT_DUPLEX_AUTO;
-		                        break;
-		                }
-		            }
+                    rc = mqttd_queue_getData(PORT_CFG_INFO, DB_ALL_FIELDS, port_id_value, &ptr_db_msg, &db_size, &db_data);
+                    if (MW_E_OK != rc) {
+                        mqttd_debug("get org DB port_cfg_info failed(%d)\n", rc);
+                        break;
+                    }
 
-		            cJSON *fc_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "fc");
-		            if (fc_obj) {
-		                switch (fc_obj->valueint) {
-		                    case 1:
-		                        port_cfg_info.admin_flow_ctrl = 1;
-		                        break;
-		                    case 0:
-		                        port_cfg_info.admin_flow_ctrl = 0;
-		                        break;
-		                    default:
-		                        // port_cfg_info.admin_flow_ctrl = 0;
-		                        break;
-		                }
-		            }
+                    memcpy(&port_cfg_info, db_data, sizeof(DB_PORT_CFG_INFO_T));
+                    dbapi_freeMsg(ptr_db_msg);
+                    mqttd_bind_apply(_mqttd_port_bind, MQTTD_PORT_BIND_LAST, present, &port_cfg_new, &port_cfg_info);
 
-		            cJSON *eee_obj = cJSON_GetObjectItemCaseSensitive(data_obj, "EEE");
-		            if (eee_obj) {
-		                switch (eee_obj->valueint) {
-		                    case 1:
-		                        port_cfg_info.eee_enable = 1;
-		                        break;
-		                    case 0:
-		                        port_cfg_info.eee_enable = 0;
-		                        break;
-		                    default:
-		                        // port_cfg_info.eee_enable = 0;
-		                        break;
-		                }
-		            }
-			        rc = mqttd_queue_setData(M_UPDATE, PORT_CFG_INFO, DB_ALL_FIELDS, port_id_value, &port_cfg_info, sizeof(port_cfg_info));
-			        if (MW_E_OK != rc) {
-			            mqttd_debug("Update DB port_cfg_info failed(%d)\n", rc);
-						break;
-			        }
-	   			}
-        	}
-    	}
-	}
+                    rc = mqttd_queue_setData(M_UPDATE, PORT_CFG_INFO, DB_ALL_FIELDS, port_id_value, &port_cfg_info, sizeof(port_cfg_info));
+                    if (MW_E_OK != rc) {
+                        mqttd_debug("Update DB port_cfg_info failed(%d)\n", rc);
+                        break;
+                    }
+                }
+            }
+        }
+    }
     return rc;
 }
 
@@ -2796,7 +3611,7 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_port_mirroring(MQTTD_CTRL_T *mqttdc
             }
 
             memcpy(&port_mirror_info, db_data, sizeof(DB_PORT_MIRROR_INFO_T));
-            mqtt_free(ptr_db_msg);
+            dbapi_freeMsg(ptr_db_msg);
             // get direction
             int dir_int,port_int;
             cJSON *dir_obj = cJSON_GetObjectItemCaseSensitive(port_mirror_obj, "dir");
@@ -2848,53 +3663,147 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_port_mirroring(MQTTD_CTRL_T *mqttdc
 
 
 
+/* setConfig "static_mac" entry */
+typedef struct MQTTD_SMAC_BIND_S
+{
+    UI8_T   mac[MQTTD_SMAC_MAC_LEN];
+    UI16_T  vid;
+    UI8_T   port;
+} MQTTD_SMAC_BIND_T;
+
+enum {
+    MQTTD_SMAC_BIND_MAC = 0,
+    MQTTD_SMAC_BIND_VID,
+    MQTTD_SMAC_BIND_P,
+    MQTTD_SMAC_BIND_OP,
+    MQTTD_SMAC_BIND_LAST
+};
+
+static const MQTTD_BIND_FIELD_T _mqttd_smac_bind[MQTTD_SMAC_BIND_LAST] = {
+    MQTTD_BIND_FIELD("mac", MQTTD_BIND_TYPE_MAC, MQTTD_SMAC_BIND_T, mac, 0, 0, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_FIELD("vid", MQTTD_BIND_TYPE_INT, MQTTD_SMAC_BIND_T, vid, MQTTD_SMAC_VID_MIN, MQTTD_SMAC_VID_MAX, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_FIELD("p", MQTTD_BIND_TYPE_INT, MQTTD_SMAC_BIND_T, port, 1, PLAT_MAX_PORT_NUM, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_ITEM("op"),
+};
+
+/* FUNCTION NAME:  _mqttd_handle_setconfig_static_mac
+ * PURPOSE:
+ *      Apply the static_mac of setConfig to STATIC_MAC_ENTRY
+ *
+ * INPUT:
+ *      mqttdctl    --  the pointer of MQTTD ctrl structure
+ *      data_obj    --  the static_mac array
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_TABLE_FULL
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      Entries are keyed by (mac, vid). An entry with "op" of "add" adds it or
+ *      moves it to port "p", "del" deletes it. When no entry has "op", the
+ *      array replaces the table. Only the changed entries are written to DB.
+ */
 static MW_ERROR_NO_T _mqttd_handle_setconfig_static_mac(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
-    DB_STATIC_MAC_ENTRY_T static_mac_info;
-    DB_MSG_T *ptr_db_msg = NULL;
-    u16_t db_size = 0;
-    void *db_data = NULL;
-
+    MW_ERROR_NO_T ret = MW_E_OK;
+    MQTTD_SMAC_IDX_T *ptr_idx = NULL;
+    UI32_T keep[(MAX_STATIC_MAC_NUM + 31) / 32];
+    MQTTD_SMAC_BIND_T entry;
+    const cJSON *items[MQTTD_SMAC_BIND_LAST];
+    UI32_T present = 0;
+    BOOL_T replace = TRUE;
+    BOOL_T del = FALSE;
+    UI16_T slot;
     cJSON *static_mac_obj;
-    int idx = 0;
-    memset(&static_mac_info, 0, sizeof(DB_STATIC_MAC_ENTRY_T));
-    rc = mqttd_queue_getData(STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_db_msg, &db_size, &db_data);
+    const cJSON *op_obj;
+
+    if (!cJSON_IsArray(data_obj)) {
+        return MW_E_BAD_PARAMETER;
+    }
+
+    rc = mqttd_smac_idx_get(&ptr_idx);
     if (MW_E_OK != rc) {
-        mqttd_debug("get org DB static_mac_info failed(%d)\n", rc);
+        mqttd_debug("get static mac index failed(%d)\n", rc);
         return rc;
     }
-    memcpy(&static_mac_info, db_data, sizeof(DB_STATIC_MAC_ENTRY_T));
-    mqtt_free(ptr_db_msg);
+    memset(keep, 0, sizeof(keep));
 
     cJSON_ArrayForEach(static_mac_obj, data_obj) {
-        if (cJSON_IsObject(static_mac_obj) && idx < MAX_STATIC_MAC_NUM) {
-            cJSON *mac_obj = cJSON_GetObjectItemCaseSensitive(static_mac_obj, "mac");
-            if (mac_obj) {
-                sscanf(mac_obj->valuestring, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
-                       &static_mac_info.mac_addr[idx][0], &static_mac_info.mac_addr[idx][1],
-                       &static_mac_info.mac_addr[idx][2], &static_mac_info.mac_addr[idx][3],
-                       &static_mac_info.mac_addr[idx][4], &static_mac_info.mac_addr[idx][5]);
+        if (!cJSON_IsObject(static_mac_obj)) {
+            continue;
+        }
+        memset(&entry, 0, sizeof(entry));
+        (void)mqttd_bind_parse(static_mac_obj, _mqttd_smac_bind, MQTTD_SMAC_BIND_LAST, &entry, items, &present);
+        op_obj = items[MQTTD_SMAC_BIND_OP];
+        if (NULL != op_obj) {
+            /* The array is a list of changes, the sweep below only runs after it */
+            replace = FALSE;
+        }
+        if (!(present & BIT(MQTTD_SMAC_BIND_MAC)) || !(present & BIT(MQTTD_SMAC_BIND_VID))) {
+            mqttd_debug("static_mac entry without a valid mac/vid\n");
+            ret = MW_E_BAD_PARAMETER;
+            continue;
+        }
+        del = (cJSON_IsString(op_obj) && (0 == osapi_strcmp(op_obj->valuestring, "del")));
+        slot = mqttd_smac_idx_find(ptr_idx, entry.mac, entry.vid);
+
+        if (TRUE == del) {
+            if (MQTTD_SMAC_SLOT_NONE == slot) {
+                continue;
             }
-            
-            cJSON *vid_obj = cJSON_GetObjectItemCaseSensitive(static_mac_obj, "vid");
-            if (vid_obj) {
-                static_mac_info.vid[idx] = vid_obj->valueint;
+            (void)mqttd_smac_idx_del(ptr_idx, slot);
+        } else {
+            if (!(present & BIT(MQTTD_SMAC_BIND_P))) {
+                mqttd_debug("static_mac entry with a bad port\n");
+                ret = MW_E_BAD_PARAMETER;
+                continue;
             }
-
-            cJSON *port_obj = cJSON_GetObjectItemCaseSensitive(static_mac_obj, "p");
-            if (port_obj) {
-                static_mac_info.port[idx] = port_obj->valueint;
+            if (MQTTD_SMAC_SLOT_NONE == slot) {
+                rc = mqttd_smac_idx_add(ptr_idx, entry.mac, entry.vid, entry.port, &slot);
+                if (MW_E_OK != rc) {
+                    mqttd_debug("add static mac failed(%d)\n", rc);
+                    ret = rc;
+                    continue;
+                }
+            } else if (entry.port == ptr_idx->tbl.port[slot]) {
+                keep[slot / 32] |= BIT(slot % 32);
+                continue;
+            } else {
+                ptr_idx->tbl.port[slot] = entry.port;
             }
-  
-    	}
-	}
+            keep[slot / 32] |= BIT(slot % 32);
+        }
+        rc = mqttd_smac_idx_commit(ptr_idx, slot);
+        if (MW_E_OK != rc) {
+            mqttd_debug("Update DB static_mac entry %u failed(%d)\n", slot + 1, rc);
+            break;
+        }
+    }
 
-    rc = mqttd_queue_setData(M_UPDATE, STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &static_mac_info, sizeof(static_mac_info));
+    /* Replace: the entries not in the array are deleted */
+    for (slot = 0; (TRUE == replace) && (MW_E_OK == rc) && (slot < MAX_STATIC_MAC_NUM); slot++) {
+        if ((0 == ptr_idx->tbl.port[slot]) || (keep[slot / 32] & BIT(slot % 32))) {
+            continue;
+        }
+        (void)mqttd_smac_idx_del(ptr_idx, slot);
+        rc = mqttd_smac_idx_commit(ptr_idx, slot);
+        if (MW_E_OK != rc) {
+            mqttd_debug("Delete DB static_mac entry %u failed(%d)\n", slot + 1, rc);
+        }
+    }
     if (MW_E_OK != rc) {
-        mqttd_debug("Update DB static_mac_info failed(%d)\n", rc);
+        /* The index is ahead of DB, build it again */
+        mqttd_smac_idx_notify(STATIC_MAC_ENTRY);
+        ret = rc;
     }
-    return rc;
+    mqttd_smac_idx_release();
+    return ret;
 }
 
 
@@ -2915,7 +3824,7 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_vlan_member(MQTTD_CTRL_T *mqttdctl,
         return rc;
     }
     memcpy(&vlan_info, db_data, sizeof(DB_VLAN_ENTRY_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
 
     cJSON_ArrayForEach(vlan_member_obj, data_obj) {
         if (cJSON_IsObject(vlan_member_obj) && idx < MAX_VLAN_ENTRY_NUM) {
@@ -2994,7 +3903,7 @@ static MW_ERROR_NO_T _mqttd_vlan_mode_set(u8_t vlan_mode){
     || (VLAN_1Q_ENABLE == vlan_mode && vlan_cfg->enable_8021q_b == VLAN_STATE_ENABLE)
     || (VLAN_MTU_ENABLE == vlan_mode && vlan_cfg->enable_mtu == VLAN_STATE_ENABLE))
     {
-        MW_FREE(ptr_db_msg);
+        DB_MSG_FREE(ptr_db_msg);
         return rc;
     }
 
@@ -3022,7 +3931,7 @@ static MW_ERROR_NO_T _mqttd_vlan_mode_set(u8_t vlan_mode){
     //更新mode
     rc = mqttd_queue_setData(M_UPDATE, VLAN_CFG_INFO, DB_ALL_FIELDS, DB_ALL_ENTRIES, &vlan_cfg, sizeof(DB_VLAN_CFG_INFO_T));
     //释放消息内存
-    MW_FREE(ptr_db_msg);
+    DB_MSG_FREE(ptr_db_msg);
     vlan_cfg = NULL;
     if(MW_E_OK != rc)
     {
@@ -3100,7 +4009,7 @@ static MW_ERROR_NO_T _mqttd_vlan_mode_set(u8_t vlan_mode){
             ptr_vlan_entry_tbl->port_member[i] = 0;
         }
         rc = mqttd_queue_setData(M_UPDATE, VLAN_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, ptr_vlan_entry_tbl, sizeof(DB_VLAN_ENTRY_T));
-        MW_FREE(ptr_msg);
+        DB_MSG_FREE(ptr_msg);
         if(MW_E_OK != rc)
         {
             return rc;
@@ -3164,7 +4073,7 @@ static MW_ERROR_NO_T _mqttd_vlan_mode_set(u8_t vlan_mode){
                 }
             }
         }
-        MW_FREE(ptr_msg);
+        DB_MSG_FREE(ptr_msg);
         rc = mqttd_queue_setData(M_UPDATE, PORT_CFG_INFO, PORT_ISOLATION, DB_ALL_ENTRIES, ptr_isolation_tbl, (sizeof(UI32_T) * PLAT_MAX_PORT_NUM));
         MW_FREE(ptr_isolation_tbl);
         if(MW_E_OK != rc)
@@ -3269,7 +4178,7 @@ static MW_ERROR_NO_T _mqttd_vlan_entry_add(VLAN_ENTRY_INFO_T *ptr_vlan_entry, u1
     }
     
     if(vidx >= MAX_VLAN_ENTRY_NUM){
-        MW_FREE(ptr_msg);
+        DB_MSG_FREE(ptr_msg);
         mqttd_debug("vlan entry full\n");
         return MW_E_TABLE_FULL;
     }
@@ -3279,7 +4188,7 @@ static MW_ERROR_NO_T _mqttd_vlan_entry_add(VLAN_ENTRY_INFO_T *ptr_vlan_entry, u1
     }
 
     //释放数据指针
-    MW_FREE(ptr_msg);
+    DB_MSG_FREE(ptr_msg);
     ptr_msg = NULL;
     ptr_vlan_entry_tbl = NULL;
 
@@ -3327,7 +4236,7 @@ static MW_ERROR_NO_T _mqttd_port_native_vlan_set(VLAN_ENTRY_INFO_T *vlan_entry){
     }
 
     rc = mqttd_queue_setData(M_UPDATE, PORT_CFG_INFO, PORT_PVID, DB_ALL_ENTRIES, ptr_pvid_tbl, (sizeof(UI16_T) * PLAT_MAX_PORT_NUM));
-    MW_FREE(ptr_msg);
+    DB_MSG_FREE(ptr_msg);
     ptr_msg = NULL;
     if(MW_E_OK != rc)
     {
@@ -3392,11 +4301,11 @@ static MW_ERROR_NO_T _mqttd_port_base_vlan_set(VLAN_ENTRY_INFO_T *vlan_entry){
     if(MW_E_OK != rc)
     {
         mqttd_debug("set vlan cfg failed(%d)\n", rc);
-        MW_FREE(ptr_msg);     
+        DB_MSG_FREE(ptr_msg);     
         return rc;
     }
     //释放数据指针
-    MW_FREE(ptr_msg);
+    DB_MSG_FREE(ptr_msg);
     ptr_msg = NULL;
     ptr_vlan_list_tbl = NULL;
 
@@ -3421,11 +4330,11 @@ static MW_ERROR_NO_T _mqttd_port_base_vlan_set(VLAN_ENTRY_INFO_T *vlan_entry){
     rc = mqttd_queue_setData(M_UPDATE, PORT_CFG_INFO, PORT_ISOLATION, DB_ALL_ENTRIES, ptr_port_matrix_tbl, (sizeof(UI32_T) * PLAT_MAX_PORT_NUM));
     if(MW_E_OK != rc){
         mqttd_debug("set vlan cfg failed(%d)\n", rc);
-        MW_FREE(ptr_msg);
+        DB_MSG_FREE(ptr_msg);
         return rc;
     }   
     //释放数据指针
-    MW_FREE(ptr_msg);
+    DB_MSG_FREE(ptr_msg);
     ptr_msg = NULL;
     ptr_port_matrix_tbl = NULL;
     */
@@ -3433,37 +4342,63 @@ static MW_ERROR_NO_T _mqttd_port_base_vlan_set(VLAN_ENTRY_INFO_T *vlan_entry){
     return rc;
 }
 
+/* setConfig "vlan" objects of each port mode */
+enum {
+    MQTTD_ACCESS_BIND_P = 0,
+    MQTTD_ACCESS_BIND_TY,
+    MQTTD_ACCESS_BIND_AC,
+    MQTTD_ACCESS_BIND_LAST
+};
+
+static const MQTTD_BIND_FIELD_T _mqttd_access_vlan_bind[MQTTD_ACCESS_BIND_LAST] = {
+    MQTTD_BIND_FIELD("p", MQTTD_BIND_TYPE_PORTS, VLAN_ENTRY_INFO_T, port_member, 0, PLAT_MAX_PORT_NUM, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_ITEM("ty"),
+    MQTTD_BIND_FIELD("ac", MQTTD_BIND_TYPE_INT, VLAN_ENTRY_INFO_T, vlan_id, 0, 4095, (const MQTTD_BIND_MAP_T *)NULL),
+};
+
+enum {
+    MQTTD_TRUNK_BIND_P = 0,
+    MQTTD_TRUNK_BIND_TY,
+    MQTTD_TRUNK_BIND_NV,
+    MQTTD_TRUNK_BIND_PV,
+    MQTTD_TRUNK_BIND_LAST
+};
+
+static const MQTTD_BIND_FIELD_T _mqttd_trunk_vlan_bind[MQTTD_TRUNK_BIND_LAST] = {
+    MQTTD_BIND_FIELD("p", MQTTD_BIND_TYPE_PORTS, VLAN_ENTRY_INFO_T, port_member, 0, PLAT_MAX_PORT_NUM, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_ITEM("ty"),
+    MQTTD_BIND_FIELD("nv", MQTTD_BIND_TYPE_INT, VLAN_ENTRY_INFO_T, vlan_id, 0, 4095, (const MQTTD_BIND_MAP_T *)NULL),
+    MQTTD_BIND_ITEM("pv"),
+};
+
 static MW_ERROR_NO_T _mqttd_handle_setconfig_access_vlan_process(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj){
     MW_ERROR_NO_T rc = MW_E_OK;
     cJSON *vlan_setting_obj;
     int idx = 0;
     VLAN_ENTRY_INFO_T vlan_entry = {0};
+    const cJSON *items[MQTTD_ACCESS_BIND_LAST];
+    UI32_T present = 0;
     
     //获取消息中的vlan 配置
     cJSON_ArrayForEach(vlan_setting_obj, data_obj) {
         if (cJSON_IsObject(vlan_setting_obj) && idx < MAX_VLAN_ENTRY_NUM) {
-            // 获取 p 数组
-            cJSON *p = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "p");
-            if (cJSON_IsArray(p)) {
-                cJSON *port;
-                cJSON_ArrayForEach(port, p) {
-                    vlan_entry.port_member |= (1 << port->valueint);
-                }
-            }
+            // p 累加到 port_member, ac 写入 vlan_id
+            (void)mqttd_bind_parse(vlan_setting_obj, _mqttd_access_vlan_bind, MQTTD_ACCESS_BIND_LAST, &vlan_entry, items, &present);
 
             // 获取 ty 字段
-            cJSON *ty = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "ty");
+            const cJSON *ty = items[MQTTD_ACCESS_BIND_TY];
             if (cJSON_IsNumber(ty)) {
                 if(MQTTD_PORT_VLAN_ACCESS != ty->valueint){
                     continue;
                 }
             }            
 
-            // 获取 ac 字段
-            cJSON *ac = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "ac");
-            if (cJSON_IsNumber(ac)) {
-                vlan_entry.vlan_id = ac->valueint;
-            }            
+            // p 无效时跳过, 不能用旧的 port_member 设置
+            if (!(present & BIT(MQTTD_ACCESS_BIND_P)) &&
+                (NULL != cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "p"))) {
+                mqttd_debug("bad port list, skip the access vlan entry\n");
+                continue;
+            }
             
             //设置端口
             rc = _mqttd_port_base_vlan_set(&vlan_entry);
@@ -3482,33 +4417,32 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_trunk_vlan_process(MQTTD_CTRL_T *mq
     cJSON *vlan_setting_obj;
     int idx = 0;
     VLAN_ENTRY_INFO_T vlan_entry = {0};
+    const cJSON *items[MQTTD_TRUNK_BIND_LAST];
+    UI32_T present = 0;
     
     //获取消息中的vlan 配置
     cJSON_ArrayForEach(vlan_setting_obj, data_obj) {
         vlan_entry.port_member = 0;
         if (cJSON_IsObject(vlan_setting_obj) && idx < MAX_VLAN_ENTRY_NUM) {
-            // 获取 p 数组
-            cJSON *p = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "p");
-            if (cJSON_IsArray(p)) {
-                cJSON *port;
-                cJSON_ArrayForEach(port, p) {
-                    vlan_entry.port_member |= (1 << port->valueint);
-                }
-            }
+            // p 写入 port_member, nv 写入 vlan_id
+            (void)mqttd_bind_parse(vlan_setting_obj, _mqttd_trunk_vlan_bind, MQTTD_TRUNK_BIND_LAST, &vlan_entry, items, &present);
 
             // 获取 ty 字段
-            cJSON *ty = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "ty");
+            const cJSON *ty = items[MQTTD_TRUNK_BIND_TY];
             if (cJSON_IsNumber(ty)) {
                 if(MQTTD_PORT_VLAN_TRUNK != ty->valueint){
                     continue;
                 }
             }    
 
-            // 获取 nv 字段
-            cJSON *nv = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "nv");
-            if (cJSON_IsNumber(nv)) {
-                //TODO:暂定nv 是 native vlan
-                vlan_entry.vlan_id = nv->valueint;
+            // p 无效时跳过
+            if (!(present & BIT(MQTTD_TRUNK_BIND_P)) &&
+                (NULL != cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "p"))) {
+                mqttd_debug("bad port list, skip the trunk vlan entry\n");
+                continue;
+            }
+
+            if (present & BIT(MQTTD_TRUNK_BIND_NV)) {
                 //设置端口
                 rc = _mqttd_port_native_vlan_set(&vlan_entry);
                 if(MW_E_OK != rc){
@@ -3518,9 +4452,9 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_trunk_vlan_process(MQTTD_CTRL_T *mq
             }
 
             // 获取 pv 数组
-            cJSON *pv = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "pv");
+            const cJSON *pv = items[MQTTD_TRUNK_BIND_PV];
             if (cJSON_IsArray(pv)) {
-                cJSON *value;
+                const cJSON *value;
                 cJSON_ArrayForEach(value, pv) {
                     //TODO:暂定 pv 是port vlan,写入vlanlsit
                     vlan_entry.vlan_id = value->valueint;
@@ -3541,30 +4475,19 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_hybrid_vlan_process(MQTTD_CTRL_T *m
     cJSON *vlan_setting_obj;
     int idx = 0;
     u8_t port_id = 0;
-    u8_t i = 0;
-    u8_t vidx = 0;
-    /*db variable*/
-    DB_MSG_T *ptr_msg = NULL;
-    UI16_T size = 0;
     VLAN_ENTRY_INFO_T vlan_entry = {0};
     
-    //获取消息中 端口的vlan 配置
+    //获取消息中 端口的vlan 配置, hybrid 只有单个端口和 vlan 数组, 不经过 bind 表
     cJSON_ArrayForEach(vlan_setting_obj, data_obj) {
         if (cJSON_IsObject(vlan_setting_obj) && idx < MAX_VLAN_ENTRY_NUM) {
             // 获取 id 字段
-            cJSON *id = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "id");
+            const cJSON *id = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "id");
             if (cJSON_IsNumber(id)) {
                 port_id = id->valueint;
             }
 
-            // 获取 n 字段
-            cJSON *n = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "n");
-            if (cJSON_IsString(n) && (n->valuestring != NULL)) {
-                //TODO: 端口desc作用
-            }
-
             // 获取 ty 字段
-            cJSON *ty = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "ty");
+            const cJSON *ty = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "ty");
             if (cJSON_IsNumber(ty)) {
                 if(MQTTD_PORT_VLAN_HYBRID != ty->valueint){
                     continue;
@@ -3572,9 +4495,9 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_hybrid_vlan_process(MQTTD_CTRL_T *m
             }   
 
             // 获取 tv 数组
-            cJSON *tv = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "tv");
+            const cJSON *tv = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "tv");
             if (cJSON_IsArray(tv)) {
-                cJSON *value;
+                const cJSON *value;
                 SET_BIT(vlan_entry.tagged_member, port_id);
                 cJSON_ArrayForEach(value, tv) {
                     vlan_entry.vlan_id = value->valueint;
@@ -3587,9 +4510,9 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_hybrid_vlan_process(MQTTD_CTRL_T *m
             }
 
             // 获取 utv 数组
-            cJSON *utv = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "utv");
+            const cJSON *utv = cJSON_GetObjectItemCaseSensitive(vlan_setting_obj, "utv");
             if (cJSON_IsArray(utv)) {
-                cJSON *value;
+                const cJSON *value;
                 SET_BIT(vlan_entry.untagged_member, port_id);
                 cJSON_ArrayForEach(value, utv) {
                     vlan_entry.vlan_id = value->valueint;
@@ -3676,7 +4599,7 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_jumbo_frame(MQTTD_CTRL_T *mqttdctl,
         return rc;
     }
     memcpy(&jumbo_frame_info, db_data, sizeof(DB_JUMBO_FRAME_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
 
     cJSON *mtu = cJSON_GetObjectItemCaseSensitive(data_obj, "mtu");
     if (mtu && cJSON_IsNumber(mtu) && mtu->valueint % 1024 == 0) {
@@ -3817,10 +4740,9 @@ static MW_ERROR_NO_T _mqttd_handle_setconfig_data(MQTTD_CTRL_T *mqttdctl,  cJSON
 	return rc;
 }
 
-static MW_ERROR_NO_T _mqttd_handle_capability(MQTTD_CTRL_T *mqttdctl,  cJSON *msgid_obj)
+/* Build the "data" of capability, it is cached by mqttd_rsp */
+static MW_ERROR_NO_T _mqttd_build_capability(void *ptr_cookie, cJSON **pptr_item)
 {
-    MW_ERROR_NO_T rc = MW_E_OK;
-    cJSON *root = cJSON_CreateObject();
     cJSON *data = cJSON_CreateObject();
     cJSON *port_setting = cJSON_CreateObject();
     cJSON *port_mirroring = cJSON_CreateObject();
@@ -3831,15 +4753,7 @@ static MW_ERROR_NO_T _mqttd_handle_capability(MQTTD_CTRL_T *mqttdctl,  cJSON *ms
     cJSON *storm_control = cJSON_CreateObject();
     cJSON *vlan_type = cJSON_CreateArray();
 
-    /* PUBLISH capability with rx topic */
-    char topic[80];
-    osapi_snprintf(topic, sizeof(topic), "%s/rx", mqttdctl->topic_prefix);
-    
-
-    cJSON_AddStringToObject(root, "type", "capability");
-    cJSON_AddStringToObject(root, "msg_id", msgid_obj->valuestring);
-
-    cJSON_AddItemToObject(root, "data", data);
+    (*pptr_item) = data;
     cJSON_AddItemToObject(data, "remote_protocols", cJSON_CreateStringArray((const char*[]){"http"}, 1));
     cJSON_AddItemToObject(data, "device_operations", cJSON_CreateStringArray((const char*[]){"reset", "reboot", "update"}, 3));
     cJSON_AddItemToObject(data, "port_stats_type", cJSON_CreateStringArray((const char*[]){"data", "packet"}, 2));
@@ -3907,17 +4821,49 @@ static MW_ERROR_NO_T _mqttd_handle_capability(MQTTD_CTRL_T *mqttdctl,  cJSON *ms
     cJSON_AddNumberToObject(storm_control_range, "max", 1000);
     cJSON_AddItemToObject(storm_control, "range", storm_control_range);
 
-    mqtt_send_json_and_free(mqttdctl, topic, root);
+    return MW_E_OK;
+}
+
+static MW_ERROR_NO_T _mqttd_handle_capability(MQTTD_CTRL_T *mqttdctl,  cJSON *msgid_obj)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    cJSON *root = cJSON_CreateObject();
+
+    /* PUBLISH capability with rx topic */
+    char topic[80];
+    osapi_snprintf(topic, sizeof(topic), "%s/rx", mqttdctl->topic_prefix);
+    
+
+    cJSON_AddStringToObject(root, "type", "capability");
+    cJSON_AddStringToObject(root, "msg_id", msgid_obj->valuestring);
+
+    /* Only msg_id changes, "data" is the cached text */
+    rc = mqttd_rsp_add(MQTTD_RSP_CAPABILITY, root, "data", _mqttd_build_capability, NULL);
+    if (MW_E_OK != rc) {
+        mqttd_debug("build capability failed(%d)\n", rc);
+        cJSON_Delete(root);
+        return rc;
+    }
+
+    mqtt_send_json_and_free(mqttdctl, topic, root, MQTTD_PUB_LANE_INTERACTIVE);
 
     return rc;
 }
+
+/* Build the "remote_protocols" of getConfig, it is cached by mqttd_rsp */
+static MW_ERROR_NO_T _mqttd_build_remote_protocols(void *ptr_cookie, cJSON **pptr_item)
+{
+	cJSON *json_remote_protocols_entry = cJSON_CreateArray();   
+    cJSON_AddItemToArray(json_remote_protocols_entry, cJSON_CreateString("http"));      
+    (*pptr_item) = json_remote_protocols_entry;
+    return MW_E_OK;
+}
+
 static MW_ERROR_NO_T _mqttd_handle_getconfig_remote_protocols(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
     osapi_printf("mqttd_handle_getconfig_remote_protocols.\n");
-	cJSON *json_remote_protocols_entry = cJSON_CreateArray();   
-    cJSON_AddItemToArray(json_remote_protocols_entry, cJSON_CreateString("http"));      
-    cJSON_AddItemToObject(data_obj, "remote_protocols", json_remote_protocols_entry);
+    rc = mqttd_rsp_add(MQTTD_RSP_REMOTE_PROTOCOLS, data_obj, "remote_protocols", _mqttd_build_remote_protocols, NULL);
 
 #if 0
     char *data_obj_str = cJSON_Print(data_obj);
@@ -3934,14 +4880,14 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_remote_protocols(MQTTD_CTRL_T *mqtt
 	return rc;
 }
 
-static MW_ERROR_NO_T _mqttd_handle_getconfig_device(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
+/* Build the "device" of getConfig from SYS_INFO, it is cached by mqttd_rsp */
+static MW_ERROR_NO_T _mqttd_build_device(void *ptr_cookie, cJSON **pptr_item)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
 	DB_SYS_INFO_T sys_info;
     DB_MSG_T *ptr_db_msg = NULL;
     u16_t db_size = 0;
     void *db_data = NULL;
-    osapi_printf("mqttd_handle_getconfig_device.\n");
     memset(&sys_info, 0, sizeof(DB_SYS_INFO_T));
     rc = mqttd_queue_getData(SYS_INFO, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_db_msg, &db_size, &db_data);
     if(MW_E_OK != rc)
@@ -3950,11 +4896,19 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_device(MQTTD_CTRL_T *mqttdctl, cJSO
 		return rc;
     }
     memcpy(&sys_info, db_data, sizeof(DB_SYS_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
 
     cJSON *json_device_entry = cJSON_CreateObject();   
     cJSON_AddStringToObject(json_device_entry, "n", (const char *)sys_info.sys_name);
-    cJSON_AddItemToObject(data_obj, "device", json_device_entry);
+    (*pptr_item) = json_device_entry;
+    return rc;
+}
+
+static MW_ERROR_NO_T _mqttd_handle_getconfig_device(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    osapi_printf("mqttd_handle_getconfig_device.\n");
+    rc = mqttd_rsp_add(MQTTD_RSP_DEVICE, data_obj, "device", _mqttd_build_device, NULL);
 
 #if 0
     char *data_obj_str = cJSON_Print(data_obj);
@@ -3986,7 +4940,7 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_ip(MQTTD_CTRL_T *mqttdctl, cJSON *d
 		return rc;
     }
     memcpy(&sys_info, db_data, sizeof(DB_SYS_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
 
     C8_T ip_str[MQTTD_IPV4_STR_SIZE];
     cJSON *json_ip_entry = cJSON_CreateObject();   
@@ -4046,7 +5000,7 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_port_setting(MQTTD_CTRL_T *mqttdctl
 			return rc;
 	    }
 	    memcpy(&port_cfg_info, db_data, sizeof(DB_PORT_CFG_INFO_T));
-	    mqtt_free(ptr_db_msg);
+	    dbapi_freeMsg(ptr_db_msg);
 		
         cJSON *json_port_entry = cJSON_CreateObject();
         if (json_port_entry == NULL)
@@ -4111,7 +5065,7 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_port_mirroring(MQTTD_CTRL_T *mqttdc
 		return rc;
     }
     memcpy(&port_mirror_info, db_data, sizeof(DB_PORT_MIRROR_INFO_T));
-    mqtt_free(ptr_db_msg);
+    dbapi_freeMsg(ptr_db_msg);
     
     cJSON *json_port_mirror_info = cJSON_CreateArray();
     if (json_port_mirror_info == NULL)
@@ -4172,56 +5126,76 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_port_mirroring(MQTTD_CTRL_T *mqttdc
 static MW_ERROR_NO_T _mqttd_handle_getconfig_static_mac(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
-	DB_STATIC_MAC_ENTRY_T static_mac_info;
-    DB_MSG_T *ptr_db_msg = NULL;
-    u16_t db_size = 0;
-    void *db_data = NULL;
+    MQTTD_SMAC_IDX_T *ptr_idx = NULL;
 	osapi_printf("mqttd_handle_getconfig_static_mac.\n");
-    memset(&static_mac_info, 0, sizeof(DB_STATIC_MAC_ENTRY_T));
-    rc = mqttd_queue_getData(STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_db_msg, &db_size, &db_data);
+    rc = mqttd_smac_idx_get(&ptr_idx);
     if(MW_E_OK != rc)
     {
-        mqttd_debug("Get org DB static_mac_info failed(%d)\n", rc);
+        mqttd_debug("Get static mac index failed(%d)\n", rc);
 		return rc;
     }
-    memcpy(&static_mac_info, db_data, sizeof(DB_STATIC_MAC_ENTRY_T));
-    mqtt_free(ptr_db_msg);
     
     cJSON *json_mac_info = cJSON_CreateArray();
     if (json_mac_info == NULL)
     {
         mqttd_debug("Failed to create JSON array for static MAC info.");
+        mqttd_smac_idx_release();
         return MW_E_NO_MEMORY;
     }
     int i;
     for (i = 0; i < MAX_STATIC_MAC_NUM; i++)
     {
         //blank entry
-        #if 0
-        if(static_mac_info.port[i] == 0)
+        if(ptr_idx->tbl.port[i] == 0)
             continue;
-        #endif
         cJSON *json_mac_entry = cJSON_CreateObject();
         if (json_mac_entry == NULL)
         {
             mqttd_debug("Failed to create JSON object for static MAC entry.");
             cJSON_Delete(json_mac_info);
+            mqttd_smac_idx_release();
             return MW_E_NO_MEMORY;
         }
 
         char mac_str[18];
         snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-                 static_mac_info.mac_addr[i][0], static_mac_info.mac_addr[i][1],
-                 static_mac_info.mac_addr[i][2], static_mac_info.mac_addr[i][3],
-                 static_mac_info.mac_addr[i][4], static_mac_info.mac_addr[i][5]);
+                 ptr_idx->tbl.mac_addr[i][0], ptr_idx->tbl.mac_addr[i][1],
+                 ptr_idx->tbl.mac_addr[i][2], ptr_idx->tbl.mac_addr[i][3],
+                 ptr_idx->tbl.mac_addr[i][4], ptr_idx->tbl.mac_addr[i][5]);
         cJSON_AddStringToObject(json_mac_entry, "mac", mac_str);
-        cJSON_AddNumberToObject(json_mac_entry, "vid", static_mac_info.vid[i]);
-        cJSON_AddNumberToObject(json_mac_entry, "p", static_mac_info.port[i]);
+        cJSON_AddNumberToObject(json_mac_entry, "vid", ptr_idx->tbl.vid[i]);
+        cJSON_AddNumberToObject(json_mac_entry, "p", ptr_idx->tbl.port[i]);
 
         cJSON_AddItemToArray(json_mac_info, json_mac_entry);
     }
+    mqttd_smac_idx_release();
 
     cJSON_AddItemToObject(data_obj, "static_mac", json_mac_info);
+	return rc;
+}
+
+static MW_ERROR_NO_T _mqttd_handle_getconfig_jumbo_frame(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+	DB_JUMBO_FRAME_INFO_T jumbo_frame_info;
+    DB_MSG_T *ptr_db_msg = NULL;
+    u16_t db_size = 0;
+    void *db_data = NULL;
+    osapi_printf("mqttd_handle_getconfig_jumbo_frame.\n");
+    memset(&jumbo_frame_info, 0, sizeof(DB_JUMBO_FRAME_INFO_T));
+    rc = mqttd_queue_getData(JUMBO_FRAME_INFO, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_db_msg, &db_size, &db_data);
+    if(MW_E_OK != rc)
+    {
+        mqttd_debug("Get org DB jumbo_frame_info failed(%d)\n", rc);
+		return rc;
+    }
+    memcpy(&jumbo_frame_info, db_data, sizeof(DB_JUMBO_FRAME_INFO_T));
+    dbapi_freeMsg(ptr_db_msg);
+
+    cJSON *json_jumbo_frame_entry = cJSON_CreateObject();   
+    cJSON_AddNumberToObject(json_jumbo_frame_entry, "mtu", jumbo_frame_info.cfg);
+    cJSON_AddItemToObject(data_obj, "jumbo_frame", json_jumbo_frame_entry);
+
 #if 0
     char *data_obj_str = cJSON_Print(data_obj);
     if (data_obj_str == NULL)
@@ -4237,95 +5211,229 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_static_mac(MQTTD_CTRL_T *mqttdctl,
 	return rc;
 }
 
-static MW_ERROR_NO_T _mqttd_handle_getconfig_jumbo_frame(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
+/* FUNCTION NAME:  _mqttd_getconfig_send
+ * PURPOSE:
+ *      Send one message of a streamed getConfig response
+ *
+ * INPUT:
+ *      ptr_stream  --  the response stream
+ *      data        --  the data of the message, NULL for none
+ *      result      --  "ok" or "error"
+ *      final       --  TRUE for the last message of the response
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      Others      --  the error of mqtt_send_json_and_free
+ *
+ * NOTES:
+ *      data is owned and released by this function. seq only advances
+ *      for a message that is sent, so the broker sees no gap in it.
+ */
+static MW_ERROR_NO_T
+_mqttd_getconfig_send(
+    MQTTD_GETCONF_STREAM_T *ptr_stream,
+    cJSON *data,
+    const C8_T *result,
+    const BOOL_T final)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
-	DB_JUMBO_FRAME_INFO_T jumbo_frame_info;
-    DB_MSG_T *ptr_db_msg = NULL;
-    u16_t db_size = 0;
-    void *db_data = NULL;
-    osapi_printf("mqttd_handle_getconfig_jumbo_frame.\n");
-    memset(&jumbo_frame_info, 0, sizeof(DB_JUMBO_FRAME_INFO_T));
-    rc = mqttd_queue_getData(JUMBO_FRAME_INFO, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_db_msg, &db_size, &db_data);
-    if(MW_E_OK != rc)
+    cJSON *root = cJSON_CreateObject();
+
+    if (NULL == root)
     {
-        mqttd_debug("Get org DB jumbo_frame_info failed(%d)\n", rc);
-		return rc;
+        mqttd_debug("Failed to create getConfig response.");
+        cJSON_Delete(data);
+        return MW_E_NO_MEMORY;
+    }
+    cJSON_AddStringToObject(root, "type", "getconf");
+    cJSON_AddStringToObject(root, "msg_id", ptr_stream->msg_id);
+    cJSON_AddNumberToObject(root, "continuity", 0);
+    cJSON_AddNumberToObject(root, "seq", ptr_stream->seq);
+    cJSON_AddNumberToObject(root, "final", (TRUE == final) ? 1 : 0);
+    cJSON_AddStringToObject(root, "result", result);
+    if (NULL != data)
+    {
+        cJSON_AddItemToObject(root, "data", data);
+    }
+    rc = mqtt_send_json_and_free(ptr_stream->ptr_mqttd, ptr_stream->topic, root, MQTTD_PUB_LANE_INTERACTIVE);
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Sending getConfig seq %u failed(%d).", (unsigned int)ptr_stream->seq, rc);
+        return rc;
+    }
+    ptr_stream->seq++;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME:  _mqttd_getconfig_emit
+ * PURPOSE:
+ *      Send the sections built so far of a streamed getConfig response
+ *
+ * INPUT:
+ *      ptr_stream  --  the response stream
+ *      data        --  the data object holding the sections
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      MW_E_OP_INVALID
+ *      Others      --  the error of sending a page
+ *
+ * NOTES:
+ *      A section printed larger than MQTTD_GETCONF_PAGE_SIZE is sent in
+ *      pages of its array items. Each item is printed alone to measure it
+ *      and the page is filled by the sum, so the page is not printed again
+ *      for every item. The paging stops at the first page not sent, the
+ *      caller ends the response with "error". data is released by this
+ *      function.
+ */
+static MW_ERROR_NO_T
+_mqttd_getconfig_emit(
+    MQTTD_GETCONF_STREAM_T *ptr_stream,
+    cJSON *data)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    C8_T *ptr_buf = NULL;
+    cJSON *section = NULL;
+    cJSON *page = NULL;
+    cJSON *page_arr = NULL;
+    cJSON *item = NULL;
+    UI32_T frame_size = 0;
+    UI32_T page_size = 0;
+    UI32_T item_size = 0;
+
+    ptr_buf = mqtt_malloc(MQTTD_GETCONF_PAGE_SIZE);
+    if (NULL == ptr_buf)
+    {
+        cJSON_Delete(data);
+        return MW_E_NO_MEMORY;
+    }
+
+    while ((MW_E_OK == rc) && (NULL != (section = data->child)))
+    {
+        cJSON_DetachItemViaPointer(data, section);
+        page = cJSON_CreateObject();
+        if (NULL == page)
+        {
+            cJSON_Delete(section);
+            rc = MW_E_NO_MEMORY;
+            break;
+        }
+        cJSON_AddItemToObject(page, section->string, section);
+        if (cJSON_PrintPreallocated(page, ptr_buf, MQTTD_GETCONF_PAGE_SIZE, 0))
+        {
+            rc = _mqttd_getconfig_send(ptr_stream, page, "ok", FALSE);
+            continue;
+        }
+        if (!cJSON_IsArray(section))
+        {
+            mqttd_debug("getConfig section %s is too large.", section->string);
+            cJSON_Delete(page);
+            rc = MW_E_OP_INVALID;
+            break;
+        }
+
+        /* Move the items to pages as long as the printed size fits */
+        cJSON_DetachItemViaPointer(page, section);
+        cJSON_Delete(page);
+        frame_size = strlen(section->string) + MQTTD_GETCONF_PAGE_FRAME;
+        while ((MW_E_OK == rc) && (NULL != section->child))
+        {
+            page = cJSON_CreateObject();
+            page_arr = cJSON_CreateArray();
+            if ((NULL == page) || (NULL == page_arr))
+            {
+                cJSON_Delete(page);
+                cJSON_Delete(page_arr);
+                rc = MW_E_NO_MEMORY;
+                break;
+            }
+            cJSON_AddItemToObject(page, section->string, page_arr);
+            page_size = frame_size;
+            while (NULL != (item = section->child))
+            {
+                item_size = 0;
+                if (cJSON_PrintPreallocated(item, ptr_buf, MQTTD_GETCONF_PAGE_SIZE, 0))
+                {
+                    /* A comma separates it from the previous item */
+                    item_size = strlen(ptr_buf) + ((NULL != page_arr->child) ? 1 : 0);
+                }
+                /* The printed page ends with a NUL */
+                if ((0 != item_size) && (page_size + item_size < MQTTD_GETCONF_PAGE_SIZE))
+                {
+                    cJSON_DetachItemViaPointer(section, item);
+                    cJSON_AddItemToArray(page_arr, item);
+                    page_size += item_size;
+                    continue;
+                }
+                if (NULL == page_arr->child)
+                {
+                    mqttd_debug("getConfig item of %s is too large.", section->string);
+                    rc = MW_E_OP_INVALID;
+                }
+                break;
+            }
+            if (MW_E_OK == rc)
+            {
+                rc = _mqttd_getconfig_send(ptr_stream, page, "ok", FALSE);
+            }
+            else
+            {
+                cJSON_Delete(page);
+            }
+        }
+        cJSON_Delete(section);
     }
-    memcpy(&jumbo_frame_info, db_data, sizeof(DB_JUMBO_FRAME_INFO_T));
-    mqtt_free(ptr_db_msg);
-
-    cJSON *json_jumbo_frame_entry = cJSON_CreateObject();   
-    cJSON_AddNumberToObject(json_jumbo_frame_entry, "mtu", jumbo_frame_info.cfg);
-    cJSON_AddItemToObject(data_obj, "jumbo_frame", json_jumbo_frame_entry);
 
-#if 0
-    char *data_obj_str = cJSON_Print(data_obj);
-    if (data_obj_str == NULL)
-    {
-        osapi_printf("Failed to print JSON object.\n");
-    }
-    else
-    {
-        osapi_printf("data_obj: %s\n", data_obj_str);
-        mqtt_free(data_obj_str);
-    }
-#endif
-	return rc;
+    mqtt_free(ptr_buf);
+    cJSON_Delete(data);
+    return rc;
 }
 
-static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_setting(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
+/* FUNCTION NAME:  _mqttd_getconfig_vlan_setting_build
+ * PURPOSE:
+ *      Build the vlan_setting section from the VLAN index
+ *
+ * INPUT:
+ *      data_obj            --  the data object of the getConfig response
+ *      ptr_idx             --  the locked VLAN index
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      None
+ */
+static MW_ERROR_NO_T
+_mqttd_getconfig_vlan_setting_build(
+    cJSON *data_obj,
+    const MQTTD_VLAN_IDX_T *ptr_idx)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
-	DB_VLAN_ENTRY_T *ptr_vlan_entry_tbl = NULL;
-    UI32_T *ptr_vlan_list_tbl = NULL;
-    u16_t vlan1_id[MAX_VLAN_ENTRY_NUM] = {0};
-    u16_t vlan2_id[MAX_VLAN_ENTRY_NUM] = {0};
-    u8_t vlan1_cnt = 0;
-    u8_t vlan2_cnt = 0;
-    UI16_T *ptr_pvid_tbl= NULL;
-    DB_MSG_T *ptr_vlan_msg = NULL;
-    DB_MSG_T *ptr_vlan_list_msg = NULL;
-    DB_MSG_T *ptr_pvid_msg = NULL;
-    u16_t pvid = 0;
-    u16_t size = 0;
     u8_t port_id = 0, j = 0;
     u8_t port_vlan_type = MQTTD_PORT_VLAN_NONE;
     char port_id_str[8] = {0};
-
-    /* Get DB VLAN_ENTRY */
-    rc = mqttd_queue_getData(VLAN_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_vlan_msg, &size, (void **)&ptr_vlan_entry_tbl);
-    if(MW_E_OK != rc)
-    {
-        mqttd_debug("get vlan cfg failed(%d)\n", rc);
-        goto GET_MSG_FREE;
-    }
-
-    /* Get DB PORT_VLAN_LIST */
-    rc = mqttd_queue_getData(PORT_CFG_INFO, PORT_VLAN_LIST, DB_ALL_ENTRIES, &ptr_vlan_list_msg, &size, (void **)&ptr_vlan_list_tbl);
-    if(MW_E_OK != rc)
-    {
-        mqttd_debug("get port vlan list failed(%d)\n", rc);
-        goto GET_MSG_FREE;
-    }
-
-    /* Get DB port native vlan */
-    rc = mqttd_queue_getData(PORT_CFG_INFO, PORT_PVID, DB_ALL_ENTRIES, &ptr_pvid_msg, &size, (void **)&ptr_pvid_tbl);
-    if(MW_E_OK != rc)
-    {
-        mqttd_debug("get port native vlan failed(%d)\n", rc);
-        goto GET_MSG_FREE;
-    }
+    cJSON *vlan_setting = NULL;
+    cJSON *member = NULL;
 
     // 创建 vlan_member 数组
-    cJSON *vlan_setting = cJSON_CreateArray();
+    vlan_setting = cJSON_CreateArray();
     if (vlan_setting == NULL)
     {
         mqttd_debug("Failed to create JSON array for vlan setting.");
-        rc = MW_E_NO_MEMORY;
-        goto GET_MSG_FREE;
+        return MW_E_NO_MEMORY;
     }
-    cJSON *member = NULL;
 
     //获取端口的vlan信息
     for(port_id = 0; port_id < PLAT_MAX_PORT_NUM; port_id++)
@@ -4336,8 +5444,8 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_setting(MQTTD_CTRL_T *mqttdctl
         }
 
         //端口不存在vlan配置则查找下一个
-        if((VLAN_DEFAULT_VID == ptr_pvid_tbl[port_id])
-        && (0 == ptr_vlan_list_tbl[port_id]))
+        if((VLAN_DEFAULT_VID == ptr_idx->pvid[port_id])
+        && (0 == ptr_idx->vlan_list[port_id]))
         {
             continue;
         }
@@ -4345,32 +5453,13 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_setting(MQTTD_CTRL_T *mqttdctl
         osapi_memset(port_id_str, 0, sizeof(port_id_str));
         osapi_sprintf(port_id_str, sizeof(port_id_str), "port%d", port_id);
         port_vlan_type = MQTTD_PORT_VLAN_NONE;
-        if(VLAN_DEFAULT_VID != ptr_pvid_tbl[port_id]){
+        if(VLAN_DEFAULT_VID != ptr_idx->pvid[port_id]){
             port_vlan_type = MQTTD_PORT_VLAN_ACCESS;
         }
 
-        if(0 != ptr_vlan_list_tbl[port_id]){
-            vlan1_cnt = 0;
-            vlan2_cnt = 0;
-            BITMAP_VLAN_FOREACH(ptr_vlan_list_tbl[port_id], j){
-                if(ptr_vlan_entry_tbl->vlan_id[j] != 0) {
-                    if(ptr_vlan_entry_tbl->port_member[j] & (1 << port_id)){
-                        vlan1_id[vlan1_cnt] = ptr_vlan_entry_tbl->vlan_id[j];
-                        vlan1_cnt++;
-                        continue;
-                    }
-                    if(ptr_vlan_entry_tbl->tagged_member[j] & (1 << port_id)){
-                        vlan1_id[vlan1_cnt] = ptr_vlan_entry_tbl->vlan_id[j];
-                        vlan1_cnt++;                        
-                    }
-                    if(ptr_vlan_entry_tbl->untagged_member[j] & (1 << port_id))
-                    {
-                        vlan2_id[vlan2_cnt] = ptr_vlan_entry_tbl->vlan_id[j];
-                        vlan2_cnt++;
-                    }
-                }
-            } 
-            if(vlan2_cnt > 0){
+        /* The tagged and untagged sets are already classified by the index */
+        if(0 != ptr_idx->vlan_list[port_id]){
+            if(0 != ptr_idx->untagged[port_id]){
                 port_vlan_type = MQTTD_PORT_VLAN_HYBRID;
             }else{
                 port_vlan_type = MQTTD_PORT_VLAN_TRUNK;
@@ -4383,45 +5472,45 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_setting(MQTTD_CTRL_T *mqttdctl
         {
             mqttd_debug("Failed to create JSON object for vlan member.");
             rc = MW_E_NO_MEMORY;
-            goto GET_MSG_FREE;
+            goto BUILD_FREE;
         }
 
         cJSON_AddNumberToObject(member, "id", port_id);        
         cJSON_AddStringToObject(member, "n", port_id_str);
         cJSON_AddNumberToObject(member, "ty", port_vlan_type);
         if(port_vlan_type == MQTTD_PORT_VLAN_ACCESS){
-            cJSON_AddNumberToObject(member, "ac", ptr_pvid_tbl[port_id]);
+            cJSON_AddNumberToObject(member, "ac", ptr_idx->pvid[port_id]);
             if(false == cJSON_AddItemToArray(vlan_setting, member)) {
                 mqttd_debug("Failed to add vlan ac member to array.");
                 rc = MW_E_NO_MEMORY;
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
         }
         else if(port_vlan_type == MQTTD_PORT_VLAN_TRUNK){
-            cJSON_AddNumberToObject(member, "nv", ptr_pvid_tbl[port_id]);
+            cJSON_AddNumberToObject(member, "nv", ptr_idx->pvid[port_id]);
             cJSON * pv = cJSON_CreateArray();
             if(NULL == pv){
                 mqttd_debug("Failed to create JSON array for vlan pv.");
                 rc = MW_E_NO_MEMORY;
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
 
-            for(j = 0; j < vlan1_cnt; j++)
-            {                
-                cJSON_AddItemToArray(pv, cJSON_CreateNumber(vlan1_id[j]));
+            BITMAP_VLAN_FOREACH(ptr_idx->tagged[port_id], j)
+            {
+                cJSON_AddItemToArray(pv, cJSON_CreateNumber(ptr_idx->vidx2vid[j]));
             }
 
             if(false == cJSON_AddItemToObject(member, "pv", pv)) {
                 mqttd_debug("Failed to add vlan pv member to array.");
                 rc = MW_E_NO_MEMORY;
                 cJSON_Delete(pv);
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
 
             if(false == cJSON_AddItemToArray(vlan_setting, member)) {
                 mqttd_debug("Failed to add vlan tk member to array.");
                 rc = MW_E_NO_MEMORY;
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
         }
         else{
@@ -4429,44 +5518,44 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_setting(MQTTD_CTRL_T *mqttdctl
             if(NULL == tv){
                 mqttd_debug("Failed to create JSON array for vlan tv.");
                 rc = MW_E_NO_MEMORY;
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
 
-            for(j = 0; j < vlan1_cnt; j++)
+            BITMAP_VLAN_FOREACH(ptr_idx->tagged[port_id], j)
             {
-                cJSON_AddItemToArray(tv, cJSON_CreateNumber(vlan1_id[j]));
+                cJSON_AddItemToArray(tv, cJSON_CreateNumber(ptr_idx->vidx2vid[j]));
             }
 
             if(false == cJSON_AddItemToObject(member, "tv", tv)) {
                 mqttd_debug("Failed to add vlan tv member to array.");
                 rc = MW_E_NO_MEMORY;
                 cJSON_Delete(tv);
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
 
             cJSON * utv= cJSON_CreateArray();
             if(NULL == utv){
                 mqttd_debug("Failed to create JSON array for vlan utv.");
                 rc = MW_E_NO_MEMORY;
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
 
-            for(j = 0; j < vlan2_cnt; j++)
+            BITMAP_VLAN_FOREACH(ptr_idx->untagged[port_id], j)
             {
-                cJSON_AddItemToArray(utv, cJSON_CreateNumber(vlan2_id[j]));
+                cJSON_AddItemToArray(utv, cJSON_CreateNumber(ptr_idx->vidx2vid[j]));
             }
 
             if(false == cJSON_AddItemToObject(member, "utv", utv)) {
                 mqttd_debug("Failed to add vlan utv member to array.");
                 rc = MW_E_NO_MEMORY;
                 cJSON_Delete(utv);
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }
 
             if(false == cJSON_AddItemToArray(vlan_setting, member)) {
                 mqttd_debug("Failed to add vlan hy member to array.");
                 rc = MW_E_NO_MEMORY;
-                goto GET_MSG_FREE;
+                goto BUILD_FREE;
             }   
         }
         member = NULL;        
@@ -4475,19 +5564,7 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_setting(MQTTD_CTRL_T *mqttdctl
     cJSON_AddItemToObject(data_obj, "vlan_setting", vlan_setting);
     vlan_setting = NULL;
 
-GET_MSG_FREE:
-    if(ptr_vlan_msg){
-        MW_FREE(ptr_vlan_msg);
-        ptr_vlan_msg = NULL;
-    }
-    if(ptr_vlan_list_msg){
-        MW_FREE(ptr_vlan_list_msg);
-        ptr_vlan_list_msg = NULL;
-    }
-    if(ptr_pvid_msg){
-        MW_FREE(ptr_pvid_msg);
-        ptr_pvid_msg = NULL;
-    }
+BUILD_FREE:
     if(vlan_setting){
         cJSON_Delete(vlan_setting);
         vlan_setting = NULL;
@@ -4499,16 +5576,201 @@ GET_MSG_FREE:
     return rc;
 }
 
+/* FUNCTION NAME:  _mqttd_getconfig_vlan_setting_done
+ * PURPOSE:
+ *      Finish the deferred getConfig response which waits for vlan_setting
+ *
+ * INPUT:
+ *      ptr_ctx     --  the continuation context
+ *      rc          --  the result of the vlan_setting section
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The context and its DB messages are released here. The section is
+ *      sent followed by the final message of the response.
+ *      A cancelled request is dropped silently since mqttd is shutting down.
+ */
+static void
+_mqttd_getconfig_vlan_setting_done(
+    MQTTD_GETCONF_VLAN_CTX_T *ptr_ctx,
+    MW_ERROR_NO_T rc)
+{
+    UI8_T idx;
+
+    if (MW_E_OP_INCOMPLETE == rc)
+    {
+        cJSON_Delete(ptr_ctx->data);
+    }
+    else
+    {
+        if (MW_E_OK != rc)
+        {
+            mqttd_debug("Handling getConfig vlan_setting failed(%d).", rc);
+            cJSON_Delete(ptr_ctx->data);
+        }
+        else
+        {
+            rc = _mqttd_getconfig_emit(&(ptr_ctx->stream), ptr_ctx->data);
+        }
+        (void)_mqttd_getconfig_send(&(ptr_ctx->stream), NULL, (MW_E_OK == rc) ? "ok" : "error", TRUE);
+    }
+
+    for (idx = 0; idx < MQTTD_GETCONF_VLAN_STEP_LAST; idx++)
+    {
+        DB_MSG_FREE(ptr_ctx->ptr_msg[idx]);
+    }
+    mqtt_free(ptr_ctx);
+}
+
+/* FUNCTION NAME:  _mqttd_getconfig_vlan_setting_cb
+ * PURPOSE:
+ *      Continue the vlan_setting section when one DB get completes
+ *
+ * INPUT:
+ *      result      --  the result of the get
+ *      ptr_msg     --  the response message, owned by this function
+ *      ptr_data    --  the raw data in ptr_msg
+ *      data_size   --  the size of ptr_data
+ *      ptr_arg     --  the continuation context
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Runs in mqttd task from _mqttd_listen_db. Each step keeps its response
+ *      and issues the next get, the last one rebuilds the VLAN index at the
+ *      generation taken when the request started, then builds and replies.
+ */
+static void
+_mqttd_getconfig_vlan_setting_cb(
+    const MW_ERROR_NO_T result,
+    DB_MSG_T *ptr_msg,
+    void *ptr_data,
+    const UI16_T data_size,
+    void *ptr_arg)
+{
+    MQTTD_GETCONF_VLAN_CTX_T *ptr_ctx = (MQTTD_GETCONF_VLAN_CTX_T *)ptr_arg;
+    const MQTTD_VLAN_IDX_T *ptr_idx = NULL;
+    MW_ERROR_NO_T rc = result;
+
+    if (MW_E_OK != rc)
+    {
+        _mqttd_getconfig_vlan_setting_done(ptr_ctx, rc);
+        return;
+    }
+    ptr_ctx->ptr_msg[ptr_ctx->step] = ptr_msg;
+    ptr_ctx->ptr_data[ptr_ctx->step] = ptr_data;
+    ptr_ctx->step++;
+
+    if (ptr_ctx->step < MQTTD_GETCONF_VLAN_STEP_LAST)
+    {
+        rc = dbapi_getDataAsync(MQTTD_QUEUE_NAME, _mqttd_getconfig_vlan_setting_req[ptr_ctx->step],
+                                _mqttd_getconfig_vlan_setting_cb, ptr_ctx);
+        if (MW_E_OK != rc)
+        {
+            _mqttd_getconfig_vlan_setting_done(ptr_ctx, rc);
+        }
+        return;
+    }
+
+    rc = mqttd_vlan_idx_build(ptr_ctx->generation,
+            (const DB_VLAN_ENTRY_T *)ptr_ctx->ptr_data[MQTTD_GETCONF_VLAN_STEP_ENTRY],
+            (const UI32_T *)ptr_ctx->ptr_data[MQTTD_GETCONF_VLAN_STEP_LIST],
+            (const UI16_T *)ptr_ctx->ptr_data[MQTTD_GETCONF_VLAN_STEP_PVID]);
+    if (MW_E_OK == rc)
+    {
+        rc = mqttd_vlan_idx_acquire(ptr_ctx->generation, &ptr_idx);
+    }
+    if (MW_E_OK == rc)
+    {
+        rc = _mqttd_getconfig_vlan_setting_build(ptr_ctx->data, ptr_idx);
+        mqttd_vlan_idx_release();
+    }
+    _mqttd_getconfig_vlan_setting_done(ptr_ctx, rc);
+}
+
+/* FUNCTION NAME:  _mqttd_handle_getconfig_vlan_setting
+ * PURPOSE:
+ *      Start the vlan_setting section of a getConfig request
+ *
+ * INPUT:
+ *      ptr_stream  --  the getConfig response stream
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      MW_E_TABLE_FULL
+ *
+ * NOTES:
+ *      When the VLAN index is current the section is built right away.
+ *      Otherwise the three DB gets are chained by
+ *      _mqttd_getconfig_vlan_setting_cb, so mqttd keeps serving DB
+ *      notifications meanwhile. When it returns MW_E_OK the rest of the
+ *      response, the final message included, is sent by the continuation.
+ */
+static MW_ERROR_NO_T
+_mqttd_handle_getconfig_vlan_setting(
+    const MQTTD_GETCONF_STREAM_T *ptr_stream)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    MQTTD_GETCONF_VLAN_CTX_T *ptr_ctx = NULL;
+    const MQTTD_VLAN_IDX_T *ptr_idx = NULL;
+
+    ptr_ctx = mqtt_malloc(sizeof(MQTTD_GETCONF_VLAN_CTX_T));
+    if (NULL == ptr_ctx)
+    {
+        mqttd_debug("Failed to allocate vlan_setting context.");
+        return MW_E_NO_MEMORY;
+    }
+    ptr_ctx->stream = (*ptr_stream);
+    ptr_ctx->data = cJSON_CreateObject();
+    if (NULL == ptr_ctx->data)
+    {
+        mqtt_free(ptr_ctx);
+        return MW_E_NO_MEMORY;
+    }
+    ptr_ctx->generation = mqttd_vlan_idx_generation();
+    ptr_ctx->step = MQTTD_GETCONF_VLAN_STEP_ENTRY;
+
+    if (MW_E_OK == mqttd_vlan_idx_acquire(ptr_ctx->generation, &ptr_idx))
+    {
+        rc = _mqttd_getconfig_vlan_setting_build(ptr_ctx->data, ptr_idx);
+        mqttd_vlan_idx_release();
+        _mqttd_getconfig_vlan_setting_done(ptr_ctx, rc);
+        return MW_E_OK;
+    }
+
+    /* Nothing touches ptr_ctx after this, the callback owns it */
+    rc = dbapi_getDataAsync(MQTTD_QUEUE_NAME, _mqttd_getconfig_vlan_setting_req[MQTTD_GETCONF_VLAN_STEP_ENTRY],
+                            _mqttd_getconfig_vlan_setting_cb, ptr_ctx);
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("get vlan cfg failed(%d)\n", rc);
+        cJSON_Delete(ptr_ctx->data);
+        mqtt_free(ptr_ctx);
+    }
+    return rc;
+}
+
 static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_member(MQTTD_CTRL_T *mqttdctl, cJSON *data_obj)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
-	DB_VLAN_ENTRY_T *ptr_vlan_entry_tbl = NULL;
-    DB_MSG_T *ptr_msg = NULL;
-    u16_t size = 0;
+    const MQTTD_VLAN_IDX_T *ptr_idx = NULL;
     u8_t i = 0;
 
-    /* Get DB VLAN_ENTRY */
-    rc = mqttd_queue_getData(VLAN_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_msg, &size, (void **)&ptr_vlan_entry_tbl);
+    /* Get the VLAN index, rebuilt from DB only when VLAN config changed */
+    rc = mqttd_vlan_idx_get(&ptr_idx);
     if(MW_E_OK != rc)
     {
         mqttd_debug("get vlan cfg failed(%d)\n", rc);
@@ -4518,41 +5780,31 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_vlan_member(MQTTD_CTRL_T *mqttdctl,
     // 创建 vlan_member 数组
     cJSON *vlan_member = cJSON_CreateArray();
 
-    //更新vlan配置
-    for(i = 0; i < MAX_VLAN_ENTRY_NUM; i++)
+    //更新vlan配置, 只遍历已配置的vlan
+    BITMAP_VLAN_FOREACH(ptr_idx->member, i)
     {
-        mqttd_debug("vlan_id:%d  %x %x %x \n", ptr_vlan_entry_tbl->vlan_id[i], ptr_vlan_entry_tbl->port_member[i], ptr_vlan_entry_tbl->tagged_member[i], ptr_vlan_entry_tbl->untagged_member[i]);
-        if(ptr_vlan_entry_tbl->vlan_id[i] == 0) {
-            continue;
-        }
-        if((ptr_vlan_entry_tbl->vlan_id[i] == i+1) 
-        && (ptr_vlan_entry_tbl->tagged_member[i] == 0)
-        && (ptr_vlan_entry_tbl->untagged_member[i] == 0)
-        && (ptr_vlan_entry_tbl->port_member[i] == 0)) {
-            continue;
-        }
         // 创建第一个对象并添加到数组
         cJSON *member1 = cJSON_CreateObject();
-        cJSON_AddNumberToObject(member1, "id", (double)ptr_vlan_entry_tbl->vlan_id[i]);
+        cJSON_AddNumberToObject(member1, "id", (double)ptr_idx->vidx2vid[i]);
         if(false == cJSON_AddItemToArray(vlan_member, member1)){
             mqttd_debug("Failed to add vlan member to array.");
             cJSON_Delete(member1);
             cJSON_Delete(vlan_member);
-            MW_FREE(ptr_msg);
+            mqttd_vlan_idx_release();
             return MW_E_NO_MEMORY;
         }
     }
 
     cJSON_AddItemToObject(data_obj, "vlan_member", vlan_member);
-    MW_FREE(ptr_msg);
-    ptr_msg = NULL;
-    ptr_vlan_entry_tbl = NULL;
+    mqttd_vlan_idx_release();
+    ptr_idx = NULL;
 	return rc;
 }
 
 static MW_ERROR_NO_T _mqttd_handle_getconfig_data(MQTTD_CTRL_T *mqttdctl,  cJSON *data_obj, cJSON *msgid_obj)
 {
     MW_ERROR_NO_T rc = MW_E_OK;
+    BOOL_T vlan_setting = FALSE;
     
 #if 1    
     char *json_data = cJSON_Print(data_obj);
@@ -4563,18 +5815,13 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_data(MQTTD_CTRL_T *mqttdctl,  cJSON
     }
 #endif
 
-    char topic[80];
-    osapi_snprintf(topic, sizeof(topic), "%s/rx", mqttdctl->topic_prefix);
-    cJSON *root = cJSON_CreateObject();
-    cJSON *data = cJSON_CreateObject();
-	
-	cJSON_AddStringToObject(root, "type", "getconf");
-    cJSON_AddStringToObject(root, "msg_id", msgid_obj->valuestring);
-	cJSON_AddNumberToObject(root, "continuity", 0);
-	cJSON_AddStringToObject(root, "result", "ok");
-
-	cJSON *result = cJSON_GetObjectItemCaseSensitive(root, "result");
-    cJSON *continuity = cJSON_GetObjectItemCaseSensitive(root, "continuity");
+    /* Each section is sent once built, the last message has final set */
+    MQTTD_GETCONF_STREAM_T stream;
+    osapi_memset(&stream, 0, sizeof(stream));
+    stream.ptr_mqttd = mqttdctl;
+    osapi_snprintf(stream.topic, sizeof(stream.topic), "%s/rx", mqttdctl->topic_prefix);
+    osapi_strncpy(stream.msg_id, msgid_obj->valuestring, sizeof(stream.msg_id) - 1);
+    cJSON *data = NULL;
     cJSON *child = NULL;
     
     cJSON_ArrayForEach(child, data_obj)
@@ -4582,6 +5829,11 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_data(MQTTD_CTRL_T *mqttdctl,  cJSON
         if (cJSON_IsString(child) && (child->valuestring != NULL))
         {
             osapi_printf("getconfig item: %s\n", child->valuestring);
+            data = cJSON_CreateObject();
+            if (NULL == data) {
+                rc = MW_E_NO_MEMORY;
+                break;
+            }
             if (osapi_strcmp(child->valuestring, "remote_protocols") == 0) {
                 rc = _mqttd_handle_getconfig_remote_protocols(mqttdctl, data);
                 if (MW_E_OK != rc) {
@@ -4632,13 +5884,8 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_data(MQTTD_CTRL_T *mqttdctl,  cJSON
                     break;
                 }
             } else if (osapi_strcmp(child->valuestring, "vlan_setting") == 0) {
-                // Handle "vlan_setting" case
-                rc = _mqttd_handle_getconfig_vlan_setting(mqttdctl, data);
-                if(MW_E_OK != rc){
-                    mqttd_debug("Handling getConfig vlan_setting failed.");
-                    break;
-                }
-
+                // Handle "vlan_setting" case, deferred until the other sections are done
+                vlan_setting = TRUE;
             } else if (osapi_strcmp(child->valuestring, "port_limit_rate") == 0) {
                 // Handle "port_limit_rate" case
             } else if (osapi_strcmp(child->valuestring, "storm_control") == 0) {
@@ -4652,19 +5899,29 @@ static MW_ERROR_NO_T _mqttd_handle_getconfig_data(MQTTD_CTRL_T *mqttdctl,  cJSON
                     break;
                 }
             }
+            /* Sections without a handler leave data empty, nothing is sent */
+            rc = _mqttd_getconfig_emit(&stream, data);
+            data = NULL;
+            if (MW_E_OK != rc) {
+                mqttd_debug("Sending getConfig %s failed(%d).", child->valuestring, rc);
+                break;
+            }
         }
     }
+    cJSON_Delete(data);
 
-    if(rc != MW_E_OK)
-    {
-        cJSON_Delete(data);
-        cJSON_SetValuestring(result, "error");
-    }
-    else//send success result with data
+    if((rc == MW_E_OK) && (TRUE == vlan_setting))
     {
-        cJSON_AddItemToObject(root, "data", data);
+        /* The continuation sends vlan_setting and the final message */
+        rc = _mqttd_handle_getconfig_vlan_setting(&stream);
+        if(MW_E_OK == rc)
+        {
+            return rc;
+        }
+        mqttd_debug("Handling getConfig vlan_setting failed.");
     }
-    mqtt_send_json_and_free(mqttdctl, topic, root);
+
+    (void)_mqttd_getconfig_send(&stream, NULL, (MW_E_OK == rc) ? "ok" : "error", TRUE);
     
 	return rc;
 }
@@ -4706,7 +5963,7 @@ static MW_ERROR_NO_T  _mqttd_handle_reset(MQTTD_CTRL_T *mqttdctl,  cJSON *msgid_
     cJSON_AddStringToObject(root, "msg_id", msgid_obj->valuestring);
     cJSON_AddStringToObject(root, "result", "ok");
 
-	mqtt_send_json_and_free(mqttdctl, topic, root); 
+	mqtt_send_json_and_free(mqttdctl, topic, root, MQTTD_PUB_LANE_INTERACTIVE); 
 
     //重启设备
     mqttd_debug("start reset system ......");
@@ -4754,7 +6011,7 @@ static MW_ERROR_NO_T  _mqttd_handle_reboot(MQTTD_CTRL_T *mqttdctl,  cJSON *msgid
     cJSON_AddStringToObject(root, "msg_id", msgid_obj->valuestring);
     cJSON_AddStringToObject(root, "result", "ok");
 
-   mqtt_send_json_and_free(mqttdctl, topic, root); 
+   mqtt_send_json_and_free(mqttdctl, topic, root, MQTTD_PUB_LANE_INTERACTIVE); 
 
     //重启设备
     mqttd_debug("start reboot system ......");
@@ -5093,8 +6350,55 @@ static void _mqttd_subscribe_cb(void *arg, err_t err)
  *      MQTTD SUBSCRIBE callback function
  *
  * INPUT:
- *      arg     --  The pointer of MQTTD ctrl structure
- *      err     --  The subscribe process error status
+ *      arg     --  The pointer of MQTTD ctrl structure
+ *      err     --  The subscribe process error status
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ *
+ */
+static void _mqttd_subscribe_cb(void *arg, err_t err)
+{
+    MQTTD_CTRL_T *ptr_mqttd = (MQTTD_CTRL_T *)arg;
+
+    mqttd_debug("mqtt subscribe rx result is (%d)\n", (UI8_T)err);
+
+    if (err == ERR_OK)
+    {
+    	osapi_printf("MQTT subscribe tx topic done.\n");
+        /* If SUBACK received, then PUBLISH online event */
+        _mqttd_publish_online(ptr_mqttd);
+		
+		ptr_mqttd->state = MQTTD_STATE_SUBACK;
+		
+    }
+    else if (err == ERR_CONN)
+    {
+        /* The connection is closed, the next connect subscribes again */
+        mqttd_debug("MQTT SUBSCRIBE aborted by disconnect");
+    }
+    else
+    {
+        /* If SUBSCRIBE failed, then try to re-subscribe again */
+        osapi_printf("MQTT SUBSCRIBE failed (%d)\n", (UI8_T)err);
+        ptr_mqttd->state = MQTTD_STATE_CONNECTED;
+    }
+    return;
+}
+#endif
+
+/* FUNCTION NAME:  _mqttd_publish_online
+ * PURPOSE:
+ *      MQTTD PUBLISH the online event
+ *
+ * INPUT:
+ *      ptr_mqttd  --  The pointer of MQTTD ctrl structure
  *
  * OUTPUT:
  *      None
@@ -5103,52 +6407,32 @@ static void _mqttd_subscribe_cb(void *arg, err_t err)
  *      None
  *
  * NOTES:
- *      None
+ *      Sent on SUBACK, or right after CONNACK when the session is resumed.
  *
  */
-static void _mqttd_subscribe_cb(void *arg, err_t err)
+static void _mqttd_publish_online(MQTTD_CTRL_T *ptr_mqttd)
 {
-    MQTTD_CTRL_T *ptr_mqttd = (MQTTD_CTRL_T *)arg;
+    char topic[80];
+    osapi_snprintf(topic, sizeof(topic), "%s/event", ptr_mqttd->topic_prefix);
+    cJSON *root = cJSON_CreateObject();
+    cJSON *data = cJSON_CreateObject();
 
-    mqttd_debug("mqtt subscribe rx result is (%d)\n", (UI8_T)err);
+    cJSON_AddStringToObject(root, "type", "online");
+    cJSON_AddItemToObject(root, "data", data);
 
-    if (err == ERR_OK)
-    {
-    	osapi_printf("MQTT subscribe tx topic done.\n");
-        /* If SUBACK received, then PUBLISH online event */
-        char topic[80];
-        osapi_snprintf(topic, sizeof(topic), "%s/event", ptr_mqttd->topic_prefix);
-        cJSON *root = cJSON_CreateObject();
-        cJSON *data = cJSON_CreateObject();
+    cJSON_AddStringToObject(data, "swid", ptr_mqttd->device_id);
+    cJSON_AddNumberToObject(data, "runtime", ptr_mqttd->ticknum/2);
+    cJSON_AddStringToObject(data, "version", "1.0.0");
+    cJSON_AddStringToObject(data, "product_name", "HR5300");
+    cJSON_AddStringToObject(data, "firmware", "1.0.0");
+    cJSON_AddStringToObject(data, "sn", ptr_mqttd->sn);
+    cJSON_AddStringToObject(data, "type", "L2");
+    cJSON_AddStringToObject(data, "mac", ptr_mqttd->mac);
 
-	    cJSON_AddStringToObject(root, "type", "online");
-	    cJSON_AddItemToObject(root, "data", data);
+    mqtt_send_json_and_free(ptr_mqttd, topic, root, MQTTD_PUB_LANE_INTERACTIVE);
 
-	    cJSON_AddStringToObject(data, "swid", ptr_mqttd->device_id);
-	    cJSON_AddNumberToObject(data, "runtime", ptr_mqttd->ticknum/2);
-	    cJSON_AddStringToObject(data, "version", "1.0.0");
-	    cJSON_AddStringToObject(data, "product_name", "HR5300");
-	    cJSON_AddStringToObject(data, "firmware", "1.0.0");
-	    cJSON_AddStringToObject(data, "sn", ptr_mqttd->sn);
-	    cJSON_AddStringToObject(data, "type", "L2");
-	    cJSON_AddStringToObject(data, "mac", ptr_mqttd->mac);
-
-	 	mqtt_send_json_and_free(ptr_mqttd, topic, root);
-	 	
-		osapi_printf("MQTT send online event done.\n");
-		
-		ptr_mqttd->state = MQTTD_STATE_SUBACK;
-		
-    }
-    else
-    {
-        /* If SUBSCRIBE failed, then try to re-subscribe again */
-        osapi_printf("MQTT SUBSCRIBE failed (%d)\n", (UI8_T)err);
-        ptr_mqttd->state = MQTTD_STATE_CONNECTED;
-    }
-    return;
+    osapi_printf("MQTT send online event done.\n");
 }
-#endif
 
 #if 0
 /* FUNCTION NAME:  _mqttd_send_subscribe
@@ -5225,6 +6509,55 @@ static void _mqttd_send_subscribe(mqtt_client_t *client, void *arg)
 		ptr_mqttd->state = MQTTD_STATE_INITING;
 }
 #endif
+/* FUNCTION NAME:  _mqttd_protocol_fallback
+ * PURPOSE:
+ *      Choose the MQTT version of the next connect after a failed one
+ *
+ * INPUT:
+ *      ptr_mqttd  --  The pointer of MQTTD ctrl structure
+ *      status     --  The status reported by the connection callback
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      A broker refusing MQTT 5 in its CONNACK keeps 3.1.1 from then on.
+ *      Many 3.1.1 brokers close the connection or never answer an MQTT 5
+ *      CONNECT instead, so such a close while connecting also tries 3.1.1.
+ *      A network failure looks the same, so if the 3.1.1 attempt fails
+ *      before CONNACK too, the next one goes back to MQTT 5.
+ */
+static void _mqttd_protocol_fallback(MQTTD_CTRL_T *ptr_mqttd, mqtt_connection_status_t status)
+{
+    if ((MQTT_CONNECT_REFUSED_PROTOCOL_VERSION == status) &&
+        (MQTT_VERSION_5 == ptr_mqttd->protocol_version))
+    {
+        osapi_printf("MQTT 5 refused by the remote server, use MQTT 3.1.1\n");
+        ptr_mqttd->protocol_version = MQTT_VERSION_3_1_1;
+        ptr_mqttd->protocol_probe = FALSE;
+        return;
+    }
+    if ((MQTTD_STATE_CONNECTING != ptr_mqttd->state) ||
+        ((MQTT_CONNECT_DISCONNECTED != status) && (MQTT_CONNECT_TIMEOUT != status)))
+    {
+        return;
+    }
+    if (MQTT_VERSION_5 == ptr_mqttd->protocol_version)
+    {
+        osapi_printf("MQTT 5 connect closed by the remote server, try MQTT 3.1.1\n");
+        ptr_mqttd->protocol_version = MQTT_VERSION_3_1_1;
+        ptr_mqttd->protocol_probe = TRUE;
+    }
+    else if (TRUE == ptr_mqttd->protocol_probe)
+    {
+        ptr_mqttd->protocol_version = MQTT_VERSION_5;
+        ptr_mqttd->protocol_probe = FALSE;
+    }
+}
+
 /* FUNCTION NAME:  _mqttd_connection_cb
  * PURPOSE:
  *      MQTTD connection callback function
@@ -5242,22 +6575,39 @@ static void _mqttd_send_subscribe(mqtt_client_t *client, void *arg)
 static void _mqttd_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status)
 {
     MQTTD_CTRL_T *ptr_mqttd = (MQTTD_CTRL_T *)arg;
+    BOOL_T resumed = FALSE;
 
     osapi_printf("mqtt connection state is \"%s(%d)\"\n", (status == MQTT_CONNECT_ACCEPTED)? "CONNECTED" : "DISCONNECTED", (UI16_T)status);
 
     if (status != MQTT_CONNECT_ACCEPTED)
     {
         // If callback by mqtt_close, then free the client
+        _mqttd_protocol_fallback(ptr_mqttd, status);
         if (ptr_mqttd->state < MQTTD_STATE_DISCONNECTED)
         {
+            if ((MQTTD_STATE_CONNECTING == ptr_mqttd->state) &&
+                (MQTTD_SERVER_SRC_CACHE == ptr_mqttd->server_cache.source))
+            {
+                ptr_mqttd->server_cache.miss = TRUE;
+            }
             ptr_mqttd->state = MQTTD_STATE_DISCONNECTED;
             ptr_mqttd->reconnect = TRUE;
+            (void)mqttd_queue_post(MQTTD_EVENT_WAKE);
         }
         return;
     }
 
     // Set publish callback functions
     mqtt_set_inpub_callback(mqttd.ptr_client, _mqttd_incoming_publish_cb, _mqttd_incoming_data_cb, (void *)&mqttd);
+    /* The CONNACK is only readable in this callback */
+    ptr_mqttd->session_present = mqtt_client_session_present(client);
+    ptr_mqttd->protocol_probe = FALSE;
+    ptr_mqttd->backoff = MQTTD_RECONNECT_MIN_DELAY;
+    _mqttd_server_cache_hit(ptr_mqttd);
+#if MQTTD_SUPPORT_TLS
+    resumed = _mqttd_tls_save(client);
+#endif
+    _mqttd_conn_stats_update(ptr_mqttd, resumed);
     ptr_mqttd->state = MQTTD_STATE_CONNECTED;
 }
 
@@ -5267,6 +6617,9 @@ static void _mqttd_connection_cb(mqtt_client_t *client, void *arg, mqtt_connecti
  *      A callback function from dns
  *
  * INPUT:
+ *      name          --  the host name
+ *      ipaddr        --  the resolved address, NULL if the lookup failed
+ *      callback_arg  --  the pointer of the mqttd ctrl structure
  *
  * OUTPUT:
  *      None
@@ -5275,17 +6628,28 @@ static void _mqttd_connection_cb(mqtt_client_t *client, void *arg, mqtt_connecti
  *      None
  *
  * NOTES:
- *      None
+ *      When the cached address is already being tried, the answer only
+ *      refreshes the cache.
  */
 void _mqttd_dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_arg)
 {
     MQTTD_CTRL_T *ptr_mqttd = (MQTTD_CTRL_T *)callback_arg;
     MW_ERROR_NO_T rc;
 
-    if (ipaddr == IPADDR_ANY)
+    if (MQTTD_SERVER_SRC_CACHE == ptr_mqttd->server_cache.source)
+    {
+        _mqttd_server_refresh(ptr_mqttd, ipaddr);
+        return;
+    }
+    if (ipaddr == NULL)
     {
         osapi_printf("server \"%s\" lookup failed, use default server\n", name);
         ip_addr_copy(ptr_mqttd->server_ip, mqttd_server_ip);
+        ptr_mqttd->server_cache.source = MQTTD_SERVER_SRC_DEFAULT;
+    }
+    else
+    {
+        ip_addr_copy(ptr_mqttd->server_ip, *ipaddr);
     }
     rc = _mqttd_client_connect(ptr_mqttd);
     if (rc == MW_E_NO_MEMORY)
@@ -5303,11 +6667,300 @@ void _mqttd_dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_
     else
     { /* Do nothing */}
 }
-#endif
+#endif
+
+/* FUNCTION NAME: _mqttd_lookup_server
+ * PURPOSE:
+ *      Lookup the remote server IP address
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      MW_E_BAD_PARAMETER
+ *
+ * NOTES:
+ *      A cached address that has not expired is connected at once and the
+ *      DNS lookup only refreshes it in the background, so the connect does
+ *      not wait for the resolver.
+ */
+static MW_ERROR_NO_T _mqttd_lookup_server(MQTTD_CTRL_T *ptr_mqttd)
+{
+    I8_T err = ERR_OK;
+    MQTTD_SERVER_CACHE_T *ptr_cache = NULL;
+#if LWIP_DNS
+    ip_addr_t resolved;
+#endif
+
+    if (ptr_mqttd == NULL)
+    {
+        return MW_E_BAD_PARAMETER;
+    }
+    ptr_cache = &(ptr_mqttd->server_cache);
+    ptr_mqttd->port = MQTT_SRV_PORT;
+    if (MQTTD_SERVER_SRC_FIXED == ptr_cache->source)
+    {
+        /* server ip set by console */
+        mqttd_debug("Connect to original MQTT remote server");
+        return _mqttd_client_connect(ptr_mqttd);
+    }
+
+    ptr_cache->fresh_valid = FALSE;
+    ptr_cache->miss = FALSE;
+    if ((TRUE == ptr_cache->valid) && ((I32_T)(sys_now() - ptr_cache->expire) < 0))
+    {
+        ip_addr_copy(ptr_mqttd->server_ip, ptr_cache->cached_ip);
+        ptr_cache->source = MQTTD_SERVER_SRC_CACHE;
+        ptr_cache->start = sys_now();
+#if LWIP_DNS
+        err = dns_gethostbyname((const char *)cloud_hostname, &resolved, _mqttd_dns_found, (void *)ptr_mqttd);
+        if (err == ERR_OK)
+        {
+            /* Answered from the lwIP DNS table, it is newer than the cache */
+            _mqttd_server_refresh(ptr_mqttd, &resolved);
+            if (TRUE == ptr_cache->fresh_valid)
+            {
+                _mqttd_server_cache_promote(ptr_cache);
+                ip_addr_copy(ptr_mqttd->server_ip, ptr_cache->cached_ip);
+            }
+        }
+#endif
+        mqttd_debug("Connect to cached MQTT remote server %s", ipaddr_ntoa(&ptr_mqttd->server_ip));
+        return _mqttd_client_connect(ptr_mqttd);
+    }
+
+    ptr_cache->source = MQTTD_SERVER_SRC_DNS;
+#if LWIP_DNS
+    err = dns_gethostbyname((const char *)cloud_hostname, &(ptr_mqttd->server_ip), _mqttd_dns_found, (void *)ptr_mqttd);
+#else
+    ip_addr_copy(ptr_mqttd->server_ip, mqttd_server_ip);
+    ptr_cache->source = MQTTD_SERVER_SRC_DEFAULT;
+#endif
+    if (err == ERR_OK)
+    {
+        return _mqttd_client_connect(ptr_mqttd);
+    }
+    else if (err != ERR_INPROGRESS)
+    {
+        // failed due to memory or argument error
+        osapi_printf("Cannot use DNS:(error %d), use MQTTD default remote server\n", (int)err);
+        ip_addr_copy(ptr_mqttd->server_ip, mqttd_server_ip);
+        ptr_cache->source = MQTTD_SERVER_SRC_DEFAULT;
+        return _mqttd_client_connect(ptr_mqttd);
+    }
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _mqttd_server_cache_load
+ * PURPOSE:
+ *      Load the cached broker address from DB
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      There is no wall clock at boot, so the saved TTL restarts from the
+ *      time it is loaded. An address still valid from the last run of the
+ *      task is kept. MQTTD_CFG_SERVER_IP and MQTTD_CFG_SERVER_TTL are UI32_T
+ *      fields of MQTTD_CFG_INFO, so they are kept in the config file.
+ */
+static void _mqttd_server_cache_load(MQTTD_CTRL_T *ptr_mqttd)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    MQTTD_SERVER_CACHE_T *ptr_cache = &(ptr_mqttd->server_cache);
+    DB_MSG_T *db_msg = NULL;
+    UI16_T db_size = 0;
+    void *db_data = NULL;
+    UI32_T addr = IPADDR_ANY;
+
+    if (TRUE == ptr_cache->valid)
+    {
+        return;
+    }
+    ptr_cache->ttl = MQTTD_SERVER_CACHE_TTL;
+    rc = mqttd_queue_getData(MQTTD_CFG_INFO, MQTTD_CFG_SERVER_TTL, DB_ALL_ENTRIES, &db_msg, &db_size, &db_data);
+    if (MW_E_OK == rc)
+    {
+        if (sizeof(UI32_T) == db_size)
+        {
+            osapi_memcpy((void *)&(ptr_cache->ttl), db_data, sizeof(UI32_T));
+        }
+        dbapi_freeMsg(db_msg);
+    }
+    rc = mqttd_queue_getData(MQTTD_CFG_INFO, MQTTD_CFG_SERVER_IP, DB_ALL_ENTRIES, &db_msg, &db_size, &db_data);
+    if (MW_E_OK == rc)
+    {
+        if (sizeof(UI32_T) == db_size)
+        {
+            osapi_memcpy((void *)&addr, db_data, sizeof(UI32_T));
+        }
+        dbapi_freeMsg(db_msg);
+    }
+    else
+    {
+        mqttd_debug_db("%s", "get cached server failed");
+    }
+
+    ip_addr_set_ip4_u32(&(ptr_cache->cached_ip), addr);
+    ptr_cache->dirty = FALSE;
+    if ((IPADDR_ANY != addr) && (0 != ptr_cache->ttl))
+    {
+        ptr_cache->expire = sys_now() + (ptr_cache->ttl * 1000);
+        ptr_cache->valid = TRUE;
+        mqttd_debug("Cached MQTT remote server %s, TTL %us", ipaddr_ntoa(&(ptr_cache->cached_ip)), (unsigned int)ptr_cache->ttl);
+    }
+}
+
+/* FUNCTION NAME: _mqttd_server_cache_save
+ * PURPOSE:
+ *      Save a changed broker address to DB
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called by the mqttd task after the broker accepted the connection.
+ */
+static void _mqttd_server_cache_save(MQTTD_CTRL_T *ptr_mqttd)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    MQTTD_SERVER_CACHE_T *ptr_cache = &(ptr_mqttd->server_cache);
+    UI32_T addr = 0;
+
+    if (TRUE != ptr_cache->dirty)
+    {
+        return;
+    }
+    ptr_cache->dirty = FALSE;
+    addr = ip4_addr_get_u32(ip_2_ip4(&(ptr_cache->cached_ip)));
+    rc = mqttd_queue_setData(M_UPDATE, MQTTD_CFG_INFO, MQTTD_CFG_SERVER_IP, DB_ALL_ENTRIES, &addr, sizeof(addr));
+    if (MW_E_OK == rc)
+    {
+        rc = mqttd_queue_setData(M_UPDATE, MQTTD_CFG_INFO, MQTTD_CFG_SERVER_TTL, DB_ALL_ENTRIES, &(ptr_cache->ttl), sizeof(ptr_cache->ttl));
+    }
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Save cached server failed(%d).", rc);
+        ptr_cache->dirty = TRUE;
+    }
+}
+
+/* FUNCTION NAME: _mqttd_server_cache_hit
+ * PURPOSE:
+ *      Remember the broker address that accepted the connection
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Only a DNS answer restarts the TTL. The console address and the
+ *      default server are never cached.
+ */
+static void _mqttd_server_cache_hit(MQTTD_CTRL_T *ptr_mqttd)
+{
+    MQTTD_SERVER_CACHE_T *ptr_cache = &(ptr_mqttd->server_cache);
+
+    if ((MQTTD_SERVER_SRC_DNS != ptr_cache->source) || (0 == ptr_cache->ttl))
+    {
+        return;
+    }
+    if (!ip_addr_cmp(&(ptr_cache->cached_ip), &(ptr_mqttd->server_ip)))
+    {
+        ip_addr_copy(ptr_cache->cached_ip, ptr_mqttd->server_ip);
+        ptr_cache->dirty = TRUE;
+    }
+    ptr_cache->expire = sys_now() + (ptr_cache->ttl * 1000);
+    ptr_cache->valid = TRUE;
+}
+
+/* FUNCTION NAME: _mqttd_server_cache_promote
+ * PURPOSE:
+ *      Replace the cached address by the newer DNS answer
+ *
+ * INPUT:
+ *      ptr_cache  --  the broker address cache
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ */
+static void _mqttd_server_cache_promote(MQTTD_SERVER_CACHE_T *ptr_cache)
+{
+    ip_addr_copy(ptr_cache->cached_ip, ptr_cache->fresh_ip);
+    ptr_cache->fresh_valid = FALSE;
+    ptr_cache->expire = sys_now() + (ptr_cache->ttl * 1000);
+    ptr_cache->valid = TRUE;
+    ptr_cache->dirty = TRUE;
+}
+
+/* FUNCTION NAME: _mqttd_server_refresh
+ * PURPOSE:
+ *      Handle the DNS answer racing the cached attempt
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *      ipaddr     --  the resolved address, NULL if the lookup failed
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The same address only restarts the TTL. A different one is kept in
+ *      fresh_ip and used by _mqttd_server_race or _mqttd_server_failover.
+ */
+static void _mqttd_server_refresh(MQTTD_CTRL_T *ptr_mqttd, const ip_addr_t *ipaddr)
+{
+    MQTTD_SERVER_CACHE_T *ptr_cache = &(ptr_mqttd->server_cache);
+
+    if (ipaddr == NULL)
+    {
+        mqttd_debug("Refresh MQTT remote server failed, keep the cached one");
+        return;
+    }
+    if (ip_addr_cmp(ipaddr, &(ptr_cache->cached_ip)))
+    {
+        ptr_cache->expire = sys_now() + (ptr_cache->ttl * 1000);
+        return;
+    }
+    ip_addr_copy(ptr_cache->fresh_ip, *ipaddr);
+    ptr_cache->fresh_valid = TRUE;
+    mqttd_debug("MQTT remote server moved to %s", ipaddr_ntoa(ipaddr));
+}
 
-/* FUNCTION NAME: _mqttd_lookup_server
+/* FUNCTION NAME: _mqttd_server_race
  * PURPOSE:
- *      Lookup the remote server IP address
+ *      Give up a slow cached attempt when DNS has a different address
  *
  * INPUT:
  *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
@@ -5316,49 +6969,67 @@ void _mqttd_dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_
  *      None
  *
  * RETURN:
- *      MW_E_OK
- *      MW_E_NO_MEMORY
- *      MW_E_BAD_PARAMETER
+ *      None
  *
  * NOTES:
- *      None
+ *      The lwIP client holds one connection, so the candidates race in
+ *      turn: the cached address gets MQTTD_SERVER_RACE_DELAY, then the
+ *      DNS answer is tried without backoff.
  */
-static MW_ERROR_NO_T _mqttd_lookup_server(MQTTD_CTRL_T *ptr_mqttd)
+static void _mqttd_server_race(MQTTD_CTRL_T *ptr_mqttd)
 {
-    I8_T err = ERR_OK;
-    ip4_addr_t *ptr_server = NULL;
+    MQTTD_SERVER_CACHE_T *ptr_cache = &(ptr_mqttd->server_cache);
 
-    if (ptr_mqttd == NULL)
+    if ((MQTTD_SERVER_SRC_CACHE != ptr_cache->source) || (TRUE != ptr_cache->fresh_valid))
     {
-        return MW_E_BAD_PARAMETER;
+        return;
     }
-    ptr_server = ip_2_ip4(&(ptr_mqttd->server_ip));
-    if (ptr_server->addr != IPADDR_ANY)
+    if ((sys_now() - ptr_cache->start) < MQTTD_SERVER_RACE_DELAY)
     {
-        /* server ip set by console */
-        mqttd_debug("Connect to original MQTT remote server");
-        return _mqttd_client_connect(ptr_mqttd);
+        return;
     }
+    osapi_printf("Cached server %s does not answer, use the DNS answer\n", ipaddr_ntoa(&ptr_mqttd->server_ip));
+    ptr_cache->miss = TRUE;
+    ptr_mqttd->reconnect = TRUE;
+    ptr_mqttd->state = MQTTD_STATE_DISCONNECTED;
+}
 
-#if LWIP_DNS
-    err = dns_gethostbyname((const char *)cloud_hostname, &(ptr_mqttd->server_ip), _mqttd_dns_found, (void *)ptr_mqttd);
-#else
-    ip_addr_copy(ptr_mqttd->server_ip, mqttd_server_ip);
-#endif
-	ptr_mqttd->port = MQTT_SRV_PORT;
-    if (err == ERR_OK)
+/* FUNCTION NAME: _mqttd_server_failover
+ * PURPOSE:
+ *      Pick the next candidate after the cached attempt failed
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      TRUE   --  a newer DNS answer is cached, retry at once
+ *      FALSE  --  retry after the backoff
+ *
+ * NOTES:
+ *      Without a newer answer the cache is dropped, so the next attempt
+ *      waits for DNS again.
+ */
+static BOOL_T _mqttd_server_failover(MQTTD_CTRL_T *ptr_mqttd)
+{
+    MQTTD_SERVER_CACHE_T *ptr_cache = &(ptr_mqttd->server_cache);
+
+    if (TRUE != ptr_cache->miss)
     {
-        return _mqttd_client_connect(ptr_mqttd);
+        return FALSE;
     }
-    else if (err != ERR_INPROGRESS)
+    ptr_cache->miss = FALSE;
+    if (TRUE == ptr_cache->fresh_valid)
     {
-        // failed due to memory or argument error
-        osapi_printf("Cannot use DNS:(error %d), use MQTTD default remote server\n", (int)err);
-        ip_addr_copy(ptr_mqttd->server_ip, mqttd_server_ip);
-        return _mqttd_client_connect(ptr_mqttd);
+        _mqttd_server_cache_promote(ptr_cache);
+        return TRUE;
     }
-    return MW_E_OK;
+    ptr_cache->valid = FALSE;
+    return FALSE;
 }
+
 /* FUNCTION NAME:  _mqttd_client_connect
  * PURPOSE:
  *      Generate the Client ID and connect to the remote MQTT server.
@@ -5405,6 +7076,16 @@ static MW_ERROR_NO_T _mqttd_client_connect(MQTTD_CTRL_T *ptr_mqttd)
         MQTTD_WILL_QOS,           /* will_qos, see will_topic */
         MQTTD_WILL_RETAIN         /* will_retain, see will_topic */
     };
+    /* Queued cloud requests and subscriptions survive a short outage */
+    client_info.keep_session = MQTTD_KEEP_SESSION;
+    client_info.protocol_version = ptr_mqttd->protocol_version;
+#if MQTTD_SUPPORT_TLS
+    if (MW_E_OK != _mqttd_tls_setup(&client_info))
+    {
+        osapi_printf("\nconnect_mqtt: create TLS config failed.\n");
+        return MW_E_NO_MEMORY;
+    }
+#endif
 
     mqttd_debug("MQTTD create a new client (%p) try to connect to %s", ptr_mqttd->ptr_client, ipaddr_ntoa(&ptr_mqttd->server_ip));
     if (ptr_mqttd->ptr_client == NULL)
@@ -5418,6 +7099,7 @@ static MW_ERROR_NO_T _mqttd_client_connect(MQTTD_CTRL_T *ptr_mqttd)
     }
 
     // connect to MQTT server
+    ptr_mqttd->conn_stats.start = sys_now();
     err = mqtt_client_connect(ptr_mqttd->ptr_client, (const ip_addr_t *)&(ptr_mqttd->server_ip), portnum,
             _mqttd_connection_cb, (void *)ptr_mqttd, (const struct mqtt_connect_client_info_t *)&client_info);
     if (ERR_OK != err)
@@ -5462,42 +7144,268 @@ static void _mqttd_client_disconnect(mqtt_client_t* ptr_mqttclient)
     }
 }
 
-/* FUNCTION NAME:  _mqttd_reconnect_tmr
+/* FUNCTION NAME:  _mqttd_backoff_rand
  * PURPOSE:
- *      The timer to do the reconnect process
+ *      Get a pseudo random number for the reconnect jitter
  *
  * INPUT:
- *      ptr_xTimer
+ *      None
  *
  * OUTPUT:
  *      None
  *
  * RETURN:
- *      None
+ *      The random number
  *
  * NOTES:
+ *      xorshift32 seeded by the device ID, so the switches behind one
+ *      broker do not retry in lock step after a broker restart.
+ */
+static UI32_T _mqttd_backoff_rand(void)
+{
+    UI32_T x = _mqttd_backoff_seed;
+    UI8_T i;
+
+    if (0 == x)
+    {
+        x = sys_now();
+        for (i = 0; mqttd.device_id[i] != '\0'; i++)
+        {
+            x = (x * 31) + (UI8_T)mqttd.device_id[i];
+        }
+        if (0 == x)
+        {
+            x = 1;
+        }
+    }
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _mqttd_backoff_seed = x;
+    return x;
+}
+
+/* FUNCTION NAME:  _mqttd_reconnect_schedule
+ * PURPOSE:
+ *      Arm the next reconnect attempt
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
  *      None
+ *
+ * NOTES:
+ *      The delay is a random value in [backoff/2, backoff], then the
+ *      backoff doubles up to MQTTD_RECONNECT_MAX_DELAY. It is reset to
+ *      MQTTD_RECONNECT_MIN_DELAY once the broker accepts the connection.
  */
+static void _mqttd_reconnect_schedule(MQTTD_CTRL_T *ptr_mqttd)
+{
+    UI32_T delay = ptr_mqttd->backoff / 2;
+
+    delay += _mqttd_backoff_rand() % (ptr_mqttd->backoff - delay + 1);
+    ptr_mqttd->retry_time = sys_now() + delay;
+    ptr_mqttd->retry_pending = TRUE;
+    ptr_mqttd->backoff = (ptr_mqttd->backoff >= (MQTTD_RECONNECT_MAX_DELAY / 2)) ?
+                         MQTTD_RECONNECT_MAX_DELAY : (ptr_mqttd->backoff * 2);
+    osapi_printf("Reconnect to remote server in %u ms\n", (unsigned int)delay);
+}
 
-static void _mqttd_reconnect_tmr(timehandle_t ptr_xTimer)
+/* FUNCTION NAME:  _mqttd_reconnect_process
+ * PURPOSE:
+ *      Handle the DISCONNECTED state of the mqttd task
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The task, its queues, the DB subscription and the lwIP client are
+ *      kept, so a reconnect is only the TCP and CONNECT exchange. DB
+ *      notifications are still received while waiting for the backoff.
+ */
+static void _mqttd_reconnect_process(MQTTD_CTRL_T *ptr_mqttd)
 {
-    if (mqttd.state == MQTTD_STATE_SHUTDOWN)
+    MW_ERROR_NO_T rc = MW_E_OK;
+    I32_T remain = 0;
+
+    if (TRUE != ptr_mqttd->reconnect)
+    {
+        mqttd_debug("MQTTD disconnected without reconnect, stop it.");
+        ptr_mqttd->state = MQTTD_STATE_SHUTDOWN;
+        return;
+    }
+    if (TRUE != ptr_mqttd->retry_pending)
     {
-        if (NULL != ptr_mqttdmain)
+        /* Close a connection that is still half open */
+        _mqttd_client_disconnect(ptr_mqttd->ptr_client);
+        if (TRUE == _mqttd_server_failover(ptr_mqttd))
         {
-            mqttd_debug("Close MQTTD main task.");
-            ptr_mqttdmain = NULL;
+            /* The DNS answer won the race, it does not wait for the backoff */
+            ptr_mqttd->retry_time = sys_now();
+            ptr_mqttd->retry_pending = TRUE;
         }
-        if (TRUE == mqttd.reconnect)
+        else
         {
-            osapi_printf("Reconnect to remote server: %s\n", ipaddr_ntoa(&mqttd.server_ip));
-            if (MW_E_OK != mqttd_init((void *)&(mqttd.server_ip)))
-            {
-                osapi_printf("Failed to Reconnect to remote server: Operation Stopped.\n");
-            }
+            _mqttd_reconnect_schedule(ptr_mqttd);
+        }
+    }
+    /* Read the clock once, a second read could pass the retry time and wrap */
+    remain = (I32_T)(ptr_mqttd->retry_time - sys_now());
+    if (remain > 0)
+    {
+        /* Returns at the retry time at most, the wait is in ticks */
+        _mqttd_listen_db(ptr_mqttd, (UI32_T)pdMS_TO_TICKS(remain));
+        return;
+    }
+
+    osapi_printf("Reconnect to remote server: %s\n", ipaddr_ntoa(&ptr_mqttd->server_ip));
+    ptr_mqttd->retry_pending = FALSE;
+    ptr_mqttd->state = MQTTD_STATE_CONNECTING;
+    rc = _mqttd_lookup_server(ptr_mqttd);
+    if (MW_E_NO_MEMORY == rc)
+    {
+        osapi_printf("Failed to reconnect to mqtt server due to no memory, close mqttd!\n");
+        ptr_mqttd->reconnect = FALSE;
+        ptr_mqttd->state = MQTTD_STATE_SHUTDOWN;
+    }
+    else if (MW_E_OK != rc)
+    {
+        mqttd_debug("Failed to reconnect to mqtt server(%d).", rc);
+        if (MQTTD_STATE_CONNECTING == ptr_mqttd->state)
+        {
+            ptr_mqttd->state = MQTTD_STATE_DISCONNECTED;
+        }
+    }
+}
+
+/* FUNCTION NAME:  _mqttd_conn_stats_update
+ * PURPOSE:
+ *      Account an accepted connection in the connect time statistics
+ *
+ * INPUT:
+ *      ptr_mqttd  --  the pointer of the mqttd ctrl structure
+ *      resumed    --  TRUE if the TLS session was resumed
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The time includes TCP, TLS handshake and the CONNECT exchange.
+ */
+static void _mqttd_conn_stats_update(MQTTD_CTRL_T *ptr_mqttd, BOOL_T resumed)
+{
+    MQTTD_CONN_STATS_T *ptr_stats = &(ptr_mqttd->conn_stats);
+    UI32_T elapsed = sys_now() - ptr_stats->start;
+
+    ptr_stats->last_ms = elapsed;
+    if (elapsed > ptr_stats->max_ms)
+    {
+        ptr_stats->max_ms = elapsed;
+    }
+    ptr_stats->total_ms += elapsed;
+    ptr_stats->count++;
+    if (TRUE == resumed)
+    {
+        ptr_stats->resumed++;
+    }
+    mqttd_debug("Connected to %s in %u ms%s", ipaddr_ntoa(&ptr_mqttd->server_ip),
+        (unsigned int)elapsed, (TRUE == resumed) ? ", TLS session resumed" : "");
+}
+
+#if MQTTD_SUPPORT_TLS
+/* FUNCTION NAME:  _mqttd_tls_setup
+ * PURPOSE:
+ *      Set the TLS configuration and the session to resume
+ *
+ * INPUT:
+ *      ptr_info  --  the client information of the connect
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      The configuration is created once and freed by _mqttd_ctrl_free.
+ */
+static MW_ERROR_NO_T _mqttd_tls_setup(struct mqtt_connect_client_info_t *ptr_info)
+{
+    if (NULL == tls_config)
+    {
+        tls_config = altcp_tls_create_config_client(MQTTD_TLS_CA_CERT, MQTTD_TLS_CA_CERT_LEN);
+        if (NULL == tls_config)
+        {
+            return MW_E_NO_MEMORY;
         }
+        mbedtls_ssl_session_init(&_mqttd_tls_session);
+        _mqttd_tls_session_valid = FALSE;
+    }
+    ptr_info->tls_config = tls_config;
+    ptr_info->tls_session = (TRUE == _mqttd_tls_session_valid) ? (void *)&_mqttd_tls_session : NULL;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME:  _mqttd_tls_save
+ * PURPOSE:
+ *      Keep the TLS session of the accepted connection
+ *
+ * INPUT:
+ *      client  --  the connected client
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      TRUE   --  the offered session was resumed
+ *      FALSE  --  it was a full handshake
+ *
+ * NOTES:
+ *      The server echoes the offered session ID when it resumes, with a
+ *      session ID or a session ticket. The kept session is freed before it
+ *      is filled again, else its peer certificate and ticket leak.
+ */
+static BOOL_T _mqttd_tls_save(mqtt_client_t *client)
+{
+    UI8_T id[sizeof(*mbedtls_ssl_session_get_id(&_mqttd_tls_session))];
+    size_t id_len = 0;
+
+    if (TRUE == _mqttd_tls_session_valid)
+    {
+        id_len = mbedtls_ssl_session_get_id_len(&_mqttd_tls_session);
+        osapi_memcpy(id, *mbedtls_ssl_session_get_id(&_mqttd_tls_session), id_len);
+    }
+    /* mbedtls_ssl_get_session allocates the peer cert and ticket again */
+    mbedtls_ssl_session_free(&_mqttd_tls_session);
+    mbedtls_ssl_session_init(&_mqttd_tls_session);
+    _mqttd_tls_session_valid = FALSE;
+    if (ERR_OK != mqtt_client_tls_session_get(client, &_mqttd_tls_session))
+    {
+        mqttd_debug("Failed to keep the TLS session.");
+        mbedtls_ssl_session_free(&_mqttd_tls_session);
+        mbedtls_ssl_session_init(&_mqttd_tls_session);
+        return FALSE;
     }
+    _mqttd_tls_session_valid = TRUE;
+    return ((0 != id_len) && (id_len == mbedtls_ssl_session_get_id_len(&_mqttd_tls_session)) &&
+            (0 == osapi_memcmp(id, *mbedtls_ssl_session_get_id(&_mqttd_tls_session), id_len))) ? TRUE : FALSE;
 }
+#endif
+
 # if 0
 static void _mqttd_main(void *arg)
 {
@@ -5655,6 +7563,36 @@ MW_ERROR_NO_T mqttd_init(void *arg)
     }
     mqttd_debug("Create the remain msg mutex %p",ptr_mqttmutex);
 
+    rc = mqttd_vlan_idx_init();
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Failed to create VLAN index");
+        mqttd_queue_free();
+        mqttd_get_queue_free();
+        osapi_mutexDelete(ptr_mqttmutex);
+        return MW_E_NOT_INITED;
+    }
+
+    rc = mqttd_smac_idx_init();
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Failed to create static MAC index");
+        mqttd_queue_free();
+        mqttd_get_queue_free();
+        osapi_mutexDelete(ptr_mqttmutex);
+        return MW_E_NOT_INITED;
+    }
+
+    rc = mqttd_rsp_init();
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("Failed to create response cache");
+        mqttd_queue_free();
+        mqttd_get_queue_free();
+        osapi_mutexDelete(ptr_mqttmutex);
+        return MW_E_NOT_INITED;
+    }
+
     /* Create timer */
     osapi_timerCreate(
             MQTTD_TIMER_NAME,
@@ -5723,9 +7661,11 @@ MW_ERROR_NO_T _mqttd_deinit(void)
         return MW_E_OK;
     }
     mqttd.state = MQTTD_STATE_SHUTDOWN;
+    dbapi_cancelAsync(MQTTD_QUEUE_NAME);
     _mqttd_unsubscribe_db(&mqttd);
     _mqttd_client_disconnect(mqttd.ptr_client);
     _mqttd_ctrl_free(&mqttd);
+    mqttd_rsp_deinit();
     if(NULL != ptr_mqttd_time)
     {
         mqttd_debug("MQTTD free the timer.");
@@ -5743,25 +7683,7 @@ MW_ERROR_NO_T _mqttd_deinit(void)
         ptr_mqttmutex = NULL;
     }
     mqttd_queue_free();
-
-    /* Create reconnect timer */
-    if(NULL == ptr_mqttd_recon_time)
-    {
-        osapi_timerCreate(
-                MQTTD_RECONNECT_TIMER_NAME,
-                _mqttd_reconnect_tmr,
-                FALSE,
-                MQTTD_TIMER_RECONNECT_PERIOD,
-                NULL, &ptr_mqttd_recon_time);
-    }
-    if(NULL != ptr_mqttd_recon_time)
-    {
-        mqttd_reconnect();
-    }
-    else
-    {
-        osapi_printf("Failed to create MQTTD Reconnect timer: No memory.\n");
-    }
+    mqttd_get_queue_free();
     osapi_processDelete(ptr_mqttdmain);
     ptr_mqttdmain = NULL;
     return MW_E_OK;
@@ -5925,11 +7847,21 @@ void mqttd_show_state(void)
     osapi_printf("MQTT remote server: %s\n", ipaddr_ntoa(&mqttd.server_ip));
     osapi_printf("MQTTD Client ID   : %s\n", mqttd.client_id);
     osapi_printf("MQTTD cloud ID    : %d\n", mqttd.cldb_id);
+    if (0 != mqttd.conn_stats.count)
+    {
+        osapi_printf("MQTTD connect time: last %u ms, max %u ms, avg %u ms\n",
+            (unsigned int)mqttd.conn_stats.last_ms, (unsigned int)mqttd.conn_stats.max_ms,
+            (unsigned int)(mqttd.conn_stats.total_ms / mqttd.conn_stats.count));
+#if MQTTD_SUPPORT_TLS
+        osapi_printf("MQTTD TLS resumed : %u of %u\n",
+            (unsigned int)mqttd.conn_stats.resumed, (unsigned int)mqttd.conn_stats.count);
+#endif
+    }
 }
 
 /* FUNCTION NAME: mqttd_reconnect
  * PURPOSE:
- *      To active the timer to do the shutdown and restart mqttd main task
+ *      To reconnect to the remote server without restarting mqttd main task
  *
  * INPUT:
  *      None
@@ -5941,20 +7873,22 @@ void mqttd_show_state(void)
  *      None
  *
  * NOTES:
- *      None
+ *      The backoff is reset, so the mqttd task reconnects after
+ *      MQTTD_RECONNECT_MIN_DELAY at most.
  */
 void mqttd_reconnect(void)
 {
-    if(MW_E_OK == osapi_timerActive(ptr_mqttd_recon_time))
+    if ((ptr_mqttdmain == NULL) || (MQTTD_STATE_SHUTDOWN == mqttd.state))
     {
-        mqttd_debug(" MQTTD Reconnect timer is active .\n");
-        return;
-    }
-    if(MW_E_OK != osapi_timerStart(ptr_mqttd_recon_time))
-    {
-        mqttd_debug("!Error: Failed to start MQTTD Reconnect timer: Operation Stopped.\n");
+        mqttd_debug("MQTTD stopped.");
         return;
     }
+    /* The mqttd task closes the connection and schedules the retry */
+    mqttd.backoff = MQTTD_RECONNECT_MIN_DELAY;
+    mqttd.retry_pending = FALSE;
+    mqttd.reconnect = TRUE;
+    mqttd.state = MQTTD_STATE_DISCONNECTED;
+    (void)mqttd_queue_post(MQTTD_EVENT_WAKE);
 }
 
 /* FUNCTION NAME: mqttd_shutdown
@@ -5989,6 +7923,7 @@ void mqttd_shutdown(void)
     mqttd.state = MQTTD_STATE_SHUTDOWN;
     mqttd.reconnect = FALSE;
     mqttd_enable = FALSE;
+    (void)mqttd_queue_post(MQTTD_EVENT_WAKE);
 }
 
 /* FUNCTION NAME: mqttd_get_state
@@ -6055,16 +7990,16 @@ static void _mqttd_main(void *arg)
 {
     MW_ERROR_NO_T rc = MW_E_NOT_INITED;
     UI8_T netif_num = 0;
+    UI32_T wait_ticks = 0;
     struct netif *xNetIf = NULL;
 
     /* Waiting until DB and Netif are ready */
-    do
-    {
-        rc = dbapi_dbisReady();
-    }while(rc != MW_E_OK);
+    rc = dbapi_waitReady(&wait_ticks);
+    mqttd_debug("DB ready after %u ticks of wait, at tick %u", (unsigned int)wait_ticks, (unsigned int)dbapi_getReadyTick());
 
     /* Initialize client ID */
     (void)_mqttd_gen_client_id(&mqttd);
+    _mqttd_server_cache_load(&mqttd);
 
     do{
         netif_num = netif_num_get();
@@ -6082,12 +8017,20 @@ static void _mqttd_main(void *arg)
         xNetIf->hwaddr[5]);
 
     do{
+        /* The timer only publishes in RUN state, it lives as long as the task */
+        if(MW_E_OK != osapi_timerStart(ptr_mqttd_time))
+        {
+            osapi_printf("Failed to start MQTTD timer. MQTTD Stopped.\n");
+            mqttd.state = MQTTD_STATE_SHUTDOWN;
+            break;
+        }
+
         /* Connect to MQTT */
         rc = _mqttd_lookup_server(&mqttd);
         if (rc == MW_E_NO_MEMORY)
         {
             osapi_printf("Failed to connect to mqtt server due to no memory, close mqttd!\n");
-            mqttd.state = MQTTD_STATE_DISCONNECTED;
+            mqttd.state = MQTTD_STATE_SHUTDOWN;
             break;
         }
         else if (rc != MW_E_OK)
@@ -6097,23 +8040,35 @@ static void _mqttd_main(void *arg)
             mqttd.state = MQTTD_STATE_DISCONNECTED;
             break;
         }
-        else
-        {
-            if(MW_E_OK != osapi_timerStart(ptr_mqttd_time))
-            {
-                osapi_printf("Failed to start MQTTD timer. MQTTD Stopped.\n");
-                mqttd.state = MQTTD_STATE_DISCONNECTED;
-                break;
-            }
-        }
     }while(0);
 
-    while(mqttd.state < MQTTD_STATE_DISCONNECTED)
+    /* Disconnection is handled in place, only mqttd_shutdown ends the task */
+    while(mqttd.state != MQTTD_STATE_SHUTDOWN)
     {
         switch (mqttd.state)
         {
+            case MQTTD_STATE_CONNECTING:
+            {
+                _mqttd_server_race(&mqttd);
+                osapi_delay(MQTTD_MUX_LOCK_TIME);
+                break;
+            }
             case MQTTD_STATE_CONNECTED:
             {
+                _mqttd_server_cache_save(&mqttd);
+                /* Send what the last session did not get acknowledged */
+                _mqttd_replay_remain(&mqttd);
+                if (TRUE == mqttd.session_present)
+                {
+                    /* The broker kept our subscription */
+                    mqttd_debug("MQTT session resumed, skip SUBSCRIBE");
+                    _mqttd_publish_online(&mqttd);
+                    if (mqttd.state != MQTTD_STATE_DISCONNECTED)
+                    {
+                        mqttd.state = MQTTD_STATE_INITING;
+                    }
+                    break;
+                }
                 // Set publish callback functions
                 _mqttd_send_subscribe(mqttd.ptr_client, (void *)&mqttd);//TO MQTT BROKER
                 break;
@@ -6131,8 +8086,13 @@ static void _mqttd_main(void *arg)
             }
             case MQTTD_STATE_RUN:
             {
-                /* Waiting for DB send notification */
-                _mqttd_listen_db(&mqttd);
+                /* Waiting for DB send notification or an event */
+                _mqttd_listen_db(&mqttd, DB_EVENT_WAIT_FOREVER);
+                break;
+            }
+            case MQTTD_STATE_DISCONNECTED:
+            {
+                _mqttd_reconnect_process(&mqttd);
                 break;
             }
             default:
@@ -0,0 +1,400 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_bind.c
+ * PURPOSE:
+ *  Implement the setConfig field binding of mqttd daemon.
+ *
+ * NOTES:
+ *  A binding table lists the keys of a JSON object with the member, type and
+ *  range each one is stored into. The object is walked once and every key
+ *  is looked up in the table, instead of one get_object_item walk per key.
+ */
+
+#include <string.h>
+#include "mqttd.h"
+#include "mqttd_bind.h"
+#include "mqttd_smac.h"
+
+#include "mw_error.h"
+#include "osapi.h"
+#include "osapi_string.h"
+
+/* NAMING CONSTANT DECLARATIONS
+*/
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+*/
+
+/* GLOBAL VARIABLE DECLARATIONS
+*/
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+*/
+static void
+_mqttd_bind_store(
+    void *ptr_member,
+    const UI8_T size,
+    const I32_T value);
+
+static I32_T
+_mqttd_bind_load(
+    const void *ptr_member,
+    const UI8_T size);
+
+static MW_ERROR_NO_T
+_mqttd_bind_field(
+    const MQTTD_BIND_FIELD_T *ptr_field,
+    const cJSON *ptr_item,
+    void *ptr_dst);
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: _mqttd_bind_store
+ * PURPOSE:
+ *      Store a value into a member of 1, 2 or 4 bytes.
+ *
+ * INPUT:
+ *      ptr_member  --  the member
+ *      size        --  the size of the member
+ *      value       --  the value
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The member may not be aligned, it is copied.
+ */
+static void
+_mqttd_bind_store(
+    void *ptr_member,
+    const UI8_T size,
+    const I32_T value)
+{
+    UI8_T   u8 = (UI8_T)value;
+    UI16_T  u16 = (UI16_T)value;
+    UI32_T  u32 = (UI32_T)value;
+
+    switch (size)
+    {
+        case sizeof(UI8_T):
+            osapi_memcpy(ptr_member, &u8, sizeof(u8));
+            break;
+        case sizeof(UI16_T):
+            osapi_memcpy(ptr_member, &u16, sizeof(u16));
+            break;
+        case sizeof(UI32_T):
+            osapi_memcpy(ptr_member, &u32, sizeof(u32));
+            break;
+        default:
+            break;
+    }
+}
+
+/* FUNCTION NAME: _mqttd_bind_load
+ * PURPOSE:
+ *      Load the value of a member of 1, 2 or 4 bytes.
+ *
+ * INPUT:
+ *      ptr_member  --  the member
+ *      size        --  the size of the member
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      The value
+ *
+ * NOTES:
+ *      None
+ */
+static I32_T
+_mqttd_bind_load(
+    const void *ptr_member,
+    const UI8_T size)
+{
+    UI8_T   u8 = 0;
+    UI16_T  u16 = 0;
+    UI32_T  u32 = 0;
+
+    switch (size)
+    {
+        case sizeof(UI8_T):
+            osapi_memcpy(&u8, ptr_member, sizeof(u8));
+            return u8;
+        case sizeof(UI16_T):
+            osapi_memcpy(&u16, ptr_member, sizeof(u16));
+            return u16;
+        case sizeof(UI32_T):
+            osapi_memcpy(&u32, ptr_member, sizeof(u32));
+            return (I32_T)u32;
+        default:
+            return 0;
+    }
+}
+
+/* FUNCTION NAME: _mqttd_bind_field
+ * PURPOSE:
+ *      Check a JSON value and store it into its member.
+ *
+ * INPUT:
+ *      ptr_field   --  the binding
+ *      ptr_item    --  the JSON value
+ *      ptr_dst     --  the structure
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER      --  the value is not valid
+ *      MW_E_ENTRY_NOT_FOUND    --  the value is not in the map, ignored
+ *
+ * NOTES:
+ *      The member is left unchanged when the value is not valid.
+ */
+static MW_ERROR_NO_T
+_mqttd_bind_field(
+    const MQTTD_BIND_FIELD_T *ptr_field,
+    const cJSON *ptr_item,
+    void *ptr_dst)
+{
+    UI8_T   *ptr_member = (UI8_T *)ptr_dst + ptr_field->offset;
+    UI8_T   mac[MQTTD_SMAC_MAC_LEN];
+    I32_T   value = 0;
+    UI8_T   i;
+    const cJSON *ptr_port = NULL;
+
+    switch (ptr_field->type)
+    {
+        case MQTTD_BIND_TYPE_INT:
+            if (!cJSON_IsNumber(ptr_item) ||
+                (ptr_item->valueint < ptr_field->min) || (ptr_item->valueint > ptr_field->max))
+            {
+                return MW_E_BAD_PARAMETER;
+            }
+            _mqttd_bind_store(ptr_member, ptr_field->size, ptr_item->valueint);
+            return MW_E_OK;
+
+        case MQTTD_BIND_TYPE_MAP:
+            if (!cJSON_IsNumber(ptr_item))
+            {
+                return MW_E_BAD_PARAMETER;
+            }
+            for (i = 0; i < ptr_field->map_num; i++)
+            {
+                if (ptr_field->ptr_map[i].json == ptr_item->valueint)
+                {
+                    _mqttd_bind_store(ptr_member, ptr_field->size, ptr_field->ptr_map[i].value);
+                    return MW_E_OK;
+                }
+            }
+            if (0 == ptr_field->max)
+            {
+                return MW_E_ENTRY_NOT_FOUND;
+            }
+            _mqttd_bind_store(ptr_member, ptr_field->size, ptr_field->min);
+            return MW_E_OK;
+
+        case MQTTD_BIND_TYPE_MAC:
+            if (!cJSON_IsString(ptr_item) || (MQTTD_SMAC_MAC_LEN != ptr_field->size) ||
+                (MW_E_OK != mqttd_smac_mac_parse(ptr_item->valuestring, mac)))
+            {
+                return MW_E_BAD_PARAMETER;
+            }
+            osapi_memcpy(ptr_member, mac, MQTTD_SMAC_MAC_LEN);
+            return MW_E_OK;
+
+        case MQTTD_BIND_TYPE_PORTS:
+            if (!cJSON_IsArray(ptr_item))
+            {
+                return MW_E_BAD_PARAMETER;
+            }
+            value = _mqttd_bind_load(ptr_member, ptr_field->size);
+            cJSON_ArrayForEach(ptr_port, ptr_item)
+            {
+                if (!cJSON_IsNumber(ptr_port) ||
+                    (ptr_port->valueint < ptr_field->min) || (ptr_port->valueint > ptr_field->max))
+                {
+                    return MW_E_BAD_PARAMETER;
+                }
+                value |= (I32_T)BIT(ptr_port->valueint);
+            }
+            _mqttd_bind_store(ptr_member, ptr_field->size, value);
+            return MW_E_OK;
+
+        default:
+            return MW_E_OK;
+    }
+}
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: mqttd_bind_parse
+ * PURPOSE:
+ *      Fill a structure from a JSON object in one walk of its keys.
+ *
+ * INPUT:
+ *      ptr_obj     --  the JSON object
+ *      ptr_tbl     --  the binding table
+ *      num         --  the number of bindings, up to MQTTD_BIND_MAX_FIELDS
+ *      ptr_dst     --  the structure, its other members are left unchanged
+ *
+ * OUTPUT:
+ *      pptr_items  --  the JSON value of each binding, NULL if absent,
+ *                      NULL if not needed
+ *      ptr_present --  bit N is set when binding N is stored or is an item
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER  --  some values are not valid, the others are
+ *                              stored
+ *
+ * NOTES:
+ *      The first binding of a key wins, unknown keys are ignored.
+ */
+MW_ERROR_NO_T
+mqttd_bind_parse(
+    const cJSON *ptr_obj,
+    const MQTTD_BIND_FIELD_T *ptr_tbl,
+    const UI8_T num,
+    void *ptr_dst,
+    const cJSON **pptr_items,
+    UI32_T *ptr_present)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    MW_ERROR_NO_T   ret = MW_E_OK;
+    const cJSON     *ptr_item = NULL;
+    UI32_T          present = 0;
+    UI8_T           i;
+
+    MW_CHECK_PTR(ptr_tbl);
+    MW_CHECK_PTR(ptr_dst);
+    MW_CHECK_PTR(ptr_present);
+    if (!cJSON_IsObject(ptr_obj) || (num > MQTTD_BIND_MAX_FIELDS))
+    {
+        return MW_E_BAD_PARAMETER;
+    }
+    if (NULL != pptr_items)
+    {
+        osapi_memset(pptr_items, 0, num * sizeof(*pptr_items));
+    }
+
+    cJSON_ArrayForEach(ptr_item, ptr_obj)
+    {
+        if (NULL == ptr_item->string)
+        {
+            continue;
+        }
+        for (i = 0; i < num; i++)
+        {
+            /* The first character rules out most of the keys */
+            if ((ptr_tbl[i].ptr_key[0] == ptr_item->string[0]) &&
+                (0 == strcmp(ptr_tbl[i].ptr_key, ptr_item->string)))
+            {
+                break;
+            }
+        }
+        if ((i == num) || (present & BIT(i)))
+        {
+            continue;
+        }
+
+        rc = _mqttd_bind_field(&ptr_tbl[i], ptr_item, ptr_dst);
+        if (MW_E_OK == rc)
+        {
+            present |= BIT(i);
+            if (NULL != pptr_items)
+            {
+                pptr_items[i] = ptr_item;
+            }
+        }
+        else if (MW_E_BAD_PARAMETER == rc)
+        {
+            mqttd_debug("bad value of \"%s\"", ptr_tbl[i].ptr_key);
+            ret = rc;
+        }
+    }
+    (*ptr_present) = present;
+    return ret;
+}
+
+/* FUNCTION NAME: mqttd_bind_apply
+ * PURPOSE:
+ *      Copy the present members from one structure to another.
+ *
+ * INPUT:
+ *      ptr_tbl     --  the binding table
+ *      num         --  the number of bindings
+ *      present     --  the present bitmap of mqttd_bind_parse
+ *      ptr_src     --  the structure filled by mqttd_bind_parse
+ *
+ * OUTPUT:
+ *      ptr_dst     --  the structure to update
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      One JSON object parsed once can be applied to the entry of each port.
+ */
+void
+mqttd_bind_apply(
+    const MQTTD_BIND_FIELD_T *ptr_tbl,
+    const UI8_T num,
+    const UI32_T present,
+    const void *ptr_src,
+    void *ptr_dst)
+{
+    UI8_T i;
+
+    for (i = 0; i < num; i++)
+    {
+        if ((present & BIT(i)) && (MQTTD_BIND_TYPE_ITEM != ptr_tbl[i].type))
+        {
+            osapi_memcpy((UI8_T *)ptr_dst + ptr_tbl[i].offset,
+                         (const UI8_T *)ptr_src + ptr_tbl[i].offset, ptr_tbl[i].size);
+        }
+    }
+}
@@ -44,16 +44,22 @@
 #include <string.h>
 #include "mqttd.h"
 #include "mqttd_queue.h"
+#include "mqttd_vlan.h"
+#include "mqttd_smac.h"
+#include "mqttd_rsp.h"
 
 #include "mw_error.h"
 #include "osapi.h"
 #include "osapi_memory.h"
 #include "osapi_message.h"
+#include "osapi_mutex.h"
 #include "osapi_string.h"
 #include "db_api.h"
 
 /* NAMING CONSTANT DECLARATIONS
 */
+#define MQTTD_GET_PENDING_NUM       (8)
+#define MQTTD_GET_MUX_LOCK_TIME     (50)
 
 /* MACRO FUNCTION DECLARATIONS
  */
@@ -62,18 +68,158 @@
 
 /* DATA TYPE DECLARATIONS
 */
+/* One outstanding M_GET on MQTTD_GET_QUEUE_NAME.
+ * The DB message carries no request ID. DB answers a queue in request order
+ * and echoes the T/F/E, so a response completes the oldest get of its T/F/E.
+ */
+typedef struct MQTTD_GET_PENDING_S
+{
+    UI16_T              req_id;     /* 0: free slot, a local handle only */
+    UI16_T              size;       /* the data size of the requested T/F/E */
+    UI32_T              seq;        /* the issue order */
+    DB_REQUEST_TYPE_T   request;
+    DB_MSG_T            *ptr_msg;   /* the response, NULL while still waiting */
+} MQTTD_GET_PENDING_T;
 
 /* GLOBAL VARIABLE DECLARATIONS
 */
 
 /* LOCAL SUBPROGRAM SPECIFICATIONS
 */
+static MW_ERROR_NO_T
+_mqttd_get_queue_request(
+    const UI8_T method,
+    const UI8_T t_idx,
+    const UI8_T f_idx,
+    const UI16_T e_idx,
+    const void *ptr_data,
+    const UI16_T size,
+    DB_MSG_T **pptr_out_msg);
 
 /* STATIC VARIABLE DECLARATIONS
  */
+static MQTTD_GET_PENDING_T _mqttd_get_pending[MQTTD_GET_PENDING_NUM];
+static UI16_T _mqttd_get_req_id = 0;
+static UI32_T _mqttd_get_seq = 0;
+static semaphorehandle_t _ptr_mqttd_get_mutex = NULL;
+static DB_EVENT_LOOP_T _mqttd_loop;
 
 /* LOCAL SUBPROGRAM BODIES
  */
+/* FUNCTION NAME: _mqttd_get_pending_find
+ * PURPOSE:
+ *      Find the pending slot of a request ID.
+ *
+ * INPUT:
+ *      req_id          --  the request ID
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      Pointer to the slot, NULL if the request ID is not pending.
+ *
+ * NOTES:
+ *      Caller must hold _ptr_mqttd_get_mutex.
+ */
+static MQTTD_GET_PENDING_T *
+_mqttd_get_pending_find(
+    const UI16_T req_id)
+{
+    UI8_T idx;
+
+    if (0 == req_id)
+    {
+        return NULL;
+    }
+    for (idx = 0; idx < MQTTD_GET_PENDING_NUM; idx++)
+    {
+        if (req_id == _mqttd_get_pending[idx].req_id)
+        {
+            return &_mqttd_get_pending[idx];
+        }
+    }
+    return NULL;
+}
+
+/* FUNCTION NAME: _mqttd_get_pending_release
+ * PURPOSE:
+ *      Release a pending slot and the response filed in it.
+ *
+ * INPUT:
+ *      ptr_slot        --  pointer to the slot
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Caller must hold _ptr_mqttd_get_mutex.
+ */
+static void
+_mqttd_get_pending_release(
+    MQTTD_GET_PENDING_T *ptr_slot)
+{
+    DB_MSG_FREE(ptr_slot->ptr_msg);
+    ptr_slot->req_id = 0;
+    ptr_slot->size = 0;
+}
+
+/* FUNCTION NAME: _mqttd_get_pending_file
+ * PURPOSE:
+ *      File a response received on MQTTD_GET_QUEUE_NAME to its pending slot.
+ *
+ * INPUT:
+ *      ptr_msg         --  the response message
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Caller must hold _ptr_mqttd_get_mutex.
+ *      The response completes the oldest waiting get of the same T/F/E.
+ *      A late response of a cancelled get may complete a younger get of the
+ *      same T/F/E, which reads the same data. A response nobody waits for is
+ *      freed.
+ */
+static void
+_mqttd_get_pending_file(
+    DB_MSG_T *ptr_msg)
+{
+    MQTTD_GET_PENDING_T *ptr_slot = NULL;
+    MQTTD_GET_PENDING_T *ptr_pend = NULL;
+    DB_PAYLOAD_T        *ptr_payload = (DB_PAYLOAD_T *)&(ptr_msg->ptr_payload);
+    UI8_T               idx;
+
+    for (idx = 0; idx < MQTTD_GET_PENDING_NUM; idx++)
+    {
+        ptr_pend = &_mqttd_get_pending[idx];
+        if ((0 == ptr_pend->req_id) || (NULL != ptr_pend->ptr_msg) ||
+            (ptr_pend->request.t_idx != ptr_payload->request.t_idx) ||
+            (ptr_pend->request.f_idx != ptr_payload->request.f_idx) ||
+            (ptr_pend->request.e_idx != ptr_payload->request.e_idx))
+        {
+            continue;
+        }
+        if ((NULL == ptr_slot) || ((I32_T)(ptr_pend->seq - ptr_slot->seq) < 0))
+        {
+            ptr_slot = ptr_pend;
+        }
+    }
+    if (NULL == ptr_slot)
+    {
+        mqttd_debug_db("drop unexpected response T/F/E=%u/%u/%u",
+            ptr_payload->request.t_idx, ptr_payload->request.f_idx, ptr_payload->request.e_idx);
+        dbapi_freeMsg(ptr_msg);
+        return;
+    }
+    ptr_slot->ptr_msg = ptr_msg;
+}
 
 /* EXPORTED SUBPROGRAM BODIES
  */
@@ -109,7 +255,14 @@ mqttd_queue_init()
     {
         return MW_E_NOT_INITED;
     }
-    
+
+    /* The mqttd task blocks on the DB queue and its own events together */
+    rc = dbapi_eventCreate(MQTTD_QUEUE_NAME, MQTTD_QUEUE_LEN, &_mqttd_loop);
+    if (MW_E_OK != rc)
+    {
+        osapi_msgDelete(MQTTD_QUEUE_NAME);
+        return MW_E_NOT_INITED;
+    }
     return MW_E_OK;
 }
 MW_ERROR_NO_T inline
@@ -126,6 +279,18 @@ mqttd_get_queue_init()
     {
         return MW_E_NOT_INITED;
     }
+
+    /* The completion table is shared by every task issuing gets */
+    osapi_memset(_mqttd_get_pending, 0, sizeof(_mqttd_get_pending));
+    if (NULL == _ptr_mqttd_get_mutex)
+    {
+        rc = osapi_mutexCreate(MQTTD_GET_QUEUE_NAME, &_ptr_mqttd_get_mutex);
+        if (MW_E_OK != rc)
+        {
+            osapi_msgDelete(MQTTD_GET_QUEUE_NAME);
+            return MW_E_NOT_INITED;
+        }
+    }
     return MW_E_OK;
 }
 
@@ -151,6 +316,7 @@ mqttd_queue_free()
     MW_ERROR_NO_T rc = MW_E_OK;
     UI8_T *ptr_msg = NULL;
 
+    dbapi_eventDelete(&_mqttd_loop);
     /* Flush the queue message */
     do
     {
@@ -160,7 +326,7 @@ mqttd_queue_free()
                 MQTTD_QUEUE_TIMEOUT);
         if (MW_E_OK == rc)
         {
-            osapi_free(ptr_msg);
+            dbapi_freeMsg((DB_MSG_T *)ptr_msg);
         }
     }while(MW_E_OK == rc);
     osapi_msgDelete(MQTTD_QUEUE_NAME);
@@ -181,50 +347,77 @@ mqttd_get_queue_free()
                 MQTTD_QUEUE_TIMEOUT);
         if (MW_E_OK == rc)
         {
-            osapi_free(ptr_msg);
+            dbapi_freeMsg((DB_MSG_T *)ptr_msg);
         }
     }while(MW_E_OK == rc);
     osapi_msgDelete(MQTTD_GET_QUEUE_NAME);
+
+    /* Drop the responses nobody collected */
+    if (NULL != _ptr_mqttd_get_mutex)
+    {
+        UI8_T idx;
+
+        for (idx = 0; idx < MQTTD_GET_PENDING_NUM; idx++)
+        {
+            _mqttd_get_pending_release(&_mqttd_get_pending[idx]);
+        }
+        osapi_mutexDelete(_ptr_mqttd_get_mutex);
+        _ptr_mqttd_get_mutex = NULL;
+    }
 }
 
-/* FUNCTION NAME: mqttd_queue_recv
+/* FUNCTION NAME: mqttd_queue_wait
  * PURPOSE:
- *      Receive DB communication message from DB.
+ *      Wait for a DB message or the events posted to the mqttd task.
  *
  * INPUT:
- *      None
+ *      timeout         --  the ticks to wait, DB_EVENT_WAIT_FOREVER to block
  *
  * OUTPUT:
- *      ptr_buf     --  pointer to pointer of receiving buffer
+ *      pptr_msg        --  the received DB message, NULL if none
+ *      ptr_events      --  the posted event bits, DB_EVENT_NONE if none
  *
  * RETURN:
  *      MW_E_OK
  *      MW_E_BAD_PARAMETER
- *      MW_E_ENTRY_NOT_FOUND
+ *      MW_E_NOT_INITED
+ *      MW_E_TIMEOUT
  *
  * NOTES:
- *      This function uses blocking mode to wait the message sent from DB.
+ *      None
  */
 MW_ERROR_NO_T
-mqttd_queue_recv(
-    void **ptr_buf)
+mqttd_queue_wait(
+    const UI32_T timeout,
+    DB_MSG_T **pptr_msg,
+    UI32_T *ptr_events)
 {
-    MW_ERROR_NO_T rc;
-    UI8_T *ptr_msg = NULL;
-
-    rc = dbapi_recvMsg(
-        MQTTD_QUEUE_NAME,
-        &ptr_msg,
-        MQTTD_QUEUE_BLOCKTIMEOUT);
-    if (MW_E_OK != rc)
-    {
-        return rc;
-    }
-
-    //mqttd_debug_db("ptr_msg=%p", ptr_msg);
-    (*ptr_buf) = ptr_msg;
+    return dbapi_eventWait(&_mqttd_loop, timeout, pptr_msg, ptr_events);
+}
 
-    return MW_E_OK;
+/* FUNCTION NAME: mqttd_queue_post
+ * PURPOSE:
+ *      Post events to the mqttd task.
+ *
+ * INPUT:
+ *      events          --  the event bits
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *
+ * NOTES:
+ *      It does not block, so timer and lwIP callbacks may call it.
+ */
+MW_ERROR_NO_T
+mqttd_queue_post(
+    const UI32_T events)
+{
+    return dbapi_eventPost(&_mqttd_loop, events);
 }
 
 MW_ERROR_NO_T
@@ -320,10 +513,7 @@ mqttd_queue_send(
     {
         msg_size = DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + size;
     }
-    rc = osapi_calloc(
-            msg_size,
-            MQTTD_QUEUE_NAME,
-            (void **)&ptr_msg);
+    rc = dbapi_allocMsg(msg_size, &ptr_msg);
     if (MW_E_OK != rc)
     {
         osapi_printf("%s: allocate memory failed(%d)\n", __func__, rc);
@@ -355,8 +545,33 @@ mqttd_queue_send(
     return MW_E_OK;
 }
 
-MW_ERROR_NO_T
-mqttd_get_queue_send(
+/* FUNCTION NAME: _mqttd_get_queue_request
+ * PURPOSE:
+ *      package message and send it to DB, the response comes back on
+ *      MQTTD_GET_QUEUE_NAME.
+ *
+ * INPUT:
+ *      method          --  the method bitmap
+ *      t_idx           --  the enum of the table
+ *      f_idx           --  the enum of the field
+ *      e_idx           --  the entry index in the table
+ *      ptr_data        --  pointer to message data
+ *      size            --  size of ptr_data
+ *
+ * OUTPUT:
+ *      pptr_out_msg    -- double pointer to db message
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_OP_INCOMPLETE
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      None
+ */
+static MW_ERROR_NO_T
+_mqttd_get_queue_request(
     const UI8_T method,
     const UI8_T t_idx,
     const UI8_T f_idx,
@@ -401,10 +616,7 @@ mqttd_get_queue_send(
     {
         msg_size = DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + size;
     }
-    rc = osapi_calloc(
-            msg_size,
-            MQTTD_GET_QUEUE_NAME,
-            (void **)&ptr_msg);
+    rc = dbapi_allocMsg(msg_size, &ptr_msg);
     if (MW_E_OK != rc)
     {
         osapi_printf("%s: allocate memory failed(%d)\n", __func__, rc);
@@ -436,6 +648,19 @@ mqttd_get_queue_send(
     return MW_E_OK;
 }
 
+MW_ERROR_NO_T
+mqttd_get_queue_send(
+    const UI8_T method,
+    const UI8_T t_idx,
+    const UI8_T f_idx,
+    const UI16_T e_idx,
+    const void *ptr_data,
+    const UI16_T size,
+    DB_MSG_T **pptr_out_msg)
+{
+    return _mqttd_get_queue_request(method, t_idx, f_idx, e_idx, ptr_data, size, pptr_out_msg);
+}
+
 /* FUNCTION NAME: mqttd_queue_setData
  * PURPOSE:
  *      package message and call sending function to DB directly.
@@ -477,50 +702,53 @@ mqttd_queue_setData(
     if (MW_E_OK != rc)
     {
         osapi_printf("%s: mqttd_queue_send failed(%d)\n", __func__, rc);
+        return rc;
     }
+    /* Do not wait for the notification to invalidate our own indexes */
+    mqttd_vlan_idx_notify(t_idx);
+    mqttd_smac_idx_notify(t_idx);
+    mqttd_rsp_notify(t_idx);
     return rc;
 }
 
-/* FUNCTION NAME: mqttd_queue_getData
+/* FUNCTION NAME: mqttd_queue_getDataReq
  * PURPOSE:
- *      1. Calculate db data size based on tid,fid,eid and then alloc memory
- *      2. Send db queue and wait db response
+ *      1. Calculate db data size based on tid,fid,eid
+ *      2. Register a pending slot and send the M_GET
  *
  * INPUT:
- *      t_idx           --  the enum of the table
- *      f_idx           --  the enum of the field
- *      e_idx           --  the entry index in the table
+ *      in_t_idx        --  the enum of the table
+ *      in_f_idx        --  the enum of the field
+ *      in_e_idx        --  the entry index in the table
  *
  * OUTPUT:
- *      pptr_out_msg    --  double pointer to db message
- *      ptr_out_size    --  pointer to size of ptr_data
- *      pptr_out_data   --  double pointer to db data in db payload
+ *      ptr_req_id      --  pointer to the request ID to collect the response
  *
  * RETURN:
  *      MW_E_OK
- *      MW_E_ENTRY_NOT_FOUND
- *      MW_E_TIMEOUT
- *      MW_E_OP_INCOMPLETE
+ *      MW_E_NOT_INITED
+ *      MW_E_TABLE_FULL
+ *      MW_E_BAD_PARAMETER
  *      MW_E_NO_MEMORY
- *      MW_E_OTHERS
  *
  * NOTES:
- *      When return MW_E_OK, caller need to free the memory which pointed by ptr_out_msg!
- *      This function should only be called before the MQTTD Running State
+ *      It does not wait for the response, so several gets can be issued back
+ *      to back. Every request ID must be collected by mqttd_queue_getDataWait
+ *      or dropped by mqttd_queue_getDataCancel.
  */
 MW_ERROR_NO_T
-mqttd_queue_getData(
+mqttd_queue_getDataReq(
     const UI8_T in_t_idx,
     const UI8_T in_f_idx,
     const UI16_T in_e_idx,
-    DB_MSG_T **pptr_out_msg,
-    UI16_T *ptr_out_size,
-    void **pptr_out_data)
+    UI16_T *ptr_req_id)
 {
-    MW_ERROR_NO_T   rc = MW_E_OK;
-    DB_MSG_T        *ptr_msg = NULL;
-    UI16_T           total_size = 0;
-    DB_PAYLOAD_T    *ptr_pload = NULL;
+    MW_ERROR_NO_T       rc = MW_E_OK;
+    DB_MSG_T            *ptr_msg = NULL;
+    MQTTD_GET_PENDING_T *ptr_slot = NULL;
+    UI16_T              total_size = 0;
+    UI16_T              req_id = 0;
+    UI8_T               idx;
 
     DB_REQUEST_TYPE_T request = {
         .t_idx = in_t_idx,
@@ -528,6 +756,12 @@ mqttd_queue_getData(
         .e_idx = in_e_idx
     };
 
+    MW_CHECK_PTR(ptr_req_id);
+    if (NULL == _ptr_mqttd_get_mutex)
+    {
+        return MW_E_NOT_INITED;
+    }
+
     rc = dbapi_getDataSize(request, &total_size);
     if (MW_E_OK != rc)
     {
@@ -535,34 +769,236 @@ mqttd_queue_getData(
        return rc;
     }
 
-    rc = mqttd_get_queue_send(M_GET, in_t_idx, in_f_idx, in_e_idx, NULL, total_size, &ptr_msg);
+    /* Register before sending, the response may be filed by another waiter */
+    rc = osapi_mutexTake(_ptr_mqttd_get_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
     if (MW_E_OK != rc)
     {
-       mqttd_debug_db("mqttd_queue_send failed(%d)\n", rc);
-       return rc;
+        return rc;
     }
-	//osapi_printf("mqttd_queue_send: %p\n", ptr_msg);
-    /* wait for DB response messgae */
-    rc = mqttd_get_queue_recv((void **)&ptr_msg);
-    if(MW_E_OK == rc)
+    for (idx = 0; idx < MQTTD_GET_PENDING_NUM; idx++)
     {
-        //mqttd_debug_db("mqttd_queue_recv success \n");
+        if (0 == _mqttd_get_pending[idx].req_id)
+        {
+            ptr_slot = &_mqttd_get_pending[idx];
+            break;
+        }
     }
-    else
+    if (NULL == ptr_slot)
     {
-        mqttd_debug_db("mqttd_queue_recv failed(%d) \n", rc);
-        osapi_free(ptr_msg);
+        osapi_mutexGive(_ptr_mqttd_get_mutex);
+        mqttd_debug_db("no free pending slot\n");
+        return MW_E_TABLE_FULL;
+    }
+    do
+    {
+        _mqttd_get_req_id++;
+    } while ((0 == _mqttd_get_req_id) || (NULL != _mqttd_get_pending_find(_mqttd_get_req_id)));
+    req_id = _mqttd_get_req_id;
+    ptr_slot->req_id = req_id;
+    ptr_slot->size = total_size;
+    ptr_slot->seq = _mqttd_get_seq++;
+    ptr_slot->request = request;
+    ptr_slot->ptr_msg = NULL;
+    osapi_mutexGive(_ptr_mqttd_get_mutex);
+
+    rc = _mqttd_get_queue_request(M_GET, in_t_idx, in_f_idx, in_e_idx, NULL, total_size, &ptr_msg);
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug_db("_mqttd_get_queue_request failed(%d)\n", rc);
+        mqttd_queue_getDataCancel(req_id);
         return rc;
     }
 
+    (*ptr_req_id) = req_id;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_queue_getDataWait
+ * PURPOSE:
+ *      Wait for the DB response of a request issued by mqttd_queue_getDataReq.
+ *
+ * INPUT:
+ *      req_id          --  the request ID
+ *
+ * OUTPUT:
+ *      pptr_out_msg    --  double pointer to db message
+ *      ptr_out_size    --  pointer to size of ptr_data
+ *      pptr_out_data   --  double pointer to db data in db payload
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NOT_INITED
+ *      MW_E_ENTRY_NOT_FOUND
+ *      MW_E_TIMEOUT
+ *
+ * NOTES:
+ *      When return MW_E_OK, caller need to free the memory which pointed by ptr_out_msg!
+ *      Every waiter receives from MQTTD_GET_QUEUE_NAME and files what it gets
+ *      by T/F/E in issue order, so responses may be collected in any order.
+ *      The request ID is released on return, also when it timed out.
+ */
+MW_ERROR_NO_T
+mqttd_queue_getDataWait(
+    const UI16_T req_id,
+    DB_MSG_T **pptr_out_msg,
+    UI16_T *ptr_out_size,
+    void **pptr_out_data)
+{
+    MW_ERROR_NO_T       rc = MW_E_OK;
+    MQTTD_GET_PENDING_T *ptr_slot = NULL;
+    DB_MSG_T            *ptr_msg = NULL;
+    DB_PAYLOAD_T        *ptr_pload = NULL;
+    UI8_T               *ptr_buf = NULL;
+    UI16_T              total_size = 0;
+    UI16_T              retry = 0;
+
+    MW_CHECK_PTR(pptr_out_msg);
+    MW_CHECK_PTR(ptr_out_size);
+    MW_CHECK_PTR(pptr_out_data);
+    if (NULL == _ptr_mqttd_get_mutex)
+    {
+        return MW_E_NOT_INITED;
+    }
+
+    while (NULL == ptr_msg)
+    {
+        if (MW_E_OK == osapi_mutexTake(_ptr_mqttd_get_mutex, MQTTD_GET_MUX_LOCK_TIME))
+        {
+            ptr_slot = _mqttd_get_pending_find(req_id);
+            if (NULL == ptr_slot)
+            {
+                osapi_mutexGive(_ptr_mqttd_get_mutex);
+                return MW_E_ENTRY_NOT_FOUND;
+            }
+            if (NULL != ptr_slot->ptr_msg)
+            {
+                /* Take over the response before releasing the slot */
+                ptr_msg = ptr_slot->ptr_msg;
+                total_size = ptr_slot->size;
+                ptr_slot->ptr_msg = NULL;
+                _mqttd_get_pending_release(ptr_slot);
+                osapi_mutexGive(_ptr_mqttd_get_mutex);
+                break;
+            }
+            if (retry >= MQTTD_GET_QUEUE_RETRY)
+            {
+                _mqttd_get_pending_release(ptr_slot);
+                osapi_mutexGive(_ptr_mqttd_get_mutex);
+                mqttd_debug_db("req_id=%u timeout\n", req_id);
+                return MW_E_TIMEOUT;
+            }
+            osapi_mutexGive(_ptr_mqttd_get_mutex);
+        }
+        retry++;
+
+        rc = dbapi_recvMsg(
+            MQTTD_GET_QUEUE_NAME,
+            &ptr_buf,
+            MQTTD_QUEUE_TIMEOUT);
+        if (MW_E_OK == rc)
+        {
+            osapi_mutexTake(_ptr_mqttd_get_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
+            _mqttd_get_pending_file((DB_MSG_T *)ptr_buf);
+            osapi_mutexGive(_ptr_mqttd_get_mutex);
+            ptr_buf = NULL;
+        }
+    }
+
     (*pptr_out_msg) = ptr_msg;
     (*ptr_out_size) = total_size;
 
     ptr_pload = (DB_PAYLOAD_T *)&(ptr_msg->ptr_payload);
     (*pptr_out_data) = &(ptr_pload->ptr_data);
 
-    //mqttd_debug_db("*pptr_out_msg = %p, *pptr_out_data = %p \n", *pptr_out_msg, *pptr_out_data);
-
     return MW_E_OK;
 }
 
+/* FUNCTION NAME: mqttd_queue_getDataCancel
+ * PURPOSE:
+ *      Drop a request issued by mqttd_queue_getDataReq.
+ *
+ * INPUT:
+ *      req_id          --  the request ID
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      A response arriving later completes a younger get of the same T/F/E,
+ *      or is freed by the waiter which receives it.
+ */
+void
+mqttd_queue_getDataCancel(
+    const UI16_T req_id)
+{
+    MQTTD_GET_PENDING_T *ptr_slot = NULL;
+
+    if (NULL == _ptr_mqttd_get_mutex)
+    {
+        return;
+    }
+    osapi_mutexTake(_ptr_mqttd_get_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
+    ptr_slot = _mqttd_get_pending_find(req_id);
+    if (NULL != ptr_slot)
+    {
+        _mqttd_get_pending_release(ptr_slot);
+    }
+    osapi_mutexGive(_ptr_mqttd_get_mutex);
+}
+
+/* FUNCTION NAME: mqttd_queue_getData
+ * PURPOSE:
+ *      1. Calculate db data size based on tid,fid,eid and then alloc memory
+ *      2. Send db queue and wait db response
+ *
+ * INPUT:
+ *      t_idx           --  the enum of the table
+ *      f_idx           --  the enum of the field
+ *      e_idx           --  the entry index in the table
+ *
+ * OUTPUT:
+ *      pptr_out_msg    --  double pointer to db message
+ *      ptr_out_size    --  pointer to size of ptr_data
+ *      pptr_out_data   --  double pointer to db data in db payload
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_ENTRY_NOT_FOUND
+ *      MW_E_TIMEOUT
+ *      MW_E_OP_INCOMPLETE
+ *      MW_E_NO_MEMORY
+ *      MW_E_OTHERS
+ *
+ * NOTES:
+ *      When return MW_E_OK, caller need to free the memory which pointed by ptr_out_msg!
+ *      This function should only be called before the MQTTD Running State
+ *      It is mqttd_queue_getDataReq followed by mqttd_queue_getDataWait.
+ */
+MW_ERROR_NO_T
+mqttd_queue_getData(
+    const UI8_T in_t_idx,
+    const UI8_T in_f_idx,
+    const UI16_T in_e_idx,
+    DB_MSG_T **pptr_out_msg,
+    UI16_T *ptr_out_size,
+    void **pptr_out_data)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    UI16_T          req_id = 0;
+
+    rc = mqttd_queue_getDataReq(in_t_idx, in_f_idx, in_e_idx, &req_id);
+    if (MW_E_OK != rc)
+    {
+       return rc;
+    }
+
+    rc = mqttd_queue_getDataWait(req_id, pptr_out_msg, ptr_out_size, pptr_out_data);
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug_db("mqttd_queue_getDataWait failed(%d) \n", rc);
+    }
+    return rc;
+}
@@ -0,0 +1,326 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_rsp.c
+ * PURPOSE:
+ *  Implement the response section cache of mqttd daemon.
+ *
+ * NOTES:
+ *  Sections that only change with one DB table, or never, are printed once
+ *  and kept as JSON text. A response adds the text as a raw item, so only
+ *  the per-request members like msg_id are built and printed again. Like
+ *  the indexes, DB notifications only bump the generation of the section
+ *  and the next response rebuilds it.
+ */
+
+#include <string.h>
+#include "mqttd.h"
+#include "mqttd_queue.h"
+#include "mqttd_rsp.h"
+
+#include "mw_error.h"
+#include "osapi.h"
+#include "osapi_mutex.h"
+#include "osapi_string.h"
+#include "db_api.h"
+#include "db_data.h"
+
+/* NAMING CONSTANT DECLARATIONS
+*/
+#define MQTTD_RSP_NAME              "mqr"
+#define MQTTD_RSP_NO_TABLE          (0xFF)  /* the section never changes */
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+*/
+typedef struct MQTTD_RSP_ENTRY_S
+{
+    UI32_T          generation;     /* The generation the text is built at */
+    C8_T            *ptr_json;      /* The printed section, NULL if not built */
+} MQTTD_RSP_ENTRY_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+*/
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+*/
+static MW_ERROR_NO_T
+_mqttd_rsp_build(
+    const MQTTD_RSP_ID_T id,
+    MQTTD_RSP_BUILD_FUNC_T build,
+    void *ptr_cookie);
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+/* The DB table each section is built from */
+static const UI8_T _mqttd_rsp_table[MQTTD_RSP_LAST] = {
+    MQTTD_RSP_NO_TABLE,             /* MQTTD_RSP_CAPABILITY */
+    MQTTD_RSP_NO_TABLE,             /* MQTTD_RSP_REMOTE_PROTOCOLS */
+    SYS_INFO,                       /* MQTTD_RSP_DEVICE */
+};
+
+static MQTTD_RSP_ENTRY_T _mqttd_rsp[MQTTD_RSP_LAST];
+/* Bumped by DB notifications, the entry is stale when it differs */
+static volatile UI32_T _mqttd_rsp_gen[MQTTD_RSP_LAST];
+static semaphorehandle_t _ptr_mqttd_rsp_mutex = NULL;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: _mqttd_rsp_build
+ * PURPOSE:
+ *      Build and print a section into its cache entry.
+ *
+ * INPUT:
+ *      id          --  the section
+ *      build       --  the builder of the section
+ *      ptr_cookie  --  passed to the builder
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      Others returned by the builder
+ *
+ * NOTES:
+ *      The caller holds the mutex. The generation is read before the build,
+ *      so a change during it leaves the entry stale.
+ */
+static MW_ERROR_NO_T
+_mqttd_rsp_build(
+    const MQTTD_RSP_ID_T id,
+    MQTTD_RSP_BUILD_FUNC_T build,
+    void *ptr_cookie)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    UI32_T          generation = _mqttd_rsp_gen[id];
+    cJSON           *ptr_item = NULL;
+    C8_T            *ptr_json = NULL;
+
+    rc = build(ptr_cookie, &ptr_item);
+    if (MW_E_OK != rc)
+    {
+        if (NULL != ptr_item)
+        {
+            cJSON_Delete(ptr_item);
+        }
+        return rc;
+    }
+    ptr_json = cJSON_PrintUnformatted(ptr_item);
+    cJSON_Delete(ptr_item);
+    if (NULL == ptr_json)
+    {
+        return MW_E_NO_MEMORY;
+    }
+
+    if (NULL != _mqttd_rsp[id].ptr_json)
+    {
+        mqtt_free(_mqttd_rsp[id].ptr_json);
+    }
+    _mqttd_rsp[id].ptr_json = ptr_json;
+    _mqttd_rsp[id].generation = generation;
+    return MW_E_OK;
+}
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: mqttd_rsp_init
+ * PURPOSE:
+ *      Initialize the response section cache.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NOT_INITED
+ *
+ * NOTES:
+ *      The sections are built by the first response.
+ */
+MW_ERROR_NO_T
+mqttd_rsp_init(
+    void)
+{
+    if (NULL == _ptr_mqttd_rsp_mutex)
+    {
+        if (MW_E_OK != osapi_mutexCreate(MQTTD_RSP_NAME, &_ptr_mqttd_rsp_mutex))
+        {
+            return MW_E_NOT_INITED;
+        }
+    }
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_rsp_notify
+ * PURPOSE:
+ *      Mark the sections built from a table stale.
+ *
+ * INPUT:
+ *      t_idx       --  the enum of the changed table
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called for DB notifications and for the updates mqttd sends itself.
+ */
+void
+mqttd_rsp_notify(
+    const UI8_T t_idx)
+{
+    UI8_T id;
+
+    for (id = 0; id < MQTTD_RSP_LAST; id++)
+    {
+        if (t_idx == _mqttd_rsp_table[id])
+        {
+            _mqttd_rsp_gen[id]++;
+        }
+    }
+}
+
+/* FUNCTION NAME: mqttd_rsp_add
+ * PURPOSE:
+ *      Add a cached section to a JSON object, build it first if it is stale.
+ *
+ * INPUT:
+ *      id          --  the section
+ *      ptr_obj     --  the JSON object to add to
+ *      ptr_name    --  the key of the section
+ *      build       --  the builder of the section
+ *      ptr_cookie  --  passed to the builder
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *      MW_E_NO_MEMORY
+ *      Others returned by the builder
+ *
+ * NOTES:
+ *      The section is added as a raw item holding a copy of the text. The
+ *      builder may block on DB, see mqttd_queue_getData.
+ */
+MW_ERROR_NO_T
+mqttd_rsp_add(
+    const MQTTD_RSP_ID_T id,
+    cJSON *ptr_obj,
+    const C8_T *ptr_name,
+    MQTTD_RSP_BUILD_FUNC_T build,
+    void *ptr_cookie)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+
+    MW_CHECK_PTR(ptr_obj);
+    MW_CHECK_PTR(ptr_name);
+    MW_CHECK_PTR(build);
+    if (id >= MQTTD_RSP_LAST)
+    {
+        return MW_E_BAD_PARAMETER;
+    }
+    if (NULL == _ptr_mqttd_rsp_mutex)
+    {
+        return MW_E_NOT_INITED;
+    }
+
+    osapi_mutexTake(_ptr_mqttd_rsp_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
+    if ((NULL == _mqttd_rsp[id].ptr_json) || (_mqttd_rsp[id].generation != _mqttd_rsp_gen[id]))
+    {
+        rc = _mqttd_rsp_build(id, build, ptr_cookie);
+        if (MW_E_OK != rc)
+        {
+            osapi_mutexGive(_ptr_mqttd_rsp_mutex);
+            mqttd_debug("build response section %u failed(%d)\n", id, rc);
+            return rc;
+        }
+    }
+    if (NULL == cJSON_AddRawToObject(ptr_obj, ptr_name, _mqttd_rsp[id].ptr_json))
+    {
+        rc = MW_E_NO_MEMORY;
+    }
+    osapi_mutexGive(_ptr_mqttd_rsp_mutex);
+    return rc;
+}
+
+/* FUNCTION NAME: mqttd_rsp_deinit
+ * PURPOSE:
+ *      Free the cached sections.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The mutex is kept for the next mqttd_rsp_init.
+ */
+void
+mqttd_rsp_deinit(
+    void)
+{
+    UI8_T id;
+
+    if (NULL == _ptr_mqttd_rsp_mutex)
+    {
+        return;
+    }
+    osapi_mutexTake(_ptr_mqttd_rsp_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
+    for (id = 0; id < MQTTD_RSP_LAST; id++)
+    {
+        if (NULL != _mqttd_rsp[id].ptr_json)
+        {
+            mqtt_free(_mqttd_rsp[id].ptr_json);
+            _mqttd_rsp[id].ptr_json = NULL;
+        }
+    }
+    osapi_mutexGive(_ptr_mqttd_rsp_mutex);
+}
@@ -0,0 +1,697 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_smac.c
+ * PURPOSE:
+ *  Implement the static MAC index of mqttd daemon.
+ *
+ * NOTES:
+ *  The index finds the slot of a (MAC, VID) without walking STATIC_MAC_ENTRY,
+ *  so setConfig writes only the entries it changes. Like the VLAN index, DB
+ *  notifications bump the generation and the next reader refreshes it. The
+ *  writes of the index itself and their notifications keep it current.
+ */
+
+#include <string.h>
+#include "mqttd.h"
+#include "mqttd_queue.h"
+#include "mqttd_smac.h"
+
+#include "mw_error.h"
+#include "osapi.h"
+#include "osapi_mutex.h"
+#include "osapi_string.h"
+#include "db_api.h"
+#include "db_data.h"
+
+/* NAMING CONSTANT DECLARATIONS
+*/
+#define MQTTD_SMAC_IDX_NAME         "mqs"
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+*/
+
+/* GLOBAL VARIABLE DECLARATIONS
+*/
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+*/
+static UI16_T
+_mqttd_smac_hash(
+    const UI8_T *ptr_mac,
+    const UI16_T vid);
+
+static void
+_mqttd_smac_idx_link(
+    MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI16_T slot);
+
+static MW_ERROR_NO_T
+_mqttd_smac_idx_refresh(
+    void);
+
+static UI16_T
+_mqttd_smac_idx_pack(
+    const MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI16_T slot,
+    UI8_T *ptr_entry);
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+static MQTTD_SMAC_IDX_T _mqttd_smac_idx;
+static BOOL_T _mqttd_smac_idx_valid = FALSE;
+/* Bumped on every change of STATIC_MAC_ENTRY, read without lock */
+static volatile UI32_T _mqttd_smac_idx_gen = 0;
+static semaphorehandle_t _ptr_mqttd_smac_mutex = NULL;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: _mqttd_smac_hash
+ * PURPOSE:
+ *      Get the bucket of a (MAC, VID).
+ *
+ * INPUT:
+ *      ptr_mac     --  the MAC address
+ *      vid         --  the VLAN ID
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      The bucket
+ *
+ * NOTES:
+ *      The low bytes of the MAC vary most, they are mixed in last.
+ */
+static UI16_T
+_mqttd_smac_hash(
+    const UI8_T *ptr_mac,
+    const UI16_T vid)
+{
+    UI32_T  hash = vid;
+    UI8_T   i;
+
+    for (i = 0; i < MQTTD_SMAC_MAC_LEN; i++)
+    {
+        hash = (hash * 31) + ptr_mac[i];
+    }
+    hash ^= (hash >> 8);
+    return (UI16_T)(hash & (MQTTD_SMAC_HASH_SIZE - 1));
+}
+
+/* FUNCTION NAME: _mqttd_smac_idx_link
+ * PURPOSE:
+ *      Put a used slot in the bucket of its (MAC, VID).
+ *
+ * INPUT:
+ *      ptr_idx     --  the index
+ *      slot        --  the slot
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ */
+static void
+_mqttd_smac_idx_link(
+    MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI16_T slot)
+{
+    UI16_T bucket = _mqttd_smac_hash(ptr_idx->tbl.mac_addr[slot], ptr_idx->tbl.vid[slot]);
+
+    ptr_idx->next[slot] = ptr_idx->head[bucket];
+    ptr_idx->head[bucket] = slot;
+    ptr_idx->used++;
+}
+
+/* FUNCTION NAME: _mqttd_smac_idx_refresh
+ * PURPOSE:
+ *      Get STATIC_MAC_ENTRY from DB and rebuild the index.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      MW_E_TIMEOUT
+ *      MW_E_OTHERS
+ *
+ * NOTES:
+ *      Called with the index locked. If the table changes meanwhile, the
+ *      index is built but stays stale.
+ */
+static MW_ERROR_NO_T
+_mqttd_smac_idx_refresh(
+    void)
+{
+    MQTTD_SMAC_IDX_T *ptr_idx = &_mqttd_smac_idx;
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    UI32_T          generation = _mqttd_smac_idx_gen;
+    DB_MSG_T        *ptr_msg = NULL;
+    void            *ptr_data = NULL;
+    UI16_T          size = 0;
+    UI16_T          slot;
+
+    rc = mqttd_queue_getData(STATIC_MAC_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES, &ptr_msg, &size, &ptr_data);
+    if (MW_E_OK != rc)
+    {
+        mqttd_debug("refresh static mac index failed(%d)", rc);
+        return rc;
+    }
+    osapi_memcpy(&(ptr_idx->tbl), ptr_data, sizeof(DB_STATIC_MAC_ENTRY_T));
+    DB_MSG_FREE(ptr_msg);
+
+    osapi_memset(ptr_idx->head, 0xFF, sizeof(ptr_idx->head));
+    ptr_idx->used = 0;
+    ptr_idx->free_head = MQTTD_SMAC_SLOT_NONE;
+    /* Backwards, so the free list hands out the lowest slot first */
+    for (slot = MAX_STATIC_MAC_NUM; slot > 0; slot--)
+    {
+        if (0 != ptr_idx->tbl.port[slot - 1])
+        {
+            _mqttd_smac_idx_link(ptr_idx, slot - 1);
+        }
+        else
+        {
+            ptr_idx->next[slot - 1] = ptr_idx->free_head;
+            ptr_idx->free_head = slot - 1;
+        }
+    }
+    ptr_idx->generation = generation;
+    _mqttd_smac_idx_valid = TRUE;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _mqttd_smac_idx_pack
+ * PURPOSE:
+ *      Get one slot of the index as DB takes and returns the entry.
+ *
+ * INPUT:
+ *      ptr_idx     --  the index
+ *      slot        --  the slot
+ *
+ * OUTPUT:
+ *      ptr_entry   --  MQTTD_SMAC_ENTRY_SIZE bytes of mac_addr, vid and port
+ *
+ * RETURN:
+ *      MQTTD_SMAC_ENTRY_SIZE
+ *
+ * NOTES:
+ *      None
+ */
+static UI16_T
+_mqttd_smac_idx_pack(
+    const MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI16_T slot,
+    UI8_T *ptr_entry)
+{
+    osapi_memcpy(&ptr_entry[0], &(ptr_idx->tbl.mac_addr[slot]), MQTTD_SMAC_FIELD_SIZE(mac_addr));
+    osapi_memcpy(&ptr_entry[MQTTD_SMAC_ENTRY_OFFSET_VID], &(ptr_idx->tbl.vid[slot]), MQTTD_SMAC_FIELD_SIZE(vid));
+    osapi_memcpy(&ptr_entry[MQTTD_SMAC_ENTRY_OFFSET_PORT], &(ptr_idx->tbl.port[slot]), MQTTD_SMAC_FIELD_SIZE(port));
+    return MQTTD_SMAC_ENTRY_SIZE;
+}
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: mqttd_smac_idx_init
+ * PURPOSE:
+ *      Initialize the static MAC index.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NOT_INITED
+ *
+ * NOTES:
+ *      The index starts stale and is built by the first reader.
+ */
+MW_ERROR_NO_T
+mqttd_smac_idx_init(
+    void)
+{
+    if (NULL == _ptr_mqttd_smac_mutex)
+    {
+        if (MW_E_OK != osapi_mutexCreate(MQTTD_SMAC_IDX_NAME, &_ptr_mqttd_smac_mutex))
+        {
+            return MW_E_NOT_INITED;
+        }
+    }
+    _mqttd_smac_idx_gen++;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_notify
+ * PURPOSE:
+ *      Mark the static MAC index stale when STATIC_MAC_ENTRY changes.
+ *
+ * INPUT:
+ *      t_idx       --  the enum of the changed table
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called for DB notifications and for the updates mqttd sends itself.
+ */
+void
+mqttd_smac_idx_notify(
+    const UI8_T t_idx)
+{
+    if (STATIC_MAC_ENTRY == t_idx)
+    {
+        _mqttd_smac_idx_gen++;
+    }
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_notify_data
+ * PURPOSE:
+ *      Mark the static MAC index stale for a DB notification unless the
+ *      index already holds the notified entry.
+ *
+ * INPUT:
+ *      ptr_req     --  the T/F/E of the notification
+ *      ptr_data    --  the notified data
+ *      size        --  the size of ptr_data
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The notification of an entry mqttd_smac_idx_commit wrote matches the
+ *      index, so it costs no refresh. Anything else is handled like
+ *      mqttd_smac_idx_notify. The index is not waited for.
+ */
+void
+mqttd_smac_idx_notify_data(
+    const DB_REQUEST_TYPE_T *ptr_req,
+    const void *ptr_data,
+    const UI16_T size)
+{
+    UI8_T   entry[MQTTD_SMAC_ENTRY_SIZE];
+    UI16_T  slot;
+    BOOL_T  match = FALSE;
+
+    if (STATIC_MAC_ENTRY != ptr_req->t_idx)
+    {
+        return;
+    }
+    if ((DB_ALL_FIELDS == ptr_req->f_idx) && (MQTTD_SMAC_ENTRY_SIZE == size) && (NULL != ptr_data) &&
+        (0 != ptr_req->e_idx) && (ptr_req->e_idx <= MAX_STATIC_MAC_NUM) &&
+        (NULL != _ptr_mqttd_smac_mutex) && (MW_E_OK == osapi_mutexTake(_ptr_mqttd_smac_mutex, 0)))
+    {
+        slot = ptr_req->e_idx - 1;
+        if ((TRUE == _mqttd_smac_idx_valid) && (_mqttd_smac_idx.generation == _mqttd_smac_idx_gen))
+        {
+            (void)_mqttd_smac_idx_pack(&_mqttd_smac_idx, slot, entry);
+            match = (0 == memcmp(entry, ptr_data, MQTTD_SMAC_ENTRY_SIZE)) ? TRUE : FALSE;
+        }
+        osapi_mutexGive(_ptr_mqttd_smac_mutex);
+    }
+    if (TRUE != match)
+    {
+        _mqttd_smac_idx_gen++;
+    }
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_get
+ * PURPOSE:
+ *      Lock the static MAC index, refresh it from DB first if it is stale.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      pptr_idx    --  double pointer to the index
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NOT_INITED
+ *      MW_E_TIMEOUT
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      When return MW_E_OK, caller must call mqttd_smac_idx_release.
+ *      It may block on DB, see mqttd_queue_getData.
+ */
+MW_ERROR_NO_T
+mqttd_smac_idx_get(
+    MQTTD_SMAC_IDX_T **pptr_idx)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+
+    MW_CHECK_PTR(pptr_idx);
+    if (NULL == _ptr_mqttd_smac_mutex)
+    {
+        return MW_E_NOT_INITED;
+    }
+
+    osapi_mutexTake(_ptr_mqttd_smac_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
+    if ((TRUE != _mqttd_smac_idx_valid) || (_mqttd_smac_idx.generation != _mqttd_smac_idx_gen))
+    {
+        rc = _mqttd_smac_idx_refresh();
+        if (MW_E_OK != rc)
+        {
+            osapi_mutexGive(_ptr_mqttd_smac_mutex);
+            return rc;
+        }
+    }
+    (*pptr_idx) = &_mqttd_smac_idx;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_release
+ * PURPOSE:
+ *      Unlock the static MAC index.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ */
+void
+mqttd_smac_idx_release(
+    void)
+{
+    osapi_mutexGive(_ptr_mqttd_smac_mutex);
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_find
+ * PURPOSE:
+ *      Find the slot of a (MAC, VID).
+ *
+ * INPUT:
+ *      ptr_idx     --  the index got by mqttd_smac_idx_get
+ *      ptr_mac     --  the MAC address
+ *      vid         --  the VLAN ID
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      The slot
+ *      MQTTD_SMAC_SLOT_NONE    --  the (MAC, VID) is not in the table
+ *
+ * NOTES:
+ *      None
+ */
+UI16_T
+mqttd_smac_idx_find(
+    const MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI8_T *ptr_mac,
+    const UI16_T vid)
+{
+    UI16_T slot;
+
+    for (slot = ptr_idx->head[_mqttd_smac_hash(ptr_mac, vid)];
+         MQTTD_SMAC_SLOT_NONE != slot;
+         slot = ptr_idx->next[slot])
+    {
+        if ((vid == ptr_idx->tbl.vid[slot]) &&
+            (0 == memcmp(ptr_mac, ptr_idx->tbl.mac_addr[slot], MQTTD_SMAC_MAC_LEN)))
+        {
+            return slot;
+        }
+    }
+    return MQTTD_SMAC_SLOT_NONE;
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_add
+ * PURPOSE:
+ *      Put a new (MAC, VID) in the lowest free slot.
+ *
+ * INPUT:
+ *      ptr_idx     --  the index got by mqttd_smac_idx_get
+ *      ptr_mac     --  the MAC address
+ *      vid         --  the VLAN ID, MQTTD_SMAC_VID_MIN to MQTTD_SMAC_VID_MAX
+ *      port        --  the port, not 0
+ *
+ * OUTPUT:
+ *      ptr_slot    --  the slot taken
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_TABLE_FULL
+ *
+ * NOTES:
+ *      Only the index is changed, see mqttd_smac_idx_commit.
+ */
+MW_ERROR_NO_T
+mqttd_smac_idx_add(
+    MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI8_T *ptr_mac,
+    const UI16_T vid,
+    const UI8_T port,
+    UI16_T *ptr_slot)
+{
+    UI16_T slot;
+
+    MW_CHECK_PTR(ptr_idx);
+    MW_CHECK_PTR(ptr_mac);
+    MW_CHECK_PTR(ptr_slot);
+    if ((0 == port) || (vid < MQTTD_SMAC_VID_MIN) || (vid > MQTTD_SMAC_VID_MAX))
+    {
+        return MW_E_BAD_PARAMETER;
+    }
+    slot = ptr_idx->free_head;
+    if (MQTTD_SMAC_SLOT_NONE == slot)
+    {
+        return MW_E_TABLE_FULL;
+    }
+    ptr_idx->free_head = ptr_idx->next[slot];
+    osapi_memcpy(ptr_idx->tbl.mac_addr[slot], ptr_mac, MQTTD_SMAC_MAC_LEN);
+    ptr_idx->tbl.vid[slot] = vid;
+    ptr_idx->tbl.port[slot] = port;
+    _mqttd_smac_idx_link(ptr_idx, slot);
+    (*ptr_slot) = slot;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_del
+ * PURPOSE:
+ *      Free a used slot.
+ *
+ * INPUT:
+ *      ptr_idx     --  the index got by mqttd_smac_idx_get
+ *      slot        --  the slot
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_ENTRY_NOT_FOUND
+ *
+ * NOTES:
+ *      Only the index is changed, see mqttd_smac_idx_commit.
+ */
+MW_ERROR_NO_T
+mqttd_smac_idx_del(
+    MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI16_T slot)
+{
+    UI16_T *ptr_link;
+
+    MW_CHECK_PTR(ptr_idx);
+    if (slot >= MAX_STATIC_MAC_NUM)
+    {
+        return MW_E_BAD_PARAMETER;
+    }
+    ptr_link = &(ptr_idx->head[_mqttd_smac_hash(ptr_idx->tbl.mac_addr[slot], ptr_idx->tbl.vid[slot])]);
+    while ((MQTTD_SMAC_SLOT_NONE != *ptr_link) && (slot != *ptr_link))
+    {
+        ptr_link = &(ptr_idx->next[*ptr_link]);
+    }
+    if (MQTTD_SMAC_SLOT_NONE == *ptr_link)
+    {
+        return MW_E_ENTRY_NOT_FOUND;
+    }
+    (*ptr_link) = ptr_idx->next[slot];
+    ptr_idx->used--;
+
+    osapi_memset(ptr_idx->tbl.mac_addr[slot], 0, MQTTD_SMAC_MAC_LEN);
+    ptr_idx->tbl.vid[slot] = 0;
+    ptr_idx->tbl.port[slot] = 0;
+    ptr_idx->next[slot] = ptr_idx->free_head;
+    ptr_idx->free_head = slot;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_smac_idx_commit
+ * PURPOSE:
+ *      Write one slot of the index to STATIC_MAC_ENTRY.
+ *
+ * INPUT:
+ *      ptr_idx     --  the index got by mqttd_smac_idx_get
+ *      slot        --  the slot
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_OP_INCOMPLETE
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      A free slot is deleted from DB, a used one is updated. The entry
+ *      index of DB is the slot plus 1.
+ *      The index already holds the change, so it stays current across its
+ *      own write. Only a change of another writer meanwhile makes it stale.
+ */
+MW_ERROR_NO_T
+mqttd_smac_idx_commit(
+    MQTTD_SMAC_IDX_T *ptr_idx,
+    const UI16_T slot)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    UI8_T   entry[MQTTD_SMAC_ENTRY_SIZE];
+    UI32_T  generation;
+
+    MW_CHECK_PTR(ptr_idx);
+    if (slot >= MAX_STATIC_MAC_NUM)
+    {
+        return MW_E_BAD_PARAMETER;
+    }
+    generation = _mqttd_smac_idx_gen;
+    if (0 == ptr_idx->tbl.port[slot])
+    {
+        rc = mqttd_queue_setData(M_DELETE, STATIC_MAC_ENTRY, DB_ALL_FIELDS, slot + 1, NULL, 0);
+    }
+    else
+    {
+        rc = mqttd_queue_setData(M_UPDATE, STATIC_MAC_ENTRY, DB_ALL_FIELDS, slot + 1, entry,
+                                 _mqttd_smac_idx_pack(ptr_idx, slot, entry));
+    }
+    /* mqttd_queue_setData bumped the generation once for this write */
+    if ((MW_E_OK == rc) && (ptr_idx->generation == generation) && (_mqttd_smac_idx_gen == (generation + 1)))
+    {
+        ptr_idx->generation = generation + 1;
+    }
+    return rc;
+}
+
+/* FUNCTION NAME: mqttd_smac_mac_parse
+ * PURPOSE:
+ *      Parse a MAC address string.
+ *
+ * INPUT:
+ *      ptr_str     --  "xx:xx:xx:xx:xx:xx", '-' is also accepted
+ *
+ * OUTPUT:
+ *      ptr_mac     --  the MAC address of MQTTD_SMAC_MAC_LEN bytes
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *
+ * NOTES:
+ *      None
+ */
+MW_ERROR_NO_T
+mqttd_smac_mac_parse(
+    const C8_T *ptr_str,
+    UI8_T *ptr_mac)
+{
+    UI8_T   i;
+    UI8_T   j;
+    UI8_T   nibble;
+    C8_T    c;
+
+    MW_CHECK_PTR(ptr_str);
+    MW_CHECK_PTR(ptr_mac);
+    for (i = 0; i < MQTTD_SMAC_MAC_LEN; i++)
+    {
+        ptr_mac[i] = 0;
+        for (j = 0; j < 2; j++)
+        {
+            c = *ptr_str++;
+            if ((c >= '0') && (c <= '9'))
+            {
+                nibble = c - '0';
+            }
+            else if ((c >= 'a') && (c <= 'f'))
+            {
+                nibble = c - 'a' + 10;
+            }
+            else if ((c >= 'A') && (c <= 'F'))
+            {
+                nibble = c - 'A' + 10;
+            }
+            else
+            {
+                return MW_E_BAD_PARAMETER;
+            }
+            ptr_mac[i] = (ptr_mac[i] << 4) | nibble;
+        }
+        c = *ptr_str++;
+        if (((MQTTD_SMAC_MAC_LEN - 1) == i) ? ('\0' != c) : ((':' != c) && ('-' != c)))
+        {
+            return MW_E_BAD_PARAMETER;
+        }
+    }
+    return MW_E_OK;
+}
@@ -0,0 +1,459 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  mqttd_vlan.c
+ * PURPOSE:
+ *  Implement the VLAN index of mqttd daemon.
+ *
+ * NOTES:
+ *  The index answers VID to entry and port to tagged/untagged VLAN queries
+ *  without walking VLAN_ENTRY. It is rebuilt lazily: DB notifications of the
+ *  source tables only bump the generation, the next reader refreshes it.
+ */
+
+#include <string.h>
+#include "mqttd.h"
+#include "mqttd_queue.h"
+#include "mqttd_vlan.h"
+
+#include "mw_error.h"
+#include "osapi.h"
+#include "osapi_mutex.h"
+#include "osapi_string.h"
+#include "db_api.h"
+#include "db_data.h"
+#include "vlan_utils.h"
+
+/* NAMING CONSTANT DECLARATIONS
+*/
+#define MQTTD_VLAN_IDX_NAME         "mqv"
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+*/
+/* The DB gets the index is built from */
+typedef enum {
+    MQTTD_VLAN_IDX_SRC_ENTRY = 0,   /* VLAN_ENTRY */
+    MQTTD_VLAN_IDX_SRC_LIST,        /* PORT_CFG_INFO.PORT_VLAN_LIST */
+    MQTTD_VLAN_IDX_SRC_PVID,        /* PORT_CFG_INFO.PORT_PVID */
+    MQTTD_VLAN_IDX_SRC_LAST
+} MQTTD_VLAN_IDX_SRC_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+*/
+
+/* LOCAL SUBPROGRAM SPECIFICATIONS
+*/
+
+/* STATIC VARIABLE DECLARATIONS
+ */
+static MQTTD_VLAN_IDX_T _mqttd_vlan_idx;
+static BOOL_T _mqttd_vlan_idx_valid = FALSE;
+/* Bumped on every change of the source tables, read without lock */
+static volatile UI32_T _mqttd_vlan_idx_gen = 0;
+static semaphorehandle_t _ptr_mqttd_vlan_mutex = NULL;
+static const DB_REQUEST_TYPE_T _mqttd_vlan_idx_src[MQTTD_VLAN_IDX_SRC_LAST] =
+{
+    { VLAN_ENTRY, DB_ALL_FIELDS, DB_ALL_ENTRIES },
+    { PORT_CFG_INFO, PORT_VLAN_LIST, DB_ALL_ENTRIES },
+    { PORT_CFG_INFO, PORT_PVID, DB_ALL_ENTRIES },
+};
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: _mqttd_vlan_idx_refresh
+ * PURPOSE:
+ *      Get the source tables from DB and rebuild the index.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NO_MEMORY
+ *      MW_E_TIMEOUT
+ *      MW_E_OTHERS
+ *
+ * NOTES:
+ *      The three gets are issued back to back and collected afterwards.
+ */
+static MW_ERROR_NO_T
+_mqttd_vlan_idx_refresh(
+    void)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    UI32_T          generation = mqttd_vlan_idx_generation();
+    UI16_T          req_id[MQTTD_VLAN_IDX_SRC_LAST] = {0};
+    DB_MSG_T        *ptr_msg[MQTTD_VLAN_IDX_SRC_LAST] = {NULL};
+    void            *ptr_data[MQTTD_VLAN_IDX_SRC_LAST] = {NULL};
+    UI16_T          size = 0;
+    UI8_T           idx;
+    UI8_T           issued = 0;
+
+    for (idx = 0; idx < MQTTD_VLAN_IDX_SRC_LAST; idx++)
+    {
+        rc = mqttd_queue_getDataReq(_mqttd_vlan_idx_src[idx].t_idx, _mqttd_vlan_idx_src[idx].f_idx,
+                                    _mqttd_vlan_idx_src[idx].e_idx, &req_id[idx]);
+        if (MW_E_OK != rc)
+        {
+            break;
+        }
+        issued++;
+    }
+    for (idx = 0; idx < issued; idx++)
+    {
+        if (MW_E_OK != rc)
+        {
+            mqttd_queue_getDataCancel(req_id[idx]);
+            continue;
+        }
+        rc = mqttd_queue_getDataWait(req_id[idx], &ptr_msg[idx], &size, &ptr_data[idx]);
+    }
+
+    if (MW_E_OK == rc)
+    {
+        rc = mqttd_vlan_idx_build(generation,
+                (const DB_VLAN_ENTRY_T *)ptr_data[MQTTD_VLAN_IDX_SRC_ENTRY],
+                (const UI32_T *)ptr_data[MQTTD_VLAN_IDX_SRC_LIST],
+                (const UI16_T *)ptr_data[MQTTD_VLAN_IDX_SRC_PVID]);
+    }
+    else
+    {
+        mqttd_debug("refresh vlan index failed(%d)", rc);
+    }
+
+    for (idx = 0; idx < MQTTD_VLAN_IDX_SRC_LAST; idx++)
+    {
+        DB_MSG_FREE(ptr_msg[idx]);
+    }
+    return rc;
+}
+
+/* EXPORTED SUBPROGRAM BODIES
+ */
+/* FUNCTION NAME: mqttd_vlan_idx_init
+ * PURPOSE:
+ *      Initialize the VLAN index.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NOT_INITED
+ *
+ * NOTES:
+ *      The index starts stale and is built by the first reader.
+ */
+MW_ERROR_NO_T
+mqttd_vlan_idx_init(
+    void)
+{
+    if (NULL == _ptr_mqttd_vlan_mutex)
+    {
+        if (MW_E_OK != osapi_mutexCreate(MQTTD_VLAN_IDX_NAME, &_ptr_mqttd_vlan_mutex))
+        {
+            return MW_E_NOT_INITED;
+        }
+    }
+    _mqttd_vlan_idx_gen++;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_vlan_idx_notify
+ * PURPOSE:
+ *      Mark the VLAN index stale when one of its source tables changes.
+ *
+ * INPUT:
+ *      t_idx       --  the enum of the changed table
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called for DB notifications and for the updates mqttd sends itself.
+ */
+void
+mqttd_vlan_idx_notify(
+    const UI8_T t_idx)
+{
+    if ((VLAN_ENTRY == t_idx) || (PORT_CFG_INFO == t_idx))
+    {
+        _mqttd_vlan_idx_gen++;
+    }
+}
+
+/* FUNCTION NAME: mqttd_vlan_idx_generation
+ * PURPOSE:
+ *      Get the current generation of the VLAN source tables.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      The generation
+ *
+ * NOTES:
+ *      Take it before getting the tables passed to mqttd_vlan_idx_build.
+ */
+UI32_T
+mqttd_vlan_idx_generation(
+    void)
+{
+    return _mqttd_vlan_idx_gen;
+}
+
+/* FUNCTION NAME: mqttd_vlan_idx_build
+ * PURPOSE:
+ *      Build the VLAN index from the DB tables.
+ *
+ * INPUT:
+ *      generation          --  the generation taken before getting the tables
+ *      ptr_vlan_entry_tbl  --  the VLAN_ENTRY table
+ *      ptr_vlan_list_tbl   --  the PORT_VLAN_LIST field of all ports
+ *      ptr_pvid_tbl        --  the PORT_PVID field of all ports
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_NOT_INITED
+ *
+ * NOTES:
+ *      If the tables changed meanwhile, the index is built but stays stale,
+ *      so the next reader refreshes it again.
+ */
+MW_ERROR_NO_T
+mqttd_vlan_idx_build(
+    const UI32_T generation,
+    const DB_VLAN_ENTRY_T *ptr_vlan_entry_tbl,
+    const UI32_T *ptr_vlan_list_tbl,
+    const UI16_T *ptr_pvid_tbl)
+{
+    MQTTD_VLAN_IDX_T *ptr_idx = &_mqttd_vlan_idx;
+    UI32_T  bit;
+    UI32_T  member;
+    UI32_T  untagged;
+    UI16_T  vid;
+    UI8_T   vidx;
+    UI8_T   port;
+
+    MW_CHECK_PTR(ptr_vlan_entry_tbl);
+    MW_CHECK_PTR(ptr_vlan_list_tbl);
+    MW_CHECK_PTR(ptr_pvid_tbl);
+    if (NULL == _ptr_mqttd_vlan_mutex)
+    {
+        return MW_E_NOT_INITED;
+    }
+
+    osapi_mutexTake(_ptr_mqttd_vlan_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
+    osapi_memset(ptr_idx->vid2vidx, MQTTD_VLAN_VIDX_NONE, sizeof(ptr_idx->vid2vidx));
+    osapi_memset(ptr_idx->tagged, 0, sizeof(ptr_idx->tagged));
+    osapi_memset(ptr_idx->untagged, 0, sizeof(ptr_idx->untagged));
+    ptr_idx->used = 0;
+    ptr_idx->member = 0;
+
+    /* One pass over VLAN_ENTRY: the VID map and the per-port member sets */
+    for (vidx = 0; vidx < MAX_VLAN_ENTRY_NUM; vidx++)
+    {
+        vid = ptr_vlan_entry_tbl->vlan_id[vidx];
+        ptr_idx->vidx2vid[vidx] = vid;
+        if ((0 == vid) || (vid >= MQTTD_VLAN_VID_NUM))
+        {
+            continue;
+        }
+        bit = BIT(vidx);
+        ptr_idx->used |= bit;
+        ptr_idx->vid2vidx[vid] = vidx;
+
+        /* An untouched default entry is not reported as a member VLAN */
+        if ((vid != (vidx + 1)) ||
+            (0 != ptr_vlan_entry_tbl->port_member[vidx]) ||
+            (0 != ptr_vlan_entry_tbl->tagged_member[vidx]) ||
+            (0 != ptr_vlan_entry_tbl->untagged_member[vidx]))
+        {
+            ptr_idx->member |= bit;
+        }
+
+        /* port_member and tagged_member count as tagged, untagged_member
+         * counts as untagged unless the port is a port_member.
+         */
+        member = ptr_vlan_entry_tbl->port_member[vidx] | ptr_vlan_entry_tbl->tagged_member[vidx];
+        untagged = ptr_vlan_entry_tbl->untagged_member[vidx] & ~(ptr_vlan_entry_tbl->port_member[vidx]);
+        for (port = 0; port < PLAT_MAX_PORT_NUM; port++)
+        {
+            if (member & BIT(port))
+            {
+                ptr_idx->tagged[port] |= bit;
+            }
+            if (untagged & BIT(port))
+            {
+                ptr_idx->untagged[port] |= bit;
+            }
+        }
+    }
+    for (port = 0; port < PLAT_MAX_PORT_NUM; port++)
+    {
+        ptr_idx->vlan_list[port] = ptr_vlan_list_tbl[port];
+        ptr_idx->pvid[port] = ptr_pvid_tbl[port];
+        ptr_idx->tagged[port] &= ptr_vlan_list_tbl[port];
+        ptr_idx->untagged[port] &= ptr_vlan_list_tbl[port];
+    }
+    ptr_idx->generation = generation;
+    _mqttd_vlan_idx_valid = TRUE;
+    osapi_mutexGive(_ptr_mqttd_vlan_mutex);
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_vlan_idx_acquire
+ * PURPOSE:
+ *      Lock the VLAN index if it is not older than a generation.
+ *
+ * INPUT:
+ *      generation  --  the oldest acceptable generation,
+ *                      mqttd_vlan_idx_generation() for an up to date index
+ *
+ * OUTPUT:
+ *      pptr_idx    --  double pointer to the index
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NOT_INITED     --  the index is stale, nothing is locked
+ *
+ * NOTES:
+ *      When return MW_E_OK, caller must call mqttd_vlan_idx_release.
+ *      It never touches DB, so it can be used by non-blocking callers.
+ */
+MW_ERROR_NO_T
+mqttd_vlan_idx_acquire(
+    const UI32_T generation,
+    const MQTTD_VLAN_IDX_T **pptr_idx)
+{
+    MW_CHECK_PTR(pptr_idx);
+    if (NULL == _ptr_mqttd_vlan_mutex)
+    {
+        return MW_E_NOT_INITED;
+    }
+
+    osapi_mutexTake(_ptr_mqttd_vlan_mutex, MQTTD_QUEUE_BLOCKTIMEOUT);
+    if ((TRUE != _mqttd_vlan_idx_valid) || ((I32_T)(_mqttd_vlan_idx.generation - generation) < 0))
+    {
+        osapi_mutexGive(_ptr_mqttd_vlan_mutex);
+        return MW_E_NOT_INITED;
+    }
+    (*pptr_idx) = &_mqttd_vlan_idx;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: mqttd_vlan_idx_get
+ * PURPOSE:
+ *      Lock the VLAN index, refresh it from DB first if it is stale.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      pptr_idx    --  double pointer to the index
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_NOT_INITED
+ *      MW_E_TIMEOUT
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      When return MW_E_OK, caller must call mqttd_vlan_idx_release.
+ *      It may block on DB, see mqttd_queue_getData.
+ */
+MW_ERROR_NO_T
+mqttd_vlan_idx_get(
+    const MQTTD_VLAN_IDX_T **pptr_idx)
+{
+    MW_ERROR_NO_T rc = MW_E_OK;
+    UI32_T generation = _mqttd_vlan_idx_gen;
+
+    rc = mqttd_vlan_idx_acquire(generation, pptr_idx);
+    if (MW_E_OK == rc)
+    {
+        return rc;
+    }
+    rc = _mqttd_vlan_idx_refresh();
+    if (MW_E_OK != rc)
+    {
+        return rc;
+    }
+
+    /* Accept what was just built even if a notification raced with it */
+    return mqttd_vlan_idx_acquire(generation, pptr_idx);
+}
+
+/* FUNCTION NAME: mqttd_vlan_idx_release
+ * PURPOSE:
+ *      Unlock the VLAN index.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ */
+void
+mqttd_vlan_idx_release(
+    void)
+{
+    osapi_mutexGive(_ptr_mqttd_vlan_mutex);
+}
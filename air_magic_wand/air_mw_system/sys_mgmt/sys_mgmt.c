@@ -44,6 +44,7 @@
 /* INCLUDE FILE DECLARATIONS
  */
 #include "inc/sys_mgmt.h"
+#include "inc/sys_mgmt_acl.h"
 #include "lwip/api.h"
 #ifdef AIR_SUPPORT_SNMP
 #include "lwip/snmp.h"
@@ -53,8 +54,40 @@
 #include "mqttd.h"
 #endif
 #include "mw_tlv.h"
+#include "osapi_timer.h"
 #include "web.h"
 
+/* NAMING CONSTANT DECLARATIONS
+*/
+/* The dynamic ACL entries, see sys_mgmt_acl_alloc */
+#define SYS_MGMT_ACL_SLOT_NUM   (MW_ACL_ID_DYNAMIC_MAX - MW_ACL_ID_DYNAMIC_MIN + 1)
+#define SYS_MGMT_ACL_WORD_NUM   ((SYS_MGMT_ACL_SLOT_NUM + 31) / 32)
+#define SYS_MGMT_ACL_OWNER_DHCP "dhcp"
+
+/* The multi-field DB updates, see _sys_mgmt_batch_send */
+#define SYS_MGMT_DB_BATCH_NUM   (8)     /* fields in one message */
+
+/* Coalesce the netif changes into one SYS_OPER_INFO update */
+#define SYS_MGMT_OPER_TIMER_NAME    "sysOperTmr"
+#define SYS_MGMT_OPER_TIMER_PERIOD  (100)
+
+/* The events of the sys_mgmt task loop */
+#define SYS_MGMT_EVENT_OPER     BIT(0)  /* send the coalesced netif changes */
+#define SYS_MGMT_EVENT_DHCP     BIT(1)  /* send SYS_DHCP_ENABLE after the netif changes */
+
+/* DATA TYPE DECLARATIONS
+*/
+/* The fields of one DB message, the data is copied when the message is sent */
+typedef struct SYS_MGMT_DB_BATCH_S
+{
+    UI8_T               method;
+    UI8_T               count;
+    UI16_T              size;       /* total data size */
+    DB_REQUEST_TYPE_T   request[SYS_MGMT_DB_BATCH_NUM];
+    UI16_T              data_size[SYS_MGMT_DB_BATCH_NUM];
+    const void          *ptr_data[SYS_MGMT_DB_BATCH_NUM];
+} SYS_MGMT_DB_BATCH_T;
+
 /* GLOBAL VARIABLE DECLARATIONS
 */
 SYS_MGMT_T           sys_mgmt_info;
@@ -74,10 +107,25 @@ UI16_T               snmp_linkup = 0;
 UI16_T               snmp_send_coldwarm_start = 1;
 #endif
 static UI8_T  _mw_attack_prevention_global_state_ref_cnt = 0;
+static UI32_T _sys_mgmt_acl_bmp[SYS_MGMT_ACL_WORD_NUM];
+static const C8_T *_sys_mgmt_acl_owner[SYS_MGMT_ACL_SLOT_NUM];
+static const C8_T _sys_mgmt_acl_owner_hw[] = "hw";   /* enabled by other users */
+static BOOL_T _sys_mgmt_acl_synced = FALSE;
+static timehandle_t _ptr_sys_mgmt_oper_timer = NULL;
+static DB_EVENT_LOOP_T _sys_mgmt_loop;
 /* LOCAL SUBPROGRAM DECLARATIONS
  */
 void sys_mgmt_get_default_ip(void);
 void sys_mgmt_update_default_to_oper(void);
+static void _sys_mgmt_acl_sync(void);
+static MW_ERROR_NO_T _sys_mgmt_acl_take(const C8_T *ptr_owner, UI16_T *ptr_acl_id);
+static void _sys_mgmt_batch_init(SYS_MGMT_DB_BATCH_T *ptr_batch, const UI8_T method);
+static MW_ERROR_NO_T _sys_mgmt_batch_add(SYS_MGMT_DB_BATCH_T *ptr_batch, const UI8_T t_idx, const UI8_T f_idx,
+                                         const UI16_T e_idx, const void *ptr_data, const UI16_T size);
+static MW_ERROR_NO_T _sys_mgmt_batch_send(const SYS_MGMT_DB_BATCH_T *ptr_batch, const C8_T *ptr_name);
+static MW_ERROR_NO_T _sys_mgmt_oper_flush(void);
+static void _sys_mgmt_dhcp_done_send(void);
+static void _sys_mgmt_oper_tmr(timehandle_t ptr_xTimer);
 MW_ERROR_NO_T
 sys_mgmt_queue_send(const UI8_T method,
                            const UI8_T t_idx,
@@ -188,77 +236,78 @@ void sys_mgmt_dhcp_set(UI8_T enable)
         if (MW_ACL_ID_INVALID == dhcp_acl_id)
         {
             UI32_T unit = 0;
-            UI8_T index = 0;
+            UI16_T index = 0;
             AIR_ACL_RULE_T acl_rule;
+            AIR_ACL_ACTION_T action;
+            AIR_ERROR_NO_T   rc;
             if(MW_E_OK == mw_acl_mutex_take())
             {
-                for (index = MW_ACL_ID_DYNAMIC_MIN; index <= MW_ACL_ID_DYNAMIC_MAX; index++)
+                if (MW_E_OK == sys_mgmt_acl_alloc(SYS_MGMT_ACL_OWNER_DHCP, &index))
                 {
-                    if (air_acl_getRule(unit, index, &acl_rule) == AIR_E_OK)
+                    osapi_memset(&acl_rule, 0, sizeof(AIR_ACL_RULE_T));
+                    acl_rule.rule_en = TRUE;
+                    AIR_PORT_BITMAP_COPY(acl_rule.portmap, PLAT_PORT_BMP_TOTAL);
+                    AIR_PORT_DEL(acl_rule.portmap, PLAT_CPU_PORT);
+                    acl_rule.end = TRUE;
+                    acl_rule.key.etype = ETHTYPE_IP;
+                    acl_rule.mask.etype = 0x3;
+                    acl_rule.key.next_header = MW_IPPROTO_UDP;
+                    acl_rule.key.dip = IPADDR_BROADCAST;
+                    acl_rule.mask.dip = 0xf;
+                    acl_rule.key.dport = MW_DHCP_CLIENT_PORT;
+                    acl_rule.mask.dport = 0x3;
+                    acl_rule.field_valid |= ((1U << AIR_ACL_ETYPE_KEY) | (1U << AIR_ACL_NEXT_HEADER_KEY) |
+                                            (1U << AIR_ACL_DIP_KEY) | (1U << AIR_ACL_DPORT_KEY));
+                    rc = air_acl_setRule(unit, index, &acl_rule);
+                    if (rc != AIR_E_OK)
                     {
-                        AIR_ACL_ACTION_T action;
-                        AIR_ERROR_NO_T   rc;
-                        UI8_T            i;
-                        if (FALSE == acl_rule.rule_en)
-                        {
-                            osapi_memset(&acl_rule, 0, sizeof(AIR_ACL_RULE_T));
-                            acl_rule.rule_en = TRUE;
-                            AIR_PORT_BITMAP_COPY(acl_rule.portmap, PLAT_PORT_BMP_TOTAL);
-                            AIR_PORT_DEL(acl_rule.portmap, PLAT_CPU_PORT);
-                            acl_rule.end = TRUE;
-                            acl_rule.key.etype = ETHTYPE_IP;
-                            acl_rule.mask.etype = 0x3;
-                            acl_rule.key.next_header = MW_IPPROTO_UDP;
-                            acl_rule.key.dip = IPADDR_BROADCAST;
-                            acl_rule.mask.dip = 0xf;
-                            acl_rule.key.dport = MW_DHCP_CLIENT_PORT;
-                            acl_rule.mask.dport = 0x3;
-                            acl_rule.field_valid |= ((1U << AIR_ACL_ETYPE_KEY) | (1U << AIR_ACL_NEXT_HEADER_KEY) |
-                                                    (1U << AIR_ACL_DIP_KEY) | (1U << AIR_ACL_DPORT_KEY));
-                            rc = air_acl_setRule(unit, index, &acl_rule);
-                            if (rc != AIR_E_OK)
-                            {
-                                osapi_printf("Add DHCP ACL rule entry-id %d failed, rc=%d.\n", index, rc);
-                                break;
-                            }
-
-                            osapi_memset(&action, 0, sizeof(AIR_ACL_ACTION_T));
-                            action.port_fw = MW_ACL_ACT_PORT_FW_CPU_INCLUDE;
-                            action.pri_user = MW_ACL_RX_PRIORITY_NOMRAL_PACKET;
-                            action.field_valid |= (1U << AIR_ACL_FW_PORT) | (1U << AIR_ACL_PRI);
-                            rc = air_acl_setAction(unit, index, &action);
-                            if (AIR_E_OK == rc)
-                            {
-                                dhcp_acl_id = index;
-                            }
-                            else
-                            {
-                                osapi_printf("Add DHCP ACL rule entry-id %d action fail, rc=%d.\n", index, rc);
-                                air_acl_delRule(unit, index);
-                            }
-                            break;
-                        }
+                        osapi_printf("Add DHCP ACL rule entry-id %d failed, rc=%d.\n", index, rc);
+                        sys_mgmt_acl_free(index);
                     }
                     else
                     {
-                        osapi_printf("Get ACL rule entry-id %d failed\n", index);
+                        osapi_memset(&action, 0, sizeof(AIR_ACL_ACTION_T));
+                        action.port_fw = MW_ACL_ACT_PORT_FW_CPU_INCLUDE;
+                        action.pri_user = MW_ACL_RX_PRIORITY_NOMRAL_PACKET;
+                        action.field_valid |= (1U << AIR_ACL_FW_PORT) | (1U << AIR_ACL_PRI);
+                        rc = air_acl_setAction(unit, index, &action);
+                        if (AIR_E_OK == rc)
+                        {
+                            dhcp_acl_id = index;
+                        }
+                        else
+                        {
+                            osapi_printf("Add DHCP ACL rule entry-id %d action fail, rc=%d.\n", index, rc);
+                            air_acl_delRule(unit, index);
+                            sys_mgmt_acl_free(index);
+                        }
                     }
                 }
+                else
+                {
+                    osapi_printf("No free ACL rule entry for DHCP\n");
+                }
                 mw_acl_mutex_release();
             }
         }
 #endif /* AIR_SUPPORT_DHCP_SNOOP */
 #if MW_DHCP
-        sys_mgmt_info.oper_ip = 0;
-        sys_mgmt_info.oper_mask = 0;
-        sys_mgmt_info.oper_gw = 0;
-        sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_ADDR, DB_ALL_ENTRIES, &sys_mgmt_info.oper_ip, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
-        sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_MASK, DB_ALL_ENTRIES, &sys_mgmt_info.oper_mask, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
-        sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_GW, DB_ALL_ENTRIES, &sys_mgmt_info.oper_gw, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
-        if(MW_AUTODNS_ENABLE == sys_mgmt_info.autodns_enable)
         {
-            sys_mgmt_info.oper_dns = 0;
-            sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_DNS, DB_ALL_ENTRIES, &sys_mgmt_info.oper_dns, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
+            SYS_MGMT_DB_BATCH_T batch;
+
+            sys_mgmt_info.oper_ip = 0;
+            sys_mgmt_info.oper_mask = 0;
+            sys_mgmt_info.oper_gw = 0;
+            _sys_mgmt_batch_init(&batch, M_UPDATE);
+            _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_ADDR, DB_ALL_ENTRIES, &sys_mgmt_info.oper_ip, sizeof(MW_IPV4_T));
+            _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_MASK, DB_ALL_ENTRIES, &sys_mgmt_info.oper_mask, sizeof(MW_IPV4_T));
+            _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_GW, DB_ALL_ENTRIES, &sys_mgmt_info.oper_gw, sizeof(MW_IPV4_T));
+            if(MW_AUTODNS_ENABLE == sys_mgmt_info.autodns_enable)
+            {
+                sys_mgmt_info.oper_dns = 0;
+                _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_DNS, DB_ALL_ENTRIES, &sys_mgmt_info.oper_dns, sizeof(MW_IPV4_T));
+            }
+            _sys_mgmt_batch_send(&batch, SYS_MGMT_DB_QUEUE_NAME);
         }
         dhcp_start(xNetIf);
 #else
@@ -283,17 +332,22 @@ void sys_mgmt_dhcp_set(UI8_T enable)
             UI32_T         unit = 0;
             AIR_ERROR_NO_T rc;
 
-            rc = air_acl_delAction(unit, dhcp_acl_id);
-            if (rc != AIR_E_OK)
-            {
-                osapi_printf("Delete DHCP ACL rule entry-id %d action failed, rc %d.\n", dhcp_acl_id, rc);
-            }
-            rc = air_acl_delRule(unit, dhcp_acl_id);
-            if (rc != AIR_E_OK)
+            if (MW_E_OK == mw_acl_mutex_take())
             {
-                osapi_printf("Delete DHCP ACL rule entry-id %d rule failed, rc %d.\n", dhcp_acl_id, rc);
+                rc = air_acl_delAction(unit, dhcp_acl_id);
+                if (rc != AIR_E_OK)
+                {
+                    osapi_printf("Delete DHCP ACL rule entry-id %d action failed, rc %d.\n", dhcp_acl_id, rc);
+                }
+                rc = air_acl_delRule(unit, dhcp_acl_id);
+                if (rc != AIR_E_OK)
+                {
+                    osapi_printf("Delete DHCP ACL rule entry-id %d rule failed, rc %d.\n", dhcp_acl_id, rc);
+                }
+                sys_mgmt_acl_free(dhcp_acl_id);
+                mw_acl_mutex_release();
+                dhcp_acl_id = MW_ACL_ID_INVALID;
             }
-            dhcp_acl_id = MW_ACL_ID_INVALID;
         }
 #endif /* AIR_SUPPORT_DHCP_SNOOP */
     }
@@ -407,7 +461,7 @@ _sys_mgmt_queue_send(
     if (MW_E_OK != rc)
     {
         /* This message could not be send, drop it */
-        osapi_free(ptr_msg);
+        dbapi_freeMsg(ptr_msg);
         return rc;
     }
     rc = dbapi_sendRequesttoDb(size, ptr_msg);
@@ -415,7 +469,7 @@ _sys_mgmt_queue_send(
     {
         /* This message could not be send, drop it */
         sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "db_sendRequesttoDb() failed");
-        osapi_free(ptr_msg);
+        dbapi_freeMsg(ptr_msg);
     }
     return rc;
 }
@@ -463,10 +517,7 @@ sys_mgmt_queue_send(
 
     MW_PARAM_CHK((t_idx >= TABLES_LAST), MW_E_BAD_PARAMETER);
     msg_size = DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + size;
-    rc = osapi_calloc(
-            msg_size,
-            SYS_MGMT_MODULE_NAME,
-            (void **)&ptr_msg);
+    rc = dbapi_allocMsg(msg_size, &ptr_msg);
     if (MW_E_OK != rc)
     {
         sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "allocate memory failed(%d)", rc);
@@ -505,6 +556,278 @@ sys_mgmt_queue_send(
     return MW_E_OK;
 }
 
+/* FUNCTION NAME: _sys_mgmt_batch_init
+ * PURPOSE:
+ *      Start a multi-field DB message.
+ *
+ * INPUT:
+ *      method      --  the method bitmap
+ *
+ * OUTPUT:
+ *      ptr_batch   --  the fields of the message
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ */
+static void
+_sys_mgmt_batch_init(
+    SYS_MGMT_DB_BATCH_T *ptr_batch,
+    const UI8_T method)
+{
+    ptr_batch->method = method;
+    ptr_batch->count = 0;
+    ptr_batch->size = 0;
+}
+
+/* FUNCTION NAME: _sys_mgmt_batch_add
+ * PURPOSE:
+ *      Add a field to a multi-field DB message.
+ *
+ * INPUT:
+ *      ptr_batch   --  the fields of the message
+ *      t_idx       --  the enum of the table
+ *      f_idx       --  the enum of the field
+ *      e_idx       --  the entry index in the table
+ *      ptr_data    --  pointer to field data
+ *      size        --  size of ptr_data
+ *
+ * OUTPUT:
+ *      ptr_batch   --  the fields of the message
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_TABLE_FULL
+ *
+ * NOTES:
+ *      ptr_data is referenced, it must stay valid until the message is sent.
+ */
+static MW_ERROR_NO_T
+_sys_mgmt_batch_add(
+    SYS_MGMT_DB_BATCH_T *ptr_batch,
+    const UI8_T t_idx,
+    const UI8_T f_idx,
+    const UI16_T e_idx,
+    const void *ptr_data,
+    const UI16_T size)
+{
+    MW_PARAM_CHK((t_idx >= TABLES_LAST), MW_E_BAD_PARAMETER);
+    if (ptr_batch->count >= SYS_MGMT_DB_BATCH_NUM)
+    {
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "too many fields in one message");
+        return MW_E_TABLE_FULL;
+    }
+    ptr_batch->request[ptr_batch->count].t_idx = t_idx;
+    ptr_batch->request[ptr_batch->count].f_idx = f_idx;
+    ptr_batch->request[ptr_batch->count].e_idx = e_idx;
+    ptr_batch->data_size[ptr_batch->count] = size;
+    ptr_batch->ptr_data[ptr_batch->count] = ptr_data;
+    ptr_batch->size += size;
+    ptr_batch->count++;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _sys_mgmt_batch_send
+ * PURPOSE:
+ *      Package the fields into one message and send it to DB.
+ *
+ * INPUT:
+ *      ptr_batch   --  the fields of the message
+ *      ptr_name    --  name of module
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_OP_INCOMPLETE
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      DB applies the fields together and notifies the subscribers with one
+ *      message, instead of one message per field.
+ */
+static MW_ERROR_NO_T
+_sys_mgmt_batch_send(
+    const SYS_MGMT_DB_BATCH_T *ptr_batch,
+    const C8_T *ptr_name)
+{
+    MW_ERROR_NO_T   rc = MW_E_OK;
+    DB_MSG_T        *ptr_msg = NULL;
+    DB_PAYLOAD_T    *ptr_payload = NULL;
+    UI8_T           *ptr_cur = NULL;
+    UI32_T          msg_size;
+    UI8_T           idx;
+
+    MW_PARAM_CHK((0 == ptr_batch->count), MW_E_BAD_PARAMETER);
+    msg_size = DB_MSG_HEADER_SIZE + (ptr_batch->count * DB_MSG_PAYLOAD_SIZE) + ptr_batch->size;
+    rc = dbapi_allocMsg(msg_size, &ptr_msg);
+    if (MW_E_OK != rc)
+    {
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "allocate memory failed(%d)", rc);
+        return MW_E_NO_MEMORY;
+    }
+    /* message */
+    osapi_strncpy(ptr_msg->cq_name, ptr_name, DB_Q_NAME_SIZE);
+    ptr_msg->method = ptr_batch->method;
+    ptr_msg->type.count = ptr_batch->count;
+    sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "ptr_msg=%p, cq_name=%s, method=0x%X, count=%u, size=%u",
+                  ptr_msg, ptr_msg->cq_name, ptr_msg->method, ptr_msg->type.count, ptr_batch->size);
+    /* payloads, packed one after another */
+    ptr_cur = (UI8_T *)&(ptr_msg->ptr_payload);
+    for (idx = 0; idx < ptr_batch->count; idx++)
+    {
+        ptr_payload = (DB_PAYLOAD_T *)ptr_cur;
+        ptr_payload->request = ptr_batch->request[idx];
+        ptr_payload->data_size = ptr_batch->data_size[idx];
+        if ((ptr_batch->data_size[idx] > 0) && (ptr_batch->method != M_GET))
+        {
+            memcpy(&(ptr_payload->ptr_data), ptr_batch->ptr_data[idx], ptr_batch->data_size[idx]);
+        }
+        ptr_cur += DB_MSG_PAYLOAD_SIZE + ptr_batch->data_size[idx];
+    }
+    /* Send message to DB */
+    rc = _sys_mgmt_queue_send(ptr_msg, msg_size);
+    if (MW_E_OK != rc)
+    {
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "Send message to DB failed(%d)", rc);
+        return MW_E_OP_INCOMPLETE;
+    }
+
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: _sys_mgmt_oper_flush
+ * PURPOSE:
+ *      Update the operational IP settings to DB in one message.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_OP_INCOMPLETE
+ *      MW_E_NO_MEMORY
+ *
+ * NOTES:
+ *      Called by sys_mgmt task only. The netif callback writes the settings
+ *      in tcpip thread, so the four of them are copied in one critical
+ *      section. If it fails, the settings are reset so the next netif change
+ *      is sent, unless they changed meanwhile.
+ */
+static MW_ERROR_NO_T
+_sys_mgmt_oper_flush(
+    void)
+{
+    MW_ERROR_NO_T       rc;
+    SYS_MGMT_DB_BATCH_T batch;
+    MW_IPV4_T           oper_ip;
+    MW_IPV4_T           oper_mask;
+    MW_IPV4_T           oper_gw;
+    MW_IPV4_T           oper_dns;
+
+    taskENTER_CRITICAL();
+    oper_ip = sys_mgmt_info.oper_ip;
+    oper_mask = sys_mgmt_info.oper_mask;
+    oper_gw = sys_mgmt_info.oper_gw;
+    oper_dns = sys_mgmt_info.oper_dns;
+    taskEXIT_CRITICAL();
+
+    sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->_sys_mgmt_batch_send(M_UPDATE, SYS_OPER_INFO)");
+    _sys_mgmt_batch_init(&batch, M_UPDATE);
+    _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_ADDR, DB_ALL_ENTRIES, &oper_ip, sizeof(MW_IPV4_T));
+    _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_MASK, DB_ALL_ENTRIES, &oper_mask, sizeof(MW_IPV4_T));
+    _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_GW, DB_ALL_ENTRIES, &oper_gw, sizeof(MW_IPV4_T));
+    _sys_mgmt_batch_add(&batch, SYS_OPER_INFO, SYS_OPER_IP_DNS, DB_ALL_ENTRIES, &oper_dns, sizeof(MW_IPV4_T));
+    rc = _sys_mgmt_batch_send(&batch, SYS_MGMT_DB_QUEUE_NAME);
+    if (MW_E_OK != rc)
+    {
+        taskENTER_CRITICAL();
+        if ((sys_mgmt_info.oper_ip == oper_ip) && (sys_mgmt_info.oper_mask == oper_mask) &&
+            (sys_mgmt_info.oper_gw == oper_gw) && (sys_mgmt_info.oper_dns == oper_dns))
+        {
+            sys_mgmt_info.oper_ip = IPADDR_ANY;
+            sys_mgmt_info.oper_mask = IPADDR_ANY;
+            sys_mgmt_info.oper_gw = IPADDR_ANY;
+            sys_mgmt_info.oper_dns = IPADDR_ANY;
+        }
+        taskEXIT_CRITICAL();
+    }
+    return rc;
+}
+
+/* FUNCTION NAME: _sys_mgmt_dhcp_done_send
+ * PURPOSE:
+ *      Update the bound DHCP state to DB.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Called by sys_mgmt task after _sys_mgmt_oper_flush(), so DB has the
+ *      leased address before SYS_DHCP_ENABLE changes.
+ */
+static void
+_sys_mgmt_dhcp_done_send(
+    void)
+{
+    MW_ERROR_NO_T   ret;
+    UI8_T           state = MW_DHCP_DONE;
+
+    if (MW_DHCP_DONE != sys_mgmt_info.dhcp_enable)
+    {
+        return;
+    }
+    ret = sys_mgmt_queue_send(M_UPDATE, SYS_INFO, SYS_DHCP_ENABLE, DB_ALL_ENTRIES, &state, sizeof(UI8_T), SYS_MGMT_DB_QUEUE_NAME);
+    if(MW_E_OK != ret)
+    {
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->sys_mgmt_queue_send(M_UPDATE, SYS_DHCP_ENABLE) fail.");
+        sys_mgmt_info.dhcp_enable = MW_DHCP_ENABLE;
+    }
+}
+
+/* FUNCTION NAME: _sys_mgmt_oper_tmr
+ * PURPOSE:
+ *      Send the coalesced netif changes.
+ *
+ * INPUT:
+ *      ptr_xTimer  --  the timer
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      The one-shot timer is restarted by each netif change, so a burst of
+ *      changes is sent once after it settles. The timer task only posts the
+ *      event, the update is sent by sys_mgmt task.
+ */
+static void
+_sys_mgmt_oper_tmr(
+    timehandle_t ptr_xTimer)
+{
+    (void)ptr_xTimer;
+    if (MW_E_OK != dbapi_eventPost(&_sys_mgmt_loop, SYS_MGMT_EVENT_OPER))
+    {
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "post the netif changes fail");
+    }
+}
+
 static MW_ERROR_NO_T
 _sys_mgmt_db_msg_process(
     const UI8_T method,
@@ -817,7 +1140,7 @@ _sys_mgmt_db_msg_process(
                         {
                             snmp_v2c_enable(SNMP_DISABLE);
                         }
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                     }
                     if (MW_E_OK == snmp_queue_getData(SNMP_INFO, SNMP_TRAP_EN, DB_ALL_ENTRIES, &ptrMsg, &dataSize, (void **)&ptrData))
                     {
@@ -830,7 +1153,7 @@ _sys_mgmt_db_msg_process(
                         {
                             snmp_trap_dst_enable(0, SNMP_ENABLE);
                         }
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                     }
                     if (MW_E_OK == snmp_queue_getData(SNMP_INFO, SNMP_TRAP_TYPE, DB_ALL_ENTRIES, &ptrMsg, &dataSize, (void **)&ptrData))
                     {
@@ -843,7 +1166,7 @@ _sys_mgmt_db_msg_process(
                         {
                             snmp_set_auth_traps_enabled(SNMP_DISABLE);
                         }
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                     }
                     if (MW_E_OK == snmp_queue_getData(SNMP_INFO, SNMP_TRAP_DST_IP, DB_ALL_ENTRIES, &ptrMsg, &dataSize, (void **)&ptrData))
                     {
@@ -854,14 +1177,14 @@ _sys_mgmt_db_msg_process(
                         {
                             snmp_trap_dst_ip_set(0, &dst);
                         }
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                     }
                     if (MW_E_OK == snmp_queue_getData(SNMP_INFO, SNMP_TRAP_DST_IP, DB_ALL_ENTRIES, &ptrMsg, &dataSize, (void **)&ptrData))
                     {
                         ip_addr_t dst;
 
                         ip_addr_set_ip4_u32_val(dst, *(u32_t *)ptrData);
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                         if (FALSE == ip_addr_isany_val(dst))
                         {
                             snmp_trap_dst_ip_set(0, &dst);
@@ -887,7 +1210,7 @@ _sys_mgmt_db_msg_process(
                                     osapi_free(trapName);
 #endif
                                 }
-                                MW_FREE(ptrMsg);
+                                DB_MSG_FREE(ptrMsg);
                             }
                         }
                     }
@@ -903,7 +1226,7 @@ _sys_mgmt_db_msg_process(
                             snmp_set_community(read_community, osapi_strlen(read_community));
                             osapi_free(read_community);
                         }
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                     }
                     if (MW_E_OK == snmp_queue_getData(SNMP_INFO, SNMP_WRITE_COMMUNITY, DB_ALL_ENTRIES, &ptrMsg, &dataSize, (void **)&ptrData))
                     {
@@ -917,7 +1240,7 @@ _sys_mgmt_db_msg_process(
                             snmp_set_community_write(write_community, osapi_strlen(write_community));
                             osapi_free(write_community);
                         }
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                     }
                     if (MW_E_OK == snmp_queue_getData(SNMP_INFO, SNMP_TRAP_COMMUNITY, DB_ALL_ENTRIES, &ptrMsg, &dataSize, (void **)&ptrData))
                     {
@@ -931,7 +1254,7 @@ _sys_mgmt_db_msg_process(
                             snmp_set_community_trap(trap_community, osapi_strlen(trap_community));
                             osapi_free(trap_community);
                         }
-                        MW_FREE(ptrMsg);
+                        DB_MSG_FREE(ptrMsg);
                     }
                     if (1 == snmp_linkup)
                     {
@@ -996,15 +1319,6 @@ _sys_mgmt_db_msg_process(
     return rc;
 }
 
-static MW_ERROR_NO_T
-_sys_mgmt_queue_recv_msg(
-    const C8_T *ptr_name,
-    UI8_T **pptr_msg,
-    const UI32_T timeout)
-{
-    return osapi_msgRecv(SYS_MGMT_DB_QUEUE_NAME, pptr_msg, 0, SYS_MGMT_TASK_DELAY);
-}
-
 static void
 _sys_mgmt_handle_db_msg(
     void)
@@ -1015,10 +1329,24 @@ _sys_mgmt_handle_db_msg(
     UI16_T data_size = 0;
     UI8_T *ptr_data = NULL;
     UI8_T *ptr_payload_data = NULL;
+    UI32_T events = DB_EVENT_NONE;
     MW_ERROR_NO_T rc = MW_E_OK;
 
-    rc = _sys_mgmt_queue_recv_msg(SYS_MGMT_DB_QUEUE_NAME, (UI8_T**)&ptr_msg, SYS_MGMT_TASK_DELAY);
-    if(MW_E_OK == rc)
+    /* Sleep until a DB message or an event comes, there is nothing to poll */
+    rc = dbapi_eventWait(&_sys_mgmt_loop, DB_EVENT_WAIT_FOREVER, &ptr_msg, &events);
+    if (MW_E_TIMEOUT == rc)
+    {
+        return;
+    }
+    if (events & SYS_MGMT_EVENT_OPER)
+    {
+        _sys_mgmt_oper_flush();
+    }
+    if (events & SYS_MGMT_EVENT_DHCP)
+    {
+        _sys_mgmt_dhcp_done_send();
+    }
+    if(NULL != ptr_msg)
     {
        /* Process the notification message */
         do {
@@ -1043,11 +1371,11 @@ _sys_mgmt_handle_db_msg(
             /* Continue to parse the next request within the payload. */
         } while ((MW_E_OK == rc) && (NULL != ptr_payload_data));
 
-        MW_FREE(ptr_msg);
-        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "MW_FREE(ptr_msg %p) Done.", ptr_msg);
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "DB_MSG_FREE(ptr_msg %p).", ptr_msg);
+        DB_MSG_FREE(ptr_msg);
 
     }
-    else
+    else if (MW_E_OK != rc)
     {
         sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "Receive message queue failed!(%d)", rc);
     }
@@ -1073,6 +1401,7 @@ static void sys_mgmt_task( void *ptr_pvParameters )
 {
     MW_ERROR_NO_T rc = MW_E_OK;
     ip_addr_t dns;
+    UI32_T wait_ticks = 0;
 
     /* Just to kill the compiler warning. */
     (void)ptr_pvParameters;
@@ -1082,9 +1411,8 @@ static void sys_mgmt_task( void *ptr_pvParameters )
 
     sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "Check DB is ready or not...");
     /* Check DB is ready or not */
-    do{
-        rc = dbapi_dbisReady();
-    }while(MW_E_OK != rc);
+    rc = dbapi_waitReady(&wait_ticks);
+    sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "DB ready after %u ticks of wait, at tick %u", (unsigned int)wait_ticks, (unsigned int)dbapi_getReadyTick());
 
     sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->sys_mgmt_queue_send(M_SUBSCRIBE, DB_ALL_FIELDS)");
     sys_mgmt_queue_send(M_SUBSCRIBE, SYS_INFO, DB_ALL_FIELDS, DB_ALL_ENTRIES, 0, 0, SYS_MGMT_DB_QUEUE_NAME);
@@ -1201,7 +1529,6 @@ static void
 sys_mgmt_netif_ext_status_callback(struct netif *netif, netif_nsc_reason_t reason, const netif_ext_callback_args_t *args)
 {
     C8_T ip_str[SYS_MGMT_IPV4_STR_SIZE];
-    MW_ERROR_NO_T ret = MW_E_OK;
     const netif_ext_callback_args_t *cb_args = args;
     MW_IPV4_T new_ip = 0, new_mask = 0, new_gw = 0;
     ip_addr_t new_dns;
@@ -1307,45 +1634,34 @@ sys_mgmt_netif_ext_status_callback(struct netif *netif, netif_nsc_reason_t reaso
            (sys_mgmt_info.oper_gw != new_gw) ||
            (sys_mgmt_info.oper_dns != ip_addr_get_ip4_u32(&new_dns)))
         {
+            taskENTER_CRITICAL();
             sys_mgmt_info.oper_ip = new_ip;
             sys_mgmt_info.oper_mask = new_mask;
             sys_mgmt_info.oper_gw = new_gw;
             sys_mgmt_info.oper_dns = ip_addr_get_ip4_u32(&new_dns);
-            sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->sys_mgmt_queue_send(M_UPDATE, SYS_OPER_IP_ADDR)");
-            ret = sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_ADDR, DB_ALL_ENTRIES, &sys_mgmt_info.oper_ip, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
-            if(MW_E_OK != ret)
-            {
-                sys_mgmt_info.oper_ip = IPADDR_ANY;
-            }
-            sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->sys_mgmt_queue_send(M_UPDATE, SYS_OPER_IP_MASK)");
-            ret = sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_MASK, DB_ALL_ENTRIES, &sys_mgmt_info.oper_mask, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
-            if(MW_E_OK != ret)
-            {
-                sys_mgmt_info.oper_mask = IPADDR_ANY;
-            }
-            sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->sys_mgmt_queue_send(M_UPDATE, SYS_OPER_IP_GW)");
-            ret = sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_GW, DB_ALL_ENTRIES, &sys_mgmt_info.oper_gw, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
-            if(MW_E_OK != ret)
-            {
-                sys_mgmt_info.oper_gw = IPADDR_ANY;
-            }
-            sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->sys_mgmt_queue_send(M_UPDATE, SYS_OPER_IP_DNS)");
-            ret = sys_mgmt_queue_send(M_UPDATE, SYS_OPER_INFO, SYS_OPER_IP_DNS, DB_ALL_ENTRIES, &sys_mgmt_info.oper_dns, sizeof(MW_IPV4_T), SYS_MGMT_DB_QUEUE_NAME);
-            if(MW_E_OK != ret)
-            {
-                sys_mgmt_info.oper_dns = IPADDR_ANY;
-            }
+            taskEXIT_CRITICAL();
             if(MW_DHCP_ENABLE == sys_mgmt_info.dhcp_enable)
             {
+                /* DHCP is bound, sys_mgmt task sends it before SYS_DHCP_ENABLE changes */
+                if (NULL != _ptr_sys_mgmt_oper_timer)
+                {
+                    osapi_timerStop(_ptr_sys_mgmt_oper_timer);
+                }
                 sys_mgmt_info.dhcp_enable = MW_DHCP_DONE;
-                ret = sys_mgmt_queue_send(M_UPDATE, SYS_INFO, SYS_DHCP_ENABLE, DB_ALL_ENTRIES, &sys_mgmt_info.dhcp_enable, sizeof(UI8_T), SYS_MGMT_DB_QUEUE_NAME);
-                if(MW_E_OK != ret)
+                if (MW_E_OK != dbapi_eventPost(&_sys_mgmt_loop, (SYS_MGMT_EVENT_OPER | SYS_MGMT_EVENT_DHCP)))
                 {
-                    sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "->sys_mgmt_queue_send(M_UPDATE, SYS_DHCP_ENABLE) fail.");
+                    sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_DEBUG, "post SYS_DHCP_ENABLE fail.");
                     sys_mgmt_info.dhcp_enable = MW_DHCP_ENABLE;
                 }
                 sys_mgmt_netif_ip_set(TRUE);
             }
+            else if ((NULL == _ptr_sys_mgmt_oper_timer) || (MW_E_OK != osapi_timerStart(_ptr_sys_mgmt_oper_timer)))
+            {
+                if (MW_E_OK != dbapi_eventPost(&_sys_mgmt_loop, SYS_MGMT_EVENT_OPER))
+                {
+                    sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "post the netif changes fail");
+                }
+            }
         }
     }
     else if (reason & LWIP_NSC_IPV4_DHCP_FAIL)
@@ -1382,12 +1698,20 @@ MW_ERROR_NO_T sys_mgmt_free_resource(void)
 {
     sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "");
 
+    /* The task may wait on the loop, delete it first */
+    osapi_threadDelete(sys_mgmt_task_handle);
+
+    dbapi_eventDelete(&_sys_mgmt_loop);
     if (osapi_msgDelete(SYS_MGMT_DB_QUEUE_NAME) != MW_E_OK)
     {
         sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "osapi_msgDelete for %s failed !", SYS_MGMT_DB_QUEUE_NAME);
     }
 
-    osapi_threadDelete(sys_mgmt_task_handle);
+    if (NULL != _ptr_sys_mgmt_oper_timer)
+    {
+        osapi_timerDelete(_ptr_sys_mgmt_oper_timer);
+        _ptr_sys_mgmt_oper_timer = NULL;
+    }
 
     return MW_E_OK;
 }
@@ -1419,6 +1743,12 @@ MW_ERROR_NO_T sys_mgmt_init(void)
         sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "osapi_msgCreate %s fail", SYS_MGMT_DB_QUEUE_NAME);
         return MW_E_NO_MEMORY;
     }
+    if (dbapi_eventCreate(SYS_MGMT_DB_QUEUE_NAME, SYS_MGMT_QUEUE_LENGTH, &_sys_mgmt_loop) != MW_E_OK)
+    {
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "dbapi_eventCreate %s fail", SYS_MGMT_DB_QUEUE_NAME);
+        osapi_msgDelete(SYS_MGMT_DB_QUEUE_NAME);
+        return MW_E_NO_MEMORY;
+    }
 
     if (osapi_threadCreate(SYS_MGMT_TASK_NAME,
                        configMINIMAL_STACK_SIZE*2,
@@ -1432,6 +1762,19 @@ MW_ERROR_NO_T sys_mgmt_init(void)
         return MW_E_NO_MEMORY;
     }
 
+    osapi_timerCreate(
+            SYS_MGMT_OPER_TIMER_NAME,
+            _sys_mgmt_oper_tmr,
+            FALSE,
+            SYS_MGMT_OPER_TIMER_PERIOD,
+            NULL,
+            &_ptr_sys_mgmt_oper_timer);
+    if (NULL == _ptr_sys_mgmt_oper_timer)
+    {
+        /* The netif changes are sent without coalescing */
+        sys_mgmt_debug(SYS_MGMT_DEBUG_LEVEL_ERROR, "osapi_timerCreate for %s failed !", SYS_MGMT_OPER_TIMER_NAME);
+    }
+
 #if LWIP_NETIF_EXT_STATUS_CALLBACK
     /* register for netif events when started on first netif */
     netif_add_ext_callback(&sys_mgmt_netif_callback, sys_mgmt_netif_ext_status_callback);
@@ -1567,6 +1910,7 @@ void sys_mgmt_dump()
 #ifndef AIR_SUPPORT_DHCP_SNOOP
     printf("\tDHCP ACL rule entry-id: %d\n\n", dhcp_acl_id);
 #endif /* AIR_SUPPORT_DHCP_SNOOP */
+    sys_mgmt_acl_dump();
 
     return;
 }
@@ -1772,6 +2116,230 @@ mw_dos_setGlobalCfg(
     return ((AIR_E_OK == rc) ? MW_E_OK : MW_E_OTHERS);
 }
 
+/* FUNCTION NAME: _sys_mgmt_acl_sync
+ * PURPOSE:
+ *      Update the occupancy bitmap of the dynamic ACL entries from hardware.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      Only the entries which are not allocated here are read, so the rules
+ *      set or deleted by other users are picked up. An entry which cannot
+ *      be read is taken as used.
+ */
+static void
+_sys_mgmt_acl_sync(
+    void)
+{
+    UI32_T          unit = 0;
+    UI16_T          slot;
+    AIR_ACL_RULE_T  acl_rule;
+
+    for (slot = 0; slot < SYS_MGMT_ACL_SLOT_NUM; slot++)
+    {
+        if ((NULL != _sys_mgmt_acl_owner[slot]) &&
+            (_sys_mgmt_acl_owner_hw != _sys_mgmt_acl_owner[slot]))
+        {
+            continue;
+        }
+        if ((AIR_E_OK != air_acl_getRule(unit, (MW_ACL_ID_DYNAMIC_MIN + slot), &acl_rule)) ||
+            (FALSE != acl_rule.rule_en))
+        {
+            _sys_mgmt_acl_bmp[slot / 32] |= (1UL << (slot % 32));
+            _sys_mgmt_acl_owner[slot] = _sys_mgmt_acl_owner_hw;
+        }
+        else
+        {
+            _sys_mgmt_acl_bmp[slot / 32] &= ~(1UL << (slot % 32));
+            _sys_mgmt_acl_owner[slot] = NULL;
+        }
+    }
+    _sys_mgmt_acl_synced = TRUE;
+}
+
+/* FUNCTION NAME: _sys_mgmt_acl_take
+ * PURPOSE:
+ *      Take the lowest free entry of the occupancy bitmap.
+ *
+ * INPUT:
+ *      ptr_owner       -- The owner name
+ *
+ * OUTPUT:
+ *      ptr_acl_id      -- The ACL entry id
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_TABLE_FULL
+ *
+ * NOTES:
+ *      The rule of a free entry is read again before it is taken. An entry
+ *      enabled by another user meanwhile is marked used and skipped.
+ */
+static MW_ERROR_NO_T
+_sys_mgmt_acl_take(
+    const C8_T *ptr_owner,
+    UI16_T *ptr_acl_id)
+{
+    UI32_T          unit = 0;
+    UI32_T          free_bmp;
+    UI16_T          word;
+    UI16_T          bit;
+    UI16_T          slot;
+    AIR_ACL_RULE_T  acl_rule;
+
+    for (word = 0; word < SYS_MGMT_ACL_WORD_NUM; word++)
+    {
+        free_bmp = ~_sys_mgmt_acl_bmp[word];
+        while (0 != free_bmp)
+        {
+            bit = 0;
+            while (0 == (free_bmp & (1UL << bit)))
+            {
+                bit++;
+            }
+            slot = (word * 32) + bit;
+            if (slot >= SYS_MGMT_ACL_SLOT_NUM)
+            {
+                return MW_E_TABLE_FULL;
+            }
+            _sys_mgmt_acl_bmp[word] |= (1UL << bit);
+            if ((AIR_E_OK != air_acl_getRule(unit, (MW_ACL_ID_DYNAMIC_MIN + slot), &acl_rule)) ||
+                (FALSE != acl_rule.rule_en))
+            {
+                _sys_mgmt_acl_owner[slot] = _sys_mgmt_acl_owner_hw;
+                free_bmp &= ~(1UL << bit);
+                continue;
+            }
+            _sys_mgmt_acl_owner[slot] = ptr_owner;
+            (*ptr_acl_id) = MW_ACL_ID_DYNAMIC_MIN + slot;
+            return MW_E_OK;
+        }
+    }
+    return MW_E_TABLE_FULL;
+}
+
+/* FUNCTION NAME: sys_mgmt_acl_alloc
+ * PURPOSE:
+ *      Allocate a dynamic ACL entry.
+ *
+ * INPUT:
+ *      ptr_owner       -- The owner name, kept for sys_mgmt_acl_dump()
+ *
+ * OUTPUT:
+ *      ptr_acl_id      -- The ACL entry id
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *      MW_E_TABLE_FULL
+ *
+ * NOTES:
+ *      Called with mw_acl_mutex_take() held. The lowest free entry of the
+ *      occupancy bitmap is taken, only its rule is read from hardware. When
+ *      none is free, the entries used by other users are read again once.
+ */
+MW_ERROR_NO_T
+sys_mgmt_acl_alloc(
+    const C8_T *ptr_owner,
+    UI16_T *ptr_acl_id)
+{
+    MW_ERROR_NO_T   rc;
+
+    MW_CHECK_PTR(ptr_owner);
+    MW_CHECK_PTR(ptr_acl_id);
+
+    if (FALSE == _sys_mgmt_acl_synced)
+    {
+        _sys_mgmt_acl_sync();
+        return _sys_mgmt_acl_take(ptr_owner, ptr_acl_id);
+    }
+    rc = _sys_mgmt_acl_take(ptr_owner, ptr_acl_id);
+    if (MW_E_TABLE_FULL == rc)
+    {
+        _sys_mgmt_acl_sync();
+        rc = _sys_mgmt_acl_take(ptr_owner, ptr_acl_id);
+    }
+    return rc;
+}
+
+/* FUNCTION NAME: sys_mgmt_acl_free
+ * PURPOSE:
+ *      Release a dynamic ACL entry.
+ *
+ * INPUT:
+ *      acl_id          -- The ACL entry id
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      MW_E_OK
+ *      MW_E_BAD_PARAMETER
+ *
+ * NOTES:
+ *      Called with mw_acl_mutex_take() held, after the rule is deleted.
+ */
+MW_ERROR_NO_T
+sys_mgmt_acl_free(
+    const UI16_T acl_id)
+{
+    UI16_T  slot;
+
+    if ((acl_id < MW_ACL_ID_DYNAMIC_MIN) || (acl_id > MW_ACL_ID_DYNAMIC_MAX))
+    {
+        return MW_E_BAD_PARAMETER;
+    }
+    slot = acl_id - MW_ACL_ID_DYNAMIC_MIN;
+    _sys_mgmt_acl_bmp[slot / 32] &= ~(1UL << (slot % 32));
+    _sys_mgmt_acl_owner[slot] = NULL;
+    return MW_E_OK;
+}
+
+/* FUNCTION NAME: sys_mgmt_acl_dump
+ * PURPOSE:
+ *      Dump the owners of the dynamic ACL entries.
+ *
+ * INPUT:
+ *      None
+ *
+ * OUTPUT:
+ *      None
+ *
+ * RETURN:
+ *      None
+ *
+ * NOTES:
+ *      None
+ */
+void
+sys_mgmt_acl_dump(
+    void)
+{
+    UI16_T  slot;
+
+    if (FALSE == _sys_mgmt_acl_synced)
+    {
+        osapi_printf("\tDynamic ACL entries: not allocated yet\n\n");
+        return;
+    }
+    osapi_printf("\tDynamic ACL entries:\n");
+    for (slot = 0; slot < SYS_MGMT_ACL_SLOT_NUM; slot++)
+    {
+        if (NULL != _sys_mgmt_acl_owner[slot])
+        {
+            osapi_printf("\t\tentry-id %d: %s\n", (MW_ACL_ID_DYNAMIC_MIN + slot), _sys_mgmt_acl_owner[slot]);
+        }
+    }
+    osapi_printf("\n");
+}
+
 /* FUNCTION NAME: sys_mgmt_language_init()
  * PURPOSE:
  *      Initialize system language.
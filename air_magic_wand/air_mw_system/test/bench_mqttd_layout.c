@@ -0,0 +1,275 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+/* FILE NAME:  bench_mqttd_layout.c
+ * PURPOSE:
+ *      Host benchmark of the MQTTD_CTRL_T and MQTTD_PUB_LIST_T layouts in
+ *      mqttd/mqttd.c, packed with embedded buffers against the aligned
+ *      layout with the hot fields grouped at the head.
+ *
+ * NOTES:
+ *      The structures are private to mqttd.c, so their layouts are mirrored
+ *      here: BENCH_CTRL_PACKED_T is the layout before the change and
+ *      BENCH_CTRL_T the current one, up to the identity strings. The fields
+ *      after them are not touched by the hot paths and are left out.
+ *
+ *      The loop runs what the timer, the receive loop and the publish path
+ *      do on every tick over BENCH_CTRL_NUM instances, so the working set
+ *      does not fit in L1 with the packed layout. Build it with the target
+ *      compiler (make bench HOST_CC=...) to see the byte-wise loads of
+ *      packed fields on cores without unaligned access.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include "mw_types.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define MQTTD_MAX_TOPIC_SIZE            (64)
+#define MQTTD_MAX_CLIENT_ID_SIZE        (64)
+#define MQTTD_MAX_TOPIC_PREFIX_SIZE     (64)
+#define MQTTD_MAX_SN_SIZE               (17)
+#define MQTTD_MAX_MAC_SIZE              (19)
+#define MQTTD_MAX_DEVICE_ID_SIZE        (33)
+#define MQTTD_MQX_OUTPUT_SIZE           (1024)
+#define MQTTD_MAX_CHUNK_NUM             (3)
+#define MQTTD_JSON_BUFF_SIZE            (MQTTD_MQX_OUTPUT_SIZE * MQTTD_MAX_CHUNK_NUM + 5)
+#define MQTTD_STATE_RUN                 (5)
+
+#define BENCH_CACHE_LINE                (64)
+#define BENCH_CTRL_NUM                  (256)
+#define BENCH_LIST_NUM                  (8)     /* remained messages of each instance */
+#define BENCH_ROUNDS                    (20000)
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+/* The cache lines spanned by the hot fields, first to last */
+#define BENCH_SPAN(__type__, __first__, __last__)                               \
+    (((offsetof(__type__, __last__) + sizeof(((__type__ *)0)->__last__) - 1) /  \
+      BENCH_CACHE_LINE) - (offsetof(__type__, __first__) / BENCH_CACHE_LINE) + 1)
+
+/* DATA TYPE DECLARATIONS
+ */
+typedef struct BENCH_LIST_PACKED_S
+{
+    C8_T            topic[MQTTD_MAX_TOPIC_SIZE];
+    UI16_T          msg_size;
+    void*           msg;
+    struct BENCH_LIST_PACKED_S *next;
+} ATTRIBUTE_PACK BENCH_LIST_PACKED_T;
+
+typedef struct BENCH_CTRL_PACKED_S
+{
+    UI32_T          state;
+    UI32_T          server_ip;
+    UI16_T          port;
+    UI16_T          cldb_id;
+    C8_T            client_id[MQTTD_MAX_CLIENT_ID_SIZE];
+    C8_T            topic_prefix[MQTTD_MAX_TOPIC_PREFIX_SIZE];
+    C8_T            sn[MQTTD_MAX_SN_SIZE];
+    C8_T            mac[MQTTD_MAX_MAC_SIZE];
+    C8_T            device_id[MQTTD_MAX_DEVICE_ID_SIZE];
+    void*           ptr_client;
+    UI8_T           db_subscribed;
+    UI8_T           reconnect;
+    C8_T            pub_in_topic[MQTTD_MAX_TOPIC_SIZE];
+    UI8_T           remain_msgs;
+    BENCH_LIST_PACKED_T *msg_head;
+    UI32_T          ticknum;
+    UI16_T          status_ontick;
+    UI16_T          mac_ontick;
+    UI8_T           mqtt_buff[MQTTD_MQX_OUTPUT_SIZE];
+    UI8_T           json_buff[MQTTD_JSON_BUFF_SIZE];
+} ATTRIBUTE_PACK BENCH_CTRL_PACKED_T;
+
+typedef struct BENCH_LIST_S
+{
+    struct BENCH_LIST_S *next;
+    void*           msg;
+    UI16_T          msg_size;
+    C8_T            topic[MQTTD_MAX_TOPIC_SIZE];
+} BENCH_LIST_T;
+
+typedef struct BENCH_CTRL_S
+{
+    UI32_T          state;
+    UI32_T          ticknum;
+    UI32_T          backoff;
+    UI32_T          retry_time;
+    void*           ptr_client;
+    BENCH_LIST_T    *msg_head;
+    UI8_T           *mqtt_buff;
+    UI8_T           *json_buff;
+    UI16_T          status_ontick;
+    UI16_T          mac_ontick;
+    UI16_T          port;
+    UI16_T          cldb_id;
+    UI8_T           remain_msgs;
+    UI8_T           db_subscribed;
+    UI8_T           reconnect;
+    UI8_T           retry_pending;
+    UI8_T           session_present;
+    UI8_T           protocol_version;
+    UI8_T           protocol_probe;
+    UI32_T          server_ip;
+    C8_T            client_id[MQTTD_MAX_CLIENT_ID_SIZE];
+    C8_T            topic_prefix[MQTTD_MAX_TOPIC_PREFIX_SIZE];
+    C8_T            sn[MQTTD_MAX_SN_SIZE];
+    C8_T            mac[MQTTD_MAX_MAC_SIZE];
+    C8_T            device_id[MQTTD_MAX_DEVICE_ID_SIZE];
+    C8_T            pub_in_topic[MQTTD_MAX_TOPIC_SIZE];
+} BENCH_CTRL_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+static volatile UI32_T _bench_sink;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+static double _bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/* The tick of mqttd: the timer, the remained list walk and its count */
+#define BENCH_TICK(__ptr__, __node_type__, __sum__) do                          \
+{                                                                               \
+    __node_type__ *__n__ = NULL;                                                \
+    UI8_T __cnt__ = 0;                                                          \
+                                                                                \
+    if ((MQTTD_STATE_RUN == (__ptr__)->state) && (NULL != (__ptr__)->ptr_client)) \
+    {                                                                           \
+        (__ptr__)->ticknum++;                                                   \
+        if ((__ptr__)->ticknum == (__ptr__)->status_ontick)                     \
+        {                                                                       \
+            (__ptr__)->status_ontick += 3000;                                   \
+        }                                                                       \
+        for (__n__ = (__ptr__)->msg_head; NULL != __n__; __n__ = __n__->next)   \
+        {                                                                       \
+            (__sum__) += __n__->msg_size;                                       \
+            __cnt__++;                                                          \
+        }                                                                       \
+        (__ptr__)->remain_msgs = __cnt__;                                       \
+    }                                                                           \
+} while (0)
+
+static double _bench_packed(void)
+{
+    BENCH_CTRL_PACKED_T *ptr_ctrl = calloc(BENCH_CTRL_NUM, sizeof(BENCH_CTRL_PACKED_T));
+    BENCH_LIST_PACKED_T *ptr_node = calloc(BENCH_CTRL_NUM * BENCH_LIST_NUM, sizeof(BENCH_LIST_PACKED_T));
+    UI32_T idx, node, round, sum = 0;
+    double start;
+
+    for (idx = 0; idx < BENCH_CTRL_NUM; idx++)
+    {
+        ptr_ctrl[idx].state = MQTTD_STATE_RUN;
+        ptr_ctrl[idx].ptr_client = &ptr_ctrl[idx];
+        for (node = 0; node < BENCH_LIST_NUM; node++)
+        {
+            ptr_node[(idx * BENCH_LIST_NUM) + node].msg_size = node;
+            ptr_node[(idx * BENCH_LIST_NUM) + node].next =
+                (node + 1 < BENCH_LIST_NUM) ? &ptr_node[(idx * BENCH_LIST_NUM) + node + 1] : NULL;
+        }
+        ptr_ctrl[idx].msg_head = &ptr_node[idx * BENCH_LIST_NUM];
+    }
+    start = _bench_now();
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for (idx = 0; idx < BENCH_CTRL_NUM; idx++)
+        {
+            BENCH_TICK(&ptr_ctrl[idx], BENCH_LIST_PACKED_T, sum);
+        }
+    }
+    start = _bench_now() - start;
+    _bench_sink = sum;
+    free(ptr_node);
+    free(ptr_ctrl);
+    return start / ((double)BENCH_ROUNDS * BENCH_CTRL_NUM);
+}
+
+static double _bench_aligned(void)
+{
+    BENCH_CTRL_T *ptr_ctrl = calloc(BENCH_CTRL_NUM, sizeof(BENCH_CTRL_T));
+    BENCH_LIST_T *ptr_node = calloc(BENCH_CTRL_NUM * BENCH_LIST_NUM, sizeof(BENCH_LIST_T));
+    UI32_T idx, node, round, sum = 0;
+    double start;
+
+    for (idx = 0; idx < BENCH_CTRL_NUM; idx++)
+    {
+        ptr_ctrl[idx].state = MQTTD_STATE_RUN;
+        ptr_ctrl[idx].ptr_client = &ptr_ctrl[idx];
+        for (node = 0; node < BENCH_LIST_NUM; node++)
+        {
+            ptr_node[(idx * BENCH_LIST_NUM) + node].msg_size = node;
+            ptr_node[(idx * BENCH_LIST_NUM) + node].next =
+                (node + 1 < BENCH_LIST_NUM) ? &ptr_node[(idx * BENCH_LIST_NUM) + node + 1] : NULL;
+        }
+        ptr_ctrl[idx].msg_head = &ptr_node[idx * BENCH_LIST_NUM];
+    }
+    start = _bench_now();
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for (idx = 0; idx < BENCH_CTRL_NUM; idx++)
+        {
+            BENCH_TICK(&ptr_ctrl[idx], BENCH_LIST_T, sum);
+        }
+    }
+    start = _bench_now() - start;
+    _bench_sink = sum;
+    free(ptr_node);
+    free(ptr_ctrl);
+    return start / ((double)BENCH_ROUNDS * BENCH_CTRL_NUM);
+}
+
+int main(void)
+{
+    double packed = _bench_packed();
+    double aligned = _bench_aligned();
+
+    printf("%-8s %-10s %-12s %-12s %s\n", "layout", "ctrl size", "hot lines", "node size", "ns/tick");
+    printf("%-8s %-10zu %-12zu %-12zu %.2f\n", "packed", sizeof(BENCH_CTRL_PACKED_T),
+        BENCH_SPAN(BENCH_CTRL_PACKED_T, state, mac_ontick), sizeof(BENCH_LIST_PACKED_T), packed);
+    printf("%-8s %-10zu %-12zu %-12zu %.2f\n", "aligned", sizeof(BENCH_CTRL_T),
+        BENCH_SPAN(BENCH_CTRL_T, state, remain_msgs), sizeof(BENCH_LIST_T), aligned);
+    printf("speedup: %.2fx\n", packed / aligned);
+    return 0;
+}
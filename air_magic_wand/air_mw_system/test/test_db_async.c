@@ -0,0 +1,303 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+/* FILE NAME:  test_db_async.c
+ * PURPOSE:
+ *      Host unit test of the asynchronous DB gets in db/freeRTOS/src/db_async.c.
+ *
+ * NOTES:
+ *      dbapi_sendMsg keeps the requests, the test plays the DB task by
+ *      answering them with _test_answer in the order it chooses.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mw_error.h"
+#include "mw_types.h"
+#include "db_api.h"
+#include "test_util.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define TEST_QNAME                  "tst"
+#define TEST_QNAME_OTHER            "oth"
+#define TEST_DATA_SIZE              (4)
+#define TEST_SENT_MAX               (DB_ASYNC_PENDING_NUM + 1)
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+ */
+typedef struct TEST_DONE_S
+{
+    UI32_T          calls;
+    MW_ERROR_NO_T   result;
+    UI16_T          e_idx;      /* the entry the response carried */
+} TEST_DONE_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+int test_failed;
+
+static TickType_t _test_tick;
+static UI32_T _test_live_msgs;
+static BOOL_T _test_send_fail;
+static DB_MSG_T *_test_sent[TEST_SENT_MAX];
+static UI32_T _test_sent_num;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+TickType_t xTaskGetTickCount(void)
+{
+    return _test_tick;
+}
+
+MW_ERROR_NO_T dbapi_allocMsg(const UI32_T msg_size, DB_MSG_T **pptr_msg)
+{
+    *pptr_msg = calloc(1, msg_size);
+    if (NULL == *pptr_msg)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    _test_live_msgs++;
+    return MW_E_OK;
+}
+
+void dbapi_freeMsg(DB_MSG_T *ptr_msg)
+{
+    if (NULL != ptr_msg)
+    {
+        _test_live_msgs--;
+        free(ptr_msg);
+    }
+}
+
+MW_ERROR_NO_T dbapi_getDataSize(DB_REQUEST_TYPE_T req, UI16_T *total_size)
+{
+    *total_size = TEST_DATA_SIZE;
+    return MW_E_OK;
+}
+
+UI16_T dbapi_setMsgHeader(void *ptr_input, const C8_T *client_qname, const UI8_T method, const UI8_T pcount)
+{
+    DB_MSG_T *ptr_msg = ptr_input;
+
+    memcpy(ptr_msg->cq_name, client_qname, DB_Q_NAME_SIZE);
+    ptr_msg->method = method;
+    ptr_msg->type.count = pcount;
+    return DB_MSG_HEADER_SIZE;
+}
+
+UI16_T dbapi_setMsgPayload(UI8_T method, UI8_T in_t_idx, UI8_T in_f_idx, UI16_T in_e_idx, void *ptr_raw_data, void *ptr_input)
+{
+    DB_PAYLOAD_T payload;
+
+    payload.request.t_idx = in_t_idx;
+    payload.request.f_idx = in_f_idx;
+    payload.request.e_idx = in_e_idx;
+    payload.data_size = 0;
+    memcpy(ptr_input, &payload, DB_MSG_PAYLOAD_SIZE);
+    return DB_MSG_PAYLOAD_SIZE;
+}
+
+/* The requests wait here for the test to answer them */
+MW_ERROR_NO_T dbapi_sendMsg(DB_MSG_T *ptr_msg, const UI32_T timeout)
+{
+    if (TRUE == _test_send_fail)
+    {
+        dbapi_freeMsg(ptr_msg);
+        return MW_E_TIMEOUT;
+    }
+    TEST_ASSERT(M_GET == ptr_msg->method);
+    TEST_ASSERT(1 == ptr_msg->type.count);
+    TEST_ASSERT(_test_sent_num < TEST_SENT_MAX);
+    _test_sent[_test_sent_num++] = ptr_msg;
+    return MW_E_OK;
+}
+
+/* Answer the idx-th request still waiting, as DB task does */
+static DB_MSG_T *_test_answer(UI32_T idx, MW_ERROR_NO_T result)
+{
+    DB_MSG_T *ptr_req = _test_sent[idx];
+    DB_MSG_T *ptr_rsp = NULL;
+    DB_PAYLOAD_T *ptr_payload = NULL;
+
+    dbapi_allocMsg(DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + TEST_DATA_SIZE, &ptr_rsp);
+    memcpy(ptr_rsp->cq_name, ptr_req->cq_name, DB_Q_NAME_SIZE);
+    ptr_rsp->method = M_GET | M_B_RESPONSE;
+    ptr_rsp->type.result = result;
+    ptr_payload = (DB_PAYLOAD_T *)&(ptr_rsp->ptr_payload);
+    memcpy(ptr_payload, &(ptr_req->ptr_payload), DB_MSG_PAYLOAD_SIZE);
+    ptr_payload->data_size = TEST_DATA_SIZE;
+    dbapi_freeMsg(ptr_req);
+    _test_sent_num--;
+    memmove(&_test_sent[idx], &_test_sent[idx + 1], (_test_sent_num - idx) * sizeof(DB_MSG_T *));
+    return ptr_rsp;
+}
+
+static void _test_done_cb(const MW_ERROR_NO_T result, DB_MSG_T *ptr_msg, void *ptr_data, const UI16_T data_size, void *ptr_arg)
+{
+    TEST_DONE_T *ptr_done = ptr_arg;
+    DB_PAYLOAD_T *ptr_payload = NULL;
+
+    ptr_done->calls++;
+    ptr_done->result = result;
+    if (MW_E_OK != result)
+    {
+        TEST_ASSERT(NULL == ptr_msg);
+        TEST_ASSERT(NULL == ptr_data);
+        return;
+    }
+    ptr_payload = (DB_PAYLOAD_T *)&(ptr_msg->ptr_payload);
+    TEST_ASSERT((void *)&(ptr_payload->ptr_data) == ptr_data);
+    TEST_ASSERT(TEST_DATA_SIZE == data_size);
+    ptr_done->e_idx = ptr_payload->request.e_idx;
+    dbapi_freeMsg(ptr_msg);
+}
+
+static DB_REQUEST_TYPE_T _test_req(UI16_T e_idx)
+{
+    DB_REQUEST_TYPE_T request = { PORT_CFG_INFO, DB_ALL_FIELDS, e_idx };
+
+    return request;
+}
+
+static void _test_match(void)
+{
+    TEST_DONE_T done[3];
+    DB_MSG_T *ptr_msg = NULL;
+
+    memset(done, 0, sizeof(done));
+    TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(1), _test_done_cb, &done[0]));
+    TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(2), _test_done_cb, &done[1]));
+    TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(1), _test_done_cb, &done[2]));
+    TEST_ASSERT(TRUE == dbapi_hasPendingAsync(TEST_QNAME));
+    TEST_ASSERT(FALSE == dbapi_hasPendingAsync(TEST_QNAME_OTHER));
+
+    /* the response of entry 2 completes the get of entry 2 */
+    TEST_ASSERT(MW_E_OK == dbapi_completeAsync(_test_answer(1, MW_E_OK)));
+    TEST_ASSERT((1 == done[1].calls) && (2 == done[1].e_idx));
+    TEST_ASSERT((0 == done[0].calls) && (0 == done[2].calls));
+
+    /* the same T/F/E completes in issue order */
+    TEST_ASSERT(MW_E_OK == dbapi_completeAsync(_test_answer(0, MW_E_OK)));
+    TEST_ASSERT((1 == done[0].calls) && (0 == done[2].calls));
+    TEST_ASSERT(MW_E_OK == dbapi_completeAsync(_test_answer(0, MW_E_OK)));
+    TEST_ASSERT((1 == done[2].calls) && (MW_E_OK == done[2].result));
+    TEST_ASSERT(FALSE == dbapi_hasPendingAsync(TEST_QNAME));
+
+    /* a response nobody waits for stays with the caller */
+    TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(3), _test_done_cb, &done[0]));
+    ptr_msg = _test_answer(0, MW_E_OK);
+    ptr_msg->cq_name[0] = 'x';
+    TEST_ASSERT(MW_E_ENTRY_NOT_FOUND == dbapi_completeAsync(ptr_msg));
+    ptr_msg->cq_name[0] = TEST_QNAME[0];
+    ptr_msg->method = M_ACK;
+    TEST_ASSERT(MW_E_ENTRY_NOT_FOUND == dbapi_completeAsync(ptr_msg));
+    ptr_msg->method = M_RESPONSE;
+    TEST_ASSERT(MW_E_OK == dbapi_completeAsync(ptr_msg));
+    TEST_ASSERT(2 == done[0].calls);
+    TEST_ASSERT(0 == _test_live_msgs);
+}
+
+static void _test_fail(void)
+{
+    TEST_DONE_T done[DB_ASYNC_PENDING_NUM + 1];
+    UI32_T idx;
+
+    memset(done, 0, sizeof(done));
+
+    /* a failed get completes the oldest request of the client */
+    TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(1), _test_done_cb, &done[0]));
+    TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(2), _test_done_cb, &done[1]));
+    TEST_ASSERT(MW_E_OK == dbapi_completeAsync(_test_answer(0, MW_E_ENTRY_NOT_FOUND)));
+    TEST_ASSERT((1 == done[0].calls) && (MW_E_ENTRY_NOT_FOUND == done[0].result));
+    TEST_ASSERT(0 == done[1].calls);
+
+    /* only the expired requests are failed */
+    _test_tick += DB_ASYNC_TIMEOUT;
+    TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(3), _test_done_cb, &done[2]));
+    dbapi_expireAsync(TEST_QNAME);
+    TEST_ASSERT((1 == done[1].calls) && (MW_E_TIMEOUT == done[1].result));
+    TEST_ASSERT(0 == done[2].calls);
+    dbapi_cancelAsync(TEST_QNAME);
+    TEST_ASSERT((1 == done[2].calls) && (MW_E_OP_INCOMPLETE == done[2].result));
+
+    /* the late responses are left to the caller */
+    while (0 != _test_sent_num)
+    {
+        DB_MSG_T *ptr_msg = _test_answer(0, MW_E_OK);
+
+        TEST_ASSERT(MW_E_ENTRY_NOT_FOUND == dbapi_completeAsync(ptr_msg));
+        dbapi_freeMsg(ptr_msg);
+    }
+
+    /* the table is full */
+    memset(done, 0, sizeof(done));
+    for (idx = 0; idx < DB_ASYNC_PENDING_NUM; idx++)
+    {
+        TEST_ASSERT(MW_E_OK == dbapi_getDataAsync(TEST_QNAME, _test_req(idx), _test_done_cb, &done[idx]));
+    }
+    TEST_ASSERT(MW_E_TABLE_FULL == dbapi_getDataAsync(TEST_QNAME, _test_req(idx), _test_done_cb, &done[idx]));
+    dbapi_cancelAsync(TEST_QNAME);
+
+    /* a request which is not sent is not pending */
+    _test_send_fail = TRUE;
+    TEST_ASSERT(MW_E_TIMEOUT == dbapi_getDataAsync(TEST_QNAME, _test_req(1), _test_done_cb, &done[0]));
+    _test_send_fail = FALSE;
+    TEST_ASSERT(FALSE == dbapi_hasPendingAsync(TEST_QNAME));
+    while (0 != _test_sent_num)
+    {
+        dbapi_freeMsg(_test_answer(0, MW_E_OK));
+    }
+    for (idx = 0; idx < DB_ASYNC_PENDING_NUM; idx++)
+    {
+        TEST_ASSERT(1 == done[idx].calls);
+    }
+    TEST_ASSERT(0 == _test_live_msgs);
+}
+
+int main(void)
+{
+    _test_match();
+    _test_fail();
+
+    return TEST_RESULT("test_db_async");
+}
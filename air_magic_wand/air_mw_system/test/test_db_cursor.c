@@ -0,0 +1,514 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  test_db_cursor.c
+ * PURPOSE:
+ *      Host unit test of the DB cursor in db/freeRTOS/src/db_cursor.c.
+ *
+ * NOTES:
+ *      The DB task is faked by dbapi_sendMsg, which answers each M_GET into
+ *      the reply queue at once unless the test holds the reply back. The
+ *      data of entry e is the UI32_T e * TEST_ENTRY_MUL. In the FDB walk the
+ *      data of entry e of batch b is b * TEST_FDB_MUL + e.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mw_error.h"
+#include "mw_types.h"
+#include "osapi_message.h"
+#include "db_api.h"
+#include "test_util.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define TEST_TABLE                  (STATIC_MAC_ENTRY)
+#define TEST_ENTRY_MUL              (3)
+#define TEST_QUEUE_LEN              (4)
+#define TEST_FDB_MUL                (1000)
+#define TEST_FDB_BATCH_MAX          (4)
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+ */
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+int test_failed;
+
+static UI16_T _test_entries_num;
+static UI16_T _test_entry_size;
+static UI32_T _test_sends;
+static UI32_T _test_hold_send;      /* the send whose reply is held, 0 for none */
+static DB_MSG_T *_test_held;
+static UI32_T _test_live_msgs;
+static C8_T _test_queue_name[DB_Q_NAME_SIZE + 1];
+static DB_MSG_T *_test_queue[TEST_QUEUE_LEN];
+static UI32_T _test_queue_num;
+static UI16_T _test_fdb_count[TEST_FDB_BATCH_MAX];  /* the entries of each batch */
+static UI8_T _test_fdb_batches;
+static UI8_T _test_fdb_batch;
+static UI8_T _test_fdb_result;
+static UI32_T _test_fdb_actions;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+MW_ERROR_NO_T osapi_msgCreate(const C8_T *ptr_name, const UI32_T count, const UI32_T size)
+{
+    if ('\0' != _test_queue_name[0])
+    {
+        return MW_E_NO_MEMORY;
+    }
+    strncpy(_test_queue_name, ptr_name, DB_Q_NAME_SIZE);
+    _test_queue_num = 0;
+    return MW_E_OK;
+}
+
+MW_ERROR_NO_T osapi_msgDelete(const C8_T *ptr_name)
+{
+    TEST_ASSERT(0 == strncmp(_test_queue_name, ptr_name, DB_Q_NAME_SIZE));
+    TEST_ASSERT(0 == _test_queue_num);
+    _test_queue_name[0] = '\0';
+    return MW_E_OK;
+}
+
+void *osapi_msgFindHandle(const C8_T *ptr_name)
+{
+    if (0 == strncmp(_test_queue_name, ptr_name, DB_Q_NAME_SIZE))
+    {
+        return _test_queue;
+    }
+    return NULL;
+}
+
+MW_ERROR_NO_T dbapi_allocMsg(const UI32_T msg_size, DB_MSG_T **pptr_msg)
+{
+    /* The real pool rejects what is over its largest class */
+    TEST_ASSERT(msg_size <= DB_MSG_POOL_XL_SIZE + DB_MSG_HEADER_SIZE);
+    *pptr_msg = calloc(1, msg_size);
+    if (NULL == *pptr_msg)
+    {
+        return MW_E_NO_MEMORY;
+    }
+    _test_live_msgs++;
+    return MW_E_OK;
+}
+
+void dbapi_freeMsg(DB_MSG_T *ptr_msg)
+{
+    if (NULL != ptr_msg)
+    {
+        _test_live_msgs--;
+        free(ptr_msg);
+    }
+}
+
+MW_ERROR_NO_T dbapi_getEntriesNum(UI8_T t_idx, UI16_T *ptr_entriesnum)
+{
+    *ptr_entriesnum = _test_entries_num;
+    return MW_E_OK;
+}
+
+MW_ERROR_NO_T dbapi_getDataSize(DB_REQUEST_TYPE_T req, UI16_T *total_size)
+{
+    *total_size = (DYNAMIC_MAC_ADDRESS_ENTRY_CFG == req.t_idx) ?
+        sizeof(DB_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_T) : _test_entry_size;
+    return MW_E_OK;
+}
+
+UI16_T dbapi_setMsgHeader(void *ptr_input, const C8_T *client_qname, const UI8_T method, const UI8_T pcount)
+{
+    DB_MSG_T *ptr_msg = ptr_input;
+
+    memcpy(ptr_msg->cq_name, client_qname, DB_Q_NAME_SIZE);
+    ptr_msg->method = method;
+    ptr_msg->type.count = pcount;
+    return DB_MSG_HEADER_SIZE;
+}
+
+UI16_T dbapi_setMsgPayload(UI8_T method, UI8_T in_t_idx, UI8_T in_f_idx, UI16_T in_e_idx, void *ptr_raw_data, void *ptr_input)
+{
+    DB_PAYLOAD_T payload;
+
+    payload.request.t_idx = in_t_idx;
+    payload.request.f_idx = in_f_idx;
+    payload.request.e_idx = in_e_idx;
+    /* The only update of the cursor is the one byte FDB walk action */
+    payload.data_size = (NULL != ptr_raw_data) ? sizeof(UI8_T) : 0;
+    memcpy(ptr_input, &payload, DB_MSG_PAYLOAD_SIZE);
+    if (NULL != ptr_raw_data)
+    {
+        memcpy(&(((DB_PAYLOAD_T *)ptr_input)->ptr_data), ptr_raw_data, sizeof(UI8_T));
+    }
+    return DB_MSG_PAYLOAD_SIZE + payload.data_size;
+}
+
+/* The fake FDB walk of DB, an action moves to the next batch */
+static DB_MSG_T *_test_fdb_answer(DB_MSG_T *ptr_msg)
+{
+    DB_MSG_T *ptr_rsp = NULL;
+    DB_PAYLOAD_T *ptr_req = (DB_PAYLOAD_T *)&(ptr_msg->ptr_payload);
+    DB_PAYLOAD_T *ptr_out = NULL;
+    DB_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_T cfg;
+    UI8_T action = 0;
+    BOOL_T last = FALSE;
+
+    TEST_ASSERT(1 == ptr_msg->type.count);
+    dbapi_allocMsg(DB_MSG_HEADER_SIZE + DB_MSG_PAYLOAD_SIZE + sizeof(cfg), &ptr_rsp);
+    memcpy(ptr_rsp->cq_name, ptr_msg->cq_name, DB_Q_NAME_SIZE);
+    ptr_rsp->method = ptr_msg->method | M_B_RESPONSE;
+    ptr_rsp->type.result = MW_E_OK;
+    ptr_out = (DB_PAYLOAD_T *)&(ptr_rsp->ptr_payload);
+    memcpy(&(ptr_out->request), &(ptr_req->request), sizeof(DB_REQUEST_TYPE_T));
+    if (M_UPDATE == ptr_msg->method)
+    {
+        TEST_ASSERT(ACTION_RESULT == ptr_req->request.f_idx);
+        TEST_ASSERT(sizeof(UI8_T) == ptr_req->data_size);
+        memcpy(&action, &(ptr_req->ptr_data), sizeof(action));
+        _test_fdb_actions++;
+        if (AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_ACTION_START == action)
+        {
+            _test_fdb_batch = 0;
+        }
+        else
+        {
+            TEST_ASSERT(AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_ACTION_CONTINUE == action);
+            TEST_ASSERT(_test_fdb_batch + 1 < _test_fdb_batches);
+            _test_fdb_batch++;
+        }
+        last = (_test_fdb_batch + 1 >= _test_fdb_batches) ? TRUE : FALSE;
+        if (AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_ACTION_START == action)
+        {
+            _test_fdb_result = last ? AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_START_END :
+                                      AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_START_DONE;
+        }
+        else
+        {
+            _test_fdb_result = last ? AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_CONTINUE_END :
+                                      AIR_DYNAMIC_MAC_ADDRESS_ENTRY_CFG_RESULT_CONTINUE_DONE;
+        }
+        ptr_out->data_size = 0;
+    }
+    else
+    {
+        TEST_ASSERT(M_GET == ptr_msg->method);
+        cfg.action_result = _test_fdb_result;
+        cfg.dynamic_entry_count = (UI8_T)_test_fdb_count[_test_fdb_batch];
+        ptr_out->data_size = sizeof(cfg);
+        memcpy(&(ptr_out->ptr_data), &cfg, sizeof(cfg));
+    }
+    return ptr_rsp;
+}
+
+/* The fake DB task, answers the M_GET pages */
+MW_ERROR_NO_T dbapi_sendMsg(DB_MSG_T *ptr_msg, const UI32_T timeout)
+{
+    DB_MSG_T *ptr_rsp = NULL;
+    DB_REQUEST_TYPE_T request;
+    UI8_T *ptr_req = (UI8_T *)&(ptr_msg->ptr_payload);
+    UI8_T *ptr_out = NULL;
+    UI32_T data = 0;
+    UI8_T count = ptr_msg->type.count;
+    UI8_T idx;
+
+    _test_sends++;
+    TEST_ASSERT(0 < count);
+    TEST_ASSERT(osapi_msgFindHandle(ptr_msg->cq_name) != NULL);
+    memcpy(&request, ptr_req, sizeof(request));
+    if (DYNAMIC_MAC_ADDRESS_ENTRY_CFG == request.t_idx)
+    {
+        ptr_rsp = _test_fdb_answer(ptr_msg);
+        dbapi_freeMsg(ptr_msg);
+        TEST_ASSERT(_test_queue_num < TEST_QUEUE_LEN);
+        _test_queue[_test_queue_num++] = ptr_rsp;
+        return MW_E_OK;
+    }
+    TEST_ASSERT(M_GET == ptr_msg->method);
+    dbapi_allocMsg(DB_MSG_HEADER_SIZE + (count * (DB_MSG_PAYLOAD_SIZE + _test_entry_size)), &ptr_rsp);
+    memcpy(ptr_rsp->cq_name, ptr_msg->cq_name, DB_Q_NAME_SIZE);
+    ptr_rsp->method = M_GET | M_B_RESPONSE;
+    ptr_rsp->type.result = MW_E_OK;
+    ptr_out = (UI8_T *)&(ptr_rsp->ptr_payload);
+    for (idx = 0; idx < count; idx++)
+    {
+        memcpy(&request, ptr_req, sizeof(request));
+        ptr_req += DB_MSG_PAYLOAD_SIZE;
+        if (DYNAMIC_MAC_ADDRESS_ENTRY == request.t_idx)
+        {
+            TEST_ASSERT((1 <= request.e_idx) && (request.e_idx <= _test_fdb_count[_test_fdb_batch]));
+            data = _test_fdb_batch * TEST_FDB_MUL + request.e_idx;
+        }
+        else
+        {
+            TEST_ASSERT(TEST_TABLE == request.t_idx);
+            TEST_ASSERT((1 <= request.e_idx) && (request.e_idx <= _test_entries_num));
+            data = request.e_idx * TEST_ENTRY_MUL;
+        }
+        memcpy(ptr_out, &request, sizeof(request));
+        ptr_out += sizeof(request);
+        memcpy(ptr_out, &_test_entry_size, sizeof(UI16_T));
+        ptr_out += sizeof(UI16_T);
+        memset(ptr_out, 0, _test_entry_size);
+        memcpy(ptr_out, &data, sizeof(data));
+        ptr_out += _test_entry_size;
+    }
+    dbapi_freeMsg(ptr_msg);
+
+    if (_test_sends == _test_hold_send)
+    {
+        _test_held = ptr_rsp;
+        return MW_E_OK;
+    }
+    TEST_ASSERT(_test_queue_num < TEST_QUEUE_LEN);
+    _test_queue[_test_queue_num++] = ptr_rsp;
+    return MW_E_OK;
+}
+
+MW_ERROR_NO_T dbapi_recvMsg(const C8_T *client_qname, DB_MSG_T **pptr_out_msg, const UI32_T timeout)
+{
+    TEST_ASSERT(osapi_msgFindHandle(client_qname) != NULL);
+    if (0 == _test_queue_num)
+    {
+        return MW_E_TIMEOUT;
+    }
+    *pptr_out_msg = _test_queue[0];
+    _test_queue_num--;
+    memmove(&_test_queue[0], &_test_queue[1], _test_queue_num * sizeof(DB_MSG_T *));
+    return MW_E_OK;
+}
+
+static void _test_reset(UI16_T entries_num, UI16_T entry_size)
+{
+    _test_entries_num = entries_num;
+    _test_entry_size = entry_size;
+    _test_sends = 0;
+    _test_hold_send = 0;
+    _test_held = NULL;
+}
+
+static BOOL_T _test_keep_odd(const UI16_T pos, const UI16_T data_size, const void *ptr_data, void *ptr_arg)
+{
+    (*(UI32_T *)ptr_arg)++;
+    return (pos & 1) ? TRUE : FALSE;
+}
+
+/* Walk a whole table, checking the order and the data of each entry */
+static void _test_walk(UI16_T entries_num, UI16_T entry_size, UI8_T page_num, UI32_T sends)
+{
+    DB_CURSOR_T cursor;
+    MW_ERROR_NO_T rc = MW_E_OK;
+    UI16_T pos = 0;
+    UI16_T size = 0;
+    UI16_T expect = 1;
+    UI32_T data = 0;
+    void *ptr_data = NULL;
+
+    _test_reset(entries_num, entry_size);
+    TEST_ASSERT(MW_E_OK == dbapi_cursorOpen(TEST_TABLE, DB_ALL_FIELDS, page_num, NULL, NULL, &cursor));
+    while (MW_E_OK == (rc = dbapi_cursorNext(&cursor, &pos, &size, &ptr_data)))
+    {
+        memcpy(&data, ptr_data, sizeof(data));
+        TEST_ASSERT(expect == pos);
+        TEST_ASSERT(entry_size == size);
+        TEST_ASSERT(pos * TEST_ENTRY_MUL == data);
+        expect++;
+    }
+    TEST_ASSERT(MW_E_ENTRY_NOT_FOUND == rc);
+    TEST_ASSERT(entries_num + 1 == expect);
+    TEST_ASSERT(sends == _test_sends);
+    /* the last page is released when the walk ends */
+    TEST_ASSERT(0 == _test_live_msgs);
+    dbapi_cursorClose(&cursor);
+    TEST_ASSERT(0 == _test_live_msgs);
+}
+
+static void _test_paging(void)
+{
+    /* 70 entries in pages of DB_CURSOR_PAGE_MAX */
+    _test_walk(70, 4, DB_CURSOR_PAGE_MAX, 3);
+    /* page_num above DB_CURSOR_PAGE_MAX is clamped */
+    _test_walk(70, 4, 0xFF, 3);
+    _test_walk(5, 4, 2, 3);
+    _test_walk(0, 4, DB_CURSOR_PAGE_MAX, 0);
+    /* a page is cut down to fit DB_MSG_POOL_XL_SIZE */
+    _test_walk(10, DB_MSG_POOL_XL_SIZE / 4, DB_CURSOR_PAGE_MAX, 4);
+}
+
+static void _test_filter(void)
+{
+    DB_CURSOR_T cursor;
+    MW_ERROR_NO_T rc = MW_E_OK;
+    UI16_T pos = 0;
+    UI16_T size = 0;
+    UI32_T seen = 0;
+    UI32_T kept = 0;
+    void *ptr_data = NULL;
+
+    _test_reset(40, 4);
+    TEST_ASSERT(MW_E_OK == dbapi_cursorOpen(TEST_TABLE, DB_ALL_FIELDS, 16, _test_keep_odd, &seen, &cursor));
+    while (MW_E_OK == (rc = dbapi_cursorNext(&cursor, &pos, &size, &ptr_data)))
+    {
+        TEST_ASSERT(pos & 1);
+        kept++;
+    }
+    TEST_ASSERT(MW_E_ENTRY_NOT_FOUND == rc);
+    TEST_ASSERT(40 == seen);
+    TEST_ASSERT(20 == kept);
+    dbapi_cursorClose(&cursor);
+    TEST_ASSERT(0 == _test_live_msgs);
+}
+
+static void _test_timeout(void)
+{
+    DB_CURSOR_T cursor;
+    UI16_T pos = 0;
+    UI16_T size = 0;
+    UI16_T idx;
+    void *ptr_data = NULL;
+
+    /* the reply of the second page is late */
+    _test_reset(20, 4);
+    _test_hold_send = 2;
+    TEST_ASSERT(MW_E_OK == dbapi_cursorOpen(TEST_TABLE, DB_ALL_FIELDS, 10, NULL, NULL, &cursor));
+    for (idx = 0; idx < 10; idx++)
+    {
+        TEST_ASSERT(MW_E_OK == dbapi_cursorNext(&cursor, &pos, &size, &ptr_data));
+    }
+    TEST_ASSERT(MW_E_TIMEOUT == dbapi_cursorNext(&cursor, &pos, &size, &ptr_data));
+
+    /* the late reply is not taken for the reply of a later page */
+    _test_queue[_test_queue_num++] = _test_held;
+    TEST_ASSERT(MW_E_TIMEOUT == dbapi_cursorNext(&cursor, &pos, &size, &ptr_data));
+    TEST_ASSERT(2 == _test_sends);
+
+    /* close drops the late reply with the queue */
+    dbapi_cursorClose(&cursor);
+    TEST_ASSERT(0 == _test_live_msgs);
+    TEST_ASSERT('\0' == _test_queue_name[0]);
+}
+
+/* Walk the FDB batches, the positions run on across the batches */
+static void _test_fdb_walk(const UI16_T *ptr_counts, UI8_T batches, UI8_T page_num, UI32_T sends)
+{
+    DB_CURSOR_T cursor;
+    MW_ERROR_NO_T rc = MW_E_OK;
+    UI16_T pos = 0;
+    UI16_T size = 0;
+    UI16_T expect = 0;
+    UI16_T total = 0;
+    UI32_T data = 0;
+    UI8_T batch = 0;
+    UI16_T e_idx = 1;
+    void *ptr_data = NULL;
+
+    _test_reset(0, 16);
+    memcpy(_test_fdb_count, ptr_counts, batches * sizeof(UI16_T));
+    _test_fdb_batches = batches;
+    _test_fdb_actions = 0;
+    for (batch = 0; batch < batches; batch++)
+    {
+        total += ptr_counts[batch];
+    }
+    batch = 0;
+    TEST_ASSERT(MW_E_OK == dbapi_cursorOpen(DYNAMIC_MAC_ADDRESS_ENTRY, DB_ALL_FIELDS, page_num, NULL, NULL, &cursor));
+    while (MW_E_OK == (rc = dbapi_cursorNext(&cursor, &pos, &size, &ptr_data)))
+    {
+        while (e_idx > ptr_counts[batch])
+        {
+            batch++;
+            e_idx = 1;
+        }
+        memcpy(&data, ptr_data, sizeof(data));
+        expect++;
+        TEST_ASSERT(expect == pos);
+        TEST_ASSERT(batch * TEST_FDB_MUL + e_idx == data);
+        e_idx++;
+    }
+    TEST_ASSERT(MW_E_ENTRY_NOT_FOUND == rc);
+    TEST_ASSERT(total == expect);
+    TEST_ASSERT(batches == _test_fdb_actions);
+    TEST_ASSERT(sends == _test_sends);
+    dbapi_cursorClose(&cursor);
+    TEST_ASSERT(0 == _test_live_msgs);
+}
+
+static void _test_fdb(void)
+{
+    const UI16_T one[] = { 5 };
+    const UI16_T three[] = { 40, 0, 7 };
+    const UI16_T none[] = { 0 };
+
+    /* one batch: START, its result, one page */
+    _test_fdb_walk(one, 1, 8, 3);
+    /* an action and a result read per batch, pages of 32, 32 and 8 */
+    _test_fdb_walk(three, 3, DB_CURSOR_PAGE_MAX, 6 + 3);
+    _test_fdb_walk(none, 1, 8, 2);
+}
+
+static void _test_open(void)
+{
+    DB_CURSOR_T cursor;
+    UI16_T pos = 0;
+    UI16_T size = 0;
+    void *ptr_data = NULL;
+
+    _test_reset(8, 4);
+    TEST_ASSERT(MW_E_BAD_PARAMETER == dbapi_cursorOpen(TABLES_LAST, DB_ALL_FIELDS, 8, NULL, NULL, &cursor));
+    TEST_ASSERT(MW_E_BAD_PARAMETER == dbapi_cursorOpen(TEST_TABLE, DB_ALL_FIELDS, 0, NULL, NULL, &cursor));
+    TEST_ASSERT('\0' == _test_queue_name[0]);
+
+    /* a closed cursor is not used again */
+    TEST_ASSERT(MW_E_OK == dbapi_cursorOpen(TEST_TABLE, DB_ALL_FIELDS, 8, NULL, NULL, &cursor));
+    dbapi_cursorClose(&cursor);
+    TEST_ASSERT(MW_E_NOT_INITED == dbapi_cursorNext(&cursor, &pos, &size, &ptr_data));
+    dbapi_cursorClose(&cursor);
+    TEST_ASSERT(0 == _test_sends);
+}
+
+int main(void)
+{
+    _test_paging();
+    _test_filter();
+    _test_timeout();
+    _test_fdb();
+    _test_open();
+
+    return TEST_RESULT("test_db_cursor");
+}
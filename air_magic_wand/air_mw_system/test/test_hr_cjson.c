@@ -0,0 +1,451 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  test_hr_cjson.c
+ * PURPOSE:
+ *      Host unit test of the compact cJSON in mqttd/hr_cjson.c.
+ *
+ * NOTES:
+ *      The heap figures model the FreeRTOS heap_4 allocator on a 32-bit
+ *      core. The old node was 40 bytes, each its own heap block, and every
+ *      key was duplicated. The compact node is 24 bytes, carved from chunks
+ *      of CJSON_NODE_CHUNK_NUM nodes behind a 12 byte chunk header.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mw_types.h"
+#include "hr_cjson.h"
+#include "test_util.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define TEST_PORT_NUM               (28)
+#define TEST_APPEND_NUM             (1000)
+
+/* heap_4 on a 32-bit core: an 8 byte block header, 8 byte alignment */
+#define TEST_HEAP_HDR_SIZE          (8)
+#define TEST_HEAP_ALIGN             (8)
+#define TEST_NODE_SIZE_OLD          (40)
+#define TEST_NODE_SIZE_NEW          (24)
+#define TEST_CHUNK_HDR_SIZE         (12)
+#define TEST_CHUNK_NODE_NUM         (32)
+#define TEST_KEY_MAX_NUM            (64)
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+#define TEST_HEAP_COST(__size__)    \
+    (((__size__) + TEST_HEAP_HDR_SIZE + TEST_HEAP_ALIGN - 1) & ~(TEST_HEAP_ALIGN - 1))
+
+/* DATA TYPE DECLARATIONS
+ */
+typedef struct TEST_HEAP_HDR_S
+{
+    size_t size;
+    size_t pad;
+} TEST_HEAP_HDR_T;
+
+typedef struct TEST_TREE_SIZE_S
+{
+    UI32_T nodes;
+    UI32_T blocks;          /* heap blocks besides the node chunks */
+    UI32_T old_heap;        /* heap_4 bytes with the old layout */
+    UI32_T new_heap;        /* heap_4 bytes with the compact layout */
+    const char *keys[TEST_KEY_MAX_NUM];
+    UI32_T key_num;
+} TEST_TREE_SIZE_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+int test_failed;
+
+static UI32_T _test_live_bytes;
+static UI32_T _test_live_blocks;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+void *mqtt_malloc(UI32_T size)
+{
+    TEST_HEAP_HDR_T *ptr_hdr = malloc(sizeof(TEST_HEAP_HDR_T) + size);
+
+    if (ptr_hdr == NULL)
+    {
+        return NULL;
+    }
+    ptr_hdr->size = size;
+    _test_live_bytes += size;
+    _test_live_blocks++;
+    return ptr_hdr + 1;
+}
+
+void mqtt_free(void *ptr)
+{
+    TEST_HEAP_HDR_T *ptr_hdr = NULL;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+    ptr_hdr = (TEST_HEAP_HDR_T *)ptr - 1;
+    _test_live_bytes -= ptr_hdr->size;
+    _test_live_blocks--;
+    free(ptr_hdr);
+}
+
+void *mqtt_realloc(void *ptr, UI32_T size)
+{
+    void *ptr_new = mqtt_malloc(size);
+    TEST_HEAP_HDR_T *ptr_hdr = NULL;
+
+    if ((ptr_new != NULL) && (ptr != NULL))
+    {
+        ptr_hdr = (TEST_HEAP_HDR_T *)ptr - 1;
+        memcpy(ptr_new, ptr, (ptr_hdr->size < size) ? ptr_hdr->size : size);
+        mqtt_free(ptr);
+    }
+    return ptr_new;
+}
+
+/* Builds the same tree as _mqttd_publish_status */
+static cJSON *
+_test_status_tree(
+    void)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *data = cJSON_CreateObject();
+    cJSON *sys = cJSON_CreateObject();
+    cJSON *ports = cJSON_CreateArray();
+    cJSON *entry = NULL;
+    char port_name[10];
+    int i;
+
+    cJSON_AddStringToObject(root, "type", "status");
+    cJSON_AddNumberToObject(root, "continuity", 0);
+    cJSON_AddItemToObject(root, "data", data);
+    cJSON_AddItemToObject(data, "sys", sys);
+    cJSON_AddNumberToObject(sys, "runtime", 123456);
+    cJSON_AddItemToObject(data, "ports", ports);
+    for (i = 0; i < TEST_PORT_NUM; i++)
+    {
+        entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "index", i + 1);
+        snprintf(port_name, sizeof(port_name), "port%d", i + 1);
+        cJSON_AddStringToObject(entry, "name", port_name);
+        cJSON_AddNumberToObject(entry, "type", 0);
+        cJSON_AddStringToObject(entry, "state", (i & 1) ? "up" : "down");
+        cJSON_AddNumberToObject(entry, "speed", 1000);
+        cJSON_AddNumberToObject(entry, "duplex", 1);
+        cJSON_AddNumberToObject(entry, "poe", 0);
+        cJSON_AddNumberToObject(entry, "power", -1);
+        cJSON_AddNumberToObject(entry, "txRate", 0);
+        cJSON_AddNumberToObject(entry, "rxRate", 0);
+        cJSON_AddBoolToObject(entry, "block", FALSE);
+        cJSON_AddItemToArray(ports, entry);
+    }
+    return root;
+}
+
+static void
+_test_tree_size_add_key(
+    TEST_TREE_SIZE_T *ptr_size,
+    const char *key)
+{
+    UI32_T i;
+
+    for (i = 0; i < ptr_size->key_num; i++)
+    {
+        if (ptr_size->keys[i] == key)
+        {
+            return;
+        }
+    }
+    TEST_ASSERT(ptr_size->key_num < TEST_KEY_MAX_NUM);
+    if (ptr_size->key_num < TEST_KEY_MAX_NUM)
+    {
+        ptr_size->keys[ptr_size->key_num++] = key;
+    }
+}
+
+/* Walks the tree and prices it with both layouts. The old layout strdup'ed
+ * every key; the compact one shares each interned key. */
+static void
+_test_tree_size(
+    const cJSON *item,
+    TEST_TREE_SIZE_T *ptr_size)
+{
+    UI32_T length;
+
+    for (; item != NULL; item = item->next)
+    {
+        ptr_size->nodes++;
+        ptr_size->old_heap += TEST_HEAP_COST(TEST_NODE_SIZE_OLD);
+        if (item->string != NULL)
+        {
+            length = strlen(item->string) + 1;
+            ptr_size->old_heap += TEST_HEAP_COST(length);
+            if (item->type & cJSON_StringIsConst)
+            {
+                _test_tree_size_add_key(ptr_size, item->string);
+            }
+            else
+            {
+                ptr_size->blocks++;
+                ptr_size->new_heap += TEST_HEAP_COST(length);
+            }
+        }
+        if (cJSON_IsString(item))
+        {
+            length = strlen(item->valuestring) + 1;
+            ptr_size->blocks++;
+            ptr_size->old_heap += TEST_HEAP_COST(length);
+            ptr_size->new_heap += TEST_HEAP_COST(length);
+        }
+        _test_tree_size(item->child, ptr_size);
+    }
+}
+
+static void
+_test_status_tree_size(
+    void)
+{
+    TEST_TREE_SIZE_T size;
+    UI32_T bytes_before = _test_live_bytes;
+    UI32_T blocks_before = _test_live_blocks;
+    UI32_T key_bytes = 0;
+    UI32_T chunks = 0;
+    UI32_T i;
+    cJSON *root = NULL;
+
+    memset(&size, 0, sizeof(size));
+    root = _test_status_tree();
+    TEST_ASSERT(root != NULL);
+    _test_tree_size(root, &size);
+    for (i = 0; i < size.key_num; i++)
+    {
+        key_bytes += strlen(size.keys[i]) + 1;
+        size.new_heap += TEST_HEAP_COST(strlen(size.keys[i]) + 1);
+    }
+    chunks = (size.nodes + TEST_CHUNK_NODE_NUM - 1) / TEST_CHUNK_NODE_NUM;
+    size.new_heap += chunks *
+        TEST_HEAP_COST(TEST_CHUNK_HDR_SIZE + (TEST_CHUNK_NODE_NUM * TEST_NODE_SIZE_NEW));
+
+    /* the walk accounts for every block the hooks handed out */
+    TEST_ASSERT((_test_live_blocks - blocks_before) == (size.blocks + size.key_num + chunks));
+
+    printf("status tree: %u nodes, %u interned keys, heap %u -> %u bytes\n",
+        (unsigned int)size.nodes, (unsigned int)size.key_num,
+        (unsigned int)size.old_heap, (unsigned int)size.new_heap);
+    TEST_ASSERT((size.new_heap * 2) < size.old_heap);
+
+    cJSON_Delete(root);
+    /* only the interned keys stay */
+    TEST_ASSERT((_test_live_bytes - bytes_before) == key_bytes);
+}
+
+static BOOL_T
+_test_array_is(
+    const cJSON *array,
+    const int *ptr_expect,
+    int num)
+{
+    const cJSON *item = NULL;
+    int i = 0;
+
+    cJSON_ArrayForEach(item, array)
+    {
+        if ((i >= num) || (item->valueint != ptr_expect[i]))
+        {
+            return FALSE;
+        }
+        i++;
+    }
+    return (i == num) ? TRUE : FALSE;
+}
+
+static void
+_test_append(
+    void)
+{
+    cJSON *array = cJSON_CreateArray();
+    cJSON *item = NULL;
+    int i;
+
+    for (i = 0; i < TEST_APPEND_NUM; i++)
+    {
+        item = cJSON_CreateNumber(i);
+        TEST_ASSERT(cJSON_AddItemToArray(array, item));
+        /* the hint follows every append, so no append walks the chain */
+        TEST_ASSERT((void *)array->valuestring == (void *)item);
+    }
+    TEST_ASSERT(cJSON_GetArraySize(array) == TEST_APPEND_NUM);
+    for (i = 0; i < TEST_APPEND_NUM; i++)
+    {
+        if (cJSON_GetArrayItem(array, i)->valueint != i)
+        {
+            break;
+        }
+    }
+    TEST_ASSERT(i == TEST_APPEND_NUM);
+    cJSON_Delete(array);
+}
+
+static void
+_test_tail_edit(
+    void)
+{
+    static const int after_detach[] = { 0, 1, 3 };
+    static const int after_replace[] = { 0, 1, 3, 7 };
+    static const int after_insert[] = { 0, 1, 3, 8, 9 };
+    static const int after_head[] = { 10 };
+    cJSON *array = cJSON_CreateArray();
+    cJSON *object = cJSON_CreateObject();
+    cJSON *dup = NULL;
+    int i;
+
+    for (i = 0; i < 5; i++)
+    {
+        cJSON_AddItemToArray(array, cJSON_CreateNumber(i));
+    }
+
+    /* detach the tail, then a middle item, then append */
+    cJSON_Delete(cJSON_DetachItemFromArray(array, 4));
+    cJSON_Delete(cJSON_DetachItemFromArray(array, 2));
+    TEST_ASSERT(_test_array_is(array, after_detach, 3));
+    cJSON_AddItemToArray(array, cJSON_CreateNumber(6));
+
+    /* replace the tail, then append */
+    TEST_ASSERT(cJSON_ReplaceItemInArray(array, 3, cJSON_CreateNumber(7)));
+    TEST_ASSERT(_test_array_is(array, after_replace, 4));
+    TEST_ASSERT(cJSON_InsertItemInArray(array, 3, cJSON_CreateNumber(8)));
+    cJSON_Delete(cJSON_DetachItemFromArray(array, 4));
+    cJSON_AddItemToArray(array, cJSON_CreateNumber(9));
+    TEST_ASSERT(_test_array_is(array, after_insert, 5));
+
+    /* a duplicate keeps its own hint */
+    dup = cJSON_Duplicate(array, 1);
+    TEST_ASSERT(cJSON_Compare(array, dup, 1));
+    cJSON_Delete(cJSON_DetachItemFromArray(dup, 4));
+    cJSON_AddItemToArray(dup, cJSON_CreateNumber(11));
+    TEST_ASSERT(cJSON_GetArrayItem(dup, 4)->valueint == 11);
+    TEST_ASSERT(cJSON_GetArrayItem(array, 4)->valueint == 9);
+    cJSON_Delete(dup);
+
+    /* empty the array, then start over */
+    while (cJSON_GetArraySize(array) > 0)
+    {
+        cJSON_DeleteItemFromArray(array, cJSON_GetArraySize(array) - 1);
+    }
+    cJSON_AddItemToArray(array, cJSON_CreateNumber(10));
+    TEST_ASSERT(_test_array_is(array, after_head, 1));
+
+    /* objects keep the hint as well */
+    cJSON_AddNumberToObject(object, "a", 1);
+    cJSON_AddNumberToObject(object, "b", 2);
+    cJSON_DeleteItemFromObject(object, "b");
+    cJSON_AddNumberToObject(object, "c", 3);
+    TEST_ASSERT(cJSON_GetObjectItem(object, "a")->valueint == 1);
+    TEST_ASSERT(cJSON_GetObjectItem(object, "c")->valueint == 3);
+    TEST_ASSERT(cJSON_GetObjectItem(object, "b") == NULL);
+    TEST_ASSERT(cJSON_GetArraySize(object) == 2);
+
+    cJSON_Delete(array);
+    cJSON_Delete(object);
+}
+
+static void
+_test_parse_print(
+    void)
+{
+    const char *text = "{\"type\":\"status\",\"ports\":[1,2.5,\"x\",{\"k\":[]}]}";
+    cJSON *root = cJSON_Parse(text);
+    char *out = NULL;
+
+    TEST_ASSERT(root != NULL);
+    cJSON_AddItemToArray(cJSON_GetObjectItem(root, "ports"), cJSON_CreateNumber(3));
+    out = cJSON_PrintUnformatted(root);
+    TEST_ASSERT((out != NULL) &&
+        (strcmp(out, "{\"type\":\"status\",\"ports\":[1,2.5,\"x\",{\"k\":[]},3]}") == 0));
+    cJSON_free(out);
+    cJSON_Delete(root);
+}
+
+/* The getConfig pager sums the items printed alone plus the frame of the
+ * page, see MQTTD_GETCONF_PAGE_FRAME in mqttd.c
+ */
+static void
+_test_page_size(
+    void)
+{
+    cJSON *page = cJSON_CreateObject();
+    cJSON *arr = cJSON_CreateArray();
+    cJSON *item = NULL;
+    char buf[256];
+    size_t size = strlen("vlan_setting") + 7;
+    int i;
+
+    cJSON_AddItemToObject(page, "vlan_setting", arr);
+    for (i = 0; i < 4; i++)
+    {
+        item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "vid", 100 * i + 1);
+        cJSON_AddStringToObject(item, "name", "v\"x");
+        TEST_ASSERT(cJSON_PrintPreallocated(item, buf, sizeof(buf), 0));
+        size += strlen(buf) + ((i > 0) ? 1 : 0);
+        cJSON_AddItemToArray(arr, item);
+    }
+    TEST_ASSERT(cJSON_PrintPreallocated(page, buf, sizeof(buf), 0));
+    TEST_ASSERT(strlen(buf) == size);
+    cJSON_Delete(page);
+}
+
+int main(void)
+{
+    UI32_T blocks;
+
+    /* first, so the interned keys it allocates are counted */
+    _test_status_tree_size();
+    blocks = _test_live_blocks;
+    _test_append();
+    _test_tail_edit();
+    _test_parse_print();
+    _test_page_size();
+    /* nothing leaks besides keys interned by the later tests */
+    TEST_ASSERT(_test_live_blocks <= blocks + 6);
+
+    return TEST_RESULT("test_hr_cjson");
+}
@@ -0,0 +1,277 @@
+/*******************************************************************************
+*  Copyright Statement:
+*  --------------------
+*  This software is protected by Copyright and the information contained
+*  herein is confidential. The software may not be copied and the information
+*  contained herein may not be used or disclosed except with the written
+*  permission of Airoha Technology Corp. (C) 2021
+*
+*  BY OPENING THIS FILE, BUYER HEREBY UNEQUIVOCALLY ACKNOWLEDGES AND AGREES
+*  THAT THE SOFTWARE/FIRMWARE AND ITS DOCUMENTATIONS ("AIROHA SOFTWARE")
+*  RECEIVED FROM AIROHA AND/OR ITS REPRESENTATIVES ARE PROVIDED TO BUYER ON
+*  AN "AS-IS" BASIS ONLY. AIROHA EXPRESSLY DISCLAIMS ANY AND ALL WARRANTIES,
+*  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF
+*  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE OR NONINFRINGEMENT.
+*  NEITHER DOES AIROHA PROVIDE ANY WARRANTY WHATSOEVER WITH RESPECT TO THE
+*  SOFTWARE OF ANY THIRD PARTY WHICH MAY BE USED BY, INCORPORATED IN, OR
+*  SUPPLIED WITH THE AIROHA SOFTWARE, AND BUYER AGREES TO LOOK ONLY TO SUCH
+*  THIRD PARTY FOR ANY WARRANTY CLAIM RELATING THERETO. AIROHA SHALL ALSO
+*  NOT BE RESPONSIBLE FOR ANY AIROHA SOFTWARE RELEASES MADE TO BUYER'S
+*  SPECIFICATION OR TO CONFORM TO A PARTICULAR STANDARD OR OPEN FORUM.
+*
+*  BUYER'S SOLE AND EXCLUSIVE REMEDY AND AIROHA'S ENTIRE AND CUMULATIVE
+*  LIABILITY WITH RESPECT TO THE AIROHA SOFTWARE RELEASED HEREUNDER WILL BE,
+*  AT AIROHA'S OPTION, TO REVISE OR REPLACE THE AIROHA SOFTWARE AT ISSUE,
+*  OR REFUND ANY SOFTWARE LICENSE FEES OR SERVICE CHARGE PAID BY BUYER TO
+*  AIROHA FOR SUCH AIROHA SOFTWARE AT ISSUE.
+*
+*  THE TRANSACTION CONTEMPLATED HEREUNDER SHALL BE CONSTRUED IN ACCORDANCE
+*  WITH THE LAWS OF THE STATE OF CALIFORNIA, USA, EXCLUDING ITS CONFLICT OF
+*  LAWS PRINCIPLES.  ANY DISPUTES, CONTROVERSIES OR CLAIMS ARISING THEREOF AND
+*  RELATED THERETO SHALL BE SETTLED BY ARBITRATION IN SAN FRANCISCO, CA, UNDER
+*  THE RULES OF THE INTERNATIONAL CHAMBER OF COMMERCE (ICC).
+*
+*******************************************************************************/
+
+/* FILE NAME:  test_mqttd_tls.c
+ * PURPOSE:
+ *      Host test of the mqttd TLS session resumption against a stand-in
+ *      TLS broker.
+ *
+ * NOTES:
+ *      The broker is OpenSSL on the loopback, it answers one MQTT CONNECT
+ *      with a CONNACK per connection. The client keeps the session of each
+ *      accepted connection and offers it on the next one, and decides
+ *      whether it was resumed with the session ID rule of _mqttd_tls_save.
+ *      TLS 1.2 only, as mbedTLS on the target.
+ */
+
+/* INCLUDE FILE DECLARATIONS
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include "test_util.h"
+
+/* NAMING CONSTANT DECLARATIONS
+ */
+#define TEST_CONNECT_LEN            (14)    /* MQTT 3.1.1 CONNECT, empty client ID */
+#define TEST_CONNACK_LEN            (4)
+
+/* MACRO FUNCTION DECLARATIONS
+ */
+
+/* DATA TYPE DECLARATIONS
+ */
+typedef struct TEST_BROKER_S
+{
+    SSL_CTX         *ptr_ctx;
+    int             listen_fd;
+    int             accepted;   /* The CONNECT was answered */
+} TEST_BROKER_T;
+
+/* GLOBAL VARIABLE DECLARATIONS
+ */
+int test_failed;
+
+static const unsigned char _test_connect_pkt[TEST_CONNECT_LEN] =
+{
+    0x10, 0x0C, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x3C, 0x00, 0x00
+};
+static const unsigned char _test_connack_pkt[TEST_CONNACK_LEN] = { 0x20, 0x02, 0x00, 0x00 };
+
+static EVP_PKEY *_test_key;
+static X509 *_test_cert;
+
+/* LOCAL SUBPROGRAM BODIES
+ */
+static void _test_cert_create(void)
+{
+    X509_NAME *ptr_name = NULL;
+
+    _test_key = EVP_EC_gen("P-256");
+    _test_cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(_test_cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(_test_cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(_test_cert), 3600);
+    X509_set_pubkey(_test_cert, _test_key);
+    ptr_name = X509_get_subject_name(_test_cert);
+    X509_NAME_add_entry_by_txt(ptr_name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(_test_cert, ptr_name);
+    X509_sign(_test_cert, _test_key, EVP_sha256());
+}
+
+/* A broker restart comes with a new context, so new ticket keys and an empty cache */
+static SSL_CTX *_test_broker_ctx(int tickets)
+{
+    SSL_CTX *ptr_ctx = SSL_CTX_new(TLS_server_method());
+
+    SSL_CTX_set_min_proto_version(ptr_ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ptr_ctx, TLS1_2_VERSION);
+    SSL_CTX_use_certificate(ptr_ctx, _test_cert);
+    SSL_CTX_use_PrivateKey(ptr_ctx, _test_key);
+    SSL_CTX_set_session_cache_mode(ptr_ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_session_id_context(ptr_ctx, (const unsigned char *)"mqttd", 5);
+    if (0 == tickets)
+    {
+        SSL_CTX_set_options(ptr_ctx, SSL_OP_NO_TICKET);
+    }
+    return ptr_ctx;
+}
+
+static void *_test_broker_run(void *arg)
+{
+    TEST_BROKER_T *ptr_broker = arg;
+    unsigned char buf[TEST_CONNECT_LEN];
+    SSL *ptr_ssl = NULL;
+    int fd;
+
+    fd = accept(ptr_broker->listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    ptr_ssl = SSL_new(ptr_broker->ptr_ctx);
+    SSL_set_fd(ptr_ssl, fd);
+    if ((1 == SSL_accept(ptr_ssl)) &&
+        (TEST_CONNECT_LEN == SSL_read(ptr_ssl, buf, sizeof(buf))) &&
+        (0 == memcmp(buf, _test_connect_pkt, TEST_CONNECT_LEN)) &&
+        (TEST_CONNACK_LEN == SSL_write(ptr_ssl, _test_connack_pkt, TEST_CONNACK_LEN)))
+    {
+        ptr_broker->accepted = 1;
+    }
+    SSL_shutdown(ptr_ssl);
+    SSL_free(ptr_ssl);
+    close(fd);
+    return NULL;
+}
+
+/* The resumed rule of _mqttd_tls_save: the server echoed the offered session ID */
+static int _test_resumed(const unsigned char *ptr_id, unsigned int id_len, SSL_SESSION *ptr_session)
+{
+    unsigned int new_len = 0;
+    const unsigned char *ptr_new = SSL_SESSION_get_id(ptr_session, &new_len);
+
+    return ((0 != id_len) && (id_len == new_len) && (0 == memcmp(ptr_id, ptr_new, id_len))) ? 1 : 0;
+}
+
+/* Connect as mqttd does, keep the session in *pptr_session and return the resumed rule */
+static int _test_connect(SSL_CTX *ptr_broker_ctx, SSL_CTX *ptr_ctx, SSL_SESSION **pptr_session, double *ptr_ms)
+{
+    TEST_BROKER_T broker;
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+    unsigned int id_len = 0;
+    unsigned char buf[TEST_CONNACK_LEN];
+    struct timespec start, end;
+    pthread_t thread;
+    SSL *ptr_ssl = NULL;
+    int fd, resumed = 0;
+
+    memset(&broker, 0, sizeof(broker));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    broker.ptr_ctx = ptr_broker_ctx;
+    broker.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(0 == bind(broker.listen_fd, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT(0 == listen(broker.listen_fd, 1));
+    getsockname(broker.listen_fd, (struct sockaddr *)&addr, &addr_len);
+    pthread_create(&thread, NULL, _test_broker_run, &broker);
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(0 == connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+    ptr_ssl = SSL_new(ptr_ctx);
+    SSL_set_fd(ptr_ssl, fd);
+    if (NULL != *pptr_session)
+    {
+        const unsigned char *ptr_id = SSL_SESSION_get_id(*pptr_session, &id_len);
+
+        memcpy(id, ptr_id, id_len);
+        SSL_set_session(ptr_ssl, *pptr_session);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TEST_ASSERT(1 == SSL_connect(ptr_ssl));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *ptr_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+
+    TEST_ASSERT(TEST_CONNECT_LEN == SSL_write(ptr_ssl, _test_connect_pkt, TEST_CONNECT_LEN));
+    TEST_ASSERT(TEST_CONNACK_LEN == SSL_read(ptr_ssl, buf, sizeof(buf)));
+    TEST_ASSERT(0 == memcmp(buf, _test_connack_pkt, TEST_CONNACK_LEN));
+
+    /* The connection was accepted, keep its session for the next one */
+    if (NULL != *pptr_session)
+    {
+        SSL_SESSION_free(*pptr_session);
+    }
+    *pptr_session = SSL_get1_session(ptr_ssl);
+    TEST_ASSERT(NULL != *pptr_session);
+    resumed = _test_resumed(id, id_len, *pptr_session);
+    TEST_ASSERT(resumed == SSL_session_reused(ptr_ssl));
+
+    SSL_shutdown(ptr_ssl);
+    SSL_free(ptr_ssl);
+    close(fd);
+    pthread_join(thread, NULL);
+    close(broker.listen_fd);
+    TEST_ASSERT(1 == broker.accepted);
+    return resumed;
+}
+
+static SSL_CTX *_test_client_ctx(void)
+{
+    SSL_CTX *ptr_ctx = SSL_CTX_new(TLS_client_method());
+
+    SSL_CTX_set_min_proto_version(ptr_ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ptr_ctx, TLS1_2_VERSION);
+    /* MQTTD_TLS_CA_CERT is NULL, the server is not verified */
+    SSL_CTX_set_verify(ptr_ctx, SSL_VERIFY_NONE, NULL);
+    return ptr_ctx;
+}
+
+static void _test_resume(int tickets)
+{
+    SSL_CTX *ptr_broker_ctx = _test_broker_ctx(tickets);
+    SSL_CTX *ptr_ctx = _test_client_ctx();
+    SSL_SESSION *ptr_session = NULL;
+    double full_ms = 0, resumed_ms = 0, ms = 0;
+
+    /* Cold start, there is no session to offer */
+    TEST_ASSERT(0 == _test_connect(ptr_broker_ctx, ptr_ctx, &ptr_session, &full_ms));
+
+    /* Each reconnect resumes the session of the last one */
+    TEST_ASSERT(1 == _test_connect(ptr_broker_ctx, ptr_ctx, &ptr_session, &resumed_ms));
+    TEST_ASSERT(1 == _test_connect(ptr_broker_ctx, ptr_ctx, &ptr_session, &ms));
+
+    /* The restarted broker does not know it, a full handshake replaces it */
+    SSL_CTX_free(ptr_broker_ctx);
+    ptr_broker_ctx = _test_broker_ctx(tickets);
+    TEST_ASSERT(0 == _test_connect(ptr_broker_ctx, ptr_ctx, &ptr_session, &ms));
+    TEST_ASSERT(1 == _test_connect(ptr_broker_ctx, ptr_ctx, &ptr_session, &ms));
+
+    printf("%s: full handshake %.3f ms, resumed %.3f ms\n",
+        (0 != tickets) ? "session ticket" : "session ID", full_ms, resumed_ms);
+    SSL_SESSION_free(ptr_session);
+    SSL_CTX_free(ptr_ctx);
+    SSL_CTX_free(ptr_broker_ctx);
+}
+
+int main(void)
+{
+    _test_cert_create();
+    _test_resume(1);
+    _test_resume(0);
+    X509_free(_test_cert);
+    EVP_PKEY_free(_test_key);
+
+    return TEST_RESULT("test_mqttd_tls");
+}
@@ -42,6 +42,7 @@
  * - Handle large outgoing payloads for PUBLISH messages
  * - Fix restriction of a single topic in each (UN)SUBSCRIBE message (protocol has support for multiple topics)
  * - Add support for legacy MQTT protocol version
+ * - MQTT 5: incoming topic aliases, AUTH and the DISCONNECT reason from server
  *
  * Please coordinate changes and requests with Erik Andersson
  * Erik Andersson <erian747@gmail.com>
@@ -58,6 +59,9 @@
 #include "lwip/altcp_tcp.h"
 #include "lwip/altcp_tls.h"
 #include <string.h>
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+#include "mbedtls/ssl.h"
+#endif
 
 #if LWIP_TCP && LWIP_CALLBACK_API
 
@@ -74,6 +78,35 @@
 #define MQTT_DEBUG_WARN_STATE   (MQTT_DEBUG | LWIP_DBG_LEVEL_WARNING | LWIP_DBG_STATE)
 #define MQTT_DEBUG_SERIOUS      (MQTT_DEBUG | LWIP_DBG_LEVEL_SERIOUS)
 
+/**
+ * MQTT5_CLIENTS: Number of clients connected with MQTT 5 at the same time
+ */
+#if !defined MQTT5_CLIENTS || defined __DOXYGEN__
+#define MQTT5_CLIENTS               1
+#endif
+
+/**
+ * MQTT5_TOPIC_ALIAS_NUM: Number of outgoing topic aliases per client, at least 1
+ */
+#if !defined MQTT5_TOPIC_ALIAS_NUM || defined __DOXYGEN__
+#define MQTT5_TOPIC_ALIAS_NUM       4
+#endif
+
+/**
+ * MQTT5_TOPIC_ALIAS_LEN: Size of a topic kept for an alias, longer topics are sent in full
+ */
+#if !defined MQTT5_TOPIC_ALIAS_LEN || defined __DOXYGEN__
+#define MQTT5_TOPIC_ALIAS_LEN       64
+#endif
+
+/**
+ * MQTT5_SESSION_EXPIRY: Session Expiry Interval in seconds sent with keep_session,
+ * the default keeps the session like MQTT 3.1.1 does
+ */
+#if !defined MQTT5_SESSION_EXPIRY || defined __DOXYGEN__
+#define MQTT5_SESSION_EXPIRY        0xFFFFFFFFUL
+#endif
+
 
 
 /**
@@ -121,6 +154,54 @@ enum mqtt_connect_flag {
   MQTT_CONNECT_FLAG_CLEAN_SESSION = 1 << 1
 };
 
+/**
+ * MQTT connect acknowledge flags, only used in CONNACK message
+ */
+enum mqtt_connack_flag {
+  MQTT_CONNACK_FLAG_SESSION_PRESENT = 1 << 0
+};
+
+/**
+ * MQTT 5 properties handled by the client
+ */
+enum mqtt5_property {
+  MQTT5_PROP_SESSION_EXPIRY = 0x11,
+  MQTT5_PROP_RECEIVE_MAX = 0x21,
+  MQTT5_PROP_TOPIC_ALIAS_MAX = 0x22,
+  MQTT5_PROP_TOPIC_ALIAS = 0x23,
+  MQTT5_PROP_MAX_PACKET_SIZE = 0x27
+};
+
+/**
+ * MQTT 5 CONNACK reason codes mapped to mqtt_connection_status_t
+ */
+enum mqtt5_connack_reason {
+  MQTT5_REASON_UNSUPPORTED_PROTOCOL = 0x84,
+  MQTT5_REASON_CLIENT_ID_INVALID = 0x85,
+  MQTT5_REASON_BAD_USER_PASS = 0x86,
+  MQTT5_REASON_NOT_AUTHORIZED = 0x87
+};
+
+/**
+ * MQTT 5 state of a connection, the limits are the ones from CONNACK
+ */
+struct mqtt5_state {
+  /** Owner, NULL if the entry is free */
+  mqtt_client_t *client;
+  /** Maximum Packet Size of the server, 0 for no limit */
+  u32_t max_packet_size;
+  /** Receive Maximum of the server, QoS 1 and 2 PUBLISH not acknowledged yet */
+  u16_t receive_max;
+  /** Topic Alias Maximum of the server */
+  u16_t topic_alias_max;
+  /** Packet identifiers of QoS 1 and 2 PUBLISH in flight, 0 if unused */
+  u16_t pub_id[MQTT_REQ_MAX_IN_FLIGHT];
+  /** Topic of alias n + 1, empty if unused */
+  char topic_alias[MQTT5_TOPIC_ALIAS_NUM][MQTT5_TOPIC_ALIAS_LEN];
+};
+
+static struct mqtt5_state mqtt5_states[MQTT5_CLIENTS];
+
 
 static void mqtt_cyclic_timer(void *arg);
 
@@ -440,7 +521,9 @@ mqtt_request_time_elapsed(struct mqtt_request_t **tail, u8_t t)
 }
 
 /**
- * Free all request items
+ * Free all request items, the owners are notified with ERR_CONN
+ * Called on every close, clean session or not, so a publish owner can keep
+ * the message for replay and a subscribe owner must ignore ERR_CONN
  * @param tail Pointer to request queue tail pointer
  */
 static void
@@ -448,11 +531,17 @@ mqtt_clear_requests(struct mqtt_request_t **tail)
 {
   struct mqtt_request_t *iter, *next;
   LWIP_ASSERT("mqtt_clear_requests: tail != NULL", tail != NULL);
-  for (iter = *tail; iter != NULL; iter = next) {
+  /* Detach the queue first, callbacks may queue new requests */
+  iter = *tail;
+  *tail = NULL;
+  for (; iter != NULL; iter = next) {
     next = iter->next;
+    /* Let the owner keep an unacknowledged publish for a later session */
+    if (iter->cb != NULL) {
+      iter->cb(iter->arg, ERR_CONN);
+    }
     mqtt_delete_request(iter);
   }
-  *tail = NULL;
 }
 /**
  * Initialize all request items
@@ -487,6 +576,22 @@ void mqtt_output_append_u16(struct mqtt_ringbuf_t *rb, u16_t value)
   mqtt_ringbuf_put(rb, value & 0xff);
 }
 
+static void
+mqtt_output_append_u32(struct mqtt_ringbuf_t *rb, u32_t value)
+{
+  mqtt_output_append_u16(rb, (u16_t)(value >> 16));
+  mqtt_output_append_u16(rb, (u16_t)(value & 0xffff));
+}
+
+static void
+mqtt_output_append_varint(struct mqtt_ringbuf_t *rb, u32_t value)
+{
+  do {
+    mqtt_ringbuf_put(rb, (u8_t)((value & 0x7f) | (value >= 128 ? 0x80 : 0)));
+    value >>= 7;
+  } while (value > 0);
+}
+
 static void
 mqtt_output_append_buf(struct mqtt_ringbuf_t *rb, const void *data, u16_t length)
 {
@@ -555,6 +660,268 @@ mqtt_output_check_space(struct mqtt_ringbuf_t *rb, u16_t r_length)
   return (total_len <= mqtt_ringbuf_free(rb));
 }
 
+/*--------------------------------------------------------------------------------------------------------------------- */
+/* MQTT 5 */
+
+/**
+ * Get the MQTT 5 state of a client
+ * @param client MQTT client
+ * @return State, NULL if the client is not connected with MQTT 5
+ */
+static struct mqtt5_state *
+mqtt5_get(const mqtt_client_t *client)
+{
+  u8_t n;
+  for (n = 0; n < MQTT5_CLIENTS; n++) {
+    if (mqtt5_states[n].client == client) {
+      return &mqtt5_states[n];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Take a free MQTT 5 state for a client
+ * @param client MQTT client
+ * @return State with the protocol defaults, NULL if all are used
+ */
+static struct mqtt5_state *
+mqtt5_alloc(mqtt_client_t *client)
+{
+  struct mqtt5_state *s = mqtt5_get(client);
+  if (s == NULL) {
+    s = mqtt5_get(NULL);
+  }
+  if (s != NULL) {
+    memset(s, 0, sizeof(struct mqtt5_state));
+    s->client = client;
+    s->receive_max = 0xFFFF;
+  }
+  return s;
+}
+
+/**
+ * Release the MQTT 5 state of a client, topic aliases end with the connection
+ * @param client MQTT client
+ */
+static void
+mqtt5_release(const mqtt_client_t *client)
+{
+  struct mqtt5_state *s = mqtt5_get(client);
+  if (s != NULL) {
+    s->client = NULL;
+  }
+}
+
+/**
+ * Number of bytes of a variable byte integer
+ * @param value Value to encode
+ * @return 1 to 4
+ */
+static u8_t
+mqtt5_varint_len(u32_t value)
+{
+  u8_t n = 1;
+  while (value >= 128) {
+    value >>= 7;
+    n++;
+  }
+  return n;
+}
+
+/**
+ * Decode a variable byte integer
+ * @param buf Input buffer
+ * @param len Bytes available in buf
+ * @param value Decoded value
+ * @return Number of bytes used, 0 if malformed or truncated
+ */
+static u8_t
+mqtt5_get_varint(const u8_t *buf, u16_t len, u32_t *value)
+{
+  u8_t n = 0;
+  u32_t v = 0;
+  do {
+    if ((n >= len) || (n >= 4)) {
+      return 0;
+    }
+    v |= (u32_t)(buf[n] & 0x7f) << (7 * n);
+  } while ((buf[n++] & 0x80) != 0);
+  *value = v;
+  return n;
+}
+
+/**
+ * Length of a property value, to skip it
+ * @param id Property identifier
+ * @param buf Property value
+ * @param len Bytes available in buf
+ * @return Value length, 0 if unknown or truncated
+ */
+static u16_t
+mqtt5_prop_value_len(u8_t id, const u8_t *buf, u16_t len)
+{
+  u32_t v;
+  u16_t n;
+  switch (id) {
+    case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+      return 1;
+    case 0x13: case 0x21: case 0x22: case 0x23:
+      return 2;
+    case 0x02: case 0x11: case 0x18: case 0x27:
+      return 4;
+    case 0x0B:
+      return mqtt5_get_varint(buf, len, &v);
+    case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+      return (len < 2) ? 0 : (u16_t)(2 + (((u16_t)buf[0] << 8) | buf[1]));
+    case 0x26:
+      /* User property, a string pair */
+      if (len < 2) {
+        return 0;
+      }
+      n = (u16_t)(2 + (((u16_t)buf[0] << 8) | buf[1]));
+      if (len < n + 2) {
+        return 0;
+      }
+      return (u16_t)(n + 2 + (((u16_t)buf[n] << 8) | buf[n + 1]));
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Skip the properties of a received packet
+ * @param buf Property length field
+ * @param len Bytes available in buf
+ * @return Number of bytes of length field and properties, 0 if they do not fit in buf
+ */
+static u16_t
+mqtt5_skip_properties(const u8_t *buf, u16_t len)
+{
+  u32_t props_len;
+  u8_t n = mqtt5_get_varint(buf, len, &props_len);
+  if ((n == 0) || (props_len > (u32_t)(len - n))) {
+    return 0;
+  }
+  return (u16_t)(n + props_len);
+}
+
+/**
+ * Take the server limits from the CONNACK properties
+ * @param s MQTT 5 state
+ * @param buf Property length field
+ * @param len Bytes available in buf
+ *
+ * A CONNACK longer than the receive buffer is cut, the limits not received keep
+ * the protocol defaults.
+ */
+static void
+mqtt5_connack_properties(struct mqtt5_state *s, const u8_t *buf, u16_t len)
+{
+  u32_t props_len;
+  u16_t idx, vlen;
+  const u8_t *v;
+  u8_t n = mqtt5_get_varint(buf, len, &props_len);
+
+  if (n == 0) {
+    return;
+  }
+  buf += n;
+  len = (u16_t)(len - n);
+  if (props_len < len) {
+    len = (u16_t)props_len;
+  }
+  for (idx = 0; idx < len; idx = (u16_t)(idx + 1 + vlen)) {
+    vlen = mqtt5_prop_value_len(buf[idx], buf + idx + 1, (u16_t)(len - idx - 1));
+    if ((vlen == 0) || (vlen > len - idx - 1)) {
+      break;
+    }
+    v = buf + idx + 1;
+    switch (buf[idx]) {
+      case MQTT5_PROP_RECEIVE_MAX:
+        s->receive_max = (u16_t)(((u16_t)v[0] << 8) | v[1]);
+        if (s->receive_max == 0) {
+          s->receive_max = 0xFFFF;
+        }
+        break;
+      case MQTT5_PROP_TOPIC_ALIAS_MAX:
+        s->topic_alias_max = (u16_t)(((u16_t)v[0] << 8) | v[1]);
+        break;
+      case MQTT5_PROP_MAX_PACKET_SIZE:
+        s->max_packet_size = ((u32_t)v[0] << 24) | ((u32_t)v[1] << 16) | ((u32_t)v[2] << 8) | v[3];
+        break;
+      default:
+        break;
+    }
+  }
+  LWIP_DEBUGF(MQTT_DEBUG_TRACE, ("mqtt5_connack_properties: receive max %d, topic alias max %d, max packet size %"U32_F"\n",
+                                 s->receive_max, s->topic_alias_max, s->max_packet_size));
+}
+
+/**
+ * Number of QoS 1 and 2 PUBLISH the server still accepts
+ * @param client MQTT client
+ * @param s MQTT 5 state
+ * @return Send quota
+ *
+ * A PUBLISH is in flight while its request is queued, so acknowledged, timed
+ * out and cleared requests free their entry here.
+ */
+static u16_t
+mqtt5_send_quota(mqtt_client_t *client, struct mqtt5_state *s)
+{
+  struct mqtt_request_t *iter;
+  u16_t inflight = 0;
+  u8_t n;
+
+  for (n = 0; n < LWIP_ARRAYSIZE(s->pub_id); n++) {
+    if (s->pub_id[n] == 0) {
+      continue;
+    }
+    for (iter = client->pend_req_queue; iter != NULL; iter = iter->next) {
+      if (iter->pkt_id == s->pub_id[n]) {
+        break;
+      }
+    }
+    if (iter == NULL) {
+      s->pub_id[n] = 0;
+    } else {
+      inflight++;
+    }
+  }
+  return (inflight < s->receive_max) ? (u16_t)(s->receive_max - inflight) : 0;
+}
+
+/**
+ * Find the topic alias of a topic
+ * @param s MQTT 5 state
+ * @param topic Topic string
+ * @param topic_len Topic length
+ * @param slot Free entry to set up a new alias, -1 if none
+ * @return Alias of the topic, 0 if it has none
+ */
+static u16_t
+mqtt5_topic_alias_find(struct mqtt5_state *s, const char *topic, u16_t topic_len, s16_t *slot)
+{
+  u16_t n;
+  u16_t num = LWIP_MIN(s->topic_alias_max, MQTT5_TOPIC_ALIAS_NUM);
+
+  *slot = -1;
+  if (topic_len >= MQTT5_TOPIC_ALIAS_LEN) {
+    return 0;
+  }
+  for (n = 0; n < num; n++) {
+    if (s->topic_alias[n][0] == '\0') {
+      if (*slot < 0) {
+        *slot = (s16_t)n;
+      }
+    } else if ((strncmp(s->topic_alias[n], topic, topic_len) == 0) && (s->topic_alias[n][topic_len] == '\0')) {
+      return (u16_t)(n + 1);
+    }
+  }
+  return 0;
+}
+
 
 /**
  * Close connection to server
@@ -589,6 +956,7 @@ mqtt_close(mqtt_client_t *client, mqtt_connection_status_t reason)
 
   /* Remove all pending requests */
   mqtt_clear_requests(&client->pend_req_queue);
+  mqtt5_release(client);
   /* Stop cyclic timer */
   sys_untimeout(mqtt_cyclic_timer, client);
 
@@ -736,6 +1104,7 @@ mqtt_message_received(mqtt_client_t *client, u8_t fixed_hdr_len, u16_t length, u
   /* Control packet type */
   u8_t pkt_type = MQTT_CTL_PACKET_TYPE(client->rx_buffer[0]);
   u16_t pkt_id = 0;
+  struct mqtt5_state *s = NULL;
 
   LWIP_ASSERT("fixed_hdr_len <= client->msg_idx", fixed_hdr_len <= client->msg_idx);
   LWIP_ERROR("buffer length mismatch", fixed_hdr_len + length <= MQTT_VAR_HEADER_BUFFER_LEN,
@@ -749,7 +1118,33 @@ mqtt_message_received(mqtt_client_t *client, u8_t fixed_hdr_len, u16_t length, u
       }
       /* Get result code from CONNACK */
       res = (mqtt_connection_status_t)var_hdr_payload[1];
-      LWIP_DEBUGF(MQTT_DEBUG_TRACE, ("mqtt_message_received: Connect response code %d\n", res));
+      s = mqtt5_get(client);
+      if (s != NULL) {
+        /* MQTT 5 refuses with reason codes from 0x80, a 3.1.1 server answers with its own codes */
+        if (var_hdr_payload[1] >= 0x80) {
+          switch (var_hdr_payload[1]) {
+            case MQTT5_REASON_UNSUPPORTED_PROTOCOL:
+              res = MQTT_CONNECT_REFUSED_PROTOCOL_VERSION;
+              break;
+            case MQTT5_REASON_CLIENT_ID_INVALID:
+              res = MQTT_CONNECT_REFUSED_IDENTIFIER;
+              break;
+            case MQTT5_REASON_BAD_USER_PASS:
+              res = MQTT_CONNECT_REFUSED_USERNAME_PASS;
+              break;
+            case MQTT5_REASON_NOT_AUTHORIZED:
+              res = MQTT_CONNECT_REFUSED_NOT_AUTHORIZED_;
+              break;
+            default:
+              res = MQTT_CONNECT_REFUSED_SERVER;
+              break;
+          }
+        } else if ((res == MQTT_CONNECT_ACCEPTED) && (length > 2)) {
+          mqtt5_connack_properties(s, var_hdr_payload + 2, (u16_t)(length - 2));
+        }
+      }
+      LWIP_DEBUGF(MQTT_DEBUG_TRACE, ("mqtt_message_received: Connect response code %d, session present %d\n",
+                                     res, var_hdr_payload[0] & MQTT_CONNACK_FLAG_SESSION_PRESENT));
       if (res == MQTT_CONNECT_ACCEPTED) {
         /* Reset cyclic_tick when changing to connected state */
         client->cyclic_tick = 0;
@@ -808,6 +1203,16 @@ mqtt_message_received(mqtt_client_t *client, u8_t fixed_hdr_len, u16_t length, u
       } else {
         client->inpub_pkt_id = 0;
       }
+      if (mqtt5_get(client) != NULL) {
+        /* Skip the properties, they must be in the receive buffer with the topic */
+        u16_t props_len = mqtt5_skip_properties(var_hdr_payload + after_topic,
+                                                (u16_t)(LWIP_MIN(length, var_hdr_payload_bufsize) - after_topic));
+        if (props_len == 0) {
+          LWIP_DEBUGF(MQTT_DEBUG_WARN, ("mqtt_message_received: Receive buffer can not fit PUBLISH properties\n"));
+          goto out_disconnect;
+        }
+        after_topic += props_len;
+      }
       /* Take backup of byte after topic */
       bkp = topic[topic_len];
       /* Zero terminate string */
@@ -865,14 +1270,20 @@ mqtt_message_received(mqtt_client_t *client, u8_t fixed_hdr_len, u16_t length, u
       if (r != NULL) {
         LWIP_DEBUGF(MQTT_DEBUG_TRACE, ("mqtt_message_received: %s response with id %d\n", mqtt_msg_type_to_str(pkt_type), pkt_id));
         if (pkt_type == MQTT_MSG_TYPE_SUBACK) {
-          if (length < 3) {
+          u16_t props_len = 0;
+          if (mqtt5_get(client) != NULL) {
+            /* The reason codes follow the properties */
+            props_len = mqtt5_skip_properties(var_hdr_payload + 2, (u16_t)(LWIP_MIN(length, var_hdr_payload_bufsize) - 2));
+          }
+          if (length < 3 + props_len) {
             LWIP_DEBUGF(MQTT_DEBUG_WARN, ("mqtt_message_received: To small SUBACK packet\n"));
             goto out_disconnect;
           } else {
-            mqtt_incomming_suback(r, var_hdr_payload[2]);
+            mqtt_incomming_suback(r, var_hdr_payload[2 + props_len]);
           }
         } else if (r->cb != NULL) {
-          r->cb(r->arg, ERR_OK);
+          /* An MQTT 5 PUBACK may carry a reason code, from 0x80 the server rejected it */
+          r->cb(r->arg, ((pkt_type == MQTT_MSG_TYPE_PUBACK) && (length > 2) && (var_hdr_payload[2] >= 0x80)) ? ERR_VAL : ERR_OK);
         }
         mqtt_delete_request(r);
       } else {
@@ -1161,6 +1572,11 @@ mqtt_publish(mqtt_client_t *client, const char *topic, const void *payload, u16_
   size_t total_len;
   u16_t topic_len;
   u16_t remaining_length;
+  struct mqtt5_state *s;
+  u16_t alias = 0;
+  s16_t alias_slot = -1;
+  u16_t wire_topic_len;
+  u8_t n;
 
   LWIP_ASSERT_CORE_LOCKED();
   LWIP_ASSERT("mqtt_publish: client != NULL", client);
@@ -1170,18 +1586,45 @@ mqtt_publish(mqtt_client_t *client, const char *topic, const void *payload, u16_
   topic_strlen = strlen(topic);
   LWIP_ERROR("mqtt_publish: topic length overflow", (topic_strlen <= (0xFFFF - 2)), return ERR_ARG);
   topic_len = (u16_t)topic_strlen;
+  wire_topic_len = topic_len;
   total_len = 2 + topic_len + payload_length;
 
+  s = mqtt5_get(client);
+  if (s != NULL) {
+    if ((qos > 0) && (mqtt5_send_quota(client, s) == 0)) {
+      LWIP_DEBUGF(MQTT_DEBUG_TRACE, ("mqtt_publish: Receive Maximum %d of server reached\n", s->receive_max));
+      return ERR_WOULDBLOCK;
+    }
+    alias = mqtt5_topic_alias_find(s, topic, topic_len, &alias_slot);
+    if (alias != 0) {
+      /* Known alias, the topic is left empty */
+      wire_topic_len = 0;
+    } else if (alias_slot >= 0) {
+      /* Set up the alias with the full topic */
+      alias = (u16_t)(alias_slot + 1);
+    }
+    /* Property length and the optional topic alias */
+    total_len = 2 + wire_topic_len + payload_length + 1 + ((alias != 0) ? 3 : 0);
+  }
+
   if (qos > 0) {
     total_len += 2;
+  }
+  LWIP_ERROR("mqtt_publish: total length overflow", (total_len <= 0xFFFF), return ERR_ARG);
+  remaining_length = (u16_t)total_len;
+  if ((s != NULL) && (s->max_packet_size != 0) &&
+      ((u32_t)(1 + mqtt5_varint_len(remaining_length) + remaining_length) > s->max_packet_size)) {
+    LWIP_DEBUGF(MQTT_DEBUG_WARN, ("mqtt_publish: Larger than Maximum Packet Size %"U32_F" of server\n", s->max_packet_size));
+    return ERR_VAL;
+  }
+
+  if (qos > 0) {
     /* Generate pkt_id id for QoS1 and 2 */
     pkt_id = msg_generate_packet_id(client);
   } else {
     /* Use reserved value pkt_id 0 for QoS 0 in request handle */
     pkt_id = 0;
   }
-  LWIP_ERROR("mqtt_publish: total length overflow", (total_len <= 0xFFFF), return ERR_ARG);
-  remaining_length = (u16_t)total_len;
 
   r = mqtt_create_request(client->req_list, LWIP_ARRAYSIZE(client->req_list), pkt_id, cb, arg);
   if (r == NULL) {
@@ -1201,13 +1644,36 @@ mqtt_publish(mqtt_client_t *client, const char *topic, const void *payload, u16_
   mqtt_output_append_fixed_header(&client->output, MQTT_MSG_TYPE_PUBLISH, 0, qos, retain, remaining_length);
 
   /* Append Topic */
-  mqtt_output_append_string(&client->output, topic, topic_len);
+  mqtt_output_append_string(&client->output, topic, wire_topic_len);
 
   /* Append packet if for QoS 1 and 2*/
   if (qos > 0) {
     mqtt_output_append_u16(&client->output, pkt_id);
   }
 
+  /* Append MQTT 5 properties */
+  if (s != NULL) {
+    if (alias != 0) {
+      mqtt_output_append_u8(&client->output, 3);
+      mqtt_output_append_u8(&client->output, MQTT5_PROP_TOPIC_ALIAS);
+      mqtt_output_append_u16(&client->output, alias);
+      if (alias_slot >= 0) {
+        MEMCPY(s->topic_alias[alias_slot], topic, topic_len);
+        s->topic_alias[alias_slot][topic_len] = '\0';
+      }
+    } else {
+      mqtt_output_append_u8(&client->output, 0);
+    }
+    if (qos > 0) {
+      for (n = 0; n < LWIP_ARRAYSIZE(s->pub_id); n++) {
+        if (s->pub_id[n] == 0) {
+          s->pub_id[n] = pkt_id;
+          break;
+        }
+      }
+    }
+  }
+
   /* Append optional publish payload */
   if ((payload != NULL) && (payload_length > 0)) {
     mqtt_output_append_buf(&client->output, payload, payload_length);
@@ -1249,6 +1715,10 @@ mqtt_sub_unsub(mqtt_client_t *client, const char *topic, u8_t qos, mqtt_request_
   topic_len = (u16_t)topic_strlen;
   /* Topic string, pkt_id, qos for subscribe */
   total_len =  topic_len + 2 + 2 + (sub != 0);
+  if (mqtt5_get(client) != NULL) {
+    /* Empty properties */
+    total_len += 1;
+  }
   LWIP_ERROR("mqtt_sub_unsub: total length overflow", (total_len <= 0xFFFF), return ERR_ARG);
   remaining_length = (u16_t)total_len;
 
@@ -1274,9 +1744,13 @@ mqtt_sub_unsub(mqtt_client_t *client, const char *topic, u8_t qos, mqtt_request_
   mqtt_output_append_fixed_header(&client->output, sub ? MQTT_MSG_TYPE_SUBSCRIBE : MQTT_MSG_TYPE_UNSUBSCRIBE, 0, 1, 0, remaining_length);
   /* Packet id */
   mqtt_output_append_u16(&client->output, pkt_id);
+  /* MQTT 5 properties */
+  if (mqtt5_get(client) != NULL) {
+    mqtt_output_append_u8(&client->output, 0);
+  }
   /* Topic */
   mqtt_output_append_string(&client->output, topic, topic_len);
-  /* QoS */
+  /* QoS, the other MQTT 5 subscription options are 0 */
   if (sub != 0) {
     mqtt_output_append_u8(&client->output, LWIP_MIN(qos, 2));
   }
@@ -1326,6 +1800,7 @@ mqtt_client_new(void)
 void
 mqtt_client_free(mqtt_client_t *client)
 {
+  mqtt5_release(client);
   mem_free(client);
 }
 
@@ -1351,6 +1826,8 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
   u16_t remaining_length = 2 + 4 + 1 + 1 + 2;
   u8_t flags = 0, will_topic_len = 0, will_msg_len = 0;
   u16_t client_user_len = 0, client_pass_len = 0;
+  u8_t level = MQTT_VERSION_3_1_1;
+  u32_t props_len = 0;
 
   LWIP_ASSERT_CORE_LOCKED();
   LWIP_ASSERT("mqtt_client_connect: client != NULL", client != NULL);
@@ -1370,6 +1847,22 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
   client->keep_alive = client_info->keep_alive;
   mqtt_init_requests(client->req_list, LWIP_ARRAYSIZE(client->req_list));
 
+  mqtt5_release(client);
+  if (client_info->protocol_version == MQTT_VERSION_5) {
+    if (mqtt5_alloc(client) == NULL) {
+      LWIP_DEBUGF(MQTT_DEBUG_WARN, ("mqtt_client_connect: No free MQTT 5 state, raise MQTT5_CLIENTS\n"));
+      return ERR_MEM;
+    }
+    level = MQTT_VERSION_5;
+    if (client_info->keep_session) {
+      props_len += 1 + 4;
+    }
+    if (client_info->max_packet_size != 0) {
+      props_len += 1 + 4;
+    }
+    remaining_length = (u16_t)(remaining_length + mqtt5_varint_len(props_len) + props_len);
+  }
+
   /* Build connect message */
   if (client_info->will_topic != NULL && client_info->will_msg != NULL) {
     flags |= MQTT_CONNECT_FLAG_WILL;
@@ -1384,7 +1877,7 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
     len = strlen(client_info->will_msg);
     LWIP_ERROR("mqtt_client_connect: client_info->will_msg length overflow", len <= 0xFF, return ERR_VAL);
     will_msg_len = (u8_t)len;
-    len = remaining_length + 2 + will_topic_len + 2 + will_msg_len;
+    len = remaining_length + 2 + will_topic_len + 2 + will_msg_len + ((level == MQTT_VERSION_5) ? 1 : 0);
     LWIP_ERROR("mqtt_client_connect: remaining_length overflow", len <= 0xFFFF, return ERR_VAL);
     remaining_length = (u16_t)len;
   }
@@ -1409,8 +1902,10 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
     remaining_length = (u16_t)len;
   }
 
-  /* Don't complicate things, always connect using clean session */
-  flags |= MQTT_CONNECT_FLAG_CLEAN_SESSION;
+  /* Resume the session kept by the server only if asked to */
+  if (!client_info->keep_session) {
+    flags |= MQTT_CONNECT_FLAG_CLEAN_SESSION;
+  }
 
   len = strlen(client_info->client_id);
   LWIP_ERROR("mqtt_client_connect: client_info->client_id length overflow", len <= 0xFFFF, return ERR_VAL);
@@ -1420,18 +1915,29 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
   remaining_length = (u16_t)len;
 
   if (mqtt_output_check_space(&client->output, remaining_length) == 0) {
+    mqtt5_release(client);
     return ERR_MEM;
   }
 
 #if LWIP_ALTCP && LWIP_ALTCP_TLS
   if (client_info->tls_config) {
     client->conn = altcp_tls_new(client_info->tls_config, IP_GET_TYPE(ip_addr));
+#if LWIP_ALTCP_TLS_MBEDTLS
+    /* The handshake starts once TCP is connected, offer the session before that */
+    if ((client->conn != NULL) && (client_info->tls_session != NULL)) {
+      if (mbedtls_ssl_set_session((mbedtls_ssl_context *)altcp_tls_context(client->conn),
+                                  (const mbedtls_ssl_session *)client_info->tls_session) != 0) {
+        LWIP_DEBUGF(MQTT_DEBUG_WARN, ("mqtt_client_connect: TLS session not offered, full handshake\n"));
+      }
+    }
+#endif
   } else
 #endif
   {
     client->conn = altcp_tcp_new_ip_type(IP_GET_TYPE(ip_addr));
   }
   if (client->conn == NULL) {
+    mqtt5_release(client);
     return ERR_MEM;
   }
   altcp_nagle_disable(client->conn);
@@ -1468,15 +1974,32 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
   /* Append Protocol string */
   mqtt_output_append_string(&client->output, "MQTT", 4);
   /* Append Protocol level */
-  mqtt_output_append_u8(&client->output, 4);
+  mqtt_output_append_u8(&client->output, level);
   /* Append connect flags */
   mqtt_output_append_u8(&client->output, flags);
   /* Append keep-alive */
   mqtt_output_append_u16(&client->output, client_info->keep_alive);
+  /* Append MQTT 5 properties */
+  if (level == MQTT_VERSION_5) {
+    mqtt_output_append_varint(&client->output, props_len);
+    if (client_info->keep_session) {
+      /* Without it an MQTT 5 session ends with the connection */
+      mqtt_output_append_u8(&client->output, MQTT5_PROP_SESSION_EXPIRY);
+      mqtt_output_append_u32(&client->output, MQTT5_SESSION_EXPIRY);
+    }
+    if (client_info->max_packet_size != 0) {
+      mqtt_output_append_u8(&client->output, MQTT5_PROP_MAX_PACKET_SIZE);
+      mqtt_output_append_u32(&client->output, client_info->max_packet_size);
+    }
+  }
   /* Append client id */
   mqtt_output_append_string(&client->output, client_info->client_id, client_id_length);
   /* Append will message if used */
   if ((flags & MQTT_CONNECT_FLAG_WILL) != 0) {
+    if (level == MQTT_VERSION_5) {
+      /* Empty will properties */
+      mqtt_output_append_u8(&client->output, 0);
+    }
     mqtt_output_append_string(&client->output, client_info->will_topic, will_topic_len);
     mqtt_output_append_string(&client->output, client_info->will_msg, will_msg_len);
   }
@@ -1493,6 +2016,7 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
 tcp_fail:
   altcp_abort(client->conn);
   client->conn = NULL;
+  mqtt5_release(client);
   return err;
 }
 
@@ -1529,4 +2053,80 @@ mqtt_client_is_connected(mqtt_client_t *client)
   return client->conn_state == MQTT_CONNECTED;
 }
 
+/**
+ * @ingroup mqtt
+ * Check if the server resumed a kept session
+ * @param client MQTT client
+ * @return 1 if the CONNACK has session present set, 0 otherwise
+ *
+ * Only valid in the connection callback reporting MQTT_CONNECT_ACCEPTED,
+ * the CONNACK is still in the receive buffer at that time.
+ */
+u8_t
+mqtt_client_session_present(mqtt_client_t *client)
+{
+  u8_t fixed_hdr_len = 1;
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("mqtt_client_session_present: client != NULL", client);
+  if (MQTT_CTL_PACKET_TYPE(client->rx_buffer[0]) != MQTT_MSG_TYPE_CONNACK) {
+    return 0;
+  }
+  /* Skip the remaining length, MQTT 5 properties make it span several bytes */
+  while ((client->rx_buffer[fixed_hdr_len] & 0x80) != 0) {
+    fixed_hdr_len++;
+    if (fixed_hdr_len >= 5) {
+      return 0;
+    }
+  }
+  fixed_hdr_len++;
+  if (fixed_hdr_len >= client->msg_idx) {
+    return 0;
+  }
+  /* Acknowledge flags follow the fixed header */
+  return (client->rx_buffer[fixed_hdr_len] & MQTT_CONNACK_FLAG_SESSION_PRESENT) != 0;
+}
+
+/**
+ * @ingroup mqtt
+ * Number of QoS 1 and 2 PUBLISH the server accepts before acknowledging
+ * @param client MQTT client
+ * @return Send quota from the MQTT 5 Receive Maximum of the server, 0xFFFF for MQTT 3.1.1
+ *
+ * mqtt_publish returns ERR_WOULDBLOCK for QoS 1 and 2 when it is 0.
+ */
+u16_t
+mqtt_client_send_quota(mqtt_client_t *client)
+{
+  struct mqtt5_state *s;
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("mqtt_client_send_quota: client != NULL", client);
+  s = mqtt5_get(client);
+  return (s != NULL) ? mqtt5_send_quota(client, s) : 0xFFFF;
+}
+
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+/**
+ * @ingroup mqtt
+ * Copy the TLS session of the connection, to resume it on the next connect
+ * @param client MQTT client connected with a tls_config
+ * @param session mbedtls_ssl_session to copy to, initialized by the caller
+ * @return ERR_OK if copied, ERR_CONN if not connected, ERR_VAL if the copy failed
+ */
+err_t
+mqtt_client_tls_session_get(mqtt_client_t *client, void *session)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("mqtt_client_tls_session_get: client != NULL", client);
+  LWIP_ASSERT("mqtt_client_tls_session_get: session != NULL", session);
+  if ((client->conn == NULL) || (client->conn_state != MQTT_CONNECTED)) {
+    return ERR_CONN;
+  }
+  if (mbedtls_ssl_get_session((const mbedtls_ssl_context *)altcp_tls_context(client->conn),
+                              (mbedtls_ssl_session *)session) != 0) {
+    return ERR_VAL;
+  }
+  return ERR_OK;
+}
+#endif
+
 #endif /* LWIP_TCP && LWIP_CALLBACK_API */
@@ -59,6 +59,13 @@ struct altcp_tls_config;
  * Default MQTT TLS port */
 #define MQTT_TLS_PORT LWIP_IANA_PORT_SECURE_MQTT
 
+/** @ingroup mqtt
+ * Protocol level of MQTT 3.1.1 */
+#define MQTT_VERSION_3_1_1  4
+/** @ingroup mqtt
+ * Protocol level of MQTT 5 */
+#define MQTT_VERSION_5      5
+
 /*---------------------------------------------------------------------------------------------- */
 /* Connection with server */
 
@@ -86,7 +93,17 @@ struct mqtt_connect_client_info_t {
 #if LWIP_ALTCP && LWIP_ALTCP_TLS
   /** TLS configuration for secure connections */
   struct altcp_tls_config *tls_config;
+  /** TLS session to resume (mbedtls_ssl_session with LWIP_ALTCP_TLS_MBEDTLS),
+      NULL for a full handshake */
+  void *tls_session;
 #endif
+  /** 1 to connect with clean session 0 and resume the session kept by the server,
+      0 to always start a clean session */
+  u8_t keep_session;
+  /** MQTT_VERSION_5 to connect with MQTT 5, MQTT_VERSION_3_1_1 or 0 for MQTT 3.1.1 */
+  u8_t protocol_version;
+  /** MQTT 5 Maximum Packet Size the client accepts, 0 for no limit */
+  u32_t max_packet_size;
 };
 
 /**
@@ -168,7 +185,8 @@ typedef void (*mqtt_incoming_publish_cb_t)(void *arg, const char *topic, u32_t t
  * @param arg Pointer to user data supplied when invoking request
  * @param err ERR_OK on success
  *            ERR_TIMEOUT if no response was received within timeout,
- *            ERR_ABRT if (un)subscribe was denied
+ *            ERR_ABRT if (un)subscribe was denied,
+ *            ERR_CONN if the connection was closed before the response
  */
 typedef void (*mqtt_request_cb_t)(void *arg, err_t err);
 
@@ -182,6 +200,11 @@ mqtt_client_t *mqtt_client_new(void);
 void mqtt_client_free(mqtt_client_t* client);
 
 u8_t mqtt_client_is_connected(mqtt_client_t *client);
+u8_t mqtt_client_session_present(mqtt_client_t *client);
+u16_t mqtt_client_send_quota(mqtt_client_t *client);
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+err_t mqtt_client_tls_session_get(mqtt_client_t *client, void *session);
+#endif
 
 void mqtt_set_inpub_callback(mqtt_client_t *client, mqtt_incoming_publish_cb_t,
                              mqtt_incoming_data_cb_t data_cb, void *arg);